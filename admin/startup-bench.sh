@@ -0,0 +1,201 @@
+#! /bin/sh
+# Copyright (c) 2026 The NetBSD Foundation, Inc.
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+# 1. Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+# 2. Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#
+# THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+# CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+# INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+# IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+# DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+# DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+# GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+# INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+# IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+# OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+
+#
+# A benchmark that measures how long it takes to start a test program
+# linked against the shared libraries and one linked against their static
+# variant, both for the C and the C++ bindings.  Uses the installed
+# pkg-config files, so PKG_CONFIG_PATH must point to them.
+#
+
+Prog_Name=${0##*/}
+
+Iterations=1000
+
+#
+# err message
+#
+err() {
+    echo "${Prog_Name}: ${@}" 1>&2
+    exit 1
+}
+
+#
+# usage
+#
+usage() {
+    echo "Usage: ${Prog_Name} [-n iterations]" 1>&2
+    exit 1
+}
+
+#
+# write_sources dir
+#
+# Writes a minimal C and C++ test program, and a launcher that runs a
+# program repeatedly and reports the time each run took.
+#
+write_sources() {
+    cat >"${1}/tp.c" <<EOS
+#include <atf-c.h>
+
+ATF_TC_WITHOUT_HEAD(tc);
+ATF_TC_BODY(tc, tc) {
+}
+
+ATF_TP_ADD_TCS(tp) {
+    ATF_TP_ADD_TC(tp, tc);
+    return atf_no_error();
+}
+EOS
+
+    cat >"${1}/tp.cpp" <<EOS
+#include <atf-c++.hpp>
+
+ATF_TEST_CASE_WITHOUT_HEAD(tc);
+ATF_TEST_CASE_BODY(tc) {
+}
+
+ATF_INIT_TEST_CASES(tcs) {
+    ATF_ADD_TEST_CASE(tcs, tc);
+}
+EOS
+
+    cat >"${1}/launch.c" <<EOS
+#include <sys/wait.h>
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+static int
+compare(const void *a, const void *b)
+{
+    const double x = *(const double *)a, y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+int
+main(int argc, char **argv)
+{
+    const int n = atoi(argv[1]);
+    double *usecs = malloc(sizeof(double) * n), total = 0;
+    int i;
+
+    for (i = 0; i < n; i++) {
+        struct timespec start, end;
+        int status;
+        pid_t pid;
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        pid = fork();
+        if (pid == 0) {
+            const int fd = open("/dev/null", O_WRONLY);
+            dup2(fd, STDOUT_FILENO);
+            dup2(fd, STDERR_FILENO);
+            execv(argv[2], argv + 2);
+            _exit(127);
+        }
+        waitpid(pid, &status, 0);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            fprintf(stderr, "%s failed\n", argv[2]);
+            return EXIT_FAILURE;
+        }
+
+        usecs[i] = (end.tv_sec - start.tv_sec) * 1e6 +
+                   (end.tv_nsec - start.tv_nsec) / 1e3;
+        total += usecs[i];
+    }
+
+    qsort(usecs, n, sizeof(double), compare);
+    printf("%10.1f %10.1f %10.1f\n", total / n, usecs[n / 2],
+           usecs[n * 99 / 100]);
+    return EXIT_SUCCESS;
+}
+EOS
+}
+
+#
+# build compiler source output package
+#
+build() {
+    cflags=$(pkg-config --cflags "${4}") || exit 1
+    libs=$(pkg-config --libs "${4}") || exit 1
+    ${1} ${cflags} -O2 -o "${3}" "${2}" ${libs} || \
+        err "Failed to build ${3} against ${4}"
+}
+
+#
+# main [-n iterations]
+#
+main() {
+    while getopts ':n:' arg "${@}"; do
+        case ${arg} in
+            n)
+                Iterations=${OPTARG}
+                ;;
+            *)
+                usage
+                ;;
+        esac
+    done
+    shift $((${OPTIND} - 1))
+    [ ${#} -eq 0 ] || usage
+
+    for pc in atf-c atf-c-static atf-c++ atf-c++-static; do
+        pkg-config --exists ${pc} || err "pkg-config cannot find ${pc}.pc"
+    done
+    cc=$(pkg-config --variable=cc atf-c)
+    cxx=$(pkg-config --variable=cxx atf-c++)
+
+    dir=$(mktemp -d "${TMPDIR:-/tmp}/startup-bench.XXXXXX") || exit 1
+    trap "rm -rf '${dir}'" EXIT
+
+    write_sources "${dir}"
+    ${cc} -O2 -o "${dir}/launch" "${dir}/launch.c" || \
+        err "Failed to build the launcher"
+    build "${cc}" "${dir}/tp.c" "${dir}/c-shared" atf-c
+    build "${cc}" "${dir}/tp.c" "${dir}/c-static" atf-c-static
+    build "${cxx}" "${dir}/tp.cpp" "${dir}/cxx-shared" atf-c++
+    build "${cxx}" "${dir}/tp.cpp" "${dir}/cxx-static" atf-c++-static
+
+    libdir=$(pkg-config --variable=libdir atf-c)
+    LD_LIBRARY_PATH="${libdir}${LD_LIBRARY_PATH:+:${LD_LIBRARY_PATH}}"
+    DYLD_LIBRARY_PATH="${libdir}${DYLD_LIBRARY_PATH:+:${DYLD_LIBRARY_PATH}}"
+    export LD_LIBRARY_PATH DYLD_LIBRARY_PATH
+
+    echo "Startup latency over ${Iterations} runs of 'tp -l', in microseconds"
+    printf '%-12s %10s %10s %10s\n' program mean p50 p99
+    for tp in c-shared c-static cxx-shared cxx-static; do
+        printf '%-12s ' ${tp}
+        "${dir}/launch" ${Iterations} "${dir}/${tp}" -l || exit 1
+    done
+}
+
+main "${@}"
+
+# vim: syntax=sh:expandtab:shiftwidth=4:softtabstop=4
@@ -39,6 +39,50 @@ extern "C" {
 namespace impl = atf::check;
 #define IMPL_NAME "atf::check"
 
+// ------------------------------------------------------------------------
+// The "capture" class.
+// ------------------------------------------------------------------------
+
+impl::capture::capture(atf_check_capture_type type, const std::string& path) :
+    m_type(type),
+    m_path(path)
+{
+}
+
+impl::capture
+impl::capture::file(void)
+{
+    return capture(atf_check_capture_file, "");
+}
+
+impl::capture
+impl::capture::discard(void)
+{
+    return capture(atf_check_capture_discard, "");
+}
+
+impl::capture
+impl::capture::probe(void)
+{
+    return capture(atf_check_capture_probe, "");
+}
+
+impl::capture
+impl::capture::path(const std::string& path)
+{
+    return capture(atf_check_capture_path, path);
+}
+
+atf_check_capture_t
+impl::capture::c_capture(void)
+    const
+{
+    atf_check_capture_t c;
+    c.m_type = m_type;
+    c.m_path = m_type == atf_check_capture_path ? m_path.c_str() : NULL;
+    return c;
+}
+
 // ------------------------------------------------------------------------
 // The "check_result" class.
 // ------------------------------------------------------------------------
@@ -83,6 +127,34 @@ impl::check_result::termsig(void)
     return atf_check_result_termsig(&m_result);
 }
 
+unsigned long long
+impl::check_result::wall_usecs(void)
+    const
+{
+    return atf_check_result_wall_usecs(&m_result);
+}
+
+unsigned long long
+impl::check_result::user_usecs(void)
+    const
+{
+    return atf_check_result_user_usecs(&m_result);
+}
+
+unsigned long long
+impl::check_result::system_usecs(void)
+    const
+{
+    return atf_check_result_system_usecs(&m_result);
+}
+
+unsigned long long
+impl::check_result::maxrss_kib(void)
+    const
+{
+    return atf_check_result_maxrss_kib(&m_result);
+}
+
 const std::string
 impl::check_result::stdout_path(void) const
 {
@@ -152,3 +224,20 @@ impl::exec(const atf::process::argv_array& argva)
 
     return std::auto_ptr< impl::check_result >(new impl::check_result(&result));
 }
+
+std::auto_ptr< impl::check_result >
+impl::exec(const atf::process::argv_array& argva, const capture& out,
+           const capture& err)
+{
+    atf_check_result_t result;
+
+    const atf_check_capture_t outcap = out.c_capture();
+    const atf_check_capture_t errcap = err.c_capture();
+    atf_error_t error = atf_check_exec_array_capture(argva.exec_argv(),
+                                                     &outcap, &errcap,
+                                                     &result);
+    if (atf_is_error(error))
+        throw_atf_error(error);
+
+    return std::auto_ptr< impl::check_result >(new impl::check_result(&result));
+}
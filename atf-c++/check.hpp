@@ -43,6 +43,48 @@ class argv_array;
 
 namespace check {
 
+// ------------------------------------------------------------------------
+// The "capture" class.
+// ------------------------------------------------------------------------
+
+//!
+//! \brief Describes what exec does with one of the command's output
+//! streams.
+//!
+class capture {
+    atf_check_capture_type m_type;
+    std::string m_path;
+
+    capture(atf_check_capture_type, const std::string&);
+
+public:
+    //!
+    //! \brief Stores the whole stream in a temporary file.
+    //!
+    static capture file(void);
+
+    //!
+    //! \brief Sends the stream to /dev/null.
+    //!
+    static capture discard(void);
+
+    //!
+    //! \brief Stores the first bytes of the stream and discards the rest.
+    //!
+    static capture probe(void);
+
+    //!
+    //! \brief Stores the whole stream in the given path.
+    //!
+    static capture path(const std::string&);
+
+    //!
+    //! \brief Returns the C representation of this object, which is only
+    //! valid as long as this object is alive.
+    //!
+    atf_check_capture_t c_capture(void) const;
+};
+
 // ------------------------------------------------------------------------
 // The "check_result" class.
 // ------------------------------------------------------------------------
@@ -72,6 +114,9 @@ class check_result {
 
     friend check_result test_constructor(const char* const*);
     friend std::auto_ptr< check_result > exec(const atf::process::argv_array&);
+    friend std::auto_ptr< check_result > exec(const atf::process::argv_array&,
+                                              const capture&,
+                                              const capture&);
 
 public:
     //!
@@ -99,6 +144,28 @@ public:
     //!
     int termsig(void) const;
 
+    //!
+    //! \brief Returns the wall-clock time the command took, in microseconds.
+    //!
+    unsigned long long wall_usecs(void) const;
+
+    //!
+    //! \brief Returns the user CPU time consumed by the command, in
+    //! microseconds.
+    //!
+    unsigned long long user_usecs(void) const;
+
+    //!
+    //! \brief Returns the system CPU time consumed by the command, in
+    //! microseconds.
+    //!
+    unsigned long long system_usecs(void) const;
+
+    //!
+    //! \brief Returns the command's maximum resident set size, in KiB.
+    //!
+    unsigned long long maxrss_kib(void) const;
+
     //!
     //! \brief Returns the path to file contaning command's stdout.
     //!
@@ -121,6 +188,8 @@ bool build_cpp(const std::string&, const std::string&,
 bool build_cxx_o(const std::string&, const std::string&,
                  const atf::process::argv_array&);
 std::auto_ptr< check_result > exec(const atf::process::argv_array&);
+std::auto_ptr< check_result > exec(const atf::process::argv_array&,
+                                   const capture&, const capture&);
 
 // Useful for testing only.
 check_result test_constructor(void);
@@ -313,6 +313,40 @@ check_lines(const std::string& path, const char* outname,
                     resname);
 }
 
+ATF_TEST_CASE(exec_capture);
+ATF_TEST_CASE_HEAD(exec_capture)
+{
+    set_md_var("descr", "Tests that exec honors the requested capture of "
+               "each stream");
+}
+ATF_TEST_CASE_BODY(exec_capture)
+{
+    std::vector< std::string > argv;
+    argv.push_back(get_process_helpers_path(*this, false).str());
+    argv.push_back("stdout-stderr");
+    argv.push_back("result");
+    atf::process::argv_array argva(argv);
+
+    {
+        std::auto_ptr< atf::check::check_result > r =
+            atf::check::exec(argva, atf::check::capture::discard(),
+                             atf::check::capture::path("saved"));
+        ATF_REQUIRE(r->exited());
+        ATF_REQUIRE_EQ("/dev/null", r->stdout_path());
+        ATF_REQUIRE_EQ("saved", r->stderr_path());
+    }
+    check_lines("saved", "stderr", "result");
+
+    {
+        std::auto_ptr< atf::check::check_result > r =
+            atf::check::exec(argva, atf::check::capture::probe(),
+                             atf::check::capture::file());
+        ATF_REQUIRE(r->exited());
+        check_lines(r->stdout_path(), "stdout", "result");
+        check_lines(r->stderr_path(), "stderr", "result");
+    }
+}
+
 ATF_TEST_CASE(exec_stdout_stderr);
 ATF_TEST_CASE_HEAD(exec_stdout_stderr)
 {
@@ -387,6 +421,7 @@ ATF_INIT_TEST_CASES(tcs)
     ATF_ADD_TEST_CASE(tcs, build_c_o);
     ATF_ADD_TEST_CASE(tcs, build_cpp);
     ATF_ADD_TEST_CASE(tcs, build_cxx_o);
+    ATF_ADD_TEST_CASE(tcs, exec_capture);
     ATF_ADD_TEST_CASE(tcs, exec_cleanup);
     ATF_ADD_TEST_CASE(tcs, exec_exitstatus);
     ATF_ADD_TEST_CASE(tcs, exec_stdout_stderr);
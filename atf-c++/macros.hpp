@@ -31,6 +31,7 @@
 #include <vector>
 
 #include <atf-c++/tests.hpp>
+#include <atf-c++/utils.hpp>
 
 // Do not define inline methods for the test case classes.  Doing so
 // significantly increases the memory requirements of GNU G++ during
@@ -75,6 +76,18 @@
 #define ATF_TEST_CASE_NAME(name) atfu_tc_ ## name
 #define ATF_TEST_CASE_USE(name) (atfu_tcptr_ ## name) = NULL
 
+#define ATF_FUZZ_TEST_CASE(name) \
+    namespace { \
+    class atfu_tc_ ## name : public atf::tests::fuzz_tc { \
+        void head(void); \
+        void fuzz_body(const void*, const std::size_t) const; \
+    public: \
+        atfu_tc_ ## name(void); \
+    }; \
+    static atfu_tc_ ## name* atfu_tcptr_ ## name; \
+    atfu_tc_ ## name::atfu_tc_ ## name(void) : atf::tests::fuzz_tc(#name) {} \
+    }
+
 #define ATF_TEST_CASE_HEAD(name) \
     void \
     atfu_tc_ ## name::head(void)
@@ -84,6 +97,11 @@
     atfu_tc_ ## name::body(void) \
         const
 
+#define ATF_FUZZ_TEST_CASE_BODY(name, data, size) \
+    void \
+    atfu_tc_ ## name::fuzz_body(const void* data, const std::size_t size) \
+        const
+
 #define ATF_TEST_CASE_CLEANUP(name) \
     void \
     atfu_tc_ ## name::cleanup(void) \
@@ -196,6 +214,70 @@
     atf::tests::tc::require_errno(__FILE__, __LINE__, expected_errno, \
                                   #bool_expr, bool_expr)
 
+#define ATF_CHECK_ALLOCS_AT_MOST(max) \
+    for (atf::utils::alloc_scope atfu_alloc_scope(__FILE__, __LINE__); \
+         atfu_alloc_scope.active(); \
+         atfu_alloc_scope.end(__FILE__, __LINE__, (max), false))
+
+#define ATF_REQUIRE_ALLOCS_AT_MOST(max) \
+    for (atf::utils::alloc_scope atfu_alloc_scope(__FILE__, __LINE__); \
+         atfu_alloc_scope.active(); \
+         atfu_alloc_scope.end(__FILE__, __LINE__, (max), true))
+
+#define ATF_CHECK_NO_ALLOCS ATF_CHECK_ALLOCS_AT_MOST(0)
+
+#define ATF_REQUIRE_NO_ALLOCS ATF_REQUIRE_ALLOCS_AT_MOST(0)
+
+#define ATF_CHECK_IO_WITHIN(budget) \
+    for (atf::utils::io_scope atfu_io_scope(budget); \
+         atfu_io_scope.active(); \
+         atfu_io_scope.end(__FILE__, __LINE__, false))
+
+#define ATF_REQUIRE_IO_WITHIN(budget) \
+    for (atf::utils::io_scope atfu_io_scope(budget); \
+         atfu_io_scope.active(); \
+         atfu_io_scope.end(__FILE__, __LINE__, true))
+
+#define ATF_CHECK_READS_AT_MOST(calls, bytes) \
+    ATF_CHECK_IO_WITHIN(atf::utils::io_budget((calls), (bytes), \
+                                              atf::utils::io_unlimited, \
+                                              atf::utils::io_unlimited))
+
+#define ATF_REQUIRE_READS_AT_MOST(calls, bytes) \
+    ATF_REQUIRE_IO_WITHIN(atf::utils::io_budget((calls), (bytes), \
+                                                atf::utils::io_unlimited, \
+                                                atf::utils::io_unlimited))
+
+#define ATF_CHECK_WRITES_AT_MOST(calls, bytes) \
+    ATF_CHECK_IO_WITHIN(atf::utils::io_budget(atf::utils::io_unlimited, \
+                                              atf::utils::io_unlimited, \
+                                              (calls), (bytes)))
+
+#define ATF_REQUIRE_WRITES_AT_MOST(calls, bytes) \
+    ATF_REQUIRE_IO_WITHIN(atf::utils::io_budget(atf::utils::io_unlimited, \
+                                                atf::utils::io_unlimited, \
+                                                (calls), (bytes)))
+
+#define ATF_CHECK_PERCENTILE_BELOW(hist, percentile, value) \
+    atf::utils::check_percentile_below(__FILE__, __LINE__, (hist), \
+                                       (percentile), (value), false)
+
+#define ATF_REQUIRE_PERCENTILE_BELOW(hist, percentile, value) \
+    atf::utils::check_percentile_below(__FILE__, __LINE__, (hist), \
+                                       (percentile), (value), true)
+
+#define ATF_CHECK_P50_BELOW(hist, value) \
+    ATF_CHECK_PERCENTILE_BELOW(hist, 50.0, value)
+
+#define ATF_REQUIRE_P50_BELOW(hist, value) \
+    ATF_REQUIRE_PERCENTILE_BELOW(hist, 50.0, value)
+
+#define ATF_CHECK_P99_BELOW(hist, value) \
+    ATF_CHECK_PERCENTILE_BELOW(hist, 99.0, value)
+
+#define ATF_REQUIRE_P99_BELOW(hist, value) \
+    ATF_REQUIRE_PERCENTILE_BELOW(hist, 99.0, value)
+
 #define ATF_INIT_TEST_CASES(tcs) \
     namespace atf { \
         namespace tests { \
@@ -98,6 +98,7 @@ atf_require_errno_semicolons(void)
 #define TEST_MACRO_1 invalid + name
 #define TEST_MACRO_2 invalid + name
 #define TEST_MACRO_3 invalid + name
+#define TEST_MACRO_4 invalid + name
 ATF_TEST_CASE(TEST_MACRO_1);
 ATF_TEST_CASE_HEAD(TEST_MACRO_1) { }
 ATF_TEST_CASE_BODY(TEST_MACRO_1) { }
@@ -124,3 +125,11 @@ void instatiate_3(void) {
     atf::tests::tc* the_test = new ATF_TEST_CASE_NAME(TEST_MACRO_3)();
     delete the_test;
 }
+ATF_FUZZ_TEST_CASE(TEST_MACRO_4);
+ATF_TEST_CASE_HEAD(TEST_MACRO_4) { }
+ATF_FUZZ_TEST_CASE_BODY(TEST_MACRO_4, data, size) { if (data && size) { } }
+void instatiate_4(void) {
+    ATF_TEST_CASE_USE(TEST_MACRO_4);
+    atf::tests::tc* the_test = new ATF_TEST_CASE_NAME(TEST_MACRO_4)();
+    delete the_test;
+}
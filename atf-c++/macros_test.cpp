@@ -26,12 +26,15 @@
 #include "atf-c++/macros.hpp"
 
 extern "C" {
+#include <sys/stat.h>
+
 #include <fcntl.h>
 #include <unistd.h>
 }
 
 #include <cerrno>
 #include <cstdlib>
+#include <fstream>
 #include <iostream>
 #include <stdexcept>
 
@@ -277,6 +280,23 @@ ATF_TEST_CASE_BODY(h_require_errno)
     create_ctl_file("after");
 }
 
+ATF_FUZZ_TEST_CASE(h_fuzz);
+ATF_TEST_CASE_HEAD(h_fuzz)
+{
+    set_md_var("descr", "Helper test case");
+}
+ATF_FUZZ_TEST_CASE_BODY(h_fuzz, data, size)
+{
+    const std::string input(static_cast< const char* >(data), size);
+    if (get_config_var("what") == "record") {
+        std::ofstream os("seen", std::ios::app);
+        os << input << "\n";
+    } else {
+        if (input.find('!') != std::string::npos)
+            ATF_FAIL("Input has a bang");
+    }
+}
+
 // ------------------------------------------------------------------------
 // Test cases for the macros.
 // ------------------------------------------------------------------------
@@ -751,6 +771,35 @@ ATF_TEST_CASE_BODY(require_errno)
     }
 }
 
+ATF_TEST_CASE(fuzz);
+ATF_TEST_CASE_HEAD(fuzz)
+{
+    set_md_var("descr", "Tests the ATF_FUZZ_TEST_CASE macro");
+}
+ATF_TEST_CASE_BODY(fuzz)
+{
+    atf::tests::vars_map config;
+    config["srcdir"] = ".";
+    config["what"] = "record";
+
+    ATF_REQUIRE(::mkdir("h_fuzz.corpus", 0755) != -1);
+    atf::utils::create_file("h_fuzz.corpus/2", "second");
+    atf::utils::create_file("h_fuzz.corpus/1", "first");
+
+    ATF_TEST_CASE_USE(h_fuzz);
+    run_h_tc< ATF_TEST_CASE_NAME(h_fuzz) >(config);
+    ATF_REQUIRE(atf::utils::grep_file("^passed", "result"));
+    ATF_REQUIRE(atf::utils::compare_file("seen", "first\nsecond\n"));
+
+    config["what"] = "reject";
+    config["fuzz"] = "true";
+    config["fuzz.iterations"] = "100000";
+    run_h_tc< ATF_TEST_CASE_NAME(h_fuzz) >(config);
+    ATF_REQUIRE(atf::utils::grep_file("^failed: Fuzzing found an input that "
+                                      "failed: .*Input has a bang; saved it "
+                                      "to \\./h_fuzz\\.corpus/crash-", "result"));
+}
+
 // ------------------------------------------------------------------------
 // Tests cases for the header file.
 // ------------------------------------------------------------------------
@@ -804,6 +853,7 @@ ATF_INIT_TEST_CASES(tcs)
     ATF_ADD_TEST_CASE(tcs, require_throw);
     ATF_ADD_TEST_CASE(tcs, require_throw_re);
     ATF_ADD_TEST_CASE(tcs, require_errno);
+    ATF_ADD_TEST_CASE(tcs, fuzz);
 
     // Add the test cases for the header file.
     ATF_ADD_TEST_CASE(tcs, use);
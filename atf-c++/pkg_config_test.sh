@@ -134,10 +134,65 @@ EOF
               "LD_LIBRARY_PATH=${libpath} ./tp tc"
 }
 
+atf_test_case build_static
+build_static_head()
+{
+    atf_set "descr" "Checks that a test program can be built against" \
+                    "the static variant of the C++ library, with and" \
+                    "without link-time optimization"
+    atf_set "require.progs" "pkg-config"
+}
+build_static_body()
+{
+    pkg-config atf-c++-static || atf_skip "The static variant was not built"
+
+    atf_check -s eq:0 -o save:stdout -e empty \
+              pkg-config --variable=cxx atf-c++
+    cxx=$(cat stdout)
+    echo "Compiler is: ${cxx}"
+    atf_require_prog ${cxx}
+
+    cat >tp.cpp <<EOF
+#include <iostream>
+
+#include <atf-c++.hpp>
+
+ATF_TEST_CASE_WITHOUT_HEAD(tc);
+ATF_TEST_CASE_BODY(tc) {
+    std::cout << "Running\n";
+}
+
+ATF_INIT_TEST_CASES(tcs) {
+    ATF_ADD_TEST_CASE(tcs, tc);
+}
+EOF
+
+    atf_check -s eq:0 -o save:stdout -e empty \
+              pkg-config --cflags atf-c++-static
+    cxxflags=$(cat stdout)
+    atf_check -s eq:0 -o save:stdout -e empty pkg-config --libs atf-c++-static
+    libs=$(cat stdout)
+    echo "LIBS are: ${libs}"
+
+    # The program must not need the shared libraries at run time, so it is
+    # run without pointing the dynamic loader at them.
+    atf_check -s eq:0 -o empty -e empty \
+              ${cxx} ${cxxflags} -o tp tp.cpp ${libs}
+    atf_check -s eq:0 -o match:'Running' -e ignore ./tp tc
+
+    if ${cxx} -flto ${cxxflags} -o lto tp.cpp ${libs} >/dev/null 2>&1
+    then
+        atf_check -s eq:0 -o match:'Running' -e ignore ./lto tc
+    else
+        echo "The compiler cannot do link-time optimization; skipping"
+    fi
+}
+
 atf_init_test_cases()
 {
     atf_add_test_case version
     atf_add_test_case build
+    atf_add_test_case build_static
 }
 
 # vim: syntax=sh:expandtab:shiftwidth=4:softtabstop=4
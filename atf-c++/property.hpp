@@ -0,0 +1,730 @@
+// Copyright (c) 2026 The NetBSD Foundation, Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+// CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+// INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+// IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+// IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+// IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#if !defined(ATF_CXX_PROPERTY_HPP)
+#define ATF_CXX_PROPERTY_HPP
+
+#include <cerrno>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <limits>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <atf-c++/tests.hpp>
+
+//
+// Generators produce the inputs of a property and know how to shrink them.
+// They provide:
+//
+//   value_type: the type of the values they produce.
+//   void generate(random&, value_type&) const: stores a new value into its
+//       second argument, reusing the storage it already has.
+//   std::size_t shrinks(const value_type&) const: returns the number of
+//       smaller candidates of a value, simplest first.
+//   bool shrink(const value_type&, std::size_t, value_type&) const: stores
+//       the given candidate into its third argument; returns false if the
+//       candidate is not valid and has to be skipped.
+//
+// Values are generated into the same objects over and over, so that a run
+// does not allocate memory once the values have grown to their final size.
+//
+
+namespace atf {
+namespace property {
+
+class random {
+    std::uint64_t m_state;
+
+public:
+    explicit random(const std::uint64_t seed) :
+        m_state(seed)
+    {
+    }
+
+    std::uint64_t
+    next(void)
+    {
+        // splitmix64.
+        std::uint64_t z = (m_state += UINT64_C(0x9e3779b97f4a7c15));
+        z = (z ^ (z >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+        z = (z ^ (z >> 27)) * UINT64_C(0x94d049bb133111eb);
+        return z ^ (z >> 31);
+    }
+
+    std::uint64_t
+    below(const std::uint64_t bound)
+    {
+        return bound == 0 ? 0 : next() % bound;
+    }
+};
+
+// ------------------------------------------------------------------------
+// Generators for primitive types.
+// ------------------------------------------------------------------------
+
+template< typename T >
+class integers {
+    T m_min;
+    T m_max;
+    T m_target;
+
+    std::uint64_t
+    distance(const T value)
+        const
+    {
+        return value >= m_target ?
+            static_cast< std::uint64_t >(value) -
+            static_cast< std::uint64_t >(m_target) :
+            static_cast< std::uint64_t >(m_target) -
+            static_cast< std::uint64_t >(value);
+    }
+
+public:
+    typedef T value_type;
+
+    integers(const T min = std::numeric_limits< T >::min(),
+             const T max = std::numeric_limits< T >::max()) :
+        m_min(min),
+        m_max(max),
+        m_target(min > T(0) ? min : (max < T(0) ? max : T(0)))
+    {
+    }
+
+    void
+    generate(random& rng, value_type& out)
+        const
+    {
+        // Favor the boundaries of the range, where bugs tend to hide.
+        switch (rng.below(16)) {
+        case 0: out = m_min; return;
+        case 1: out = m_max; return;
+        case 2: out = m_target; return;
+        }
+
+        const std::uint64_t span = static_cast< std::uint64_t >(m_max) -
+            static_cast< std::uint64_t >(m_min);
+        const std::uint64_t offset = span == UINT64_MAX ?
+            rng.next() : rng.below(span + 1);
+        out = static_cast< T >(static_cast< std::uint64_t >(m_min) + offset);
+    }
+
+    std::size_t
+    shrinks(const value_type& value)
+        const
+    {
+        std::size_t count = 0;
+        for (std::uint64_t d = distance(value); d != 0; d >>= 1)
+            count++;
+        return count;
+    }
+
+    bool
+    shrink(const value_type& from, const std::size_t index, value_type& out)
+        const
+    {
+        // Candidates approach the value from the target: the target first,
+        // then halfway towards the value, and so on.
+        const std::uint64_t delta = distance(from) >> index;
+        if (from >= m_target)
+            out = static_cast< T >(static_cast< std::uint64_t >(from) - delta);
+        else
+            out = static_cast< T >(static_cast< std::uint64_t >(from) + delta);
+        return true;
+    }
+};
+
+class booleans {
+public:
+    typedef bool value_type;
+
+    void
+    generate(random& rng, value_type& out)
+        const
+    {
+        out = rng.below(2) == 1;
+    }
+
+    std::size_t
+    shrinks(const value_type& value)
+        const
+    {
+        return value ? 1 : 0;
+    }
+
+    bool
+    shrink(const value_type&, const std::size_t, value_type& out)
+        const
+    {
+        out = false;
+        return true;
+    }
+};
+
+template< typename T >
+class reals {
+    T m_min;
+    T m_max;
+    T m_target;
+
+public:
+    typedef T value_type;
+
+    reals(const T min, const T max) :
+        m_min(min),
+        m_max(max),
+        m_target(min > T(0) ? min : (max < T(0) ? max : T(0)))
+    {
+    }
+
+    void
+    generate(random& rng, value_type& out)
+        const
+    {
+        switch (rng.below(16)) {
+        case 0: out = m_min; return;
+        case 1: out = m_max; return;
+        case 2: out = m_target; return;
+        }
+
+        const T unit = static_cast< T >(rng.next() >> 11) /
+            static_cast< T >(UINT64_C(1) << 53);
+        out = m_min + (m_max - m_min) * unit;
+    }
+
+    std::size_t
+    shrinks(const value_type& value)
+        const
+    {
+        return value == m_target ? 0 : 3;
+    }
+
+    bool
+    shrink(const value_type& from, const std::size_t index, value_type& out)
+        const
+    {
+        switch (index) {
+        case 0: out = m_target; break;
+        case 1: out = std::trunc(from); break;
+        default: out = from - (from - m_target) / 2; break;
+        }
+        return out != from && out >= m_min && out <= m_max;
+    }
+};
+
+template< typename T >
+class elements {
+    std::vector< T > m_values;
+
+public:
+    typedef T value_type;
+
+    explicit elements(const std::vector< T >& values) :
+        m_values(values)
+    {
+    }
+
+    void
+    generate(random& rng, value_type& out)
+        const
+    {
+        out = m_values[rng.below(m_values.size())];
+    }
+
+    std::size_t
+    shrinks(const value_type& value)
+        const
+    {
+        // Values listed earlier are simpler.
+        for (std::size_t i = 0; i < m_values.size(); i++) {
+            if (m_values[i] == value)
+                return i;
+        }
+        return 0;
+    }
+
+    bool
+    shrink(const value_type&, const std::size_t index, value_type& out)
+        const
+    {
+        out = m_values[index];
+        return true;
+    }
+};
+
+// ------------------------------------------------------------------------
+// Generators for containers and combinators.
+// ------------------------------------------------------------------------
+
+template< class Container, class Generator >
+class sequences {
+    Generator m_element;
+    std::size_t m_min;
+    std::size_t m_max;
+
+    std::size_t
+    removable(const std::size_t length)
+        const
+    {
+        return length > m_min ? length - m_min : 0;
+    }
+
+public:
+    typedef Container value_type;
+
+    sequences(const Generator& element, const std::size_t min,
+              const std::size_t max) :
+        m_element(element),
+        m_min(min),
+        m_max(max)
+    {
+    }
+
+    void
+    generate(random& rng, value_type& out)
+        const
+    {
+        const std::size_t length = rng.below(16) == 0 ? m_min :
+            m_min + rng.below(m_max - m_min + 1);
+        out.resize(length);
+        for (std::size_t i = 0; i < length; i++)
+            m_element.generate(rng, out[i]);
+    }
+
+    std::size_t
+    shrinks(const value_type& value)
+        const
+    {
+        const std::size_t length = value.size();
+        std::size_t count = 0;
+        for (std::size_t chunk = removable(length); chunk > 0; chunk /= 2)
+            count += length / chunk;
+        for (std::size_t i = 0; i < length; i++)
+            count += m_element.shrinks(value[i]);
+        return count;
+    }
+
+    bool
+    shrink(const value_type& from, std::size_t index, value_type& out)
+        const
+    {
+        // Removing chunks of elements comes first, from the largest chunk
+        // down to single elements; shrinking the elements comes next.
+        const std::size_t length = from.size();
+        for (std::size_t chunk = removable(length); chunk > 0; chunk /= 2) {
+            if (index < length / chunk) {
+                const std::size_t offset = index * chunk;
+                out.assign(from.begin(), from.begin() + offset);
+                out.insert(out.end(), from.begin() + offset + chunk,
+                           from.end());
+                return true;
+            }
+            index -= length / chunk;
+        }
+        for (std::size_t i = 0; i < length; i++) {
+            const std::size_t count = m_element.shrinks(from[i]);
+            if (index < count) {
+                out = from;
+                return m_element.shrink(from[i], index, out[i]);
+            }
+            index -= count;
+        }
+        return false;
+    }
+};
+
+template< class First, class Second >
+class pairs {
+    First m_first;
+    Second m_second;
+
+public:
+    typedef std::pair< typename First::value_type,
+                       typename Second::value_type > value_type;
+
+    pairs(const First& first, const Second& second) :
+        m_first(first),
+        m_second(second)
+    {
+    }
+
+    void
+    generate(random& rng, value_type& out)
+        const
+    {
+        m_first.generate(rng, out.first);
+        m_second.generate(rng, out.second);
+    }
+
+    std::size_t
+    shrinks(const value_type& value)
+        const
+    {
+        return m_first.shrinks(value.first) + m_second.shrinks(value.second);
+    }
+
+    bool
+    shrink(const value_type& from, const std::size_t index, value_type& out)
+        const
+    {
+        const std::size_t count = m_first.shrinks(from.first);
+        if (index < count) {
+            out.second = from.second;
+            return m_first.shrink(from.first, index, out.first);
+        } else {
+            out.first = from.first;
+            return m_second.shrink(from.second, index - count, out.second);
+        }
+    }
+};
+
+template< class Generator, class Predicate >
+class filtered {
+    Generator m_generator;
+    Predicate m_predicate;
+
+public:
+    typedef typename Generator::value_type value_type;
+
+    filtered(const Generator& generator, const Predicate& predicate) :
+        m_generator(generator),
+        m_predicate(predicate)
+    {
+    }
+
+    void
+    generate(random& rng, value_type& out)
+        const
+    {
+        for (int tries = 0; tries < 100; tries++) {
+            m_generator.generate(rng, out);
+            if (m_predicate(out))
+                return;
+        }
+        atf::tests::tc::fail("Could not generate a value that satisfies "
+                             "the such_that predicate in 100 tries");
+    }
+
+    std::size_t
+    shrinks(const value_type& value)
+        const
+    {
+        return m_generator.shrinks(value);
+    }
+
+    bool
+    shrink(const value_type& from, const std::size_t index, value_type& out)
+        const
+    {
+        return m_generator.shrink(from, index, out) && m_predicate(out);
+    }
+};
+
+template< class Generator >
+sequences< std::vector< typename Generator::value_type >, Generator >
+vectors(const Generator& element, const std::size_t min,
+        const std::size_t max)
+{
+    return sequences< std::vector< typename Generator::value_type >,
+                      Generator >(element, min, max);
+}
+
+template< class Generator >
+sequences< std::string, Generator >
+strings(const Generator& element, const std::size_t min,
+        const std::size_t max)
+{
+    return sequences< std::string, Generator >(element, min, max);
+}
+
+inline sequences< std::string, integers< char > >
+strings(const std::size_t min, const std::size_t max)
+{
+    return strings(integers< char >(' ', '~'), min, max);
+}
+
+template< typename T >
+elements< T >
+elements_of(const std::vector< T >& values)
+{
+    return elements< T >(values);
+}
+
+template< class First, class Second >
+pairs< First, Second >
+pairs_of(const First& first, const Second& second)
+{
+    return pairs< First, Second >(first, second);
+}
+
+template< class Generator, class Predicate >
+filtered< Generator, Predicate >
+such_that(const Generator& generator, const Predicate& predicate)
+{
+    return filtered< Generator, Predicate >(generator, predicate);
+}
+
+// ------------------------------------------------------------------------
+// The property runner.
+// ------------------------------------------------------------------------
+
+namespace detail {
+
+template< typename T >
+void print(std::ostream&, const T&);
+inline void print(std::ostream&, const bool);
+inline void print(std::ostream&, const char);
+inline void print(std::ostream&, const signed char);
+inline void print(std::ostream&, const unsigned char);
+inline void print(std::ostream&, const std::string&);
+template< typename T >
+void print(std::ostream&, const std::vector< T >&);
+template< typename T1, typename T2 >
+void print(std::ostream&, const std::pair< T1, T2 >&);
+
+template< typename T >
+void
+print(std::ostream& os, const T& value)
+{
+    os << value;
+}
+
+inline void
+print(std::ostream& os, const bool value)
+{
+    os << (value ? "true" : "false");
+}
+
+inline void
+print_char(std::ostream& os, const char c, const char quote)
+{
+    static const char hex[] = "0123456789abcdef";
+
+    if (c == quote || c == '\\')
+        os << '\\' << c;
+    else if (c == '\n')
+        os << "\\n";
+    else if (c == '\t')
+        os << "\\t";
+    else if (c < ' ' || c > '~')
+        os << "\\x" << hex[(c >> 4) & 0xf] << hex[c & 0xf];
+    else
+        os << c;
+}
+
+inline void
+print(std::ostream& os, const char value)
+{
+    os << '\'';
+    print_char(os, value, '\'');
+    os << '\'';
+}
+
+inline void
+print(std::ostream& os, const signed char value)
+{
+    os << static_cast< int >(value);
+}
+
+inline void
+print(std::ostream& os, const unsigned char value)
+{
+    os << static_cast< int >(value);
+}
+
+inline void
+print(std::ostream& os, const std::string& value)
+{
+    os << '"';
+    for (std::string::const_iterator iter = value.begin();
+         iter != value.end(); ++iter)
+        print_char(os, *iter, '"');
+    os << '"';
+}
+
+template< typename T >
+void
+print(std::ostream& os, const std::vector< T >& value)
+{
+    os << '[';
+    for (typename std::vector< T >::const_iterator iter = value.begin();
+         iter != value.end(); ++iter) {
+        if (iter != value.begin())
+            os << ", ";
+        print(os, *iter);
+    }
+    os << ']';
+}
+
+template< typename T1, typename T2 >
+void
+print(std::ostream& os, const std::pair< T1, T2 >& value)
+{
+    os << '(';
+    print(os, value.first);
+    os << ", ";
+    print(os, value.second);
+    os << ')';
+}
+
+inline std::uint64_t
+get_param(const atf::tests::tc& tc, const std::string& name,
+          const std::uint64_t defval)
+{
+    std::string value;
+    if (tc.has_config_var("property." + name))
+        value = tc.get_config_var("property." + name);
+    else if (tc.has_md_var("X-atf.property." + name))
+        value = tc.get_md_var("X-atf.property." + name);
+    else
+        return defval;
+
+    char* end;
+    errno = 0;
+    const unsigned long long number = std::strtoull(value.c_str(), &end, 10);
+    if (value.empty() || value[0] == '-' || *end != '\0' || errno == ERANGE)
+        atf::tests::tc::fail("Invalid value for the property." + name +
+                             " parameter: " + value);
+    return number;
+}
+
+inline std::uint64_t
+default_seed(const atf::tests::tc& tc, const int line)
+{
+    // Derive the seed from the location of the property so that runs are
+    // deterministic unless asked otherwise.
+    std::ostringstream location;
+    location << tc.get_md_var("ident") << ':' << line;
+    const std::string text = location.str();
+
+    std::uint64_t hash = UINT64_C(0xcbf29ce484222325);
+    for (std::string::const_iterator iter = text.begin(); iter != text.end();
+         ++iter) {
+        hash ^= static_cast< unsigned char >(*iter);
+        hash *= UINT64_C(0x100000001b3);
+    }
+    return hash;
+}
+
+template< class Property, typename T >
+bool
+falsifies(Property& property, const T& value, std::string& reason)
+{
+    atf::tests::detail::failure_trap trap;
+    try {
+        property(value);
+        return false;
+    } catch (const atf::tests::detail::trapped_failure& e) {
+        reason = e.reason();
+        return true;
+    } catch (const std::exception& e) {
+        reason = std::string("Caught unexpected exception: ") + e.what();
+        return true;
+    }
+}
+
+} // namespace detail
+
+//!
+//! \brief Checks that a property holds for the values of a generator.
+//!
+//! The property is a callable that receives a value and uses the
+//! ATF_REQUIRE* macros to check it; a failure or an exception falsifies the
+//! property, in which case the value is shrunk to a simpler one that still
+//! falsifies it and the test case fails.
+//!
+template< class Generator, class Property >
+void
+check(const atf::tests::tc& tc, const int line, const Generator& generator,
+      Property property)
+{
+    const std::uint64_t cases = detail::get_param(tc, "cases", 1000);
+    const std::uint64_t seed = detail::get_param(tc, "seed",
+                                                 detail::default_seed(tc,
+                                                                      line));
+
+    random rng(seed);
+    typename Generator::value_type value = typename Generator::value_type();
+    std::string reason;
+    std::uint64_t tried = 0;
+    for (;;) {
+        if (tried == cases)
+            return;
+        tried++;
+        generator.generate(rng, value);
+        if (detail::falsifies(property, value, reason))
+            break;
+    }
+
+    std::ostringstream original;
+    detail::print(original, value);
+
+    // Shrink greedily: take the first candidate that still falsifies the
+    // property and start over from it, up to a bounded number of attempts.
+    typename Generator::value_type candidate = value;
+    std::size_t steps = 0;
+    std::size_t attempts = 0;
+    bool shrunk = true;
+    while (shrunk && attempts < 10000) {
+        shrunk = false;
+        const std::size_t count = generator.shrinks(value);
+        for (std::size_t i = 0; i < count && attempts < 10000; i++) {
+            if (!generator.shrink(value, i, candidate))
+                continue;
+            attempts++;
+            std::string candidate_reason;
+            if (detail::falsifies(property, candidate, candidate_reason)) {
+                std::swap(value, candidate);
+                reason = candidate_reason;
+                steps++;
+                shrunk = true;
+                break;
+            }
+        }
+    }
+
+    std::ostringstream ss;
+    ss << "Line " << line << ": Property falsified after " << tried
+       << " cases by ";
+    detail::print(ss, value);
+    ss << " (shrunk from " << original.str() << " in " << steps
+       << " steps; seed " << seed << ", set property.seed to reproduce): "
+       << reason;
+    atf::tests::tc::fail(ss.str());
+}
+
+} // namespace property
+} // namespace atf
+
+#define ATF_REQUIRE_PROPERTY(generator, ...) \
+    atf::property::check(*this, __LINE__, (generator), __VA_ARGS__)
+
+#endif // !defined(ATF_CXX_PROPERTY_HPP)
@@ -0,0 +1,360 @@
+// Copyright (c) 2026 The NetBSD Foundation, Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+// CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+// INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+// IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+// IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+// IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "atf-c++/property.hpp"
+
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <atf-c++.hpp>
+
+#include "atf-c++/detail/fs.hpp"
+#include "atf-c++/detail/test_helpers.hpp"
+
+namespace prop = atf::property;
+
+// ------------------------------------------------------------------------
+// Auxiliary test cases.
+// ------------------------------------------------------------------------
+
+static int calls = 0;
+
+ATF_TEST_CASE(h_property);
+ATF_TEST_CASE_HEAD(h_property)
+{
+    set_md_var("descr", "Helper test case");
+    set_md_var("X-atf.property.cases", "10");
+}
+ATF_TEST_CASE_BODY(h_property)
+{
+    const std::string what = get_config_var("what");
+
+    if (what == "pass") {
+        ATF_REQUIRE_PROPERTY(prop::pairs_of(prop::integers< int >(-100, 100),
+                                            prop::integers< int >(-100, 100)),
+                             [](const std::pair< int, int >& p) {
+            ATF_REQUIRE_EQ(p.first + p.second, p.second + p.first);
+        });
+    } else if (what == "integer") {
+        ATF_REQUIRE_PROPERTY(prop::integers< int >(0, 1000000),
+                             [](const int v) {
+            ATF_REQUIRE(v < 1000);
+        });
+    } else if (what == "string") {
+        ATF_REQUIRE_PROPERTY(prop::strings(prop::integers< char >('a', 'z'),
+                                           0, 50),
+                             [](const std::string& s) {
+            ATF_REQUIRE(s.find('x') == std::string::npos);
+        });
+    } else if (what == "vector") {
+        ATF_REQUIRE_PROPERTY(prop::vectors(prop::integers< int >(0, 1000),
+                                           0, 20),
+                             [](const std::vector< int >& v) {
+            for (std::vector< int >::const_iterator iter = v.begin();
+                 iter != v.end(); ++iter)
+                ATF_REQUIRE(*iter < 100);
+        });
+    } else if (what == "exception") {
+        ATF_REQUIRE_PROPERTY(prop::integers< int >(0, 10), [](const int v) {
+            if (v > 5)
+                throw std::runtime_error("Too large");
+        });
+    } else if (what == "count") {
+        ATF_REQUIRE_PROPERTY(prop::booleans(), [](const bool) {
+            calls++;
+        });
+        std::ofstream os("calls");
+        os << calls << "\n";
+    }
+}
+
+// ------------------------------------------------------------------------
+// Test cases for the generators.
+// ------------------------------------------------------------------------
+
+ATF_TEST_CASE_WITHOUT_HEAD(integers__generate);
+ATF_TEST_CASE_BODY(integers__generate)
+{
+    const prop::integers< int > gen(-5, 7);
+    prop::random rng(1);
+
+    bool seen_min = false, seen_max = false;
+    for (int i = 0; i < 10000; i++) {
+        int value;
+        gen.generate(rng, value);
+        ATF_REQUIRE(value >= -5 && value <= 7);
+        seen_min = seen_min || value == -5;
+        seen_max = seen_max || value == 7;
+    }
+    ATF_REQUIRE(seen_min);
+    ATF_REQUIRE(seen_max);
+}
+
+ATF_TEST_CASE_WITHOUT_HEAD(integers__shrink);
+ATF_TEST_CASE_BODY(integers__shrink)
+{
+    const prop::integers< int > gen(-1000, 1000);
+    int value;
+
+    ATF_REQUIRE_EQ(7, gen.shrinks(100));
+    ATF_REQUIRE(gen.shrink(100, 0, value));
+    ATF_REQUIRE_EQ(0, value);
+    ATF_REQUIRE(gen.shrink(100, 1, value));
+    ATF_REQUIRE_EQ(50, value);
+    ATF_REQUIRE(gen.shrink(100, 6, value));
+    ATF_REQUIRE_EQ(99, value);
+
+    ATF_REQUIRE_EQ(7, gen.shrinks(-100));
+    ATF_REQUIRE(gen.shrink(-100, 6, value));
+    ATF_REQUIRE_EQ(-99, value);
+
+    ATF_REQUIRE_EQ(0, gen.shrinks(0));
+
+    const prop::integers< unsigned int > positive(10, 20);
+    ATF_REQUIRE_EQ(3, positive.shrinks(15));
+    unsigned int uvalue;
+    ATF_REQUIRE(positive.shrink(15, 0, uvalue));
+    ATF_REQUIRE_EQ(10, uvalue);
+}
+
+ATF_TEST_CASE_WITHOUT_HEAD(strings__generate);
+ATF_TEST_CASE_BODY(strings__generate)
+{
+    const prop::sequences< std::string, prop::integers< char > > gen =
+        prop::strings(prop::integers< char >('a', 'c'), 2, 5);
+    prop::random rng(2);
+
+    std::string value;
+    for (int i = 0; i < 1000; i++) {
+        gen.generate(rng, value);
+        ATF_REQUIRE(value.length() >= 2 && value.length() <= 5);
+        ATF_REQUIRE(value.find_first_not_of("abc") == std::string::npos);
+    }
+}
+
+ATF_TEST_CASE_WITHOUT_HEAD(sequences__shrink);
+ATF_TEST_CASE_BODY(sequences__shrink)
+{
+    const prop::sequences< std::vector< int >, prop::integers< int > > gen =
+        prop::vectors(prop::integers< int >(0, 10), 0, 10);
+
+    std::vector< int > value;
+    value.push_back(1);
+    value.push_back(2);
+    value.push_back(3);
+
+    // Removal of the 3 elements at once, then of each of them, then the
+    // shrinks of each element (1, 2 and 2 candidates).
+    ATF_REQUIRE_EQ(9, gen.shrinks(value));
+
+    std::vector< int > candidate;
+    ATF_REQUIRE(gen.shrink(value, 0, candidate));
+    ATF_REQUIRE(candidate.empty());
+    ATF_REQUIRE(gen.shrink(value, 2, candidate));
+    ATF_REQUIRE_EQ(2, candidate.size());
+    ATF_REQUIRE_EQ(1, candidate[0]);
+    ATF_REQUIRE_EQ(3, candidate[1]);
+    ATF_REQUIRE(gen.shrink(value, 8, candidate));
+    ATF_REQUIRE_EQ(3, candidate.size());
+    ATF_REQUIRE_EQ(2, candidate[2]);
+
+    const prop::sequences< std::vector< int >, prop::integers< int > > fixed =
+        prop::vectors(prop::integers< int >(0, 10), 3, 3);
+    ATF_REQUIRE_EQ(5, fixed.shrinks(value));
+}
+
+ATF_TEST_CASE_WITHOUT_HEAD(combinators);
+ATF_TEST_CASE_BODY(combinators)
+{
+    prop::random rng(3);
+
+    std::vector< std::string > names;
+    names.push_back("first");
+    names.push_back("second");
+    names.push_back("third");
+    const prop::elements< std::string > elements = prop::elements_of(names);
+    std::string name;
+    elements.generate(rng, name);
+    ATF_REQUIRE(name == "first" || name == "second" || name == "third");
+    ATF_REQUIRE_EQ(2, elements.shrinks("third"));
+    ATF_REQUIRE(elements.shrink("third", 1, name));
+    ATF_REQUIRE_EQ("second", name);
+
+    const auto even = prop::such_that(prop::integers< int >(0, 100),
+                                      [](const int v) { return v % 2 == 0; });
+    for (int i = 0; i < 1000; i++) {
+        int value;
+        even.generate(rng, value);
+        ATF_REQUIRE_EQ(0, value % 2);
+    }
+    int value;
+    ATF_REQUIRE(!even.shrink(8, 3, value));
+    ATF_REQUIRE(even.shrink(8, 2, value));
+    ATF_REQUIRE_EQ(6, value);
+
+    const auto pairs = prop::pairs_of(prop::booleans(),
+                                      prop::integers< int >(0, 4));
+    ATF_REQUIRE_EQ(3, pairs.shrinks(std::make_pair(true, 3)));
+    std::pair< bool, int > pair;
+    ATF_REQUIRE(pairs.shrink(std::make_pair(true, 3), 0, pair));
+    ATF_REQUIRE(!pair.first);
+    ATF_REQUIRE_EQ(3, pair.second);
+    ATF_REQUIRE(pairs.shrink(std::make_pair(true, 3), 2, pair));
+    ATF_REQUIRE(pair.first);
+    ATF_REQUIRE_EQ(2, pair.second);
+}
+
+// ------------------------------------------------------------------------
+// Test cases for the property runner.
+// ------------------------------------------------------------------------
+
+ATF_TEST_CASE_WITHOUT_HEAD(check__pass);
+ATF_TEST_CASE_BODY(check__pass)
+{
+    ATF_TEST_CASE_USE(h_property);
+    atf::tests::vars_map config;
+    config["what"] = "pass";
+    run_h_tc< ATF_TEST_CASE_NAME(h_property) >(config);
+    ATF_REQUIRE(atf::utils::grep_file("^passed$", "result"));
+}
+
+ATF_TEST_CASE_WITHOUT_HEAD(check__shrink);
+ATF_TEST_CASE_BODY(check__shrink)
+{
+    struct test {
+        const char *what;
+        const char *value;
+        const char *reason;
+    } *t, tests[] = {
+        { "integer", "1000", "Line [0-9]+: v < 1000 not met" },
+        { "string", "\"x\"", "Line [0-9]+: s.find\\('x'\\) == "
+          "std::string::npos not met" },
+        { "vector", "\\[100\\]", "Line [0-9]+: \\*iter < 100 not met" },
+        { "exception", "6", "Caught unexpected exception: Too large" },
+        { NULL, NULL, NULL }
+    };
+
+    for (t = &tests[0]; t->what != NULL; t++) {
+        std::cout << "Checking " << t->what << "\n";
+        atf::tests::vars_map config;
+        config["what"] = t->what;
+        config["property.cases"] = "100000";
+        run_h_tc< ATF_TEST_CASE_NAME(h_property) >(config);
+
+        const std::string exp_result = std::string("^failed: Line [0-9]+: "
+            "Property falsified after [0-9]+ cases by ") + t->value +
+            " \\(shrunk from .* in [0-9]+ steps; seed [0-9]+, set "
+            "property.seed to reproduce\\): " + t->reason + "$";
+        ATF_REQUIRE(atf::utils::grep_file(exp_result, "result"));
+    }
+}
+
+ATF_TEST_CASE_WITHOUT_HEAD(check__seed);
+ATF_TEST_CASE_BODY(check__seed)
+{
+    ATF_TEST_CASE_USE(h_property);
+    atf::tests::vars_map config;
+    config["what"] = "integer";
+    config["property.cases"] = "100000";
+
+    run_h_tc< ATF_TEST_CASE_NAME(h_property) >(config);
+    atf::utils::copy_file("result", "first");
+    run_h_tc< ATF_TEST_CASE_NAME(h_property) >(config);
+    std::ifstream first("first");
+    std::string line;
+    std::getline(first, line);
+    ATF_REQUIRE(atf::utils::compare_file("result", line + "\n"));
+
+    config["property.seed"] = "42";
+    run_h_tc< ATF_TEST_CASE_NAME(h_property) >(config);
+    ATF_REQUIRE(atf::utils::grep_file("seed 42, set property.seed", "result"));
+}
+
+ATF_TEST_CASE_WITHOUT_HEAD(check__cases);
+ATF_TEST_CASE_BODY(check__cases)
+{
+    ATF_TEST_CASE_USE(h_property);
+    atf::tests::vars_map config;
+    config["what"] = "count";
+
+    run_h_tc< ATF_TEST_CASE_NAME(h_property) >(config);
+    ATF_REQUIRE(atf::utils::grep_file("^passed$", "result"));
+    ATF_REQUIRE(atf::utils::compare_file("calls", "10\n"));
+
+    config["property.cases"] = "25";
+    run_h_tc< ATF_TEST_CASE_NAME(h_property) >(config);
+    ATF_REQUIRE(atf::utils::grep_file("^passed$", "result"));
+    ATF_REQUIRE(atf::utils::compare_file("calls", "25\n"));
+
+    config["property.cases"] = "many";
+    run_h_tc< ATF_TEST_CASE_NAME(h_property) >(config);
+    ATF_REQUIRE(atf::utils::grep_file("^failed: Invalid value for the "
+                                      "property.cases parameter: many$",
+                                      "result"));
+}
+
+ATF_TEST_CASE_WITHOUT_HEAD(check__allocs);
+ATF_TEST_CASE_BODY(check__allocs)
+{
+    // A run reuses the storage of its values, so the allocations do not
+    // grow with the number of cases.
+    ATF_REQUIRE_ALLOCS_AT_MOST(50) {
+        ATF_REQUIRE_PROPERTY(prop::strings(0, 64), [](const std::string& s) {
+            ATF_REQUIRE(s.length() <= 64);
+        });
+    }
+}
+
+// ------------------------------------------------------------------------
+// Tests cases for the header file.
+// ------------------------------------------------------------------------
+
+HEADER_TC(include, "atf-c++/property.hpp");
+
+// ------------------------------------------------------------------------
+// Main.
+// ------------------------------------------------------------------------
+
+ATF_INIT_TEST_CASES(tcs)
+{
+    // Add the test cases for the generators.
+    ATF_ADD_TEST_CASE(tcs, integers__generate);
+    ATF_ADD_TEST_CASE(tcs, integers__shrink);
+    ATF_ADD_TEST_CASE(tcs, strings__generate);
+    ATF_ADD_TEST_CASE(tcs, sequences__shrink);
+    ATF_ADD_TEST_CASE(tcs, combinators);
+
+    // Add the test cases for the property runner.
+    ATF_ADD_TEST_CASE(tcs, check__pass);
+    ATF_ADD_TEST_CASE(tcs, check__shrink);
+    ATF_ADD_TEST_CASE(tcs, check__seed);
+    ATF_ADD_TEST_CASE(tcs, check__cases);
+    ATF_ADD_TEST_CASE(tcs, check__allocs);
+
+    // Add the test cases for the header file.
+    ATF_ADD_TEST_CASE(tcs, include);
+}
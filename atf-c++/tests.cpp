@@ -53,8 +53,16 @@ extern "C" {
 
 extern "C" {
 #include "atf-c/error.h"
+#include "atf-c/fuzz.h"
 #include "atf-c/tc.h"
 #include "atf-c/utils.h"
+
+// No prototypes in header for these ones, they are a little sketchy
+// (internal).
+void atf_tc_set_program_args(char **);
+atf_error_t atf_tc_run_in_process(const atf_tc_t *, const char *,
+                                  void (*)(void), bool *);
+void atf_tc_unwind(void);
 }
 
 #include "atf-c++/detail/application.hpp"
@@ -138,6 +146,35 @@ detail::match(const std::string& regexp, const std::string& str)
     return atf::text::match(str, regexp);
 }
 
+// ------------------------------------------------------------------------
+// The "failure_trap" and "trapped_failure" classes.
+// ------------------------------------------------------------------------
+
+static int Trap_Depth = 0;
+
+detail::failure_trap::failure_trap(void)
+{
+    Trap_Depth++;
+}
+
+detail::failure_trap::~failure_trap(void)
+{
+    PRE(Trap_Depth > 0);
+    Trap_Depth--;
+}
+
+detail::trapped_failure::trapped_failure(const std::string& reason) :
+    m_reason(reason)
+{
+}
+
+const std::string&
+detail::trapped_failure::reason(void)
+    const
+{
+    return m_reason;
+}
+
 // ------------------------------------------------------------------------
 // The "tc" class.
 // ------------------------------------------------------------------------
@@ -145,6 +182,30 @@ detail::match(const std::string& regexp, const std::string& str)
 static std::map< atf_tc_t*, impl::tc* > wraps;
 static std::map< const atf_tc_t*, const impl::tc* > cwraps;
 
+namespace {
+
+//!
+//! \brief Raised to unwind the body of a test case that runs in-process.
+//!
+//! This does not derive from std::exception so that test cases do not
+//! mistake it for an error of the code under test.
+//!
+struct in_process_unwind {
+};
+
+// Whether the test case runs in-process and whether its body is running.
+static bool In_Process = false;
+static bool In_Process_Body = false;
+
+static void
+unwind_in_process_body(void)
+{
+    if (In_Process_Body)
+        throw in_process_unwind();
+}
+
+} // anonymous namespace
+
 struct impl::tc_impl {
 private:
     // Non-copyable.
@@ -176,7 +237,16 @@ public:
         std::map< const atf_tc_t*, const impl::tc* >::const_iterator iter =
             cwraps.find(tc);
         INV(iter != cwraps.end());
-        (*iter).second->body();
+        bool unwind = false;
+        In_Process_Body = In_Process;
+        try {
+            (*iter).second->body();
+        } catch (const in_process_unwind&) {
+            unwind = true;
+        }
+        In_Process_Body = false;
+        if (unwind)
+            ::atf_tc_unwind();
     }
 
     static void
@@ -187,6 +257,12 @@ public:
         INV(iter != cwraps.end());
         (*iter).second->cleanup();
     }
+
+    static void
+    wrap_fuzz_body(const void* data, const size_t size, const void* tc)
+    {
+        static_cast< const impl::fuzz_tc* >(tc)->fuzz_body(data, size);
+    }
 };
 
 impl::tc::tc(const std::string& ident, const bool has_cleanup) :
@@ -298,6 +374,21 @@ impl::tc::run(const std::string& resfile)
         throw_atf_error(err);
 }
 
+bool
+impl::tc::run_in_process(const std::string& resfile)
+    const
+{
+    bool failed;
+
+    In_Process = true;
+    atf_error_t err = atf_tc_run_in_process(&pimpl->m_tc, resfile.c_str(),
+                                            unwind_in_process_body, &failed);
+    In_Process = false;
+    if (atf_is_error(err))
+        throw_atf_error(err);
+    return !failed;
+}
+
 void
 impl::tc::run_cleanup(void)
     const
@@ -334,12 +425,16 @@ impl::tc::pass(void)
 void
 impl::tc::fail(const std::string& reason)
 {
+    if (Trap_Depth > 0)
+        throw detail::trapped_failure(reason);
     atf_tc_fail("%s", reason.c_str());
 }
 
 void
 impl::tc::fail_nonfatal(const std::string& reason)
 {
+    if (Trap_Depth > 0)
+        throw detail::trapped_failure(reason);
     atf_tc_fail_nonfatal("%s", reason.c_str());
 }
 
@@ -399,6 +494,29 @@ impl::tc::expect_timeout(const std::string& reason)
     atf_tc_expect_timeout("%s", reason.c_str());
 }
 
+void
+impl::tc::record_metric(const std::string& name, const double value,
+                        const std::string& unit)
+{
+    atf_tc_record_metric(name.c_str(), value, unit.c_str());
+}
+
+// ------------------------------------------------------------------------
+// The "fuzz_tc" class.
+// ------------------------------------------------------------------------
+
+impl::fuzz_tc::fuzz_tc(const std::string& ident) :
+    tc(ident, false)
+{
+}
+
+void
+impl::fuzz_tc::body(void)
+    const
+{
+    ::atf_fuzz_run(&pimpl->m_tc, tc_impl::wrap_fuzz_body, this);
+}
+
 // ------------------------------------------------------------------------
 // Test program main code.
 // ------------------------------------------------------------------------
@@ -427,6 +545,44 @@ parse_vflag(const std::string& str, atf::tests::vars_map& vars)
     }
 }
 
+//!
+//! \brief Loads the configuration variables in a file.
+//!
+//! The file holds one var=value pair per line; blank lines and lines
+//! starting with '#' are ignored.  It is read in a single call and split in
+//! one pass, so configurations with thousands of variables do not have to
+//! go through the command line.
+//!
+static void
+parse_cflag(const std::string& path, atf::tests::vars_map& vars)
+{
+    std::ifstream is(path.c_str());
+    if (!is)
+        throw usage_error("Cannot open config file %s", path.c_str());
+
+    std::ostringstream contents;
+    contents << is.rdbuf();
+    const std::string text = contents.str();
+
+    std::string::size_type pos = 0;
+    for (size_t lineno = 1; pos < text.length(); lineno++) {
+        std::string::size_type end = text.find('\n', pos);
+        if (end == std::string::npos)
+            end = text.length();
+
+        if (end != pos && text[pos] != '#') {
+            const std::string::size_type split = text.find('=', pos);
+            if (split == pos || split >= end)
+                throw usage_error("Invalid line %zu in config file %s; "
+                                  "expected var=value", lineno, path.c_str());
+            vars[text.substr(pos, split - pos)] =
+                text.substr(split + 1, end - split - 1);
+        }
+
+        pos = end + 1;
+    }
+}
+
 static atf::fs::path
 handle_srcdir(const char* argv0, const std::string& srcdir_arg)
 {
@@ -535,8 +691,9 @@ run_tc(tc_vector& tcs, const std::string& tcarg, const atf::fs::path& resfile)
     {
         std::cerr << Program_Name << ": WARNING: Running test cases outside "
             "of kyua(1) is unsupported\n";
-        std::cerr << Program_Name << ": WARNING: No isolation nor timeout "
-            "control is being applied; you may get unexpected failures; see "
+        std::cerr << Program_Name << ": WARNING: No isolation is being "
+            "applied and only explicit timeouts are enforced by the test "
+            "program itself; you may get unexpected failures; see "
             "atf-test-case(4)\n";
     }
 
@@ -553,11 +710,76 @@ run_tc(tc_vector& tcs, const std::string& tcarg, const atf::fs::path& resfile)
     return EXIT_SUCCESS;
 }
 
+static bool
+in_process_allowed(const impl::tc* tc)
+{
+    if (!tc->has_md_var("X-atf.in_process"))
+        return false;
+
+    try {
+        return atf::text::to_bool(tc->get_md_var("X-atf.in_process"));
+    } catch (const std::runtime_error&) {
+        return false;
+    }
+}
+
+//!
+//! \brief Runs several test cases in this process, one after the other.
+//!
+//! Only test cases that set X-atf.in_process can run this way: they trade
+//! the isolation of a process per test case for the cost of starting it.
+//!
+static int
+run_tcs_in_process(tc_vector& tcs, const std::vector< std::string >& names,
+                   const atf::fs::path& resfile)
+{
+    tc_vector selected;
+    if (names.empty()) {
+        for (tc_vector::iterator iter = tcs.begin(); iter != tcs.end();
+             iter++) {
+            if (in_process_allowed(*iter))
+                selected.push_back(*iter);
+        }
+    } else {
+        for (std::vector< std::string >::const_iterator iter = names.begin();
+             iter != names.end(); iter++) {
+            impl::tc* tc = find_tc(tcs, *iter);
+            if (!in_process_allowed(tc))
+                throw usage_error("Test case `%s' cannot run in-process; see "
+                                  "X-atf.in_process", (*iter).c_str());
+            selected.push_back(tc);
+        }
+    }
+
+    if (resfile.str() != "/dev/stdout" && resfile.str() != "/dev/stderr") {
+        std::ofstream os(resfile.c_str(), std::ios::trunc);
+        if (!os)
+            throw std::runtime_error("Cannot create results file '" +
+                                     resfile.str() + "'");
+
+        // The test cases append their metrics, if any, to a companion
+        // file; start it afresh too.
+        (void)::unlink((resfile.str() + ".metrics").c_str());
+    }
+
+    bool all_passed = true;
+    for (tc_vector::iterator iter = selected.begin(); iter != selected.end();
+         iter++) {
+        impl::tc* tc = *iter;
+
+        if (!tc->run_in_process(resfile.str()))
+            all_passed = false;
+        tc->run_cleanup();
+    }
+    return all_passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
 static int
 safe_main(int argc, char** argv, void (*add_tcs)(tc_vector&))
 {
     const char* argv0 = argv[0];
 
+    bool iflag = false;
     bool lflag = false;
     atf::fs::path resfile("/dev/stdout");
     std::string srcdir_arg;
@@ -568,8 +790,16 @@ safe_main(int argc, char** argv, void (*add_tcs)(tc_vector&))
 
     old_opterr = opterr;
     ::opterr = 0;
-    while ((ch = ::getopt(argc, argv, GETOPT_POSIX ":lr:s:v:")) != -1) {
+    while ((ch = ::getopt(argc, argv, GETOPT_POSIX ":c:ilr:s:v:")) != -1) {
         switch (ch) {
+        case 'c':
+            parse_cflag(::optarg, vars);
+            break;
+
+        case 'i':
+            iflag = true;
+            break;
+
         case 'l':
             lflag = true;
             break;
@@ -611,11 +841,17 @@ safe_main(int argc, char** argv, void (*add_tcs)(tc_vector&))
 
     tc_vector tcs;
     if (lflag) {
-        if (argc > 0)
+        if (iflag)
+            throw usage_error("Cannot use -i with -l");
+        else if (argc > 0)
             throw usage_error("Cannot provide test case names with -l");
 
         init_tcs(add_tcs, tcs, vars);
         errcode = list_tcs(tcs);
+    } else if (iflag) {
+        init_tcs(add_tcs, tcs, vars);
+        errcode = run_tcs_in_process(tcs, std::vector< std::string >(
+            argv, argv + argc), resfile);
     } else {
         if (argc == 0)
             throw usage_error("Must provide a test case name");
@@ -648,6 +884,7 @@ impl::run_tp(int argc, char** argv, void (*add_tcs)(tc_vector&))
 {
     try {
         set_program_name(argv[0]);
+        ::atf_tc_set_program_args(argv);
         return ::safe_main(argc, argv, add_tcs);
     } catch (const usage_error& e) {
         std::cerr
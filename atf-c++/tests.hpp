@@ -26,6 +26,7 @@
 #if !defined(ATF_CXX_TESTS_HPP)
 #define ATF_CXX_TESTS_HPP
 
+#include <cstddef>
 #include <map>
 #include <memory>
 #include <string>
@@ -54,6 +55,32 @@ public:
 
 bool match(const std::string&, const std::string&);
 
+//!
+//! \brief Turns the failures of the test case into exceptions.
+//!
+//! While an instance of this class is alive, tc::fail and tc::fail_nonfatal
+//! throw a trapped_failure instead of recording the result of the test
+//! case, so that the caller can inspect the failure and carry on.
+//!
+class failure_trap {
+    // Non-copyable.
+    failure_trap(const failure_trap&);
+    failure_trap& operator=(const failure_trap&);
+
+public:
+    failure_trap(void);
+    ~failure_trap(void);
+};
+
+class trapped_failure {
+    std::string m_reason;
+
+public:
+    explicit trapped_failure(const std::string&);
+
+    const std::string& reason(void) const;
+};
+
 } // namespace
 
 // ------------------------------------------------------------------------
@@ -83,6 +110,7 @@ protected:
     void require_prog(const std::string&) const;
 
     friend struct tc_impl;
+    friend class fuzz_tc;
 
 public:
     tc(const std::string&, const bool);
@@ -100,6 +128,7 @@ public:
     void set_md_var(const std::string&, const std::string&);
 
     void run(const std::string&) const;
+    bool run_in_process(const std::string&) const;
     void run_cleanup(void) const;
 
     // To be called from the child process only.
@@ -117,6 +146,23 @@ public:
     static void expect_signal(const int, const std::string&);
     static void expect_death(const std::string&);
     static void expect_timeout(const std::string&);
+    static void record_metric(const std::string&, const double,
+                              const std::string& = "");
+};
+
+// ------------------------------------------------------------------------
+// The "fuzz_tc" class.
+// ------------------------------------------------------------------------
+
+class fuzz_tc : public tc {
+protected:
+    void body(void) const;
+    virtual void fuzz_body(const void*, const std::size_t) const = 0;
+
+    friend struct tc_impl;
+
+public:
+    fuzz_tc(const std::string&);
 };
 
 } // namespace tests
@@ -30,14 +30,220 @@ extern "C" {
 }
 
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 
+namespace {
+
+static atf_utils_io_stats_t
+to_c_io_stats(const atf::utils::io_stats& stats)
+{
+    atf_utils_io_stats_t c_stats;
+    c_stats.m_reads = stats.reads;
+    c_stats.m_read_bytes = stats.read_bytes;
+    c_stats.m_writes = stats.writes;
+    c_stats.m_write_bytes = stats.write_bytes;
+    c_stats.m_storage_read_bytes = stats.storage_read_bytes;
+    c_stats.m_storage_write_bytes = stats.storage_write_bytes;
+    c_stats.m_block_ins = stats.block_ins;
+    c_stats.m_block_outs = stats.block_outs;
+    return c_stats;
+}
+
+static atf::utils::io_stats
+from_c_io_stats(const atf_utils_io_stats_t& c_stats)
+{
+    atf::utils::io_stats stats;
+    stats.reads = c_stats.m_reads;
+    stats.read_bytes = c_stats.m_read_bytes;
+    stats.writes = c_stats.m_writes;
+    stats.write_bytes = c_stats.m_write_bytes;
+    stats.storage_read_bytes = c_stats.m_storage_read_bytes;
+    stats.storage_write_bytes = c_stats.m_storage_write_bytes;
+    stats.block_ins = c_stats.m_block_ins;
+    stats.block_outs = c_stats.m_block_outs;
+    return stats;
+}
+
+} // anonymous namespace
+
+const unsigned long long atf::utils::io_unlimited = ATF_UTILS_IO_UNLIMITED;
+
+atf::utils::alloc_scope::alloc_scope(const char* file, const int line)
+{
+    const atf_utils_alloc_scope_t scope = atf_utils_alloc_scope_begin(file,
+                                                                      line);
+    m_active = scope.m_active;
+    m_depth = scope.m_depth;
+    m_start.allocs = scope.m_start.m_allocs;
+    m_start.frees = scope.m_start.m_frees;
+    m_start.bytes = scope.m_start.m_bytes;
+    m_start.live_bytes = scope.m_start.m_live_bytes;
+}
+
+bool
+atf::utils::alloc_scope::active(void)
+    const
+{
+    return m_active;
+}
+
+void
+atf::utils::alloc_scope::end(const char* file, const int line,
+                             const unsigned long long max, const bool fatal)
+{
+    atf_utils_alloc_scope_t scope;
+    scope.m_active = m_active;
+    scope.m_depth = m_depth;
+    scope.m_start.m_allocs = m_start.allocs;
+    scope.m_start.m_frees = m_start.frees;
+    scope.m_start.m_bytes = m_start.bytes;
+    scope.m_start.m_live_bytes = m_start.live_bytes;
+
+    m_active = false;
+    atf_utils_alloc_scope_end(&scope, file, line, max, fatal);
+}
+
+atf::utils::histogram::histogram(void) :
+    m_impl(new atf_utils_histogram_t)
+{
+    atf_utils_histogram_init(m_impl);
+}
+
+atf::utils::histogram::histogram(const histogram& h) :
+    m_impl(new atf_utils_histogram_t)
+{
+    std::memcpy(m_impl, h.m_impl, sizeof(*m_impl));
+}
+
+atf::utils::histogram::~histogram(void)
+{
+    delete m_impl;
+}
+
+atf::utils::histogram&
+atf::utils::histogram::operator=(const histogram& h)
+{
+    if (this != &h)
+        std::memcpy(m_impl, h.m_impl, sizeof(*m_impl));
+    return *this;
+}
+
+unsigned long long
+atf::utils::histogram::count(void)
+    const
+{
+    return m_impl->m_count;
+}
+
+unsigned long long
+atf::utils::histogram::max(void)
+    const
+{
+    return m_impl->m_count == 0 ? 0 : m_impl->m_max;
+}
+
+unsigned long long
+atf::utils::histogram::mean(void)
+    const
+{
+    return m_impl->m_count == 0 ? 0 : m_impl->m_sum / m_impl->m_count;
+}
+
+unsigned long long
+atf::utils::histogram::min(void)
+    const
+{
+    return m_impl->m_count == 0 ? 0 : m_impl->m_min;
+}
+
+unsigned long long
+atf::utils::histogram::percentile(const double pct)
+    const
+{
+    return atf_utils_histogram_percentile(m_impl, pct);
+}
+
+void
+atf::utils::histogram::print(std::ostream& os)
+    const
+{
+    if (m_impl->m_count == 0) {
+        os << "Histogram: no values\n";
+        return;
+    }
+
+    os << "Histogram: " << count() << " values, min " << min() << ", mean "
+       << mean() << ", max " << max() << "\n";
+    os << "    p50 " << percentile(50.0) << ", p90 " << percentile(90.0)
+       << ", p99 " << percentile(99.0) << ", p99.9 " << percentile(99.9)
+       << "\n";
+    for (std::size_t i = 0; i < ATF_UTILS_HISTOGRAM_BUCKETS; i++) {
+        unsigned long long lowest, highest;
+        const unsigned long long n = atf_utils_histogram_bucket(
+            m_impl, i, &lowest, &highest);
+        if (n > 0)
+            os << "    [" << lowest << ", " << highest << "]: " << n << "\n";
+    }
+}
+
+void
+atf::utils::histogram::merge(const histogram& h)
+{
+    atf_utils_histogram_merge(m_impl, h.m_impl);
+}
+
+void
+atf::utils::histogram::record(const unsigned long long value)
+{
+    atf_utils_histogram_record(m_impl, value);
+}
+
+atf::utils::io_scope::io_scope(const io_stats& budget)
+{
+    const atf_utils_io_scope_t scope = atf_utils_io_scope_begin(
+        to_c_io_stats(budget));
+    m_active = scope.m_active;
+    m_budget = from_c_io_stats(scope.m_budget);
+    m_start = from_c_io_stats(scope.m_start);
+    m_overhead = scope.m_overhead;
+}
+
+bool
+atf::utils::io_scope::active(void)
+    const
+{
+    return m_active;
+}
+
+void
+atf::utils::io_scope::end(const char* file, const int line, const bool fatal)
+{
+    atf_utils_io_scope_t scope;
+    scope.m_active = m_active;
+    scope.m_budget = to_c_io_stats(m_budget);
+    scope.m_start = to_c_io_stats(m_start);
+    scope.m_overhead = m_overhead;
+
+    m_active = false;
+    atf_utils_io_scope_end(&scope, file, line, fatal);
+}
+
 void
 atf::utils::cat_file(const std::string& path, const std::string& prefix)
 {
     atf_utils_cat_file(path.c_str(), prefix.c_str());
 }
 
+void
+atf::utils::check_percentile_below(const char* file, const int line,
+                                   const histogram& h, const double pct,
+                                   const unsigned long long value,
+                                   const bool fatal)
+{
+    atf_utils_histogram_check_below(file, line, h.m_impl, pct, value, fatal);
+}
+
 void
 atf::utils::copy_file(const std::string& source, const std::string& destination)
 {
@@ -70,6 +276,39 @@ atf::utils::fork(void)
     return atf_utils_fork();
 }
 
+bool
+atf::utils::get_alloc_stats(alloc_stats& stats)
+{
+    atf_utils_alloc_stats_t c_stats;
+    if (!atf_utils_get_alloc_stats(&c_stats))
+        return false;
+
+    stats.allocs = c_stats.m_allocs;
+    stats.frees = c_stats.m_frees;
+    stats.bytes = c_stats.m_bytes;
+    stats.live_bytes = c_stats.m_live_bytes;
+    return true;
+}
+
+bool
+atf::utils::get_io_stats(io_stats& stats)
+{
+    atf_utils_io_stats_t c_stats;
+    const bool complete = atf_utils_get_io_stats(&c_stats);
+    stats = from_c_io_stats(c_stats);
+    return complete;
+}
+
+atf::utils::io_stats
+atf::utils::io_budget(const unsigned long long reads,
+                      const unsigned long long read_bytes,
+                      const unsigned long long writes,
+                      const unsigned long long write_bytes)
+{
+    return from_c_io_stats(atf_utils_io_budget(reads, read_bytes, writes,
+                                               write_bytes));
+}
+
 void
 atf::utils::reset_resultsfile(void)
 {
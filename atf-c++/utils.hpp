@@ -30,17 +30,117 @@ extern "C" {
 #include <unistd.h>
 }
 
+#include <ostream>
 #include <string>
 
+struct atf_utils_histogram;
+
 namespace atf {
 namespace utils {
 
+//!
+//! \brief Allocation counters maintained by the libatf-c-alloc interposer.
+//!
+struct alloc_stats {
+    unsigned long long allocs;
+    unsigned long long frees;
+    unsigned long long bytes;
+    unsigned long long live_bytes;
+};
+
+//!
+//! \brief State of an ATF_{CHECK,REQUIRE}_ALLOCS_AT_MOST block.
+//!
+class alloc_scope {
+    bool m_active;
+    size_t m_depth;
+    alloc_stats m_start;
+
+public:
+    alloc_scope(const char*, const int);
+
+    bool active(void) const;
+    void end(const char*, const int, const unsigned long long, const bool);
+};
+
+//!
+//! \brief I/O counters of the process; also used to express I/O budgets.
+//!
+//! Budgets use io_unlimited for the counters that are not to be checked.
+//!
+struct io_stats {
+    unsigned long long reads;
+    unsigned long long read_bytes;
+    unsigned long long writes;
+    unsigned long long write_bytes;
+    unsigned long long storage_read_bytes;
+    unsigned long long storage_write_bytes;
+    unsigned long long block_ins;
+    unsigned long long block_outs;
+};
+
+extern const unsigned long long io_unlimited;
+
+//!
+//! \brief State of an ATF_{CHECK,REQUIRE}_IO_WITHIN block.
+//!
+class io_scope {
+    bool m_active;
+    io_stats m_budget;
+    io_stats m_start;
+    size_t m_overhead;
+
+public:
+    io_scope(const io_stats&);
+
+    bool active(void) const;
+    void end(const char*, const int, const bool);
+};
+
+//!
+//! \brief A log-linear histogram of values, typically latencies.
+//!
+//! Recording is cheap but not thread safe: use a histogram per thread and
+//! merge them once the threads are done.
+//!
+class histogram {
+    ::atf_utils_histogram* m_impl;
+
+    friend void check_percentile_below(const char*, const int,
+                                       const histogram&, const double,
+                                       const unsigned long long, const bool);
+
+public:
+    histogram(void);
+    histogram(const histogram&);
+    ~histogram(void);
+
+    histogram& operator=(const histogram&);
+
+    unsigned long long count(void) const;
+    unsigned long long max(void) const;
+    unsigned long long mean(void) const;
+    unsigned long long min(void) const;
+    unsigned long long percentile(const double) const;
+    void print(std::ostream&) const;
+
+    void merge(const histogram&);
+    void record(const unsigned long long);
+};
+
 void cat_file(const std::string&, const std::string&);
+void check_percentile_below(const char*, const int, const histogram&,
+                            const double, const unsigned long long,
+                            const bool);
 bool compare_file(const std::string&, const std::string&);
 void copy_file(const std::string&, const std::string&);
 void create_file(const std::string&, const std::string&);
 bool file_exists(const std::string&);
 pid_t fork(void);
+bool get_alloc_stats(alloc_stats&);
+bool get_io_stats(io_stats&);
+io_stats io_budget(const unsigned long long, const unsigned long long,
+                   const unsigned long long, const unsigned long long);
 void reset_resultsfile(void);
 bool grep_file(const std::string&, const std::string&);
 bool grep_string(const std::string&, const std::string&);
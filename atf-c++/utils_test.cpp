@@ -64,6 +64,58 @@ read_file(const std::string& path)
 // Tests cases for the free functions.
 // ------------------------------------------------------------------------
 
+// Storage for blocks that the tests below intentionally leak, so that the
+// compiler cannot optimize the allocations away.
+static int* volatile leaked_block;
+
+ATF_TEST_CASE_WITHOUT_HEAD(alloc_stats);
+ATF_TEST_CASE_BODY(alloc_stats)
+{
+    atf::utils::alloc_stats before, after;
+    if (!atf::utils::get_alloc_stats(before))
+        ATF_SKIP("Allocation tracking not available");
+
+    leaked_block = new int[10];
+    ATF_REQUIRE(atf::utils::get_alloc_stats(after));
+    ATF_REQUIRE_EQ(before.allocs + 1, after.allocs);
+    ATF_REQUIRE(after.live_bytes - before.live_bytes >= sizeof(int) * 10);
+
+    delete [] leaked_block;
+    ATF_REQUIRE(atf::utils::get_alloc_stats(after));
+    ATF_REQUIRE_EQ(before.frees + 1, after.frees);
+    ATF_REQUIRE_EQ(before.live_bytes, after.live_bytes);
+}
+
+ATF_TEST_CASE_WITHOUT_HEAD(allocs_at_most__ok);
+ATF_TEST_CASE_BODY(allocs_at_most__ok)
+{
+    ATF_REQUIRE_ALLOCS_AT_MOST(1) {
+        leaked_block = new int(5);
+        delete leaked_block;
+    }
+}
+
+ATF_TEST_CASE_WITHOUT_HEAD(no_allocs__violated);
+ATF_TEST_CASE_BODY(no_allocs__violated)
+{
+    expect_fail("The scope allocates memory");
+    ATF_CHECK_NO_ALLOCS {
+        leaked_block = new int(5);
+        delete leaked_block;
+    }
+}
+
+ATF_TEST_CASE(leak_check__leaky);
+ATF_TEST_CASE_HEAD(leak_check__leaky)
+{
+    set_md_var("X-atf.leak_check", "true");
+}
+ATF_TEST_CASE_BODY(leak_check__leaky)
+{
+    expect_fail("The body leaks one block");
+    leaked_block = new int(5);
+}
+
 ATF_TEST_CASE_WITHOUT_HEAD(cat_file__empty);
 ATF_TEST_CASE_BODY(cat_file__empty)
 {
@@ -293,6 +345,113 @@ ATF_TEST_CASE_BODY(grep_string)
     ATF_REQUIRE(!atf::utils::grep_string("aaaaa", str));
 }
 
+ATF_TEST_CASE_WITHOUT_HEAD(histogram__percentile);
+ATF_TEST_CASE_BODY(histogram__percentile)
+{
+    atf::utils::histogram h;
+    ATF_REQUIRE_EQ(0, h.count());
+    ATF_REQUIRE_EQ(0, h.percentile(99.0));
+
+    for (unsigned long long i = 1; i <= 1000; i++)
+        h.record(i);
+    ATF_REQUIRE_EQ(1000, h.count());
+    ATF_REQUIRE_EQ(1, h.min());
+    ATF_REQUIRE_EQ(500, h.mean());
+    ATF_REQUIRE_EQ(1000, h.max());
+    ATF_REQUIRE_EQ(100, h.percentile(10.0));
+    ATF_REQUIRE(h.percentile(99.0) >= 990);
+    ATF_REQUIRE(h.percentile(99.0) <= 990 + 990 / 64);
+}
+
+ATF_TEST_CASE_WITHOUT_HEAD(histogram__merge);
+ATF_TEST_CASE_BODY(histogram__merge)
+{
+    atf::utils::histogram h1, h2;
+    for (int i = 0; i < 90; i++)
+        h1.record(10);
+    for (int i = 0; i < 10; i++)
+        h2.record(50000);
+
+    atf::utils::histogram copy(h1);
+    copy.merge(h2);
+    ATF_REQUIRE_EQ(90, h1.count());
+    ATF_REQUIRE_EQ(100, copy.count());
+    ATF_REQUIRE_EQ(10, copy.percentile(90.0));
+    ATF_REQUIRE_EQ(50000, copy.percentile(91.0));
+
+    h1 = copy;
+    ATF_REQUIRE_EQ(100, h1.count());
+}
+
+ATF_TEST_CASE_WITHOUT_HEAD(histogram__print);
+ATF_TEST_CASE_BODY(histogram__print)
+{
+    atf::utils::histogram h;
+    h.record(3);
+    h.record(3);
+    h.record(1000);
+
+    std::ostringstream out;
+    h.print(out);
+    ATF_REQUIRE(atf::utils::grep_string("3 values, min 3, mean 335, max 1000",
+                                        out.str()));
+    ATF_REQUIRE(atf::utils::grep_string("    \\[3, 3\\]: 2\n", out.str()));
+    ATF_REQUIRE(atf::utils::grep_string("    \\[1000, 1007\\]: 1\n",
+                                        out.str()));
+}
+
+ATF_TEST_CASE_WITHOUT_HEAD(p99_below__ok);
+ATF_TEST_CASE_BODY(p99_below__ok)
+{
+    atf::utils::histogram h;
+    for (int i = 0; i < 1000; i++)
+        h.record(i < 995 ? 100 : 100000);
+    ATF_CHECK_P50_BELOW(h, 101);
+    ATF_REQUIRE_P99_BELOW(h, 101);
+}
+
+ATF_TEST_CASE_WITHOUT_HEAD(p99_below__exceeded);
+ATF_TEST_CASE_BODY(p99_below__exceeded)
+{
+    atf::utils::histogram h;
+    for (int i = 0; i < 1000; i++)
+        h.record(i < 980 ? 100 : 100000);
+
+    expect_fail("p99 is above the limit");
+    ATF_CHECK_P99_BELOW(h, 1000);
+}
+
+ATF_TEST_CASE_WITHOUT_HEAD(io_stats);
+ATF_TEST_CASE_BODY(io_stats)
+{
+    atf::utils::io_stats before, after;
+    if (!atf::utils::get_io_stats(before))
+        ATF_SKIP("I/O accounting not available");
+
+    atf::utils::create_file("test.txt", "12345");
+    ATF_REQUIRE(atf::utils::get_io_stats(after));
+    ATF_REQUIRE_EQ(before.writes + 1, after.writes);
+    ATF_REQUIRE_EQ(before.write_bytes + 5, after.write_bytes);
+}
+
+ATF_TEST_CASE_WITHOUT_HEAD(reads_at_most__ok);
+ATF_TEST_CASE_BODY(reads_at_most__ok)
+{
+    atf::utils::create_file("test.txt", "12345");
+    ATF_REQUIRE_READS_AT_MOST(2, 5) {
+        ATF_REQUIRE(atf::utils::compare_file("test.txt", "12345"));
+    }
+}
+
+ATF_TEST_CASE_WITHOUT_HEAD(writes_at_most__exceeded);
+ATF_TEST_CASE_BODY(writes_at_most__exceeded)
+{
+    expect_fail("The scope writes more than permitted");
+    ATF_CHECK_WRITES_AT_MOST(1, 4) {
+        atf::utils::create_file("test.txt", "12345");
+    }
+}
+
 ATF_TEST_CASE_WITHOUT_HEAD(redirect__stdout);
 ATF_TEST_CASE_BODY(redirect__stdout)
 {
@@ -470,6 +629,11 @@ ATF_TEST_CASE_BODY(wait__save_stderr)
 ATF_INIT_TEST_CASES(tcs)
 {
     // Add the test for the free functions.
+    ATF_ADD_TEST_CASE(tcs, alloc_stats);
+    ATF_ADD_TEST_CASE(tcs, allocs_at_most__ok);
+    ATF_ADD_TEST_CASE(tcs, no_allocs__violated);
+    ATF_ADD_TEST_CASE(tcs, leak_check__leaky);
+
     ATF_ADD_TEST_CASE(tcs, cat_file__empty);
     ATF_ADD_TEST_CASE(tcs, cat_file__one_line);
     ATF_ADD_TEST_CASE(tcs, cat_file__several_lines);
@@ -496,6 +660,16 @@ ATF_INIT_TEST_CASES(tcs)
     ATF_ADD_TEST_CASE(tcs, grep_file);
     ATF_ADD_TEST_CASE(tcs, grep_string);
 
+    ATF_ADD_TEST_CASE(tcs, histogram__percentile);
+    ATF_ADD_TEST_CASE(tcs, histogram__merge);
+    ATF_ADD_TEST_CASE(tcs, histogram__print);
+    ATF_ADD_TEST_CASE(tcs, p99_below__ok);
+    ATF_ADD_TEST_CASE(tcs, p99_below__exceeded);
+
+    ATF_ADD_TEST_CASE(tcs, io_stats);
+    ATF_ADD_TEST_CASE(tcs, reads_at_most__ok);
+    ATF_ADD_TEST_CASE(tcs, writes_at_most__exceeded);
+
     ATF_ADD_TEST_CASE(tcs, redirect__stdout);
     ATF_ADD_TEST_CASE(tcs, redirect__stderr);
     ATF_ADD_TEST_CASE(tcs, redirect__other);
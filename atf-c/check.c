@@ -29,6 +29,8 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -72,30 +74,27 @@ out:
     return err;
 }
 
+/* Uses unlink(2) directly because this also runs while an error is being
+ * reported, and only one atf_error_t can be on flight at a time. */
+static
+void
+cleanup_file(const atf_fs_path_t *file)
+{
+    if (unlink(atf_fs_path_cstring(file)) == -1)
+        INV(errno == ENOENT);
+}
+
+/* The output files are only removed if they are not NULL, which is the
+ * case when they live outside of the temporary directory. */
 static
 void
 cleanup_tmpdir(const atf_fs_path_t *dir, const atf_fs_path_t *outfile,
                const atf_fs_path_t *errfile)
 {
-    {
-        atf_error_t err = atf_fs_unlink(outfile);
-        if (atf_is_error(err)) {
-            INV(atf_error_is(err, "libc") &&
-                atf_libc_error_code(err) == ENOENT);
-            atf_error_free(err);
-        } else
-            INV(!atf_is_error(err));
-    }
-
-    {
-        atf_error_t err = atf_fs_unlink(errfile);
-        if (atf_is_error(err)) {
-            INV(atf_error_is(err, "libc") &&
-                atf_libc_error_code(err) == ENOENT);
-            atf_error_free(err);
-        } else
-            INV(!atf_is_error(err));
-    }
+    if (outfile != NULL)
+        cleanup_file(outfile);
+    if (errfile != NULL)
+        cleanup_file(errfile);
 
     {
         atf_error_t err = atf_fs_rmdir(dir);
@@ -191,6 +190,227 @@ out:
     return err;
 }
 
+/* Amount of output kept by an atf_check_capture_probe stream; enough to
+ * tell whether the stream was empty and to show what it started with. */
+#define PROBE_PREFIX 4096
+
+struct probe {
+    int m_fd;
+    int m_out;
+    size_t m_kept;
+};
+
+static
+atf_error_t
+probe_init(struct probe *p, const atf_fs_path_t *path)
+{
+    p->m_fd = -1;
+    p->m_kept = 0;
+    p->m_out = open(atf_fs_path_cstring(path),
+                    O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (p->m_out == -1)
+        return atf_libc_error(errno, "Could not create %s",
+                              atf_fs_path_cstring(path));
+    return atf_no_error();
+}
+
+static
+void
+probe_fini(struct probe *p)
+{
+    if (p->m_out != -1)
+        close(p->m_out);
+}
+
+/* Reads whatever the child has written to the probed stream, keeping only
+ * the first PROBE_PREFIX bytes.  The pipe itself is closed when the child
+ * is waited for, so reaching EOF just stops watching it.  Errors are not
+ * reported because they would only lose output that is being discarded. */
+static
+void
+probe_read(struct probe *p)
+{
+    char buf[4096];
+    ssize_t n;
+
+    n = read(p->m_fd, buf, sizeof(buf));
+    if (n == -1) {
+        if (errno != EINTR && errno != EAGAIN)
+            p->m_fd = -1;
+        return;
+    } else if (n == 0) {
+        p->m_fd = -1;
+        return;
+    }
+
+    if (p->m_kept < PROBE_PREFIX) {
+        size_t keep = (size_t)n;
+        if (keep > PROBE_PREFIX - p->m_kept)
+            keep = PROBE_PREFIX - p->m_kept;
+        if (write(p->m_out, buf, keep) == (ssize_t)keep)
+            p->m_kept += keep;
+        else
+            p->m_kept = PROBE_PREFIX;
+    }
+}
+
+/* Returns whether the child has terminated without reaping it, so that
+ * atf_process_child_wait() can still collect its status and resources. */
+static
+bool
+child_terminated(const atf_process_child_t *child)
+{
+    siginfo_t info;
+
+    memset(&info, 0, sizeof(info));
+    if (waitid(P_PID, atf_process_child_pid(child), &info,
+               WEXITED | WNOHANG | WNOWAIT) == -1)
+        return errno != EINTR;
+    return info.si_pid != 0;
+}
+
+/* Pumps the probed streams until they are closed.  Background processes
+ * spawned by the command may keep the pipes open past its termination, so
+ * the pump also stops once the child is gone and nothing is left to read. */
+static
+void
+pump_probes(const atf_process_child_t *child, struct probe *probes,
+            const size_t nprobes)
+{
+    bool terminated = false;
+
+    for (;;) {
+        struct pollfd fds[2];
+        struct probe *owners[2];
+        nfds_t nfds = 0;
+        size_t i;
+        int ret;
+
+        for (i = 0; i < nprobes; i++) {
+            if (probes[i].m_fd != -1) {
+                fds[nfds].fd = probes[i].m_fd;
+                fds[nfds].events = POLLIN;
+                owners[nfds] = &probes[i];
+                nfds++;
+            }
+        }
+        if (nfds == 0)
+            break;
+
+        ret = poll(fds, nfds, terminated ? 0 : 100);
+        if (ret == -1) {
+            if (errno == EINTR)
+                continue;
+            break;
+        } else if (ret == 0) {
+            if (terminated)
+                break;
+            terminated = child_terminated(child);
+            continue;
+        }
+
+        for (i = 0; i < nfds; i++) {
+            if (fds[i].revents != 0)
+                probe_read(owners[i]);
+        }
+    }
+}
+
+static
+atf_error_t
+init_capture_sb(const atf_check_capture_t *capture,
+                const atf_fs_path_t *path, atf_process_stream_t *sb)
+{
+    atf_error_t err;
+
+    switch (capture->m_type) {
+    case atf_check_capture_probe:
+        err = atf_process_stream_init_capture(sb);
+        break;
+
+    case atf_check_capture_path: {
+        /* Create the destination here so that a bad path is reported as
+         * an error instead of as a failure of the child. */
+        const int fd = open(atf_fs_path_cstring(path),
+                            O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd == -1) {
+            err = atf_libc_error(errno, "Could not create %s",
+                                 atf_fs_path_cstring(path));
+            break;
+        }
+        close(fd);
+        err = atf_process_stream_init_redirect_path(sb, path);
+        break;
+    }
+
+    default:
+        err = atf_process_stream_init_redirect_path(sb, path);
+        break;
+    }
+
+    return err;
+}
+
+static
+atf_error_t
+fork_and_capture(const char *const *argv,
+                 const atf_check_capture_t *outcap,
+                 const atf_fs_path_t *outfile,
+                 const atf_check_capture_t *errcap,
+                 const atf_fs_path_t *errfile,
+                 atf_process_status_t *status)
+{
+    atf_error_t err;
+    atf_process_child_t child;
+    atf_process_stream_t outsb, errsb;
+    struct exec_data ea = { argv };
+    struct probe probes[2];
+    size_t nprobes = 0;
+
+    err = init_capture_sb(outcap, outfile, &outsb);
+    if (atf_is_error(err))
+        goto out;
+
+    err = init_capture_sb(errcap, errfile, &errsb);
+    if (atf_is_error(err))
+        goto out_outsb;
+
+    if (outcap->m_type == atf_check_capture_probe) {
+        err = probe_init(&probes[nprobes], outfile);
+        if (atf_is_error(err))
+            goto out_probes;
+        nprobes++;
+    }
+    if (errcap->m_type == atf_check_capture_probe) {
+        err = probe_init(&probes[nprobes], errfile);
+        if (atf_is_error(err))
+            goto out_probes;
+        nprobes++;
+    }
+
+    err = atf_process_fork(&child, exec_child, &outsb, &errsb, &ea);
+    if (atf_is_error(err))
+        goto out_probes;
+
+    nprobes = 0;
+    if (outcap->m_type == atf_check_capture_probe)
+        probes[nprobes++].m_fd = atf_process_child_stdout(&child);
+    if (errcap->m_type == atf_check_capture_probe)
+        probes[nprobes++].m_fd = atf_process_child_stderr(&child);
+
+    pump_probes(&child, probes, nprobes);
+    err = atf_process_child_wait(&child, status);
+
+out_probes:
+    while (nprobes > 0)
+        probe_fini(&probes[--nprobes]);
+    atf_process_stream_fini(&errsb);
+out_outsb:
+    atf_process_stream_fini(&outsb);
+out:
+    return err;
+}
+
 static
 void
 update_success_from_status(const char *progname,
@@ -289,13 +509,42 @@ struct atf_check_result_impl {
     atf_fs_path_t m_dir;
     atf_fs_path_t m_stdout;
     atf_fs_path_t m_stderr;
+    bool m_stdout_owned;
+    bool m_stderr_owned;
     atf_process_status_t m_status;
 };
 
+/* Determines where a captured stream ends up.  Only the files that live in
+ * the temporary directory belong to the result. */
+static
+atf_error_t
+init_capture_path(atf_fs_path_t *path, bool *owned,
+                  const atf_check_capture_t *capture,
+                  const atf_fs_path_t *dir, const char *name)
+{
+    switch (capture->m_type) {
+    case atf_check_capture_discard:
+        *owned = false;
+        return atf_fs_path_init_fmt(path, "/dev/null");
+
+    case atf_check_capture_path:
+        PRE(capture->m_path != NULL);
+        *owned = false;
+        return atf_fs_path_init_fmt(path, "%s", capture->m_path);
+
+    default:
+        *owned = true;
+        return atf_fs_path_init_fmt(path, "%s/%s", atf_fs_path_cstring(dir),
+                                    name);
+    }
+}
+
 static
 atf_error_t
 atf_check_result_init(atf_check_result_t *r, const char *const *argv,
-                      const atf_fs_path_t *dir)
+                      const atf_fs_path_t *dir,
+                      const atf_check_capture_t *outcap,
+                      const atf_check_capture_t *errcap)
 {
     atf_error_t err;
 
@@ -311,13 +560,13 @@ atf_check_result_init(atf_check_result_t *r, const char *const *argv,
     if (atf_is_error(err))
         goto err_argv;
 
-    err = atf_fs_path_init_fmt(&r->pimpl->m_stdout, "%s/stdout",
-                               atf_fs_path_cstring(dir));
+    err = init_capture_path(&r->pimpl->m_stdout, &r->pimpl->m_stdout_owned,
+                            outcap, dir, "stdout");
     if (atf_is_error(err))
         goto err_dir;
 
-    err = atf_fs_path_init_fmt(&r->pimpl->m_stderr, "%s/stderr",
-                               atf_fs_path_cstring(dir));
+    err = init_capture_path(&r->pimpl->m_stderr, &r->pimpl->m_stderr_owned,
+                            errcap, dir, "stderr");
     if (atf_is_error(err))
         goto err_stdout;
 
@@ -339,8 +588,9 @@ atf_check_result_fini(atf_check_result_t *r)
 {
     atf_process_status_fini(&r->pimpl->m_status);
 
-    cleanup_tmpdir(&r->pimpl->m_dir, &r->pimpl->m_stdout,
-                   &r->pimpl->m_stderr);
+    cleanup_tmpdir(&r->pimpl->m_dir,
+                   r->pimpl->m_stdout_owned ? &r->pimpl->m_stdout : NULL,
+                   r->pimpl->m_stderr_owned ? &r->pimpl->m_stderr : NULL);
     atf_fs_path_fini(&r->pimpl->m_stdout);
     atf_fs_path_fini(&r->pimpl->m_stderr);
     atf_fs_path_fini(&r->pimpl->m_dir);
@@ -386,6 +636,30 @@ atf_check_result_termsig(const atf_check_result_t *r)
     return atf_process_status_termsig(&r->pimpl->m_status);
 }
 
+unsigned long long
+atf_check_result_wall_usecs(const atf_check_result_t *r)
+{
+    return atf_process_status_wall_usecs(&r->pimpl->m_status);
+}
+
+unsigned long long
+atf_check_result_user_usecs(const atf_check_result_t *r)
+{
+    return atf_process_status_user_usecs(&r->pimpl->m_status);
+}
+
+unsigned long long
+atf_check_result_system_usecs(const atf_check_result_t *r)
+{
+    return atf_process_status_system_usecs(&r->pimpl->m_status);
+}
+
+unsigned long long
+atf_check_result_maxrss_kib(const atf_check_result_t *r)
+{
+    return atf_process_status_maxrss_kib(&r->pimpl->m_status);
+}
+
 /* ---------------------------------------------------------------------
  * Free functions.
  * --------------------------------------------------------------------- */
@@ -455,6 +729,17 @@ out:
 
 atf_error_t
 atf_check_exec_array(const char *const *argv, atf_check_result_t *r)
+{
+    const atf_check_capture_t capture = { atf_check_capture_file, NULL };
+
+    return atf_check_exec_array_capture(argv, &capture, &capture, r);
+}
+
+atf_error_t
+atf_check_exec_array_capture(const char *const *argv,
+                             const atf_check_capture_t *outcap,
+                             const atf_check_capture_t *errcap,
+                             atf_check_result_t *r)
 {
     atf_error_t err;
     atf_fs_path_t dir;
@@ -463,15 +748,15 @@ atf_check_exec_array(const char *const *argv, atf_check_result_t *r)
     if (atf_is_error(err))
         goto out;
 
-    err = atf_check_result_init(r, argv, &dir);
+    err = atf_check_result_init(r, argv, &dir, outcap, errcap);
     if (atf_is_error(err)) {
         atf_error_t err2 = atf_fs_rmdir(&dir);
         INV(!atf_is_error(err2));
         goto out;
     }
 
-    err = fork_and_wait(argv, &r->pimpl->m_stdout, &r->pimpl->m_stderr,
-                        &r->pimpl->m_status);
+    err = fork_and_capture(argv, outcap, &r->pimpl->m_stdout,
+                           errcap, &r->pimpl->m_stderr, &r->pimpl->m_status);
     if (atf_is_error(err)) {
         atf_check_result_fini(r);
         goto out;
@@ -30,6 +30,27 @@
 
 #include <atf-c/error_fwd.h>
 
+/* ---------------------------------------------------------------------
+ * The "atf_check_capture" type.
+ * --------------------------------------------------------------------- */
+
+/* How atf_check_exec_array_capture() handles one of the output streams of
+ * the command it runs. */
+enum atf_check_capture_type {
+    atf_check_capture_file,     /* Store everything in a temporary file. */
+    atf_check_capture_discard,  /* Send everything to /dev/null. */
+    atf_check_capture_probe,    /* Store the first bytes; discard the rest. */
+    atf_check_capture_path,     /* Store everything in m_path. */
+};
+
+struct atf_check_capture {
+    enum atf_check_capture_type m_type;
+
+    /* Valid if m_type == atf_check_capture_path. */
+    const char *m_path;
+};
+typedef struct atf_check_capture atf_check_capture_t;
+
 /* ---------------------------------------------------------------------
  * The "atf_check_result" type.
  * --------------------------------------------------------------------- */
@@ -50,6 +71,10 @@ bool atf_check_result_exited(const atf_check_result_t *);
 int atf_check_result_exitcode(const atf_check_result_t *);
 bool atf_check_result_signaled(const atf_check_result_t *);
 int atf_check_result_termsig(const atf_check_result_t *);
+unsigned long long atf_check_result_wall_usecs(const atf_check_result_t *);
+unsigned long long atf_check_result_user_usecs(const atf_check_result_t *);
+unsigned long long atf_check_result_system_usecs(const atf_check_result_t *);
+unsigned long long atf_check_result_maxrss_kib(const atf_check_result_t *);
 
 /* ---------------------------------------------------------------------
  * Free functions.
@@ -65,5 +90,9 @@ atf_error_t atf_check_build_cxx_o(const char *, const char *,
                                   const char *const [],
                                   bool *);
 atf_error_t atf_check_exec_array(const char *const *, atf_check_result_t *);
+atf_error_t atf_check_exec_array_capture(const char *const *,
+                                         const atf_check_capture_t *,
+                                         const atf_check_capture_t *,
+                                         atf_check_result_t *);
 
 #endif /* !defined(ATF_C_CHECK_H) */
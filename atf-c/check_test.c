@@ -25,6 +25,8 @@
 
 #include "atf-c/check.h"
 
+#include <sys/stat.h>
+
 #include <fcntl.h>
 #include <signal.h>
 #include <stdio.h>
@@ -327,6 +329,53 @@ ATF_TC_BODY(exec_array, tc)
     atf_fs_path_fini(&process_helpers);
 }
 
+ATF_TC(exec_capture);
+ATF_TC_HEAD(exec_capture, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks that atf_check_exec_array_capture "
+                      "honors the requested capture of each stream");
+}
+ATF_TC_BODY(exec_capture, tc)
+{
+    const char *argv[] = { "/bin/sh", "-c",
+        "i=0; while [ $i -lt 1000 ]; do echo 0123456789; i=$((i + 1)); "
+        "done; echo err 1>&2", NULL };
+    atf_check_result_t result;
+    atf_fs_path_t path;
+    bool exists;
+
+    {
+        const atf_check_capture_t out = { atf_check_capture_discard, NULL };
+        const atf_check_capture_t err = { atf_check_capture_probe, NULL };
+        RE(atf_check_exec_array_capture(argv, &out, &err, &result));
+    }
+    ATF_CHECK(atf_check_result_exited(&result));
+    ATF_CHECK_STREQ("/dev/null", atf_check_result_stdout(&result));
+    ATF_CHECK(atf_utils_compare_file(atf_check_result_stderr(&result),
+                                     "err\n"));
+    atf_check_result_fini(&result);
+
+    {
+        const atf_check_capture_t out = { atf_check_capture_probe, NULL };
+        const atf_check_capture_t err = { atf_check_capture_path, "saved" };
+        RE(atf_check_exec_array_capture(argv, &out, &err, &result));
+    }
+    ATF_CHECK(atf_check_result_exited(&result));
+    {
+        struct stat sb;
+        ATF_REQUIRE(stat(atf_check_result_stdout(&result), &sb) != -1);
+        ATF_CHECK(sb.st_size > 0 && sb.st_size < 11000);
+    }
+    ATF_CHECK_STREQ("saved", atf_check_result_stderr(&result));
+    atf_check_result_fini(&result);
+
+    RE(atf_fs_path_init_fmt(&path, "saved"));
+    RE(atf_fs_exists(&path, &exists));
+    ATF_CHECK(exists);
+    ATF_CHECK(atf_utils_compare_file("saved", "err\n"));
+    atf_fs_path_fini(&path);
+}
+
 ATF_TC(exec_cleanup);
 ATF_TC_HEAD(exec_cleanup, tc)
 {
@@ -390,6 +439,27 @@ ATF_TC_BODY(exec_exitstatus, tc)
     }
 }
 
+ATF_TC(exec_resources);
+ATF_TC_HEAD(exec_resources, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks that atf_check_exec_array "
+                      "records the resources used by the executed command");
+}
+ATF_TC_BODY(exec_resources, tc)
+{
+    atf_check_result_t result;
+    const char *argv[] = { "/bin/sh", "-c", "sleep 1", NULL };
+
+    RE(atf_check_exec_array(argv, &result));
+    ATF_CHECK(atf_check_result_exited(&result));
+    ATF_CHECK(atf_check_result_wall_usecs(&result) >= 900000);
+    ATF_CHECK(atf_check_result_user_usecs(&result) +
+              atf_check_result_system_usecs(&result) <
+              atf_check_result_wall_usecs(&result));
+    ATF_CHECK(atf_check_result_maxrss_kib(&result) > 0);
+    atf_check_result_fini(&result);
+}
+
 ATF_TC(exec_stdout_stderr);
 ATF_TC_HEAD(exec_stdout_stderr, tc)
 {
@@ -511,8 +581,10 @@ ATF_TP_ADD_TCS(tp)
     ATF_TP_ADD_TC(tp, build_cpp);
     ATF_TP_ADD_TC(tp, build_cxx_o);
     ATF_TP_ADD_TC(tp, exec_array);
+    ATF_TP_ADD_TC(tp, exec_capture);
     ATF_TP_ADD_TC(tp, exec_cleanup);
     ATF_TP_ADD_TC(tp, exec_exitstatus);
+    ATF_TP_ADD_TC(tp, exec_resources);
     ATF_TP_ADD_TC(tp, exec_stdout_stderr);
     ATF_TP_ADD_TC(tp, exec_umask);
     ATF_TP_ADD_TC(tp, exec_unknown);
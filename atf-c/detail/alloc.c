@@ -0,0 +1,154 @@
+/* Copyright (c) 2026 The NetBSD Foundation, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+ * CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.  */
+
+#if defined(HAVE_CONFIG_H)
+#include "config.h"
+#endif
+
+#include "atf-c/detail/alloc.h"
+
+#if defined(HAVE_DLFCN_H)
+#include <dlfcn.h>
+#endif
+#include <stddef.h>
+#include <string.h>
+
+#include "atf-c/tc.h"
+
+/* Entry points of the interposer, looked up once by lookup(). */
+static bool looked_up = false;
+static const struct atf_alloc_counters *(*counters_getter)(void) = NULL;
+static void (*pauser)(bool) = NULL;
+
+/* Location of the allocation-counting blocks that are open, innermost
+ * last. */
+#define MAX_SCOPES 16
+static struct scope {
+    const char *m_file;
+    size_t m_line;
+} scopes[MAX_SCOPES];
+static size_t nscopes = 0;
+
+/* ---------------------------------------------------------------------
+ * Auxiliary functions.
+ * --------------------------------------------------------------------- */
+
+/** Locates the entry points of the libatf-c-alloc interposer.
+ *
+ * The lookup is done only once: it may allocate memory itself, and callers
+ * take their snapshots of the counters after the first lookup. */
+static
+void
+lookup(void)
+{
+    if (looked_up)
+        return;
+
+#if defined(HAVE_DLFCN_H)
+    {
+        void *self = dlopen(NULL, RTLD_LAZY);
+        if (self != NULL) {
+            void *sym;
+
+            sym = dlsym(self, ATF_ALLOC_COUNTERS_SYMBOL);
+            memcpy(&counters_getter, &sym, sizeof(counters_getter));
+            sym = dlsym(self, ATF_ALLOC_PAUSE_SYMBOL);
+            memcpy(&pauser, &sym, sizeof(pauser));
+            dlclose(self);
+        }
+    }
+#endif
+    looked_up = true;
+}
+
+/** Closes the open blocks from the given depth on.
+ *
+ * \param depth Depth of the outermost block to close.
+ * \param report_from Depth of the outermost block to report as left
+ *     without checking its budget. */
+static
+void
+close_scopes(const size_t depth, const size_t report_from)
+{
+    size_t i;
+
+    for (i = report_from; i < nscopes; i++)
+        atf_tc_fail_check(scopes[i].m_file, scopes[i].m_line, "Block left "
+            "early with break, goto or return; its allocation budget was "
+            "not checked");
+    if (depth < nscopes)
+        nscopes = depth;
+}
+
+/* ---------------------------------------------------------------------
+ * Free functions.
+ * --------------------------------------------------------------------- */
+
+const struct atf_alloc_counters *
+atf_alloc_get_counters(void)
+{
+    lookup();
+    return counters_getter == NULL ? NULL : counters_getter();
+}
+
+void
+atf_alloc_suspend(void)
+{
+    lookup();
+    if (pauser != NULL)
+        pauser(true);
+}
+
+void
+atf_alloc_resume(void)
+{
+    lookup();
+    if (pauser != NULL)
+        pauser(false);
+}
+
+bool
+atf_alloc_scope_push(const char *file, size_t line, size_t *depth)
+{
+    if (nscopes == MAX_SCOPES)
+        return false;
+
+    scopes[nscopes].m_file = file;
+    scopes[nscopes].m_line = line;
+    *depth = nscopes++;
+    return true;
+}
+
+void
+atf_alloc_scope_pop(size_t depth)
+{
+    close_scopes(depth, depth + 1);
+}
+
+void
+atf_alloc_scope_pop_all(bool report)
+{
+    close_scopes(0, report ? 0 : nscopes);
+}
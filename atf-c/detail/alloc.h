@@ -0,0 +1,83 @@
+/* Copyright (c) 2026 The NetBSD Foundation, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+ * CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.  */
+
+#if !defined(ATF_C_DETAIL_ALLOC_H)
+#define ATF_C_DETAIL_ALLOC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* ---------------------------------------------------------------------
+ * Interface between libatf-c and the libatf-c-alloc interposer.
+ * --------------------------------------------------------------------- */
+
+/* Counters maintained by the interposer.  Sizes are those reported by
+ * malloc_usable_size(3) so that blocks can be accounted for on release
+ * without keeping any bookkeeping of our own. */
+struct atf_alloc_counters {
+    unsigned long long m_allocs;
+    unsigned long long m_frees;
+    unsigned long long m_bytes;
+    unsigned long long m_live_bytes;
+};
+
+/* Name of the symbol exported by the interposer.  libatf-c looks it up at
+ * run time so that it does not depend on the interposer being present. */
+#define ATF_ALLOC_COUNTERS_SYMBOL "atf_alloc_counters"
+
+/* Name of the symbol that stops (when given true) and restarts (when given
+ * false) the counters.  Calls nest. */
+#define ATF_ALLOC_PAUSE_SYMBOL "atf_alloc_pause"
+
+const struct atf_alloc_counters *atf_alloc_counters(void);
+void atf_alloc_pause(bool);
+
+/* ---------------------------------------------------------------------
+ * Access to the interposer from libatf-c.
+ * --------------------------------------------------------------------- */
+
+/* Returns the counters of the interposer, or NULL if it is not loaded. */
+const struct atf_alloc_counters *atf_alloc_get_counters(void);
+
+/* Stop and restart counting around the allocations that libatf-c does for
+ * its own purposes while a test case runs, so that they are reported
+ * neither as part of the allocation budgets nor as leaks of the test case.
+ * The calls nest and do nothing if the interposer is not loaded. */
+void atf_alloc_suspend(void);
+void atf_alloc_resume(void);
+
+/* Bookkeeping of the ATF_*_ALLOCS_AT_MOST blocks that have been entered and
+ * not left yet, so that a block left without checking its budget (e.g.
+ * with break, goto or return) is reported instead of passing silently.
+ * atf_alloc_scope_push stores the nesting depth of the new block and fails
+ * if the blocks are nested too deeply.  atf_alloc_scope_pop closes a block
+ * and reports the blocks nested in it that were left early.
+ * atf_alloc_scope_pop_all closes every block, reporting them if asked to,
+ * and is used at the boundaries of the test case body. */
+bool atf_alloc_scope_push(const char *, size_t, size_t *);
+void atf_alloc_scope_pop(size_t);
+void atf_alloc_scope_pop_all(bool);
+
+#endif /* !defined(ATF_C_DETAIL_ALLOC_H) */
@@ -0,0 +1,366 @@
+/* Copyright (c) 2026 The NetBSD Foundation, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+ * CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.  */
+
+/* libatf-c-alloc: a thin layer on top of the system allocator that counts
+ * every allocation and release done by the process.  It is meant to be
+ * either preloaded (LD_PRELOAD) into a test program or linked into it
+ * ahead of the C library; libatf-c queries the counters through the
+ * atf_alloc_counters() entry point to implement its allocation assertions.
+ *
+ * All memory comes from the real allocator so that blocks can cross the
+ * boundary freely (e.g. memory obtained before the interposer was loaded
+ * or by code that calls into the allocator through private symbols). */
+
+#if !defined(_GNU_SOURCE)
+#   define _GNU_SOURCE
+#endif
+
+#if defined(HAVE_CONFIG_H)
+#include "config.h"
+#endif
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#if defined(HAVE_MALLOC_NP_H)
+#   include <malloc_np.h>
+#elif defined(HAVE_MALLOC_H)
+#   include <malloc.h>
+#endif
+
+#include "atf-c/detail/alloc.h"
+
+#if defined(__GNUC__)
+#   define COUNTER_ADD(var, val) __atomic_add_fetch(&(var), (val), \
+                                                    __ATOMIC_RELAXED)
+#   define COUNTER_SUB(var, val) __atomic_sub_fetch(&(var), (val), \
+                                                    __ATOMIC_RELAXED)
+#else
+#   define COUNTER_ADD(var, val) ((var) += (val))
+#   define COUNTER_SUB(var, val) ((var) -= (val))
+#endif
+
+typedef void *(*malloc_fn)(size_t);
+typedef void *(*calloc_fn)(size_t, size_t);
+typedef void *(*realloc_fn)(void *, size_t);
+typedef void (*free_fn)(void *);
+typedef int (*posix_memalign_fn)(void **, size_t, size_t);
+
+static struct {
+    malloc_fn m_malloc;
+    calloc_fn m_calloc;
+    realloc_fn m_realloc;
+    posix_memalign_fn m_posix_memalign;
+    free_fn m_free;
+} real;
+
+static struct atf_alloc_counters counters;
+
+/* Nesting level of the atf_alloc_pause() calls in effect.  libatf-c pauses
+ * the counters while it runs its own code on behalf of a test case, so
+ * that the memory it needs (e.g. to grow its arena) is not charged to the
+ * test case.  As with the rest of libatf-c, this assumes that there is a
+ * single thread. */
+static unsigned int paused = 0;
+
+/* Memory handed out while the real allocator is being looked up: dlsym(3)
+ * may need to allocate on some systems, and those requests cannot be
+ * forwarded anywhere yet.  These blocks are never released. */
+static union {
+    char m_buf[8192];
+    long double m_ld;
+    void *m_ptr;
+} bootstrap;
+static size_t bootstrap_used = 0;
+static bool resolving = false;
+
+/* ---------------------------------------------------------------------
+ * Auxiliary functions.
+ * --------------------------------------------------------------------- */
+
+static
+void *
+bootstrap_alloc(size_t size)
+{
+    void *p;
+
+    size = (size + 15) & ~(size_t)15;
+    if (size > sizeof(bootstrap.m_buf) - bootstrap_used)
+        return NULL;
+
+    p = bootstrap.m_buf + bootstrap_used;
+    bootstrap_used += size;
+    return p;
+}
+
+static
+bool
+is_bootstrap(const void *p)
+{
+    const char *c = p;
+
+    return c >= bootstrap.m_buf && c < bootstrap.m_buf + sizeof(bootstrap.m_buf);
+}
+
+#define LOOKUP(field, name) \
+    do { \
+        void *sym = dlsym(RTLD_NEXT, name); \
+        memcpy(&real.field, &sym, sizeof(real.field)); \
+    } while (0)
+
+/** Looks up the real allocator functions.
+ *
+ * \return True if the real allocator can be used; false while the lookup
+ * is in progress or if it failed. */
+static
+bool
+resolve(void)
+{
+    if (real.m_free != NULL)
+        return true;
+    if (resolving)
+        return false;
+
+    resolving = true;
+    LOOKUP(m_malloc, "malloc");
+    LOOKUP(m_calloc, "calloc");
+    LOOKUP(m_realloc, "realloc");
+    LOOKUP(m_posix_memalign, "posix_memalign");
+    if (real.m_malloc != NULL && real.m_calloc != NULL &&
+        real.m_realloc != NULL && real.m_posix_memalign != NULL)
+        LOOKUP(m_free, "free");
+    resolving = false;
+
+    return real.m_free != NULL;
+}
+
+static
+void
+count_alloc(void *p)
+{
+    size_t size;
+
+    if (p == NULL || paused > 0)
+        return;
+
+    size = malloc_usable_size(p);
+    COUNTER_ADD(counters.m_allocs, 1);
+    COUNTER_ADD(counters.m_bytes, size);
+    COUNTER_ADD(counters.m_live_bytes, size);
+}
+
+static
+void
+count_free(void *p)
+{
+    if (paused > 0)
+        return;
+
+    COUNTER_ADD(counters.m_frees, 1);
+    COUNTER_SUB(counters.m_live_bytes, malloc_usable_size(p));
+}
+
+static
+void *
+aligned(size_t alignment, size_t size)
+{
+    void *p;
+    int ret;
+
+    ret = posix_memalign(&p, alignment, size);
+    if (ret != 0) {
+        errno = ret;
+        return NULL;
+    }
+    return p;
+}
+
+/* ---------------------------------------------------------------------
+ * Interposed functions.
+ * --------------------------------------------------------------------- */
+
+void *
+malloc(size_t size)
+{
+    void *p;
+
+    if (!resolve())
+        return bootstrap_alloc(size);
+
+    p = real.m_malloc(size);
+    count_alloc(p);
+    return p;
+}
+
+void *
+calloc(size_t nmemb, size_t size)
+{
+    void *p;
+
+    if (!resolve()) {
+        if (size != 0 && nmemb > SIZE_MAX / size)
+            return NULL;
+        /* The bootstrap buffer is never reused, so it is still zeroed. */
+        return bootstrap_alloc(nmemb * size);
+    }
+
+    p = real.m_calloc(nmemb, size);
+    count_alloc(p);
+    return p;
+}
+
+void *
+realloc(void *ptr, size_t size)
+{
+    size_t old_size;
+    void *p;
+
+    if (ptr == NULL)
+        return malloc(size);
+
+    if (is_bootstrap(ptr)) {
+        const size_t avail = (size_t)(bootstrap.m_buf +
+            sizeof(bootstrap.m_buf) - (char *)ptr);
+
+        p = malloc(size);
+        if (p != NULL)
+            memcpy(p, ptr, size < avail ? size : avail);
+        return p;
+    }
+
+    if (size == 0) {
+        free(ptr);
+        return NULL;
+    }
+
+    if (!resolve())
+        return NULL;
+
+    old_size = malloc_usable_size(ptr);
+    p = real.m_realloc(ptr, size);
+    if (p != NULL && paused == 0) {
+        COUNTER_ADD(counters.m_frees, 1);
+        COUNTER_SUB(counters.m_live_bytes, old_size);
+        count_alloc(p);
+    }
+    return p;
+}
+
+#if defined(HAVE_REALLOCARRAY)
+void *
+reallocarray(void *ptr, size_t nmemb, size_t size)
+{
+    if (size != 0 && nmemb > SIZE_MAX / size) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    return realloc(ptr, nmemb * size);
+}
+#endif
+
+void
+free(void *ptr)
+{
+    if (ptr == NULL || is_bootstrap(ptr))
+        return;
+
+    if (!resolve())
+        return;
+
+    count_free(ptr);
+    real.m_free(ptr);
+}
+
+int
+posix_memalign(void **memptr, size_t alignment, size_t size)
+{
+    int ret;
+
+    if (!resolve()) {
+        if (alignment > 16)
+            return ENOMEM;
+        *memptr = bootstrap_alloc(size);
+        return *memptr == NULL ? ENOMEM : 0;
+    }
+
+    ret = real.m_posix_memalign(memptr, alignment, size);
+    if (ret == 0)
+        count_alloc(*memptr);
+    return ret;
+}
+
+void *
+aligned_alloc(size_t alignment, size_t size)
+{
+    return aligned(alignment, size);
+}
+
+#if defined(HAVE_MEMALIGN)
+void *
+memalign(size_t alignment, size_t size)
+{
+    return aligned(alignment, size);
+}
+#endif
+
+void *
+valloc(size_t size)
+{
+    return aligned((size_t)sysconf(_SC_PAGESIZE), size);
+}
+
+#if defined(HAVE_PVALLOC)
+void *
+pvalloc(size_t size)
+{
+    const size_t pagesize = (size_t)sysconf(_SC_PAGESIZE);
+
+    return aligned(pagesize, (size + pagesize - 1) & ~(pagesize - 1));
+}
+#endif
+
+/* ---------------------------------------------------------------------
+ * Interface to libatf-c.
+ * --------------------------------------------------------------------- */
+
+const struct atf_alloc_counters *
+atf_alloc_counters(void)
+{
+    return &counters;
+}
+
+void
+atf_alloc_pause(bool pause)
+{
+    if (pause)
+        paused++;
+    else if (paused > 0)
+        paused--;
+}
@@ -0,0 +1,202 @@
+/* Copyright (c) 2026 The NetBSD Foundation, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+ * CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.  */
+
+#include "atf-c/detail/arena.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "atf-c/detail/alloc.h"
+#include "atf-c/detail/sanity.h"
+
+/* ---------------------------------------------------------------------
+ * Auxiliary functions.
+ * --------------------------------------------------------------------- */
+
+/* Size of the chunks requested from malloc.  Allocations larger than a
+ * quarter of this get a chunk of their own so that they do not waste the
+ * remaining space of the current chunk. */
+#define CHUNK_SIZE 4096
+
+union chunk_align {
+    long double m_ld;
+    long long m_ll;
+    void *m_ptr;
+};
+
+#define ALIGN sizeof(union chunk_align)
+#define ROUND(size) (((size) + ALIGN - 1) & ~(ALIGN - 1))
+
+struct chunk {
+    struct chunk *m_next;
+    union chunk_align m_data[1];
+};
+
+#define CHUNK_HDRSIZE offsetof(struct chunk, m_data)
+
+static
+struct chunk *
+new_chunk(size_t size)
+{
+    struct chunk *c;
+
+    if (size > (size_t)-1 - CHUNK_HDRSIZE)
+        return NULL;
+
+    /* Arenas hold the state of the framework, which must not be charged to
+     * the test cases whose allocations are being counted. */
+    atf_alloc_suspend();
+    c = (struct chunk *)malloc(CHUNK_HDRSIZE + size);
+    atf_alloc_resume();
+    if (c != NULL)
+        c->m_next = NULL;
+    return c;
+}
+
+/* ---------------------------------------------------------------------
+ * The "atf_arena" type.
+ * --------------------------------------------------------------------- */
+
+/*
+ * Constructors/destructors.
+ */
+
+void
+atf_arena_init(atf_arena_t *a)
+{
+    a->m_chunks = NULL;
+    a->m_top = NULL;
+    a->m_limit = NULL;
+    a->m_last = NULL;
+}
+
+void
+atf_arena_fini(atf_arena_t *a)
+{
+    struct chunk *c;
+
+    atf_alloc_suspend();
+    c = (struct chunk *)a->m_chunks;
+    while (c != NULL) {
+        struct chunk *cnext;
+
+        cnext = c->m_next;
+        free(c);
+        c = cnext;
+    }
+    atf_alloc_resume();
+}
+
+/*
+ * Modifiers.
+ */
+
+void *
+atf_arena_alloc(atf_arena_t *a, size_t size)
+{
+    struct chunk *c;
+    char *ptr;
+
+    if (size > (size_t)-1 - ALIGN)
+        return NULL;
+    size = ROUND(size == 0 ? 1 : size);
+
+    if (size <= (size_t)(a->m_limit - a->m_top)) {
+        ptr = a->m_top;
+        a->m_top += size;
+        a->m_last = ptr;
+    } else if (size > CHUNK_SIZE / 4) {
+        c = new_chunk(size);
+        if (c == NULL)
+            return NULL;
+
+        /* Keep the current chunk at the head so that its free space can
+         * still be used by subsequent small allocations. */
+        if (a->m_chunks == NULL)
+            a->m_chunks = c;
+        else {
+            struct chunk *head = (struct chunk *)a->m_chunks;
+            c->m_next = head->m_next;
+            head->m_next = c;
+        }
+        ptr = (char *)c->m_data;
+    } else {
+        c = new_chunk(CHUNK_SIZE);
+        if (c == NULL)
+            return NULL;
+
+        c->m_next = (struct chunk *)a->m_chunks;
+        a->m_chunks = c;
+
+        ptr = (char *)c->m_data;
+        a->m_top = ptr + size;
+        a->m_limit = ptr + CHUNK_SIZE;
+        a->m_last = ptr;
+    }
+
+    POST(((size_t)ptr & (ALIGN - 1)) == 0);
+    return ptr;
+}
+
+void *
+atf_arena_realloc(atf_arena_t *a, void *ptr, size_t oldsize, size_t newsize)
+{
+    void *newptr;
+
+    if (ptr == NULL)
+        return atf_arena_alloc(a, newsize);
+
+    if (ptr == a->m_last && newsize <= (size_t)-1 - ALIGN &&
+        ROUND(newsize) <= (size_t)(a->m_limit - a->m_last)) {
+        a->m_top = a->m_last + ROUND(newsize == 0 ? 1 : newsize);
+        return ptr;
+    }
+
+    newptr = atf_arena_alloc(a, newsize);
+    if (newptr != NULL)
+        memcpy(newptr, ptr, oldsize < newsize ? oldsize : newsize);
+    return newptr;
+}
+
+void
+atf_arena_release(atf_arena_t *a, void *ptr)
+{
+    if (ptr != NULL && ptr == a->m_last) {
+        a->m_top = a->m_last;
+        a->m_last = NULL;
+    }
+}
+
+char *
+atf_arena_strdup(atf_arena_t *a, const char *str)
+{
+    const size_t len = strlen(str) + 1;
+    char *copy;
+
+    copy = (char *)atf_arena_alloc(a, len);
+    if (copy != NULL)
+        memcpy(copy, str, len);
+    return copy;
+}
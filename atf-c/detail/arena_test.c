@@ -0,0 +1,190 @@
+/* Copyright (c) 2026 The NetBSD Foundation, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+ * CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.  */
+
+#include "atf-c/detail/arena.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include <atf-c.h>
+
+/* ---------------------------------------------------------------------
+ * Tests for the "atf_arena" type.
+ * --------------------------------------------------------------------- */
+
+/*
+ * Constructors and destructors.
+ */
+
+ATF_TC(init_fini);
+ATF_TC_HEAD(init_fini, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks that an arena that has never "
+                      "been used can be finalized");
+}
+ATF_TC_BODY(init_fini, tc)
+{
+    atf_arena_t arena;
+
+    atf_arena_init(&arena);
+    ATF_REQUIRE(arena.m_chunks == NULL);
+    atf_arena_fini(&arena);
+}
+
+/*
+ * Modifiers.
+ */
+
+ATF_TC(alloc);
+ATF_TC_HEAD(alloc, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks that allocations are distinct "
+                      "and suitably aligned");
+}
+ATF_TC_BODY(alloc, tc)
+{
+    atf_arena_t arena;
+    char *ptrs[1000];
+    size_t i;
+
+    atf_arena_init(&arena);
+    for (i = 0; i < sizeof(ptrs) / sizeof(ptrs[0]); i++) {
+        ptrs[i] = atf_arena_alloc(&arena, i % 37 + 1);
+        ATF_REQUIRE(ptrs[i] != NULL);
+        ATF_REQUIRE_EQ((uintptr_t)ptrs[i] % sizeof(void *), 0);
+        memset(ptrs[i], (int)i, i % 37 + 1);
+    }
+    for (i = 0; i < sizeof(ptrs) / sizeof(ptrs[0]); i++)
+        ATF_CHECK_EQ(ptrs[i][i % 37], (char)i);
+    atf_arena_fini(&arena);
+}
+
+ATF_TC(alloc_big);
+ATF_TC_HEAD(alloc_big, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks that allocations larger than a "
+                      "chunk do not disturb the current chunk");
+}
+ATF_TC_BODY(alloc_big, tc)
+{
+    atf_arena_t arena;
+    char *small1, *small2, *big;
+
+    atf_arena_init(&arena);
+    small1 = atf_arena_alloc(&arena, 16);
+    big = atf_arena_alloc(&arena, 100000);
+    ATF_REQUIRE(big != NULL);
+    memset(big, 'x', 100000);
+    small2 = atf_arena_alloc(&arena, 16);
+    ATF_REQUIRE(small2 == small1 + 16);
+    ATF_REQUIRE(atf_arena_alloc(&arena, SIZE_MAX) == NULL);
+    atf_arena_fini(&arena);
+}
+
+ATF_TC(realloc);
+ATF_TC_HEAD(realloc, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks that the most recent allocation "
+                      "grows in place and that others are moved");
+}
+ATF_TC_BODY(realloc, tc)
+{
+    atf_arena_t arena;
+    char *p1, *p2, *p3;
+
+    atf_arena_init(&arena);
+    p1 = atf_arena_alloc(&arena, 4);
+    strcpy(p1, "abc");
+    p2 = atf_arena_realloc(&arena, p1, 4, 100);
+    ATF_REQUIRE(p2 == p1);
+    ATF_REQUIRE_STREQ("abc", p2);
+
+    p3 = atf_arena_alloc(&arena, 8);
+    ATF_REQUIRE(p3 != NULL);
+    p2 = atf_arena_realloc(&arena, p1, 100, 200);
+    ATF_REQUIRE(p2 != p1);
+    ATF_REQUIRE_STREQ("abc", p2);
+    atf_arena_fini(&arena);
+}
+
+ATF_TC(release);
+ATF_TC_HEAD(release, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks that releasing the most recent "
+                      "allocation recycles its memory and that releasing "
+                      "others is a no-op");
+}
+ATF_TC_BODY(release, tc)
+{
+    atf_arena_t arena;
+    char *p1, *p2;
+
+    atf_arena_init(&arena);
+    p1 = atf_arena_alloc(&arena, 32);
+    atf_arena_release(&arena, p1);
+    ATF_REQUIRE(atf_arena_alloc(&arena, 32) == p1);
+
+    p2 = atf_arena_alloc(&arena, 32);
+    atf_arena_release(&arena, p1);
+    ATF_REQUIRE(atf_arena_alloc(&arena, 32) == p2 + 32);
+    atf_arena_fini(&arena);
+}
+
+ATF_TC(strdup);
+ATF_TC_HEAD(strdup, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks the atf_arena_strdup function");
+}
+ATF_TC_BODY(strdup, tc)
+{
+    atf_arena_t arena;
+    const char *orig = "Some text";
+    char *copy;
+
+    atf_arena_init(&arena);
+    copy = atf_arena_strdup(&arena, orig);
+    ATF_REQUIRE(copy != orig);
+    ATF_REQUIRE_STREQ(orig, copy);
+    atf_arena_fini(&arena);
+}
+
+/* ---------------------------------------------------------------------
+ * Main.
+ * --------------------------------------------------------------------- */
+
+ATF_TP_ADD_TCS(tp)
+{
+    /* Constructors and destructors. */
+    ATF_TP_ADD_TC(tp, init_fini);
+
+    /* Modifiers. */
+    ATF_TP_ADD_TC(tp, alloc);
+    ATF_TP_ADD_TC(tp, alloc_big);
+    ATF_TP_ADD_TC(tp, realloc);
+    ATF_TP_ADD_TC(tp, release);
+    ATF_TP_ADD_TC(tp, strdup);
+
+    return atf_no_error();
+}
@@ -33,7 +33,6 @@
 #include <string.h>
 
 #include "atf-c/detail/sanity.h"
-#include "atf-c/detail/text.h"
 #include "atf-c/error.h"
 
 /* ---------------------------------------------------------------------
@@ -49,12 +48,20 @@ resize(atf_dynstr_t *ad, size_t newsize)
 
     PRE(newsize > ad->m_datasize);
 
-    newdata = (char *)malloc(newsize);
+    if (ad->m_arena != NULL) {
+        newdata = (char *)atf_arena_realloc(ad->m_arena, ad->m_data,
+                                            ad->m_datasize, newsize);
+    } else {
+        newdata = (char *)malloc(newsize);
+        if (newdata != NULL) {
+            strcpy(newdata, ad->m_data);
+            free(ad->m_data);
+        }
+    }
+
     if (newdata == NULL) {
         err = atf_no_memory_error();
     } else {
-        strcpy(newdata, ad->m_data);
-        free(ad->m_data);
         ad->m_data = newdata;
         ad->m_datasize = newsize;
         err = atf_no_error();
@@ -68,34 +75,48 @@ atf_error_t
 prepend_or_append(atf_dynstr_t *ad, const char *fmt, va_list ap,
                   bool prepend)
 {
-    char *aux;
     atf_error_t err;
     size_t newlen;
+    char *dest;
+    char saved;
+    int ret;
     va_list ap2;
 
+    /* Measure the formatted text first so that it can be written straight
+     * into its final location, without going through a temporary
+     * buffer. */
     va_copy(ap2, ap);
-    err = atf_text_format_ap(&aux, fmt, ap2);
+    ret = vsnprintf(NULL, 0, fmt, ap2);
     va_end(ap2);
-    if (atf_is_error(err))
+    if (ret < 0) {
+        err = atf_libc_error(errno, "Cannot format string");
         goto out;
-    newlen = ad->m_length + strlen(aux);
+    }
+    newlen = ad->m_length + ret;
 
     if (newlen + sizeof(char) > ad->m_datasize) {
         err = resize(ad, newlen + sizeof(char));
         if (atf_is_error(err))
-            goto out_free;
+            goto out;
     }
 
     if (prepend) {
-        memmove(ad->m_data + strlen(aux), ad->m_data, ad->m_length + 1);
-        memcpy(ad->m_data, aux, strlen(aux));
+        memmove(ad->m_data + ret, ad->m_data, ad->m_length + 1);
+        dest = ad->m_data;
     } else
-        strcpy(ad->m_data + ad->m_length, aux);
+        dest = ad->m_data + ad->m_length;
+
+    /* vsnprintf terminates its output, which clobbers the first byte of
+     * the old contents when prepending. */
+    saved = prepend ? dest[ret] : '\0';
+    va_copy(ap2, ap);
+    vsnprintf(dest, ret + 1, fmt, ap2);
+    va_end(ap2);
+    dest[ret] = saved;
+
     ad->m_length = newlen;
     err = atf_no_error();
 
-out_free:
-    free(aux);
 out:
     return err;
 }
@@ -116,10 +137,20 @@ const size_t atf_dynstr_npos = SIZE_MAX;
 
 atf_error_t
 atf_dynstr_init(atf_dynstr_t *ad)
+{
+    return atf_dynstr_init_arena(ad, NULL);
+}
+
+atf_error_t
+atf_dynstr_init_arena(atf_dynstr_t *ad, atf_arena_t *arena)
 {
     atf_error_t err;
 
-    ad->m_data = (char *)malloc(sizeof(char));
+    ad->m_arena = arena;
+    if (arena != NULL)
+        ad->m_data = (char *)atf_arena_alloc(arena, sizeof(char));
+    else
+        ad->m_data = (char *)malloc(sizeof(char));
     if (ad->m_data == NULL) {
         err = atf_no_memory_error();
         goto out;
@@ -141,6 +172,7 @@ atf_dynstr_init_ap(atf_dynstr_t *ad, const char *fmt, va_list ap)
 
     ad->m_datasize = strlen(fmt) + 1;
     ad->m_length = 0;
+    ad->m_arena = NULL;
 
     do {
         va_list ap2;
@@ -206,6 +238,7 @@ atf_dynstr_init_raw(atf_dynstr_t *ad, const void *mem, size_t memlen)
     }
 
     ad->m_datasize = memlen + 1;
+    ad->m_arena = NULL;
     memcpy(ad->m_data, mem, memlen);
     ad->m_data[memlen] = '\0';
     ad->m_length = strlen(ad->m_data);
@@ -236,6 +269,7 @@ atf_dynstr_init_rep(atf_dynstr_t *ad, size_t len, char ch)
     memset(ad->m_data, ch, len);
     ad->m_data[len] = '\0';
     ad->m_length = len;
+    ad->m_arena = NULL;
     err = atf_no_error();
 
 out:
@@ -267,6 +301,7 @@ atf_dynstr_copy(atf_dynstr_t *dest, const atf_dynstr_t *src)
         memcpy(dest->m_data, src->m_data, src->m_datasize);
         dest->m_datasize = src->m_datasize;
         dest->m_length = src->m_length;
+        dest->m_arena = NULL;
         err = atf_no_error();
     }
 
@@ -277,13 +312,17 @@ void
 atf_dynstr_fini(atf_dynstr_t *ad)
 {
     INV(ad->m_data != NULL);
-    free(ad->m_data);
+    if (ad->m_arena != NULL)
+        atf_arena_release(ad->m_arena, ad->m_data);
+    else
+        free(ad->m_data);
 }
 
 char *
 atf_dynstr_fini_disown(atf_dynstr_t *ad)
 {
     INV(ad->m_data != NULL);
+    PRE(ad->m_arena == NULL);
     return ad->m_data;
 }
 
@@ -30,6 +30,7 @@
 #include <stdbool.h>
 #include <stddef.h>
 
+#include <atf-c/detail/arena.h>
 #include <atf-c/error_fwd.h>
 
 /* ---------------------------------------------------------------------
@@ -40,6 +41,10 @@ struct atf_dynstr {
     char *m_data;
     size_t m_datasize;
     size_t m_length;
+
+    /* If not NULL, the arena that holds m_data.  Such strings cannot be
+     * disowned. */
+    atf_arena_t *m_arena;
 };
 typedef struct atf_dynstr atf_dynstr_t;
 
@@ -48,6 +53,7 @@ extern const size_t atf_dynstr_npos;
 
 /* Constructors and destructors */
 atf_error_t atf_dynstr_init(atf_dynstr_t *);
+atf_error_t atf_dynstr_init_arena(atf_dynstr_t *, atf_arena_t *);
 atf_error_t atf_dynstr_init_ap(atf_dynstr_t *, const char *, va_list);
 atf_error_t atf_dynstr_init_fmt(atf_dynstr_t *, const char *, ...);
 atf_error_t atf_dynstr_init_raw(atf_dynstr_t *, const void *, size_t);
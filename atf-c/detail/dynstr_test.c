@@ -58,6 +58,36 @@ ATF_TC_BODY(init, tc)
     atf_dynstr_fini(&str);
 }
 
+ATF_TC(init_arena);
+ATF_TC_HEAD(init_arena, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks the construction of strings "
+                      "whose contents live in an arena");
+}
+ATF_TC_BODY(init_arena, tc)
+{
+    atf_arena_t arena;
+    atf_dynstr_t str, str2;
+    size_t i;
+
+    atf_arena_init(&arena);
+
+    RE(atf_dynstr_init_arena(&str, &arena));
+    ATF_REQUIRE_EQ(atf_dynstr_length(&str), 0);
+    for (i = 0; i < 1000; i++)
+        RE(atf_dynstr_append_fmt(&str, "%c", 'a'));
+    RE(atf_dynstr_prepend_fmt(&str, "%s", "begin "));
+    ATF_REQUIRE_EQ(atf_dynstr_length(&str), 1006);
+    ATF_REQUIRE(strncmp(atf_dynstr_cstring(&str), "begin aaa", 9) == 0);
+
+    RE(atf_dynstr_copy(&str2, &str));
+    ATF_REQUIRE(atf_equal_dynstr_dynstr(&str, &str2));
+    atf_dynstr_fini(&str2);
+
+    atf_dynstr_fini(&str);
+    atf_arena_fini(&arena);
+}
+
 static
 void
 init_fmt(atf_dynstr_t *str, const char *fmt, ...)
@@ -606,6 +636,7 @@ ATF_TP_ADD_TCS(tp)
 {
     /* Constructors and destructors. */
     ATF_TP_ADD_TC(tp, init);
+    ATF_TP_ADD_TC(tp, init_arena);
     ATF_TP_ADD_TC(tp, init_ap);
     ATF_TP_ADD_TC(tp, init_fmt);
     ATF_TP_ADD_TC(tp, init_raw);
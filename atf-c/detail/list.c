@@ -65,11 +65,14 @@ entry_to_iter(atf_list_t *l, struct list_entry *le)
 
 static
 struct list_entry *
-new_entry(void *object, bool managed)
+new_entry(atf_arena_t *arena, void *object, bool managed)
 {
     struct list_entry *le;
 
-    le = (struct list_entry *)malloc(sizeof(*le));
+    if (arena != NULL)
+        le = (struct list_entry *)atf_arena_alloc(arena, sizeof(*le));
+    else
+        le = (struct list_entry *)malloc(sizeof(*le));
     if (le != NULL) {
         le->m_prev = le->m_next = NULL;
         le->m_object = object;
@@ -82,22 +85,25 @@ new_entry(void *object, bool managed)
 
 static
 void
-delete_entry(struct list_entry *le)
+delete_entry(atf_arena_t *arena, struct list_entry *le)
 {
     if (le->m_managed)
         free(le->m_object);
 
-    free(le);
+    if (arena != NULL)
+        atf_arena_release(arena, le);
+    else
+        free(le);
 }
 
 static
 struct list_entry *
-new_entry_and_link(void *object, bool managed, struct list_entry *prev,
-                   struct list_entry *next)
+new_entry_and_link(atf_arena_t *arena, void *object, bool managed,
+                   struct list_entry *prev, struct list_entry *next)
 {
     struct list_entry *le;
 
-    le = new_entry(object, managed);
+    le = new_entry(arena, object, managed);
     if (le != NULL) {
         le->m_prev = prev;
         le->m_next = next;
@@ -193,17 +199,23 @@ atf_equal_list_iter_list_iter(const atf_list_iter_t i1,
 
 atf_error_t
 atf_list_init(atf_list_t *l)
+{
+    return atf_list_init_arena(l, NULL);
+}
+
+atf_error_t
+atf_list_init_arena(atf_list_t *l, atf_arena_t *arena)
 {
     struct list_entry *lebeg, *leend;
 
-    lebeg = new_entry(NULL, false);
+    lebeg = new_entry(arena, NULL, false);
     if (lebeg == NULL) {
         return atf_no_memory_error();
     }
 
-    leend = new_entry(NULL, false);
+    leend = new_entry(arena, NULL, false);
     if (leend == NULL) {
-        free(lebeg);
+        delete_entry(arena, lebeg);
         return atf_no_memory_error();
     }
 
@@ -216,6 +228,7 @@ atf_list_init(atf_list_t *l)
     l->m_size = 0;
     l->m_begin = lebeg;
     l->m_end = leend;
+    l->m_arena = arena;
 
     return atf_no_error();
 }
@@ -232,7 +245,7 @@ atf_list_fini(atf_list_t *l)
         struct list_entry *lenext;
 
         lenext = le->m_next;
-        delete_entry(le);
+        delete_entry(l->m_arena, le);
         le = lenext;
 
         freed++;
@@ -270,6 +283,14 @@ atf_list_end_c(const atf_list_t *l)
     return entry_to_citer(l, l->m_end);
 }
 
+atf_list_iter_t
+atf_list_last(atf_list_t *l)
+{
+    struct list_entry *le = l->m_end;
+    PRE(atf_list_size(l) > 0);
+    return entry_to_iter(l, le->m_prev);
+}
+
 void *
 atf_list_index(atf_list_t *list, const size_t idx)
 {
@@ -355,7 +376,7 @@ atf_list_append(atf_list_t *l, void *data, bool managed)
 
     next = (struct list_entry *)l->m_end;
     prev = next->m_prev;
-    le = new_entry_and_link(data, managed, prev, next);
+    le = new_entry_and_link(l->m_arena, data, managed, prev, next);
     if (le == NULL)
         err = atf_no_memory_error();
     else {
@@ -371,14 +392,16 @@ atf_list_append_list(atf_list_t *l, atf_list_t *src)
 {
     struct list_entry *e1, *e2, *ghost1, *ghost2;
 
+    PRE(l->m_arena == src->m_arena);
+
     ghost1 = (struct list_entry *)l->m_end;
     ghost2 = (struct list_entry *)src->m_begin;
 
     e1 = ghost1->m_prev;
     e2 = ghost2->m_next;
 
-    delete_entry(ghost1);
-    delete_entry(ghost2);
+    delete_entry(l->m_arena, ghost1);
+    delete_entry(src->m_arena, ghost2);
 
     e1->m_next = e2;
     e2->m_prev = e1;
@@ -30,6 +30,7 @@
 #include <stdbool.h>
 #include <stddef.h>
 
+#include <atf-c/detail/arena.h>
 #include <atf-c/error_fwd.h>
 
 /* ---------------------------------------------------------------------
@@ -77,11 +78,16 @@ struct atf_list {
     void *m_end;
 
     size_t m_size;
+
+    /* If not NULL, the arena from which the list entries are allocated.
+     * Managed objects are always heap-allocated though. */
+    atf_arena_t *m_arena;
 };
 typedef struct atf_list atf_list_t;
 
 /* Constructors and destructors */
 atf_error_t atf_list_init(atf_list_t *);
+atf_error_t atf_list_init_arena(atf_list_t *, atf_arena_t *);
 void atf_list_fini(atf_list_t *);
 
 /* Getters. */
@@ -89,6 +95,7 @@ atf_list_iter_t atf_list_begin(atf_list_t *);
 atf_list_citer_t atf_list_begin_c(const atf_list_t *);
 atf_list_iter_t atf_list_end(atf_list_t *);
 atf_list_citer_t atf_list_end_c(const atf_list_t *);
+atf_list_iter_t atf_list_last(atf_list_t *);
 void *atf_list_index(atf_list_t *, const size_t);
 const void *atf_list_index_c(const atf_list_t *, const size_t);
 size_t atf_list_size(const atf_list_t *);
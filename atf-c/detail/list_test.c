@@ -107,6 +107,30 @@ ATF_TC_BODY(list_index_c, tc)
     atf_list_fini(&list);
 }
 
+ATF_TC(list_last);
+ATF_TC_HEAD(list_last, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks the atf_list_last function");
+}
+ATF_TC_BODY(list_last, tc)
+{
+    atf_list_t list;
+    atf_list_iter_t iter;
+    int i1 = 1;
+    int i2 = 5;
+
+    RE(atf_list_init(&list));
+    RE(atf_list_append(&list, &i1, false));
+    ATF_CHECK_EQ(*(int *)atf_list_iter_data(atf_list_last(&list)), 1);
+    RE(atf_list_append(&list, &i2, false));
+    iter = atf_list_last(&list);
+    ATF_CHECK_EQ(*(int *)atf_list_iter_data(iter), 5);
+    ATF_CHECK(atf_equal_list_iter_list_iter(atf_list_iter_next(iter),
+                                            atf_list_end(&list)));
+
+    atf_list_fini(&list);
+}
+
 ATF_TC_WITHOUT_HEAD(list_to_charpp_empty);
 ATF_TC_BODY(list_to_charpp_empty, tc)
 {
@@ -350,6 +374,7 @@ ATF_TP_ADD_TCS(tp)
     /* Getters. */
     ATF_TP_ADD_TC(tp, list_index);
     ATF_TP_ADD_TC(tp, list_index_c);
+    ATF_TP_ADD_TC(tp, list_last);
     ATF_TP_ADD_TC(tp, list_to_charpp_empty);
     ATF_TP_ADD_TC(tp, list_to_charpp_some);
 
@@ -26,6 +26,7 @@
 #include "atf-c/detail/map.h"
 
 #include <errno.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -37,18 +38,155 @@
  * Auxiliary functions.
  * --------------------------------------------------------------------- */
 
+/* Number of entries past which a map indexes its entries by hash.  Below
+ * this, scanning the list is as fast as hashing the key. */
+#define INDEX_THRESHOLD 16
+
 struct map_entry {
     char *m_key;
     void *m_value;
     bool m_managed;
+
+    /* Next entry in the same bucket of the index, and the position of the
+     * entry in the list, so that lookups through the index can return a
+     * full iterator. */
+    struct map_entry *m_hnext;
+    atf_list_iter_t m_listiter;
 };
 
+static
+size_t
+hash_key(const char *key)
+{
+    /* FNV-1a. */
+    size_t h = 2166136261u;
+
+    for (; *key != '\0'; key++) {
+        h ^= (unsigned char)*key;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/* Rebuilds the index of the map with the given number of buckets.  The
+ * index is an optimization only: if it cannot be allocated, the map is
+ * left without one and lookups scan the list instead.
+ *
+ * Maps backed by an arena take the index from the arena too, so that
+ * releasing the arena releases everything; their previous indexes stay
+ * there until then, which is at most a third of the final size. */
+static
+void
+reindex(atf_map_t *m, size_t nbuckets)
+{
+    atf_arena_t *arena = m->m_list.m_arena;
+    struct map_entry **buckets;
+    atf_list_iter_t iter;
+
+    if (arena == NULL)
+        free(m->m_buckets);
+    m->m_buckets = NULL;
+    m->m_nbuckets = 0;
+
+    if (arena == NULL)
+        buckets = (struct map_entry **)calloc(nbuckets, sizeof(*buckets));
+    else if (nbuckets > (size_t)-1 / sizeof(*buckets))
+        buckets = NULL;
+    else {
+        buckets = (struct map_entry **)atf_arena_alloc(arena,
+            nbuckets * sizeof(*buckets));
+        if (buckets != NULL)
+            memset(buckets, 0, nbuckets * sizeof(*buckets));
+    }
+    if (buckets == NULL)
+        return;
+
+    atf_list_for_each(iter, &m->m_list) {
+        struct map_entry *me = atf_list_iter_data(iter);
+        const size_t b = hash_key(me->m_key) % nbuckets;
+
+        me->m_hnext = buckets[b];
+        buckets[b] = me;
+    }
+
+    m->m_buckets = (void **)buckets;
+    m->m_nbuckets = nbuckets;
+}
+
+/* Adds the entry just appended to the list to the index, building or
+ * growing the latter as needed to keep the buckets short. */
+static
+void
+index_entry(atf_map_t *m, struct map_entry *me)
+{
+    const size_t size = atf_list_size(&m->m_list);
+
+    me->m_listiter = atf_list_last(&m->m_list);
+
+    if (m->m_buckets == NULL) {
+        if (size >= INDEX_THRESHOLD)
+            reindex(m, size * 2);
+    } else if (size > m->m_nbuckets) {
+        reindex(m, m->m_nbuckets * 4);
+    } else {
+        struct map_entry **buckets = (struct map_entry **)m->m_buckets;
+        const size_t b = hash_key(me->m_key) % m->m_nbuckets;
+
+        me->m_hnext = buckets[b];
+        buckets[b] = me;
+    }
+}
+
 static
 struct map_entry *
-new_entry(const char *key, void *value, bool managed)
+lookup(const atf_map_t *m, const char *key)
+{
+    if (m->m_buckets != NULL) {
+        struct map_entry *me;
+
+        me = ((struct map_entry **)m->m_buckets)[hash_key(key) %
+                                                 m->m_nbuckets];
+        for (; me != NULL; me = me->m_hnext) {
+            if (strcmp(me->m_key, key) == 0)
+                return me;
+        }
+    } else {
+        atf_list_citer_t iter;
+
+        atf_list_for_each_c(iter, &m->m_list) {
+            const struct map_entry *me = atf_list_citer_data(iter);
+
+#define UNCONST(a) ((void *)(uintptr_t)(const void *)(a))
+            if (strcmp(me->m_key, key) == 0)
+                return UNCONST(me);
+#undef UNCONST
+        }
+    }
+
+    return NULL;
+}
+
+static
+struct map_entry *
+new_entry(atf_arena_t *arena, const char *key, void *value, bool managed)
 {
     struct map_entry *me;
 
+    if (arena != NULL) {
+        me = (struct map_entry *)atf_arena_alloc(arena, sizeof(*me));
+        if (me != NULL) {
+            me->m_key = atf_arena_strdup(arena, key);
+            if (me->m_key == NULL)
+                me = NULL;
+            else {
+                me->m_value = value;
+                me->m_managed = managed;
+                me->m_hnext = NULL;
+            }
+        }
+        return me;
+    }
+
     me = (struct map_entry *)malloc(sizeof(*me));
     if (me != NULL) {
         me->m_key = strdup(key);
@@ -58,6 +196,7 @@ new_entry(const char *key, void *value, bool managed)
         } else {
             me->m_value = value;
             me->m_managed = managed;
+            me->m_hnext = NULL;
         }
     }
 
@@ -163,16 +302,33 @@ atf_equal_map_iter_map_iter(const atf_map_iter_t i1,
 atf_error_t
 atf_map_init(atf_map_t *m)
 {
+    m->m_buckets = NULL;
+    m->m_nbuckets = 0;
     return atf_list_init(&m->m_list);
 }
 
+atf_error_t
+atf_map_init_arena(atf_map_t *m, atf_arena_t *arena)
+{
+    m->m_buckets = NULL;
+    m->m_nbuckets = 0;
+    return atf_list_init_arena(&m->m_list, arena);
+}
+
 atf_error_t
 atf_map_init_charpp(atf_map_t *m, const char *const *array)
+{
+    return atf_map_init_charpp_arena(m, array, NULL);
+}
+
+atf_error_t
+atf_map_init_charpp_arena(atf_map_t *m, const char *const *array,
+                          atf_arena_t *arena)
 {
     atf_error_t err;
     const char *const *ptr = array;
 
-    err = atf_map_init(m);
+    err = atf_map_init_arena(m, arena);
     if (array != NULL) {
         while (!atf_is_error(err) && *ptr != NULL) {
             const char *key, *value;
@@ -188,7 +344,14 @@ atf_map_init_charpp(atf_map_t *m, const char *const *array)
             }
             ptr++;
 
-            err = atf_map_insert(m, key, strdup(value), true);
+            if (arena != NULL) {
+                char *copy = atf_arena_strdup(arena, value);
+                if (copy == NULL)
+                    err = atf_no_memory_error();
+                else
+                    err = atf_map_insert(m, key, copy, false);
+            } else
+                err = atf_map_insert(m, key, strdup(value), true);
         }
     }
 
@@ -208,9 +371,13 @@ atf_map_fini(atf_map_t *m)
 
         if (me->m_managed)
             free(me->m_value);
-        free(me->m_key);
-        free(me);
+        if (m->m_list.m_arena == NULL) {
+            free(me->m_key);
+            free(me);
+        }
     }
+    if (m->m_list.m_arena == NULL)
+        free(m->m_buckets);
     atf_list_fini(&m->m_list);
 }
 
@@ -261,18 +428,14 @@ atf_map_end_c(const atf_map_t *m)
 atf_map_iter_t
 atf_map_find(atf_map_t *m, const char *key)
 {
-    atf_list_iter_t iter;
+    struct map_entry *me = lookup(m, key);
 
-    atf_list_for_each(iter, &m->m_list) {
-        struct map_entry *me = atf_list_iter_data(iter);
-
-        if (strcmp(me->m_key, key) == 0) {
-            atf_map_iter_t i;
-            i.m_map = m;
-            i.m_entry = me;
-            i.m_listiter = iter;
-            return i;
-        }
+    if (me != NULL) {
+        atf_map_iter_t i;
+        i.m_map = m;
+        i.m_entry = me;
+        i.m_listiter = me->m_listiter;
+        return i;
     }
 
     return atf_map_end(m);
@@ -281,18 +444,15 @@ atf_map_find(atf_map_t *m, const char *key)
 atf_map_citer_t
 atf_map_find_c(const atf_map_t *m, const char *key)
 {
-    atf_list_citer_t iter;
-
-    atf_list_for_each_c(iter, &m->m_list) {
-        const struct map_entry *me = atf_list_citer_data(iter);
+    const struct map_entry *me = lookup(m, key);
 
-        if (strcmp(me->m_key, key) == 0) {
-            atf_map_citer_t i;
-            i.m_map = m;
-            i.m_entry = me;
-            i.m_listiter = iter;
-            return i;
-        }
+    if (me != NULL) {
+        atf_map_citer_t i;
+        i.m_map = m;
+        i.m_entry = me;
+        i.m_listiter.m_list = me->m_listiter.m_list;
+        i.m_listiter.m_entry = me->m_listiter.m_entry;
+        return i;
     }
 
     return atf_map_end_c(m);
@@ -348,11 +508,10 @@ atf_map_insert(atf_map_t *m, const char *key, void *value, bool managed)
 {
     struct map_entry *me;
     atf_error_t err;
-    atf_map_iter_t iter;
 
-    iter = atf_map_find(m, key);
-    if (atf_equal_map_iter_map_iter(iter, atf_map_end(m))) {
-        me = new_entry(key, value, managed);
+    me = lookup(m, key);
+    if (me == NULL) {
+        me = new_entry(m->m_list.m_arena, key, value, managed);
         if (me == NULL)
             err = atf_no_memory_error();
         else {
@@ -360,11 +519,14 @@ atf_map_insert(atf_map_t *m, const char *key, void *value, bool managed)
             if (atf_is_error(err)) {
                 if (managed)
                     free(value);
-                free(me);
-            }
+                if (m->m_list.m_arena == NULL) {
+                    free(me->m_key);
+                    free(me);
+                }
+            } else
+                index_entry(m, me);
         }
     } else {
-        me = iter.m_entry;
         if (me->m_managed)
             free(me->m_value);
 
@@ -29,6 +29,7 @@
 #include <stdarg.h>
 #include <stdbool.h>
 
+#include <atf-c/detail/arena.h>
 #include <atf-c/detail/list.h>
 #include <atf-c/error_fwd.h>
 
@@ -76,16 +77,27 @@ bool atf_equal_map_iter_map_iter(const atf_map_iter_t,
  * The "atf_map" type.
  * --------------------------------------------------------------------- */
 
-/* A list-based map.  Typically very inefficient, but our maps are small
- * enough. */
+/* A list-based map.  Iteration follows the insertion order; maps that
+ * grow past a handful of entries, such as configurations with thousands
+ * of variables, also index their entries by hash so that lookups and
+ * inserts do not degrade to a scan of the list.  Maps created with an
+ * arena allocate their entries and keys from it; the values stored by
+ * atf_map_init_charpp_arena live there too, but managed values passed to
+ * atf_map_insert and the index are still heap-allocated. */
 struct atf_map {
     atf_list_t m_list;
+
+    void **m_buckets;
+    size_t m_nbuckets;
 };
 typedef struct atf_map atf_map_t;
 
 /* Constructors and destructors */
 atf_error_t atf_map_init(atf_map_t *);
+atf_error_t atf_map_init_arena(atf_map_t *, atf_arena_t *);
 atf_error_t atf_map_init_charpp(atf_map_t *, const char *const *);
+atf_error_t atf_map_init_charpp_arena(atf_map_t *, const char *const *,
+                                      atf_arena_t *);
 void atf_map_fini(atf_map_t *);
 
 /* Getters. */
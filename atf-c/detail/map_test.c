@@ -26,6 +26,7 @@
 #include "atf-c/detail/map.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include <atf-c.h>
@@ -99,6 +100,35 @@ ATF_TC_BODY(map_init_charpp_some, tc)
     atf_map_fini(&map);
 }
 
+ATF_TC_WITHOUT_HEAD(map_init_charpp_arena);
+ATF_TC_BODY(map_init_charpp_arena, tc)
+{
+    const char *const array[] = { "K1", "V1", "K2", "V2", NULL };
+    atf_arena_t arena;
+    atf_map_t map;
+    atf_map_citer_t iter;
+    char *value;
+
+    atf_arena_init(&arena);
+    RE(atf_map_init_charpp_arena(&map, array, &arena));
+    ATF_REQUIRE_EQ(atf_map_size(&map), 2);
+
+    ATF_REQUIRE((value = strdup("V3")) != NULL);
+    RE(atf_map_insert(&map, "K1", value, true));
+
+    iter = atf_map_find_c(&map, "K1");
+    ATF_REQUIRE(!atf_equal_map_citer_map_citer(iter, atf_map_end_c(&map)));
+    ATF_REQUIRE(strcmp(atf_map_citer_data(iter), "V3") == 0);
+
+    iter = atf_map_find_c(&map, "K2");
+    ATF_REQUIRE(!atf_equal_map_citer_map_citer(iter, atf_map_end_c(&map)));
+    ATF_REQUIRE(strcmp(atf_map_citer_key(iter), "K2") == 0);
+    ATF_REQUIRE(strcmp(atf_map_citer_data(iter), "V2") == 0);
+
+    atf_map_fini(&map);
+    atf_arena_fini(&arena);
+}
+
 ATF_TC_WITHOUT_HEAD(map_init_charpp_short);
 ATF_TC_BODY(map_init_charpp_short, tc)
 {
@@ -388,6 +418,70 @@ ATF_TC_BODY(stable_keys, tc)
     atf_map_fini(&map);
 }
 
+ATF_TC(many_keys);
+ATF_TC_HEAD(many_keys, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks that maps large enough to be "
+                      "indexed find, replace and iterate over their entries "
+                      "in insertion order");
+}
+ATF_TC_BODY(many_keys, tc)
+{
+    atf_arena_t arena;
+    atf_map_t maps[2];
+    size_t i, j;
+
+    atf_arena_init(&arena);
+    RE(atf_map_init(&maps[0]));
+    RE(atf_map_init_arena(&maps[1], &arena));
+
+    for (j = 0; j < 2; j++) {
+        atf_map_t *map = &maps[j];
+        atf_map_iter_t iter;
+        char key[32];
+
+        for (i = 0; i < 1000; i++) {
+            snprintf(key, sizeof(key), "var%zu", i);
+            RE(atf_map_insert(map, key, strdup(key), true));
+        }
+        RE(atf_map_insert(map, "var500", strdup("replaced"), true));
+        ATF_REQUIRE_EQ(atf_map_size(map), 1000);
+
+        for (i = 0; i < 1000; i++) {
+            atf_map_citer_t citer;
+
+            snprintf(key, sizeof(key), "var%zu", i);
+            citer = atf_map_find_c(map, key);
+            ATF_REQUIRE(!atf_equal_map_citer_map_citer(citer,
+                                                       atf_map_end_c(map)));
+            ATF_REQUIRE_STREQ(atf_map_citer_key(citer), key);
+            ATF_REQUIRE_STREQ((const char *)atf_map_citer_data(citer),
+                              i == 500 ? "replaced" : key);
+        }
+        iter = atf_map_find(map, "var1000");
+        ATF_REQUIRE(atf_equal_map_iter_map_iter(iter, atf_map_end(map)));
+
+        iter = atf_map_find(map, "var998");
+        ATF_REQUIRE_STREQ(atf_map_iter_key(iter), "var998");
+        iter = atf_map_iter_next(iter);
+        ATF_REQUIRE_STREQ(atf_map_iter_key(iter), "var999");
+        iter = atf_map_iter_next(iter);
+        ATF_REQUIRE(atf_equal_map_iter_map_iter(iter, atf_map_end(map)));
+
+        i = 0;
+        atf_map_for_each(iter, map) {
+            snprintf(key, sizeof(key), "var%zu", i);
+            ATF_REQUIRE_STREQ(atf_map_iter_key(iter), key);
+            i++;
+        }
+        ATF_REQUIRE_EQ(i, 1000);
+
+        atf_map_fini(map);
+    }
+
+    atf_arena_fini(&arena);
+}
+
 /* ---------------------------------------------------------------------
  * Main.
  * --------------------------------------------------------------------- */
@@ -399,6 +493,7 @@ ATF_TP_ADD_TCS(tp)
     ATF_TP_ADD_TC(tp, map_init_charpp_null);
     ATF_TP_ADD_TC(tp, map_init_charpp_empty);
     ATF_TP_ADD_TC(tp, map_init_charpp_some);
+    ATF_TP_ADD_TC(tp, map_init_charpp_arena);
     ATF_TP_ADD_TC(tp, map_init_charpp_short);
 
     /* Getters. */
@@ -416,6 +511,7 @@ ATF_TP_ADD_TCS(tp)
 
     /* Other. */
     ATF_TP_ADD_TC(tp, stable_keys);
+    ATF_TP_ADD_TC(tp, many_keys);
 
     return atf_no_error();
 }
@@ -0,0 +1,326 @@
+/* Copyright (c) 2026 The NetBSD Foundation, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+ * CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.  */
+
+#if defined(HAVE_CONFIG_H)
+#include "config.h"
+#endif
+
+#if defined(HAVE_NAMESPACES) && !defined(_GNU_SOURCE)
+#   define _GNU_SOURCE
+#endif
+
+#include "atf-c/detail/ns.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#if defined(HAVE_NAMESPACES)
+#include <sys/ioctl.h>
+#include <sys/mount.h>
+#include <sys/socket.h>
+
+#include <net/if.h>
+#include <sched.h>
+#endif
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "atf-c/detail/sanity.h"
+#include "atf-c/error.h"
+
+#if defined(HAVE_NAMESPACES)
+
+/* Maximum number of directories under /tmp that can be kept visible. */
+#define MAX_KEPT 8
+
+struct kept_dir {
+    char path[PATH_MAX];
+    int fd;
+};
+
+/* ---------------------------------------------------------------------
+ * Auxiliary functions.
+ * --------------------------------------------------------------------- */
+
+static bool
+is_under_tmp(const char *path)
+{
+    return strncmp(path, "/tmp/", 5) == 0 && path[5] != '\0';
+}
+
+/** Records the directories under /tmp that must survive the new /tmp.
+ *
+ * \param cwd_kept Set to true if the first kept directory is the current
+ *     one.
+ *
+ * \return The number of directories recorded in kept. */
+static size_t
+find_kept_dirs(const char *const *paths, struct kept_dir *kept,
+               bool *cwd_kept)
+{
+    char cwd[PATH_MAX];
+    size_t count = 0;
+
+    *cwd_kept = false;
+    if (getcwd(cwd, sizeof(cwd)) != NULL && is_under_tmp(cwd)) {
+        snprintf(kept[count].path, sizeof(kept[count].path), "%s", cwd);
+        kept[count].fd = -1;
+        count++;
+        *cwd_kept = true;
+    }
+
+    for (; *paths != NULL && count < MAX_KEPT; paths++) {
+        if (!is_under_tmp(*paths) || strlen(*paths) >= PATH_MAX)
+            continue;
+        snprintf(kept[count].path, sizeof(kept[count].path), "%s", *paths);
+        kept[count].fd = -1;
+        count++;
+    }
+
+    return count;
+}
+
+static void
+close_kept_dirs(struct kept_dir *kept, const size_t count)
+{
+    size_t i;
+
+    for (i = 0; i < count; i++) {
+        if (kept[i].fd != -1)
+            (void)close(kept[i].fd);
+    }
+}
+
+static atf_error_t
+write_proc_file(const char *path, const char *contents)
+{
+    const size_t length = strlen(contents);
+    atf_error_t err;
+    int fd;
+
+    fd = open(path, O_WRONLY);
+    if (fd == -1) {
+        /* Kernels before 3.19 do not have /proc/self/setgroups and do not
+         * need it to be written. */
+        if (errno == ENOENT && strcmp(path, "/proc/self/setgroups") == 0)
+            return atf_no_error();
+        return atf_libc_error(errno, "Cannot open %s", path);
+    }
+
+    if (write(fd, contents, length) != (ssize_t)length)
+        err = atf_libc_error(errno, "Cannot write to %s", path);
+    else
+        err = atf_no_error();
+    (void)close(fd);
+    return err;
+}
+
+/** Maps the user and group of the caller to themselves in the new user
+ * namespace, so that files keep their owners. */
+static atf_error_t
+map_ids(const uid_t uid, const gid_t gid)
+{
+    char map[64];
+    atf_error_t err;
+
+    err = write_proc_file("/proc/self/setgroups", "deny");
+    if (atf_is_error(err))
+        return err;
+
+    snprintf(map, sizeof(map), "%lu %lu 1", (unsigned long)uid,
+             (unsigned long)uid);
+    err = write_proc_file("/proc/self/uid_map", map);
+    if (atf_is_error(err))
+        return err;
+
+    snprintf(map, sizeof(map), "%lu %lu 1", (unsigned long)gid,
+             (unsigned long)gid);
+    return write_proc_file("/proc/self/gid_map", map);
+}
+
+static atf_error_t
+make_dirs(const char *path)
+{
+    char buf[PATH_MAX];
+    char *p;
+
+    if (strlen(path) >= sizeof(buf))
+        return atf_libc_error(ENAMETOOLONG, "Cannot create %s", path);
+    strcpy(buf, path);
+    for (p = buf + 1; ; p++) {
+        if (*p == '/' || *p == '\0') {
+            const char saved = *p;
+
+            *p = '\0';
+            if (mkdir(buf, 0755) == -1 && errno != EEXIST)
+                return atf_libc_error(errno, "Cannot create %s", buf);
+            *p = saved;
+            if (saved == '\0')
+                break;
+        }
+    }
+    return atf_no_error();
+}
+
+/** Mounts a private tmpfs on /tmp, keeping the given directories. */
+static atf_error_t
+mount_tmp(struct kept_dir *kept, const size_t count)
+{
+    atf_error_t err;
+    size_t i;
+
+    if (mount(NULL, "/", NULL, MS_REC | MS_PRIVATE, NULL) == -1)
+        return atf_libc_error(errno, "Cannot make the mounts private");
+
+    /* Grab the kept directories before they are hidden.  This must happen
+     * in the new mount namespace: the kernel refuses to bind mounts that
+     * belong to a different one. */
+    for (i = 0; i < count; i++) {
+        kept[i].fd = open(kept[i].path, O_RDONLY | O_DIRECTORY);
+        if (kept[i].fd == -1)
+            return atf_libc_error(errno, "Cannot open %s", kept[i].path);
+    }
+
+    if (mount("tmpfs", "/tmp", "tmpfs", MS_NOSUID | MS_NODEV,
+              "mode=1777") == -1)
+        return atf_libc_error(errno, "Cannot mount a tmpfs on /tmp");
+
+    for (i = 0; i < count; i++) {
+        char source[64];
+
+        err = make_dirs(kept[i].path);
+        if (atf_is_error(err))
+            return err;
+
+        snprintf(source, sizeof(source), "/proc/self/fd/%d", kept[i].fd);
+        if (mount(source, kept[i].path, NULL, MS_BIND | MS_REC, NULL) == -1)
+            return atf_libc_error(errno, "Cannot keep %s visible",
+                                  kept[i].path);
+    }
+
+    return atf_no_error();
+}
+
+/** Brings up the loopback interface of the new network namespace. */
+static atf_error_t
+loopback_up(void)
+{
+    struct ifreq ifr;
+    atf_error_t err;
+    int fd;
+
+    fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd == -1)
+        return atf_libc_error(errno, "Cannot create a socket");
+
+    memset(&ifr, 0, sizeof(ifr));
+    snprintf(ifr.ifr_name, sizeof(ifr.ifr_name), "lo");
+    if (ioctl(fd, SIOCGIFFLAGS, &ifr) == -1)
+        err = atf_libc_error(errno, "Cannot get the flags of lo");
+    else {
+        ifr.ifr_flags |= IFF_UP;
+        if (ioctl(fd, SIOCSIFFLAGS, &ifr) == -1)
+            err = atf_libc_error(errno, "Cannot bring lo up");
+        else
+            err = atf_no_error();
+    }
+
+    (void)close(fd);
+    return err;
+}
+
+#endif /* defined(HAVE_NAMESPACES) */
+
+/* ---------------------------------------------------------------------
+ * Free functions.
+ * --------------------------------------------------------------------- */
+
+/** Moves the calling process into fresh namespaces.
+ *
+ * The process gets new user, mount, network, UTS and IPC namespaces: a
+ * loopback interface of its own, a private tmpfs on /tmp and a hostname it
+ * can change freely.  The user and group IDs do not change.  The current
+ * directory and the given absolute paths remain visible if they live under
+ * /tmp.
+ *
+ * \param keep NULL-terminated list of absolute paths to keep visible.
+ * \param entered Set to true once the process has left its namespaces.  An
+ *     error with this unset means that namespaces are not available and
+ *     that nothing changed; an error with this set leaves the process in a
+ *     half-configured state.
+ *
+ * \return An error if the namespaces could not be set up. */
+atf_error_t
+atf_ns_enter(const char *const *keep, bool *entered)
+{
+#if defined(HAVE_NAMESPACES)
+    struct kept_dir kept[MAX_KEPT];
+    const uid_t uid = getuid();
+    const gid_t gid = getgid();
+    size_t count;
+    bool cwd_kept;
+    atf_error_t err;
+
+    *entered = false;
+
+    count = find_kept_dirs(keep, kept, &cwd_kept);
+    if (unshare(CLONE_NEWUSER | CLONE_NEWNS | CLONE_NEWNET | CLONE_NEWUTS |
+                CLONE_NEWIPC) == -1) {
+        err = atf_libc_error(errno, "Cannot create namespaces");
+        goto out;
+    }
+    *entered = true;
+
+    err = map_ids(uid, gid);
+    if (atf_is_error(err))
+        goto out;
+
+    err = mount_tmp(kept, count);
+    if (atf_is_error(err))
+        goto out;
+
+    err = loopback_up();
+    if (atf_is_error(err))
+        goto out;
+
+    /* Move onto the bind mount of the current directory so that relative
+     * and absolute paths to it agree. */
+    if (cwd_kept && chdir(kept[0].path) == -1)
+        err = atf_libc_error(errno, "Cannot change to %s", kept[0].path);
+
+out:
+    close_kept_dirs(kept, count);
+    return err;
+#else
+    (void)keep;
+    *entered = false;
+    return atf_libc_error(ENOSYS, "Namespaces are not supported on this "
+                          "platform");
+#endif
+}
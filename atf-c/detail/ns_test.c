@@ -0,0 +1,187 @@
+/* Copyright (c) 2026 The NetBSD Foundation, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+ * CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.  */
+
+#include "atf-c/detail/ns.h"
+
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <atf-c.h>
+
+/* ---------------------------------------------------------------------
+ * Auxiliary functions.
+ * --------------------------------------------------------------------- */
+
+/* Exit code of the child when namespaces are not available. */
+#define NS_UNAVAILABLE 77
+
+/** Runs a function in a child process that enters new namespaces.
+ *
+ * Skips the test case if namespaces are not available. */
+static void
+run_in_ns(void (*func)(void))
+{
+    const char *const keep[] = { NULL };
+    pid_t pid;
+    int status;
+
+    fflush(stdout);
+    fflush(stderr);
+    pid = fork();
+    ATF_REQUIRE(pid != -1);
+    if (pid == 0) {
+        atf_error_t err;
+        bool entered;
+
+        err = atf_ns_enter(keep, &entered);
+        if (atf_is_error(err)) {
+            char buf[1024];
+
+            atf_error_format(err, buf, sizeof(buf));
+            fprintf(stderr, "%s\n", buf);
+            exit(entered ? EXIT_FAILURE : NS_UNAVAILABLE);
+        }
+        func();
+        exit(EXIT_SUCCESS);
+    }
+
+    ATF_REQUIRE(waitpid(pid, &status, 0) != -1);
+    ATF_REQUIRE(WIFEXITED(status));
+    if (WEXITSTATUS(status) == NS_UNAVAILABLE)
+        atf_tc_skip("Namespaces are not available");
+    ATF_REQUIRE_EQ_MSG(EXIT_SUCCESS, WEXITSTATUS(status), "The child failed; "
+                       "see its output for details");
+}
+
+/* ---------------------------------------------------------------------
+ * Helper functions for the child processes.
+ * --------------------------------------------------------------------- */
+
+static void
+child_tmp(void)
+{
+    char path[64];
+
+    snprintf(path, sizeof(path), "/tmp/atf-ns-test.%d", (int)getpid());
+    atf_utils_create_file(path, "private\n");
+    atf_utils_create_file("cookie", "%s\n", path);
+}
+
+static void
+child_hostname(void)
+{
+    if (sethostname("atf-ns-test", strlen("atf-ns-test")) == -1) {
+        printf("sethostname failed: %s\n", strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+}
+
+static void
+child_ids(void)
+{
+    atf_utils_create_file("ids", "%d %d\n", (int)getuid(), (int)getgid());
+}
+
+/* ---------------------------------------------------------------------
+ * Test cases for the free functions.
+ * --------------------------------------------------------------------- */
+
+ATF_TC(enter__tmp);
+ATF_TC_HEAD(enter__tmp, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Tests that atf_ns_enter gives the "
+                      "process a private /tmp and keeps the current "
+                      "directory");
+}
+ATF_TC_BODY(enter__tmp, tc)
+{
+    char path[64];
+
+    run_in_ns(child_tmp);
+
+    /* The child wrote the cookie to the work directory, so that is still
+     * visible, but its file in /tmp must be gone. */
+    ATF_REQUIRE(atf_utils_file_exists("cookie"));
+    ATF_REQUIRE(atf_utils_grep_file("^/tmp/atf-ns-test\\.", "cookie"));
+    {
+        FILE *f = fopen("cookie", "r");
+        ATF_REQUIRE(f != NULL);
+        ATF_REQUIRE(fgets(path, sizeof(path), f) != NULL);
+        fclose(f);
+        path[strcspn(path, "\n")] = '\0';
+    }
+    ATF_REQUIRE(!atf_utils_file_exists(path));
+}
+
+ATF_TC(enter__hostname);
+ATF_TC_HEAD(enter__hostname, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Tests that atf_ns_enter lets the "
+                      "process change its hostname privately");
+}
+ATF_TC_BODY(enter__hostname, tc)
+{
+    char before[256], after[256];
+
+    ATF_REQUIRE(gethostname(before, sizeof(before)) != -1);
+    run_in_ns(child_hostname);
+    ATF_REQUIRE(gethostname(after, sizeof(after)) != -1);
+    ATF_REQUIRE_STREQ(before, after);
+}
+
+ATF_TC(enter__ids);
+ATF_TC_HEAD(enter__ids, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Tests that atf_ns_enter keeps the user "
+                      "and group of the process");
+}
+ATF_TC_BODY(enter__ids, tc)
+{
+    char ids[64];
+
+    run_in_ns(child_ids);
+    snprintf(ids, sizeof(ids), "%d %d\n", (int)getuid(), (int)getgid());
+    ATF_REQUIRE(atf_utils_compare_file("ids", ids));
+}
+
+/* ---------------------------------------------------------------------
+ * Main.
+ * --------------------------------------------------------------------- */
+
+ATF_TP_ADD_TCS(tp)
+{
+    /* Add the tests for the free functions. */
+    ATF_TP_ADD_TC(tp, enter__tmp);
+    ATF_TP_ADD_TC(tp, enter__hostname);
+    ATF_TP_ADD_TC(tp, enter__ids);
+
+    return atf_no_error();
+}
@@ -26,6 +26,8 @@
 #include "atf-c/detail/process.h"
 
 #include <sys/types.h>
+#include <sys/resource.h>
+#include <sys/time.h>
 #include <sys/wait.h>
 
 #include <errno.h>
@@ -34,6 +36,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "atf-c/defs.h"
@@ -44,6 +47,28 @@
  * function; however, we need to access it during testing. */
 atf_error_t atf_process_status_init(atf_process_status_t *, int);
 
+/* ---------------------------------------------------------------------
+ * Auxiliary functions.
+ * --------------------------------------------------------------------- */
+
+static
+unsigned long long
+monotonic_usecs(void)
+{
+    struct timespec ts;
+
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) == -1)
+        return 0;
+    return (unsigned long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static
+unsigned long long
+timeval_usecs(const struct timeval *tv)
+{
+    return (unsigned long long)tv->tv_sec * 1000000 + tv->tv_usec;
+}
+
 /* ---------------------------------------------------------------------
  * The "stream_prepare" auxiliary type.
  * --------------------------------------------------------------------- */
@@ -189,6 +214,10 @@ atf_error_t
 atf_process_status_init(atf_process_status_t *s, int status)
 {
     s->m_status = status;
+    s->m_wall_usecs = 0;
+    s->m_user_usecs = 0;
+    s->m_system_usecs = 0;
+    s->m_maxrss_kib = 0;
 
     return atf_no_error();
 }
@@ -240,6 +269,30 @@ atf_process_status_coredump(const atf_process_status_t *s)
 #endif
 }
 
+unsigned long long
+atf_process_status_wall_usecs(const atf_process_status_t *s)
+{
+    return s->m_wall_usecs;
+}
+
+unsigned long long
+atf_process_status_user_usecs(const atf_process_status_t *s)
+{
+    return s->m_user_usecs;
+}
+
+unsigned long long
+atf_process_status_system_usecs(const atf_process_status_t *s)
+{
+    return s->m_system_usecs;
+}
+
+unsigned long long
+atf_process_status_maxrss_kib(const atf_process_status_t *s)
+{
+    return s->m_maxrss_kib;
+}
+
 /* ---------------------------------------------------------------------
  * The "atf_process_child" type.
  * --------------------------------------------------------------------- */
@@ -249,6 +302,7 @@ atf_error_t
 atf_process_child_init(atf_process_child_t *c)
 {
     c->m_pid = 0;
+    c->m_start_usecs = monotonic_usecs();
     c->m_stdout = -1;
     c->m_stderr = -1;
 
@@ -269,14 +323,27 @@ atf_error_t
 atf_process_child_wait(atf_process_child_t *c, atf_process_status_t *s)
 {
     atf_error_t err;
+    struct rusage ru;
     int status;
 
-    if (waitpid(c->m_pid, &status, 0) == -1)
+    if (wait4(c->m_pid, &status, 0, &ru) == -1)
         err = atf_libc_error(errno, "Failed waiting for process %d",
                              c->m_pid);
     else {
+        const unsigned long long end_usecs = monotonic_usecs();
+
         atf_process_child_fini(c);
         err = atf_process_status_init(s, status);
+        if (!atf_is_error(err)) {
+            s->m_wall_usecs = end_usecs - c->m_start_usecs;
+            s->m_user_usecs = timeval_usecs(&ru.ru_utime);
+            s->m_system_usecs = timeval_usecs(&ru.ru_stime);
+#if defined(__APPLE__)
+            s->m_maxrss_kib = (unsigned long long)ru.ru_maxrss / 1024;
+#else
+            s->m_maxrss_kib = (unsigned long long)ru.ru_maxrss;
+#endif
+        }
     }
 
     return err;
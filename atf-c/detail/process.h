@@ -77,6 +77,12 @@ int atf_process_stream_type(const atf_process_stream_t *);
 
 struct atf_process_status {
     int m_status;
+
+    /* Resources used by the process and its waited-for descendants. */
+    unsigned long long m_wall_usecs;
+    unsigned long long m_user_usecs;
+    unsigned long long m_system_usecs;
+    unsigned long long m_maxrss_kib;
 };
 typedef struct atf_process_status atf_process_status_t;
 
@@ -87,6 +93,11 @@ int atf_process_status_exitstatus(const atf_process_status_t *);
 bool atf_process_status_signaled(const atf_process_status_t *);
 int atf_process_status_termsig(const atf_process_status_t *);
 bool atf_process_status_coredump(const atf_process_status_t *);
+unsigned long long atf_process_status_wall_usecs(const atf_process_status_t *);
+unsigned long long atf_process_status_user_usecs(const atf_process_status_t *);
+unsigned long long atf_process_status_system_usecs(
+    const atf_process_status_t *);
+unsigned long long atf_process_status_maxrss_kib(const atf_process_status_t *);
 
 /* ---------------------------------------------------------------------
  * The "atf_process_child" type.
@@ -94,6 +105,7 @@ bool atf_process_status_coredump(const atf_process_status_t *);
 
 struct atf_process_child {
     pid_t m_pid;
+    unsigned long long m_start_usecs;
 
     int m_stdout;
     int m_stderr;
@@ -0,0 +1,340 @@
+/* Copyright (c) 2026 The NetBSD Foundation, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+ * CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.  */
+
+#if defined(HAVE_CONFIG_H)
+#include "config.h"
+#endif
+
+/* glibc only declares dladdr(3) as an extension. */
+#if defined(HAVE_DLFCN_H) && !defined(_GNU_SOURCE)
+#   define _GNU_SOURCE
+#endif
+
+#include "atf-c/detail/prof.h"
+
+#include <sys/types.h>
+#include <sys/time.h>
+
+#if defined(HAVE_DLFCN_H)
+#include <dlfcn.h>
+#endif
+#include <errno.h>
+#if defined(HAVE_BACKTRACE)
+#include <execinfo.h>
+#endif
+#include <limits.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "atf-c/detail/dynstr.h"
+#include "atf-c/detail/sanity.h"
+#include "atf-c/error.h"
+
+#if defined(HAVE_BACKTRACE)
+
+/* Time between samples, measured in CPU time consumed by the process. */
+#define SAMPLE_INTERVAL_USEC 1000
+
+/* Samples taken past this many are counted but not recorded; at the above
+ * interval, this covers about 16 seconds of CPU time. */
+#define MAX_SAMPLES 16384
+
+/* Deepest stack recorded by a sample; deeper stacks lose their outermost
+ * frames. */
+#define MAX_FRAMES 64
+
+/* Frames at the top of each sample that belong to the signal handler and
+ * the signal trampoline of the system. */
+#define SKIP_FRAMES 2
+
+struct sample {
+    int depth;
+    void *frames[MAX_FRAMES];
+};
+
+static struct sample *Samples = NULL;
+static unsigned long Sample_Count = 0;
+static unsigned long Dropped_Count = 0;
+static char Path[PATH_MAX];
+static struct sigaction Old_Action;
+
+/* ---------------------------------------------------------------------
+ * Auxiliary functions.
+ * --------------------------------------------------------------------- */
+
+static void
+sample_handler(const int signo)
+{
+    const int saved_errno = errno;
+    const unsigned long index = __sync_fetch_and_add(&Sample_Count, 1);
+
+    (void)signo;
+    if (index < MAX_SAMPLES)
+        Samples[index].depth = backtrace(Samples[index].frames, MAX_FRAMES);
+    else
+        __sync_fetch_and_add(&Dropped_Count, 1);
+    errno = saved_errno;
+}
+
+static atf_error_t
+set_timer(const long usec)
+{
+    struct itimerval it;
+
+    it.it_interval.tv_sec = 0;
+    it.it_interval.tv_usec = usec;
+    it.it_value = it.it_interval;
+    if (setitimer(ITIMER_PROF, &it, NULL) == -1)
+        return atf_libc_error(errno, "Cannot set the profiling timer");
+    return atf_no_error();
+}
+
+/** Appends the name of the function that contains an address.
+ *
+ * Names come from the dynamic symbol table, so functions that are not
+ * exported are shown as an offset into their object unless the program was
+ * linked with -rdynamic. */
+static atf_error_t
+append_frame(atf_dynstr_t *stack, const void *addr)
+{
+#if defined(HAVE_DLFCN_H)
+    Dl_info info;
+
+    if (dladdr(addr, &info) != 0) {
+        if (info.dli_sname != NULL)
+            return atf_dynstr_append_fmt(stack, "%s", info.dli_sname);
+        if (info.dli_fname != NULL) {
+            const char *base = strrchr(info.dli_fname, '/');
+
+            return atf_dynstr_append_fmt(stack, "%s+0x%lx",
+                base == NULL ? info.dli_fname : base + 1,
+                (unsigned long)((uintptr_t)addr -
+                                (uintptr_t)info.dli_fbase));
+        }
+    }
+#endif
+    return atf_dynstr_append_fmt(stack, "0x%lx", (unsigned long)(uintptr_t)addr);
+}
+
+/** Formats a sample as a semicolon-separated list of functions, starting
+ * from the outermost one.
+ *
+ * The innermost frame is the interrupted instruction; all others are return
+ * addresses, which are moved back by one byte so that calls at the very end
+ * of a function are attributed to it. */
+static atf_error_t
+format_sample(const struct sample *sample, char **line)
+{
+    atf_dynstr_t stack;
+    atf_error_t err;
+    int i;
+
+    err = atf_dynstr_init(&stack);
+    if (atf_is_error(err))
+        return err;
+
+    for (i = sample->depth - 1; i >= SKIP_FRAMES; i--) {
+        const uintptr_t addr = (uintptr_t)sample->frames[i];
+
+        if (i != sample->depth - 1) {
+            err = atf_dynstr_append_fmt(&stack, ";");
+            if (atf_is_error(err))
+                goto err;
+        }
+        err = append_frame(&stack, (const void *)(i == SKIP_FRAMES ? addr :
+                                                  addr - 1));
+        if (atf_is_error(err))
+            goto err;
+    }
+
+    *line = atf_dynstr_fini_disown(&stack);
+    return atf_no_error();
+
+err:
+    atf_dynstr_fini(&stack);
+    return err;
+}
+
+static int
+compare_lines(const void *a, const void *b)
+{
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+/** Writes the samples as folded stacks: one line per distinct stack,
+ * followed by the number of samples that hit it. */
+static atf_error_t
+write_folded(const char *path, const unsigned long count)
+{
+    atf_error_t err = atf_no_error();
+    unsigned long i, n;
+    char **lines;
+    FILE *f;
+
+    lines = calloc(count > 0 ? count : 1, sizeof(char *));
+    if (lines == NULL)
+        return atf_no_memory_error();
+
+    n = 0;
+    for (i = 0; i < count; i++) {
+        if (Samples[i].depth <= SKIP_FRAMES)
+            continue;
+        err = format_sample(&Samples[i], &lines[n]);
+        if (atf_is_error(err))
+            goto out;
+        n++;
+    }
+    qsort(lines, n, sizeof(char *), compare_lines);
+
+    f = fopen(path, "w");
+    if (f == NULL) {
+        err = atf_libc_error(errno, "Cannot create %s", path);
+        goto out;
+    }
+    for (i = 0; i < n; ) {
+        unsigned long j = i + 1;
+
+        while (j < n && strcmp(lines[i], lines[j]) == 0)
+            j++;
+        fprintf(f, "%s %lu\n", lines[i], j - i);
+        i = j;
+    }
+    if (Dropped_Count > 0)
+        fprintf(f, "[dropped] %lu\n", Dropped_Count);
+    if (fclose(f) == EOF)
+        err = atf_libc_error(errno, "Cannot write %s", path);
+
+out:
+    for (i = 0; i < n; i++)
+        free(lines[i]);
+    free(lines);
+    return err;
+}
+
+#endif /* defined(HAVE_BACKTRACE) */
+
+/* ---------------------------------------------------------------------
+ * Free functions.
+ * --------------------------------------------------------------------- */
+
+/** Starts sampling the stack of the process.
+ *
+ * The process is interrupted with SIGPROF about every millisecond of CPU
+ * time it consumes, as the timer resolution of the system allows, and the
+ * stack of the interrupted thread is recorded.  This needs
+ * no support from the kernel other than setitimer(2), so it works where
+ * perf_event_open(2) is not allowed.
+ *
+ * \param path File to write the folded stacks to when the profile is
+ *     finished with atf_prof_finish. */
+atf_error_t
+atf_prof_start(const char *path)
+{
+#if defined(HAVE_BACKTRACE)
+    struct sigaction sa;
+    void *warmup[1];
+    atf_error_t err;
+
+    PRE(Samples == NULL);
+
+    if (strlen(path) >= sizeof(Path))
+        return atf_libc_error(ENAMETOOLONG, "Cannot profile to %s", path);
+    snprintf(Path, sizeof(Path), "%s", path);
+
+    Samples = malloc(MAX_SAMPLES * sizeof(struct sample));
+    if (Samples == NULL)
+        return atf_no_memory_error();
+    Sample_Count = 0;
+    Dropped_Count = 0;
+
+    /* The first call to backtrace(3) may load the unwinder, which is not
+     * safe to do from a signal handler. */
+    (void)backtrace(warmup, 1);
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = sample_handler;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = SA_RESTART;
+    if (sigaction(SIGPROF, &sa, &Old_Action) == -1) {
+        err = atf_libc_error(errno, "Cannot install the SIGPROF handler");
+        free(Samples);
+        Samples = NULL;
+        return err;
+    }
+
+    err = set_timer(SAMPLE_INTERVAL_USEC);
+    if (atf_is_error(err)) {
+        (void)sigaction(SIGPROF, &Old_Action, NULL);
+        free(Samples);
+        Samples = NULL;
+    }
+    return err;
+#else
+    (void)path;
+    return atf_libc_error(ENOSYS, "Stack sampling is not supported on this "
+                          "platform");
+#endif
+}
+
+/** Stops the profile started by atf_prof_start and writes it.
+ *
+ * Does nothing if there is no profile in progress. */
+atf_error_t
+atf_prof_finish(void)
+{
+#if defined(HAVE_BACKTRACE)
+    unsigned long count;
+    atf_error_t err;
+
+    if (Samples == NULL)
+        return atf_no_error();
+
+    /* Ignoring the signal discards any sample that is still pending, which
+     * could otherwise reach the previous disposition. */
+    (void)set_timer(0);
+    {
+        struct sigaction sa;
+
+        memset(&sa, 0, sizeof(sa));
+        sa.sa_handler = SIG_IGN;
+        sigemptyset(&sa.sa_mask);
+        (void)sigaction(SIGPROF, &sa, NULL);
+    }
+    (void)sigaction(SIGPROF, &Old_Action, NULL);
+
+    count = Sample_Count < MAX_SAMPLES ? Sample_Count : MAX_SAMPLES;
+    err = write_folded(Path, count);
+
+    free(Samples);
+    Samples = NULL;
+    return err;
+#else
+    return atf_no_error();
+#endif
+}
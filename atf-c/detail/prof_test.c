@@ -0,0 +1,173 @@
+/* Copyright (c) 2026 The NetBSD Foundation, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+ * CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.  */
+
+#include "atf-c/detail/prof.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <atf-c.h>
+
+#include "atf-c/detail/test_helpers.h"
+#include "atf-c/error.h"
+
+/* ---------------------------------------------------------------------
+ * Auxiliary functions.
+ * --------------------------------------------------------------------- */
+
+static void
+start_or_skip(const char *path)
+{
+    atf_error_t err = atf_prof_start(path);
+
+    if (atf_is_error(err)) {
+        const bool unsupported = atf_error_is(err, "libc") &&
+            atf_libc_error_code(err) == ENOSYS;
+
+        atf_error_free(err);
+        if (unsupported)
+            atf_tc_skip("Stack sampling is not supported on this platform");
+        atf_tc_fail("atf_prof_start failed");
+    }
+}
+
+/* Consumes about the given amount of CPU time. */
+static unsigned long
+burn_cpu(const clock_t ticks)
+{
+    const clock_t start = clock();
+    volatile unsigned long counter = 0;
+
+    while (clock() - start < ticks)
+        counter++;
+    return counter;
+}
+
+static void
+profile_handler(const int signo)
+{
+    (void)signo;
+}
+
+/* ---------------------------------------------------------------------
+ * Test cases for the free functions.
+ * --------------------------------------------------------------------- */
+
+ATF_TC(start_finish);
+ATF_TC_HEAD(start_finish, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Tests that a profile is written as "
+                      "folded stacks with their sample counts");
+}
+ATF_TC_BODY(start_finish, tc)
+{
+    char line[4096];
+    unsigned long total = 0;
+    FILE *f;
+
+    start_or_skip("prof.folded");
+    (void)burn_cpu(CLOCKS_PER_SEC / 5);
+    RE(atf_prof_finish());
+
+    f = fopen("prof.folded", "r");
+    ATF_REQUIRE(f != NULL);
+    while (fgets(line, sizeof(line), f) != NULL) {
+        char *space = strrchr(line, ' ');
+        unsigned long count;
+        char *end;
+
+        printf("%s", line);
+        ATF_REQUIRE(space != NULL);
+        ATF_REQUIRE(space != line);
+        count = strtoul(space + 1, &end, 10);
+        ATF_REQUIRE(count > 0);
+        ATF_REQUIRE_STREQ("\n", end);
+        total += count;
+    }
+    fclose(f);
+    ATF_REQUIRE(total > 0);
+}
+
+ATF_TC(finish__idle);
+ATF_TC_HEAD(finish__idle, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Tests that atf_prof_finish does nothing "
+                      "if no profile is in progress");
+}
+ATF_TC_BODY(finish__idle, tc)
+{
+    RE(atf_prof_finish());
+
+    start_or_skip("prof.folded");
+    RE(atf_prof_finish());
+    ATF_REQUIRE(atf_utils_file_exists("prof.folded"));
+    ATF_REQUIRE(unlink("prof.folded") != -1);
+
+    RE(atf_prof_finish());
+    ATF_REQUIRE(!atf_utils_file_exists("prof.folded"));
+}
+
+ATF_TC(finish__restores_handler);
+ATF_TC_HEAD(finish__restores_handler, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Tests that atf_prof_finish restores the "
+                      "previous SIGPROF handler");
+}
+ATF_TC_BODY(finish__restores_handler, tc)
+{
+    struct sigaction sa;
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = profile_handler;
+    sigemptyset(&sa.sa_mask);
+    ATF_REQUIRE(sigaction(SIGPROF, &sa, NULL) != -1);
+
+    start_or_skip("prof.folded");
+    (void)burn_cpu(CLOCKS_PER_SEC / 20);
+    RE(atf_prof_finish());
+
+    ATF_REQUIRE(sigaction(SIGPROF, NULL, &sa) != -1);
+    ATF_REQUIRE(sa.sa_handler == profile_handler);
+}
+
+/* ---------------------------------------------------------------------
+ * Main.
+ * --------------------------------------------------------------------- */
+
+ATF_TP_ADD_TCS(tp)
+{
+    /* Add the tests for the free functions. */
+    ATF_TP_ADD_TC(tp, start_finish);
+    ATF_TP_ADD_TC(tp, finish__idle);
+    ATF_TP_ADD_TC(tp, finish__restores_handler);
+
+    return atf_no_error();
+}
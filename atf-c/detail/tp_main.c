@@ -27,18 +27,26 @@
 #include "config.h"
 #endif
 
+#include <sys/stat.h>
+
 #include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <stdarg.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 
+#include "atf-c/detail/arena.h"
 #include "atf-c/detail/dynstr.h"
 #include "atf-c/detail/env.h"
+#include "atf-c/detail/error.h"
 #include "atf-c/detail/fs.h"
 #include "atf-c/detail/map.h"
 #include "atf-c/detail/sanity.h"
+#include "atf-c/detail/text.h"
 #include "atf-c/error.h"
 #include "atf-c/tc.h"
 #include "atf-c/tp.h"
@@ -57,6 +65,12 @@ static const char *progname = NULL;
  * though. */
 int atf_tp_main(int, char **, atf_error_t (*)(atf_tp_t *));
 
+/* No prototypes in header for these ones, they are a little sketchy
+ * (internal). */
+void atf_tc_set_program_args(char **);
+atf_error_t atf_tc_run_in_process(const atf_tc_t *, const char *,
+                                  void (*)(void), bool *);
+
 enum tc_part {
     BODY,
     CLEANUP,
@@ -88,14 +102,16 @@ enum tc_part {
     name ## _error(const char *fmt, ...) \
     { \
         atf_error_t err; \
-        struct name ## _error_data data; \
+        struct name ## _error_data *data; \
         va_list ap; \
         \
-        va_start(ap, fmt); \
-        vsnprintf(data.m_what, sizeof(data.m_what), fmt, ap); \
-        va_end(ap); \
-        \
-        err = atf_error_new(#name, &data, sizeof(data), name ## _format); \
+        err = atf_error_new_inplace(#name, sizeof(*data), name ## _format, \
+                                    (void **)&data); \
+        if (data != NULL) { \
+            va_start(ap, fmt); \
+            vsnprintf(data->m_what, sizeof(data->m_what), fmt, ap); \
+            va_end(ap); \
+        } \
         \
         return err; \
     }
@@ -135,9 +151,13 @@ print_warning(const char *message)
  * --------------------------------------------------------------------- */
 
 struct params {
+    atf_arena_t m_arena;
     bool m_do_list;
+    bool m_in_process;
     atf_fs_path_t m_srcdir;
     char *m_tcname;
+    char **m_tcnames;
+    int m_ntcnames;
     enum tc_part m_tcpart;
     atf_fs_path_t m_resfile;
     atf_map_t m_config;
@@ -167,13 +187,19 @@ params_init(struct params *p, const char *argv0)
 {
     atf_error_t err;
 
+    atf_arena_init(&p->m_arena);
     p->m_do_list = false;
+    p->m_in_process = false;
     p->m_tcname = NULL;
+    p->m_tcnames = NULL;
+    p->m_ntcnames = 0;
     p->m_tcpart = BODY;
 
     err = argv0_to_dir(argv0, &p->m_srcdir);
-    if (atf_is_error(err))
+    if (atf_is_error(err)) {
+        atf_arena_fini(&p->m_arena);
         return err;
+    }
 
     err = atf_fs_path_init_fmt(&p->m_resfile, "/dev/stdout");
     if (atf_is_error(err)) {
@@ -181,10 +207,11 @@ params_init(struct params *p, const char *argv0)
         return err;
     }
 
-    err = atf_map_init(&p->m_config);
+    err = atf_map_init_arena(&p->m_config, &p->m_arena);
     if (atf_is_error(err)) {
         atf_fs_path_fini(&p->m_resfile);
         atf_fs_path_fini(&p->m_srcdir);
+        atf_arena_fini(&p->m_arena);
         return err;
     }
 
@@ -200,6 +227,7 @@ params_fini(struct params *p)
     atf_fs_path_fini(&p->m_srcdir);
     if (p->m_tcname != NULL)
         free(p->m_tcname);
+    atf_arena_fini(&p->m_arena);
 }
 
 static
@@ -224,6 +252,94 @@ out:
     return err;
 }
 
+/* Loads the configuration variables in the file 'path', which holds one
+ * var=value pair per line; blank lines and lines starting with '#' are
+ * ignored.  The file is read into a single buffer owned by the arena and
+ * split in place, so building a configuration with thousands of variables
+ * takes one pass and no allocation per value. */
+static
+atf_error_t
+parse_cflag(const char *path, atf_arena_t *arena, atf_map_t *config)
+{
+    atf_error_t err;
+    struct stat sb;
+    char *buf, *line, *end;
+    size_t cap, len, lineno;
+    ssize_t cnt;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        err = atf_libc_error(errno, "Cannot open config file %s", path);
+        goto out;
+    }
+
+    if (fstat(fd, &sb) == -1) {
+        err = atf_libc_error(errno, "Cannot stat config file %s", path);
+        goto out_fd;
+    }
+
+    /* Pipes, such as those of process substitutions, have no size, so
+     * their buffer grows as they are read. */
+    cap = S_ISREG(sb.st_mode) ? (size_t)sb.st_size + 1 : 4096;
+    buf = (char *)atf_arena_alloc(arena, cap);
+    if (buf == NULL) {
+        err = atf_no_memory_error();
+        goto out_fd;
+    }
+
+    len = 0;
+    while ((cnt = read(fd, buf + len, cap - 1 - len)) != 0) {
+        if (cnt == -1) {
+            if (errno == EINTR)
+                continue;
+            err = atf_libc_error(errno, "Cannot read config file %s", path);
+            goto out_fd;
+        }
+        len += (size_t)cnt;
+
+        if (len == cap - 1 && !S_ISREG(sb.st_mode)) {
+            buf = (char *)atf_arena_realloc(arena, buf, cap, cap * 2);
+            if (buf == NULL) {
+                err = atf_no_memory_error();
+                goto out_fd;
+            }
+            cap *= 2;
+        }
+    }
+    buf[len] = '\0';
+
+    err = atf_no_error();
+    lineno = 0;
+    for (line = buf; !atf_is_error(err) && line < buf + len; line = end + 1) {
+        char *split;
+
+        lineno++;
+        end = strchr(line, '\n');
+        if (end == NULL)
+            end = buf + len;
+        *end = '\0';
+
+        if (*line == '\0' || *line == '#')
+            continue;
+
+        split = strchr(line, '=');
+        if (split == NULL || split == line) {
+            err = usage_error("Invalid line %zu in config file %s; expected "
+                              "var=value", lineno, path);
+            continue;
+        }
+        *split = '\0';
+
+        err = atf_map_insert(config, line, split + 1, false);
+    }
+
+out_fd:
+    close(fd);
+out:
+    return err;
+}
+
 static
 atf_error_t
 replace_path_param(atf_fs_path_t *param, const char *value)
@@ -334,8 +450,16 @@ process_params(int argc, char **argv, struct params *p)
     old_opterr = opterr;
     opterr = 0;
     while (!atf_is_error(err) &&
-           (ch = getopt(argc, argv, GETOPT_POSIX ":lr:s:v:")) != -1) {
+           (ch = getopt(argc, argv, GETOPT_POSIX ":c:ilr:s:v:")) != -1) {
         switch (ch) {
+        case 'c':
+            err = parse_cflag(optarg, &p->m_arena, &p->m_config);
+            break;
+
+        case 'i':
+            p->m_in_process = true;
+            break;
+
         case 'l':
             p->m_do_list = true;
             break;
@@ -373,8 +497,13 @@ process_params(int argc, char **argv, struct params *p)
 
     if (!atf_is_error(err)) {
         if (p->m_do_list) {
-            if (argc > 0)
+            if (p->m_in_process)
+                err = usage_error("Cannot use -i with -l");
+            else if (argc > 0)
                 err = usage_error("Cannot provide test case names with -l");
+        } else if (p->m_in_process) {
+            p->m_tcnames = argv;
+            p->m_ntcnames = argc;
         } else {
             if (argc == 0)
                 err = usage_error("Must provide a test case name");
@@ -462,8 +591,12 @@ handle_srcdir(struct params *p)
     err = atf_fs_exists(&exe, &b);
     if (!atf_is_error(err)) {
         if (b) {
-            err = atf_map_insert(&p->m_config, "srcdir",
-                                 strdup(atf_fs_path_cstring(&srcdir)), true);
+            char *value = atf_arena_strdup(&p->m_arena,
+                                           atf_fs_path_cstring(&srcdir));
+            if (value == NULL)
+                err = atf_no_memory_error();
+            else
+                err = atf_map_insert(&p->m_config, "srcdir", value, false);
         } else {
             err = user_error("Cannot find the test program in the source "
                              "directory `%s'", atf_fs_path_cstring(&srcdir));
@@ -495,7 +628,8 @@ run_tc(const atf_tp_t *tp, struct params *p, int *exitcode)
         "__RUNNING_INSIDE_ATF_RUN"), "internal-yes-value") != 0)
     {
         print_warning("Running test cases outside of kyua(1) is unsupported");
-        print_warning("No isolation nor timeout control is being applied; you "
+        print_warning("No isolation is being applied and only explicit "
+                      "timeouts are enforced by the test program itself; you "
                       "may get unexpected failures; see atf-test-case(4)");
     }
 
@@ -533,6 +667,112 @@ out:
     return err;
 }
 
+static
+bool
+in_process_allowed(const atf_tc_t *tc)
+{
+    atf_error_t err;
+    bool val;
+
+    if (!atf_tc_has_md_var(tc, "X-atf.in_process"))
+        return false;
+
+    err = atf_text_to_bool(atf_tc_get_md_var(tc, "X-atf.in_process"), &val);
+    if (atf_is_error(err)) {
+        atf_error_free(err);
+        return false;
+    }
+    return val;
+}
+
+static
+atf_error_t
+run_tc_in_process(const atf_tc_t *tc, const char *resfile, bool *failed)
+{
+    atf_error_t err;
+
+    err = atf_tc_run_in_process(tc, resfile, NULL, failed);
+    if (!atf_is_error(err))
+        err = atf_tc_cleanup(tc);
+    return err;
+}
+
+/** Runs several test cases in this process, one after the other.
+ *
+ * Only test cases that set X-atf.in_process can run this way: they trade
+ * the isolation of a process per test case for the cost of starting it. */
+static
+atf_error_t
+run_tcs_in_process(const atf_tp_t *tp, struct params *p, int *exitcode)
+{
+    atf_error_t err;
+    const char *resfile = atf_fs_path_cstring(&p->m_resfile);
+    atf_dynstr_t metrics;
+    bool any_failed = false;
+    int i;
+
+    err = atf_no_error();
+
+    for (i = 0; i < p->m_ntcnames; i++) {
+        if (!atf_tp_has_tc(tp, p->m_tcnames[i])) {
+            err = usage_error("Unknown test case `%s'", p->m_tcnames[i]);
+            goto out;
+        } else if (!in_process_allowed(atf_tp_get_tc(tp, p->m_tcnames[i]))) {
+            err = usage_error("Test case `%s' cannot run in-process; see "
+                              "X-atf.in_process", p->m_tcnames[i]);
+            goto out;
+        }
+    }
+
+    if (strcmp(resfile, "/dev/stdout") != 0 &&
+        strcmp(resfile, "/dev/stderr") != 0) {
+        const int fd = open(resfile, O_WRONLY | O_CREAT | O_TRUNC,
+                            S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+        if (fd == -1) {
+            err = atf_libc_error(errno, "Cannot create results file '%s'",
+                                 resfile);
+            goto out;
+        }
+        close(fd);
+
+        /* The test cases append their metrics, if any, to a companion
+         * file; start it afresh too. */
+        err = atf_dynstr_init_fmt(&metrics, "%s.metrics", resfile);
+        if (atf_is_error(err))
+            goto out;
+        (void)unlink(atf_dynstr_cstring(&metrics));
+        atf_dynstr_fini(&metrics);
+    }
+
+    if (p->m_ntcnames > 0) {
+        for (i = 0; !atf_is_error(err) && i < p->m_ntcnames; i++) {
+            bool failed;
+
+            err = run_tc_in_process(atf_tp_get_tc(tp, p->m_tcnames[i]),
+                                    resfile, &failed);
+            any_failed |= failed;
+        }
+    } else {
+        const atf_tc_t *const *tcs = atf_tp_get_tcs(tp);
+        const atf_tc_t *const *tcsptr;
+
+        INV(tcs != NULL);  /* Should be checked. */
+        for (tcsptr = tcs; !atf_is_error(err) && *tcsptr != NULL; tcsptr++) {
+            bool failed;
+
+            if (!in_process_allowed(*tcsptr))
+                continue;
+
+            err = run_tc_in_process(*tcsptr, resfile, &failed);
+            any_failed |= failed;
+        }
+    }
+
+    *exitcode = any_failed ? EXIT_FAILURE : EXIT_SUCCESS;
+out:
+    return err;
+}
+
 static
 atf_error_t
 controlled_main(int argc, char **argv,
@@ -570,6 +810,8 @@ controlled_main(int argc, char **argv,
         list_tcs(&tp);
         INV(!atf_is_error(err));
         *exitcode = EXIT_SUCCESS;
+    } else if (p.m_in_process) {
+        err = run_tcs_in_process(&tp, &p, exitcode);
     } else {
         err = run_tc(&tp, &p, exitcode);
     }
@@ -600,6 +842,10 @@ atf_tp_main(int argc, char **argv, atf_error_t (*add_tcs_hook)(atf_tp_t *))
     if (strncmp(progname, "lt-", 3) == 0)
         progname += 3;
 
+    /* Test cases may need to re-execute the program to set up their
+     * environment; see the X-atf.virtual_clock property. */
+    atf_tc_set_program_args(argv);
+
     exitcode = EXIT_FAILURE; /* Silence GCC warning. */
     err = controlled_main(argc, argv, add_tcs_hook, &exitcode);
     if (atf_is_error(err)) {
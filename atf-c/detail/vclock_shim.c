@@ -0,0 +1,670 @@
+/* Copyright (c) 2026 The NetBSD Foundation, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+ * CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.  */
+
+/* libatf-c-vclock: a shim that virtualizes the clocks seen by a test
+ * program.  It is meant to be preloaded (LD_PRELOAD), which libatf-c does
+ * on its own for test cases that set the X-atf.virtual_clock property.
+ *
+ * The virtual clocks run at the same pace as the real ones, shifted by a
+ * skew that only ever grows.  Whenever every thread of the process is
+ * blocked, and at least one of them is in a timed wait (a sleep, a poll
+ * without descriptors, etc.), the skew is increased so that the earliest
+ * of those waits expires right away.  A test case that sleeps for an hour
+ * thus observes an hour going by but completes in no time, while code that
+ * keeps a thread busy still sees time pass at its normal pace. */
+
+#if !defined(_GNU_SOURCE)
+#   define _GNU_SOURCE
+#endif
+
+#if defined(HAVE_CONFIG_H)
+#include "config.h"
+#endif
+
+#include <sys/types.h>
+#include <sys/select.h>
+#include <sys/time.h>
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "atf-c/detail/vclock.h"
+
+#define NSECS_PER_SEC 1000000000LL
+
+typedef int (*clock_gettime_fn)(clockid_t, struct timespec *);
+typedef int (*gettimeofday_fn)(struct timeval *, void *);
+typedef int (*nanosleep_fn)(const struct timespec *, struct timespec *);
+typedef int (*clock_nanosleep_fn)(clockid_t, int, const struct timespec *,
+                                  struct timespec *);
+typedef int (*poll_fn)(struct pollfd *, nfds_t, int);
+typedef int (*select_fn)(int, fd_set *, fd_set *, fd_set *, struct timeval *);
+typedef int (*pthread_create_fn)(pthread_t *, const pthread_attr_t *,
+                                 void *(*)(void *), void *);
+typedef int (*pthread_join_fn)(pthread_t, void **);
+
+static struct {
+    clock_gettime_fn m_clock_gettime;
+    gettimeofday_fn m_gettimeofday;
+    nanosleep_fn m_nanosleep;
+    clock_nanosleep_fn m_clock_nanosleep;
+    poll_fn m_poll;
+    select_fn m_select;
+    pthread_create_fn m_pthread_create;
+    pthread_join_fn m_pthread_join;
+} real;
+
+/* A thread blocked in a timed wait. */
+struct sleeper {
+    long long m_deadline;
+    struct sleeper *m_next;
+};
+
+static struct {
+    pthread_mutex_t m_mutex;
+    pthread_cond_t m_cond;
+
+    /* Nanoseconds the virtual clocks are ahead of the real ones.  Only
+     * modified with m_mutex held, but read locklessly by the clock
+     * functions. */
+    long long m_skew;
+
+    /* Threads in the process and how many of them are blocked. */
+    unsigned int m_threads;
+    unsigned int m_blocked;
+    struct sleeper *m_sleepers;
+
+    /* Virtual monotonic time at which the alarm(2) timer expires, or 0. */
+    long long m_alarm;
+} vclock = {
+    PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, 0, 1, 0, NULL, 0
+};
+
+static pthread_once_t resolve_once = PTHREAD_ONCE_INIT;
+
+/* ---------------------------------------------------------------------
+ * Auxiliary functions.
+ * --------------------------------------------------------------------- */
+
+#define LOOKUP(field, name) \
+    do { \
+        void *sym = dlsym(RTLD_NEXT, name); \
+        memcpy(&real.field, &sym, sizeof(real.field)); \
+    } while (0)
+
+static void fork_prepare(void);
+static void fork_parent(void);
+static void fork_child(void);
+
+static
+void
+do_resolve(void)
+{
+    pthread_condattr_t attr;
+
+    LOOKUP(m_clock_gettime, "clock_gettime");
+    LOOKUP(m_gettimeofday, "gettimeofday");
+    LOOKUP(m_nanosleep, "nanosleep");
+    LOOKUP(m_clock_nanosleep, "clock_nanosleep");
+    LOOKUP(m_poll, "poll");
+    LOOKUP(m_select, "select");
+    LOOKUP(m_pthread_create, "pthread_create");
+    LOOKUP(m_pthread_join, "pthread_join");
+
+    /* Timed waits on the condition variable are computed against the real
+     * monotonic clock, which is immune to changes to the system time. */
+    (void)pthread_condattr_init(&attr);
+    (void)pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    (void)pthread_cond_init(&vclock.m_cond, &attr);
+    (void)pthread_condattr_destroy(&attr);
+
+    (void)pthread_atfork(fork_prepare, fork_parent, fork_child);
+}
+
+/** Looks up the real functions, once. */
+static
+void
+resolve(void)
+{
+    (void)pthread_once(&resolve_once, do_resolve);
+}
+
+/** Tells whether a clock is subject to virtualization.
+ *
+ * Clocks that measure CPU time are not: they do not advance while a thread
+ * sleeps anyway. */
+static
+bool
+is_virtual(const clockid_t clock_id)
+{
+    switch (clock_id) {
+    case CLOCK_REALTIME:
+    case CLOCK_MONOTONIC:
+#if defined(CLOCK_MONOTONIC_RAW)
+    case CLOCK_MONOTONIC_RAW:
+#endif
+#if defined(CLOCK_REALTIME_COARSE)
+    case CLOCK_REALTIME_COARSE:
+#endif
+#if defined(CLOCK_MONOTONIC_COARSE)
+    case CLOCK_MONOTONIC_COARSE:
+#endif
+#if defined(CLOCK_BOOTTIME)
+    case CLOCK_BOOTTIME:
+#endif
+        return true;
+    default:
+        return false;
+    }
+}
+
+static
+long long
+ts_to_ns(const struct timespec *ts)
+{
+    return (long long)ts->tv_sec * NSECS_PER_SEC + ts->tv_nsec;
+}
+
+static
+struct timespec
+ns_to_ts(const long long ns)
+{
+    struct timespec ts;
+
+    ts.tv_sec = (time_t)(ns / NSECS_PER_SEC);
+    ts.tv_nsec = (long)(ns % NSECS_PER_SEC);
+    return ts;
+}
+
+static
+long long
+get_skew(void)
+{
+#if defined(__GNUC__)
+    return __atomic_load_n(&vclock.m_skew, __ATOMIC_ACQUIRE);
+#else
+    return vclock.m_skew;
+#endif
+}
+
+static
+long long
+real_now(const clockid_t clock_id)
+{
+    struct timespec ts;
+
+    (void)real.m_clock_gettime(clock_id, &ts);
+    return ts_to_ns(&ts);
+}
+
+/** Returns the current value of the virtual monotonic clock. */
+static
+long long
+virtual_now(void)
+{
+    return real_now(CLOCK_MONOTONIC) + get_skew();
+}
+
+/** Converts a time in the given clock to the monotonic clock.
+ *
+ * The skew is the same for all clocks, so this works equally well for real
+ * and virtual times. */
+static
+long long
+to_monotonic(const clockid_t clock_id, const long long value)
+{
+    if (clock_id == CLOCK_MONOTONIC)
+        return value;
+    return value - real_now(clock_id) + real_now(CLOCK_MONOTONIC);
+}
+
+/** Programs the real alarm(2) timer to match the virtual one.
+ *
+ * The real timer guarantees that the alarm is delivered even if the process
+ * never becomes idle; moving the virtual clock forward just brings it
+ * closer.  Must be called with the mutex held.
+ *
+ * \return True if the real timer was still pending; false if it had
+ * already expired and its signal was delivered by the kernel. */
+static
+bool
+program_alarm(const long long now)
+{
+    struct itimerval value, old;
+
+    memset(&value, 0, sizeof(value));
+    if (vclock.m_alarm != 0) {
+        long long remaining = vclock.m_alarm - now;
+        if (remaining < 1000)
+            remaining = 1000;
+        value.it_value.tv_sec = (time_t)(remaining / NSECS_PER_SEC);
+        value.it_value.tv_usec =
+            (suseconds_t)((remaining % NSECS_PER_SEC) / 1000);
+    }
+    (void)setitimer(ITIMER_REAL, &value, &old);
+    return old.it_value.tv_sec != 0 || old.it_value.tv_usec != 0;
+}
+
+/** Moves the virtual clock forward if every thread is blocked.
+ *
+ * Must be called with the mutex held.
+ *
+ * \param [out] alarm_fired Set to true if the clock reached the alarm(2)
+ *     deadline and the caller must deliver SIGALRM.
+ *
+ * \return True if the clock was moved. */
+static
+bool
+advance_if_idle(bool *alarm_fired)
+{
+    const struct sleeper *s;
+    long long now, target;
+
+    if (vclock.m_blocked < vclock.m_threads || vclock.m_sleepers == NULL)
+        return false;
+
+    /* An alarm whose time has come in real time was delivered by the
+     * kernel already. */
+    now = virtual_now();
+    if (vclock.m_alarm != 0 && vclock.m_alarm <= now)
+        vclock.m_alarm = 0;
+
+    target = vclock.m_sleepers->m_deadline;
+    for (s = vclock.m_sleepers->m_next; s != NULL; s = s->m_next) {
+        if (s->m_deadline < target)
+            target = s->m_deadline;
+    }
+    if (vclock.m_alarm != 0 && vclock.m_alarm < target)
+        target = vclock.m_alarm;
+
+    if (target <= now)
+        return false;
+
+#if defined(__GNUC__)
+    __atomic_store_n(&vclock.m_skew, vclock.m_skew + (target - now),
+                     __ATOMIC_RELEASE);
+#else
+    vclock.m_skew += target - now;
+#endif
+
+    if (vclock.m_alarm != 0 && vclock.m_alarm <= target) {
+        vclock.m_alarm = 0;
+        *alarm_fired = program_alarm(target);
+    } else
+        (void)program_alarm(target);
+
+    (void)pthread_cond_broadcast(&vclock.m_cond);
+    return true;
+}
+
+/** Blocks the calling thread until the virtual clock reaches a deadline.
+ *
+ * \param deadline The virtual monotonic time at which to return.
+ *
+ * \return True if the deadline was reached; false if the wait was cut short
+ * by the delivery of SIGALRM. */
+static
+bool
+wait_until(const long long deadline)
+{
+    struct sleeper self, **iter;
+    bool alarm_fired = false, reached;
+
+    (void)pthread_mutex_lock(&vclock.m_mutex);
+    self.m_deadline = deadline;
+    self.m_next = vclock.m_sleepers;
+    vclock.m_sleepers = &self;
+    vclock.m_blocked++;
+
+    while (virtual_now() < deadline && !alarm_fired) {
+        if (!advance_if_idle(&alarm_fired)) {
+            const struct timespec ts = ns_to_ts(deadline - get_skew());
+            (void)pthread_cond_timedwait(&vclock.m_cond, &vclock.m_mutex, &ts);
+        }
+    }
+
+    for (iter = &vclock.m_sleepers; *iter != &self; iter = &(*iter)->m_next)
+        ;
+    *iter = self.m_next;
+    vclock.m_blocked--;
+    reached = virtual_now() >= deadline;
+    (void)pthread_mutex_unlock(&vclock.m_mutex);
+
+    if (alarm_fired)
+        (void)raise(SIGALRM);
+    return reached;
+}
+
+/** Marks the calling thread as blocked in an untimed wait. */
+static
+void
+block(void)
+{
+    (void)pthread_mutex_lock(&vclock.m_mutex);
+    vclock.m_blocked++;
+    (void)pthread_cond_broadcast(&vclock.m_cond);
+    (void)pthread_mutex_unlock(&vclock.m_mutex);
+}
+
+/** Marks the calling thread as running again after block(). */
+static
+void
+unblock(void)
+{
+    (void)pthread_mutex_lock(&vclock.m_mutex);
+    vclock.m_blocked--;
+    (void)pthread_mutex_unlock(&vclock.m_mutex);
+}
+
+static
+void
+fork_prepare(void)
+{
+    (void)pthread_mutex_lock(&vclock.m_mutex);
+}
+
+static
+void
+fork_parent(void)
+{
+    (void)pthread_mutex_unlock(&vclock.m_mutex);
+}
+
+/** Resets the state of the shim in a new child process.
+ *
+ * Only the forking thread survives, and alarms are not inherited.  The
+ * skew is kept so that time does not go backwards for the child. */
+static
+void
+fork_child(void)
+{
+    vclock.m_threads = 1;
+    vclock.m_blocked = 0;
+    vclock.m_sleepers = NULL;
+    vclock.m_alarm = 0;
+    (void)pthread_mutex_unlock(&vclock.m_mutex);
+}
+
+struct thread_start {
+    void *(*m_routine)(void *);
+    void *m_arg;
+};
+
+static
+void
+thread_exited(void *unused)
+{
+    (void)unused;
+
+    (void)pthread_mutex_lock(&vclock.m_mutex);
+    vclock.m_threads--;
+    (void)pthread_cond_broadcast(&vclock.m_cond);
+    (void)pthread_mutex_unlock(&vclock.m_mutex);
+}
+
+static
+void *
+thread_main(void *raw_start)
+{
+    struct thread_start start;
+    void *result;
+
+    memcpy(&start, raw_start, sizeof(start));
+    free(raw_start);
+
+    pthread_cleanup_push(thread_exited, NULL);
+    result = start.m_routine(start.m_arg);
+    pthread_cleanup_pop(1);
+    return result;
+}
+
+/* ---------------------------------------------------------------------
+ * Interposed functions.
+ * --------------------------------------------------------------------- */
+
+unsigned int
+alarm(unsigned int seconds)
+{
+    long long now, previous;
+
+    resolve();
+    (void)pthread_mutex_lock(&vclock.m_mutex);
+    now = virtual_now();
+    previous = vclock.m_alarm == 0 ? 0 : vclock.m_alarm - now;
+    vclock.m_alarm = seconds == 0 ? 0 :
+        now + (long long)seconds * NSECS_PER_SEC;
+    (void)program_alarm(now);
+    (void)pthread_mutex_unlock(&vclock.m_mutex);
+
+    if (previous <= 0)
+        return 0;
+    return (unsigned int)((previous + NSECS_PER_SEC - 1) / NSECS_PER_SEC);
+}
+
+int
+clock_gettime(clockid_t clock_id, struct timespec *tp)
+{
+    int ret;
+
+    resolve();
+    ret = real.m_clock_gettime(clock_id, tp);
+    if (ret == 0 && is_virtual(clock_id))
+        *tp = ns_to_ts(ts_to_ns(tp) + get_skew());
+    return ret;
+}
+
+int
+clock_nanosleep(clockid_t clock_id, int flags, const struct timespec *rqtp,
+                struct timespec *rmtp)
+{
+    long long deadline;
+
+    resolve();
+    if (!is_virtual(clock_id))
+        return real.m_clock_nanosleep(clock_id, flags, rqtp, rmtp);
+    if (rqtp->tv_nsec < 0 || rqtp->tv_nsec >= NSECS_PER_SEC)
+        return EINVAL;
+
+    if (flags & TIMER_ABSTIME)
+        deadline = to_monotonic(clock_id, ts_to_ns(rqtp));
+    else
+        deadline = virtual_now() + ts_to_ns(rqtp);
+
+    if (!wait_until(deadline)) {
+        if (rmtp != NULL && !(flags & TIMER_ABSTIME))
+            *rmtp = ns_to_ts(deadline - virtual_now());
+        return EINTR;
+    }
+    return 0;
+}
+
+/* The prototype of gettimeofday(2) differs across systems in the type of
+ * its second argument, so define it under a different name. */
+int atf_vclock_gettimeofday(struct timeval *, void *)
+    __asm__("gettimeofday");
+
+int
+atf_vclock_gettimeofday(struct timeval *tv, void *tz)
+{
+    int ret;
+
+    resolve();
+    ret = real.m_gettimeofday(tv, tz);
+    if (ret == 0 && tv != NULL) {
+        const long long usecs = (long long)tv->tv_sec * 1000000 +
+            tv->tv_usec + get_skew() / 1000;
+        tv->tv_sec = (time_t)(usecs / 1000000);
+        tv->tv_usec = (suseconds_t)(usecs % 1000000);
+    }
+    return ret;
+}
+
+int
+nanosleep(const struct timespec *rqtp, struct timespec *rmtp)
+{
+    const int ret = clock_nanosleep(CLOCK_MONOTONIC, 0, rqtp, rmtp);
+
+    if (ret != 0) {
+        errno = ret;
+        return -1;
+    }
+    return 0;
+}
+
+int
+poll(struct pollfd *fds, nfds_t nfds, int timeout)
+{
+    resolve();
+
+    /* Waits on descriptors depend on other processes, which do not share
+     * our clock; only virtualize pure timeouts. */
+    if (nfds > 0 || timeout <= 0)
+        return real.m_poll(fds, nfds, timeout);
+
+    if (!wait_until(virtual_now() + (long long)timeout * 1000000)) {
+        errno = EINTR;
+        return -1;
+    }
+    return 0;
+}
+
+int
+pthread_create(pthread_t *thread, const pthread_attr_t *attr,
+               void *(*routine)(void *), void *arg)
+{
+    struct thread_start *start;
+    int ret;
+
+    resolve();
+    start = malloc(sizeof(*start));
+    if (start == NULL)
+        return EAGAIN;
+    start->m_routine = routine;
+    start->m_arg = arg;
+
+    (void)pthread_mutex_lock(&vclock.m_mutex);
+    vclock.m_threads++;
+    (void)pthread_mutex_unlock(&vclock.m_mutex);
+
+    ret = real.m_pthread_create(thread, attr, thread_main, start);
+    if (ret != 0) {
+        free(start);
+        thread_exited(NULL);
+    }
+    return ret;
+}
+
+int
+pthread_join(pthread_t thread, void **value)
+{
+    int ret;
+
+    resolve();
+    block();
+    ret = real.m_pthread_join(thread, value);
+    unblock();
+    return ret;
+}
+
+int
+select(int nfds, fd_set *readfds, fd_set *writefds, fd_set *errorfds,
+       struct timeval *timeout)
+{
+    long long delay;
+
+    resolve();
+    if (timeout == NULL ||
+        (nfds > 0 && (readfds != NULL || writefds != NULL || errorfds != NULL)))
+        return real.m_select(nfds, readfds, writefds, errorfds, timeout);
+
+    delay = (long long)timeout->tv_sec * NSECS_PER_SEC +
+        (long long)timeout->tv_usec * 1000;
+    if (delay <= 0)
+        return real.m_select(nfds, readfds, writefds, errorfds, timeout);
+
+    if (!wait_until(virtual_now() + delay)) {
+        errno = EINTR;
+        return -1;
+    }
+    timeout->tv_sec = 0;
+    timeout->tv_usec = 0;
+    return 0;
+}
+
+unsigned int
+sleep(unsigned int seconds)
+{
+    long long deadline;
+
+    resolve();
+    deadline = virtual_now() + (long long)seconds * NSECS_PER_SEC;
+    if (!wait_until(deadline))
+        return (unsigned int)((deadline - virtual_now() + NSECS_PER_SEC - 1) /
+                              NSECS_PER_SEC);
+    return 0;
+}
+
+time_t
+time(time_t *tloc)
+{
+    struct timespec ts;
+    time_t now;
+
+    (void)clock_gettime(CLOCK_REALTIME, &ts);
+    now = ts.tv_sec;
+    if (tloc != NULL)
+        *tloc = now;
+    return now;
+}
+
+int
+usleep(useconds_t usecs)
+{
+    resolve();
+    if (!wait_until(virtual_now() + (long long)usecs * 1000)) {
+        errno = EINTR;
+        return -1;
+    }
+    return 0;
+}
+
+/* ---------------------------------------------------------------------
+ * Entry point for libatf-c.
+ * --------------------------------------------------------------------- */
+
+long long
+atf_vclock_skew(void)
+{
+    resolve();
+    return get_skew();
+}
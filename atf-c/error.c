@@ -26,10 +26,12 @@
 #include "atf-c/error.h"
 
 #include <stdarg.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "atf-c/detail/error.h"
 #include "atf-c/detail/sanity.h"
 
 /* Theoretically, there can only be a single error intance at any given
@@ -38,10 +40,33 @@
  * handling process, something else has to be done with the previous
  * error.
  *
+ * The flag below tells whether the preallocated storage holds such an
+ * error.  Raising a second one while the first is still alive is checked
+ * at run time, even in NDEBUG builds, and yields a no_memory error instead
+ * of overwriting the first.  The no_memory error has no payload, so any
+ * number of them can coexist and they do not use this storage.
+ *
  * This is per-thread information and will break threaded tests, but we
  * currently do not have any threading support; therefore, this is fine. */
 static bool error_on_flight = false;
 
+/* Given that there is at most one error on flight, the error object and
+ * its payload live in preallocated storage so that raising an error does
+ * not need to touch the heap.  This keeps error reporting working under
+ * memory pressure and makes code that probes for errors in a loop (e.g.
+ * looking for a binary in the PATH) cheap.  Only payloads that do not fit
+ * in the buffer below fall back to dynamic memory. */
+#define ERROR_DATA_SIZE 8192
+static struct atf_error error_storage;
+static union {
+    char m_bytes[ERROR_DATA_SIZE];
+
+    /* Unused members to force the most restrictive alignment. */
+    long double m_align_ld;
+    long long m_align_ll;
+    void *m_align_ptr;
+} error_data_storage;
+
 /* ---------------------------------------------------------------------
  * Auxiliary functions.
  * --------------------------------------------------------------------- */
@@ -56,27 +81,26 @@ error_format(const atf_error_t err, char *buf, size_t buflen)
 
 static
 bool
-error_init(atf_error_t err, const char *type, void *data, size_t datalen,
+error_init(atf_error_t err, const char *type, size_t datalen,
            void (*format)(const atf_error_t, char *, size_t))
 {
     bool ok;
 
-    PRE(data != NULL || datalen == 0);
-    PRE(datalen != 0 || data == NULL);
-
     err->m_free = false;
     err->m_type = type;
     err->m_format = (format == NULL) ? error_format : format;
 
     ok = true;
-    if (data == NULL) {
+    if (datalen == 0) {
         err->m_data = NULL;
+    } else if (datalen <= sizeof(error_data_storage.m_bytes)) {
+        err->m_data = error_data_storage.m_bytes;
     } else {
         err->m_data = malloc(datalen);
-        if (err->m_data == NULL) {
+        if (err->m_data == NULL)
             ok = false;
-        } else
-            memcpy(err->m_data, data, datalen);
+        else
+            err->m_free = true;
     }
 
     return ok;
@@ -91,44 +115,55 @@ atf_error_new(const char *type, void *data, size_t datalen,
               void (*format)(const atf_error_t, char *, size_t))
 {
     atf_error_t err;
+    void *errdata;
 
-    PRE(!error_on_flight);
     PRE(data != NULL || datalen == 0);
     PRE(datalen != 0 || data == NULL);
 
-    err = malloc(sizeof(*err));
-    if (err == NULL)
+    err = atf_error_new_inplace(type, datalen, format, &errdata);
+    if (errdata != NULL)
+        memcpy(errdata, data, datalen);
+
+    return err;
+}
+
+atf_error_t
+atf_error_new_inplace(const char *type, size_t datalen,
+                      void (*format)(const atf_error_t, char *, size_t),
+                      void **datap)
+{
+    atf_error_t err;
+
+    PRE(datap != NULL);
+
+    err = &error_storage;
+    if (error_on_flight || !error_init(err, type, datalen, format)) {
         err = atf_no_memory_error();
-    else {
-        if (!error_init(err, type, data, datalen, format)) {
-            free(err);
-            err = atf_no_memory_error();
-        } else {
-            err->m_free = true;
-            error_on_flight = true;
-        }
+        *datap = NULL;
+    } else {
+        *datap = err->m_data;
+        error_on_flight = true;
     }
 
     INV(err != NULL);
-    POST(error_on_flight);
     return err;
 }
 
 void
 atf_error_free(atf_error_t err)
 {
-    bool freeit;
-
-    PRE(error_on_flight);
     PRE(err != NULL);
 
-    freeit = err->m_free;
+    if (err != &error_storage) {
+        INV(err->m_data == NULL);
+        return;
+    }
 
-    if (err->m_data != NULL)
-        free(err->m_data);
+    PRE(error_on_flight);
 
-    if (freeit)
-        free(err);
+    if (err->m_free)
+        free(err->m_data);
+    err->m_data = NULL;
 
     error_on_flight = false;
 }
@@ -198,15 +233,24 @@ atf_error_t
 atf_libc_error(int syserrno, const char *fmt, ...)
 {
     atf_error_t err;
-    atf_libc_error_data_t data;
-    va_list ap;
-
-    data.m_errno = syserrno;
-    va_start(ap, fmt);
-    vsnprintf(data.m_what, sizeof(data.m_what), fmt, ap);
-    va_end(ap);
+    atf_libc_error_data_t *data;
+
+    err = atf_error_new_inplace("libc", sizeof(*data), libc_format,
+                                (void **)&data);
+    if (data != NULL) {
+        data->m_errno = syserrno;
+        if (strchr(fmt, '%') == NULL) {
+            /* No conversions to expand: a plain copy is enough. */
+            strncpy(data->m_what, fmt, sizeof(data->m_what) - 1);
+            data->m_what[sizeof(data->m_what) - 1] = '\0';
+        } else {
+            va_list ap;
 
-    err = atf_error_new("libc", &data, sizeof(data), libc_format);
+            va_start(ap, fmt);
+            vsnprintf(data->m_what, sizeof(data->m_what), fmt, ap);
+            va_end(ap);
+        }
+    }
 
     return err;
 }
@@ -253,11 +297,7 @@ no_memory_format(const atf_error_t err, char *buf, size_t buflen)
 atf_error_t
 atf_no_memory_error(void)
 {
-    PRE(!error_on_flight);
-
-    error_init(&no_memory_error, "no_memory", NULL, 0,
-               no_memory_format);
+    error_init(&no_memory_error, "no_memory", 0, no_memory_format);
 
-    error_on_flight = true;
     return &no_memory_error;
 }
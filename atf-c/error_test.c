@@ -33,6 +33,7 @@
 #include <atf-c.h>
 
 #include "atf-c/defs.h"
+#include "atf-c/detail/error.h"
 
 /* ---------------------------------------------------------------------
  * Auxiliary functions.
@@ -97,6 +98,86 @@ ATF_TC_BODY(error_new_wo_memory, tc)
     atf_error_free(err);
 }
 
+ATF_TC(error_new_big_data);
+ATF_TC_HEAD(error_new_big_data, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks the construction of an error "
+                      "object whose payload does not fit in the "
+                      "preallocated storage");
+}
+ATF_TC_BODY(error_new_big_data, tc)
+{
+    atf_error_t err;
+    static char data[65536];
+
+    memset(data, 'a', sizeof(data));
+    data[sizeof(data) - 1] = '\0';
+
+    err = atf_error_new("test_error", data, sizeof(data), NULL);
+    ATF_REQUIRE(atf_error_is(err, "test_error"));
+    ATF_REQUIRE(atf_error_data(err) != data);
+    ATF_REQUIRE(strcmp((const char *)atf_error_data(err), data) == 0);
+    atf_error_free(err);
+}
+
+ATF_TC(error_new_inplace);
+ATF_TC_HEAD(error_new_inplace, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks the construction of an error "
+                      "object whose payload is filled in by the caller");
+}
+ATF_TC_BODY(error_new_inplace, tc)
+{
+    atf_error_t err;
+    int *data;
+
+    err = atf_error_new_inplace("test_error", sizeof(*data), NULL,
+                                (void **)&data);
+    ATF_REQUIRE(atf_error_is(err, "test_error"));
+    ATF_REQUIRE(data != NULL);
+    ATF_REQUIRE(atf_error_data(err) == data);
+    *data = 7;
+    ATF_REQUIRE_EQ(*((const int *)atf_error_data(err)), 7);
+    atf_error_free(err);
+
+    err = atf_error_new_inplace("test_error", SIZE_MAX, NULL,
+                                (void **)&data);
+    ATF_REQUIRE(atf_error_is(err, "no_memory"));
+    ATF_REQUIRE(data == NULL);
+    atf_error_free(err);
+}
+
+ATF_TC(error_new_on_flight);
+ATF_TC_HEAD(error_new_on_flight, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks that raising an error while "
+                      "another one is still on flight does not overwrite "
+                      "the first one");
+}
+ATF_TC_BODY(error_new_on_flight, tc)
+{
+    atf_error_t err1, err2;
+    int data1 = 5, data2 = 6;
+
+    err1 = atf_error_new("test_error", &data1, sizeof(data1), NULL);
+    ATF_REQUIRE(atf_error_is(err1, "test_error"));
+
+    err2 = atf_error_new("other_error", &data2, sizeof(data2), NULL);
+    ATF_REQUIRE(atf_error_is(err2, "no_memory"));
+    ATF_REQUIRE(atf_error_data(err2) == NULL);
+
+    ATF_REQUIRE(atf_error_is(err1, "test_error"));
+    ATF_REQUIRE_EQ(*((const int *)atf_error_data(err1)), 5);
+
+    atf_error_free(err2);
+    atf_error_free(err1);
+
+    err1 = atf_error_new("test_error", &data2, sizeof(data2), NULL);
+    ATF_REQUIRE(atf_error_is(err1, "test_error"));
+    ATF_REQUIRE_EQ(*((const int *)atf_error_data(err1)), 6);
+    atf_error_free(err1);
+}
+
 ATF_TC(no_error);
 ATF_TC_HEAD(no_error, tc)
 {
@@ -181,6 +262,33 @@ ATF_TC_BODY(libc_new, tc)
     atf_error_free(err);
 }
 
+ATF_TC(libc_literal);
+ATF_TC_HEAD(libc_literal, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks that libc errors with a message "
+                      "that has no conversion specifications keep a copy "
+                      "of it");
+}
+ATF_TC_BODY(libc_literal, tc)
+{
+    char msg[] = "Test message";
+    atf_error_t err;
+    char buf[1024];
+
+    err = atf_libc_error(ENOENT, msg);
+    ATF_REQUIRE_EQ(atf_libc_error_code(err), ENOENT);
+    ATF_REQUIRE(atf_libc_error_msg(err) != msg);
+    memset(msg, 'X', sizeof(msg) - 1);
+    atf_error_format(err, buf, sizeof(buf));
+    ATF_REQUIRE(strstr(buf, strerror(ENOENT)) != NULL);
+    ATF_REQUIRE(strstr(buf, "Test message") != NULL);
+    atf_error_free(err);
+
+    err = atf_libc_error(ENOENT, "100%% literal");
+    ATF_REQUIRE(strcmp(atf_libc_error_msg(err), "100% literal") == 0);
+    atf_error_free(err);
+}
+
 ATF_TC(libc_format);
 ATF_TC_HEAD(libc_format, tc)
 {
@@ -280,12 +388,16 @@ ATF_TP_ADD_TCS(tp)
     /* Add the tests for the "atf_error" type. */
     ATF_TP_ADD_TC(tp, error_new);
     ATF_TP_ADD_TC(tp, error_new_wo_memory);
+    ATF_TP_ADD_TC(tp, error_new_big_data);
+    ATF_TP_ADD_TC(tp, error_new_inplace);
+    ATF_TP_ADD_TC(tp, error_new_on_flight);
     ATF_TP_ADD_TC(tp, no_error);
     ATF_TP_ADD_TC(tp, is_error);
     ATF_TP_ADD_TC(tp, format);
 
     /* Add the tests for the "libc" error. */
     ATF_TP_ADD_TC(tp, libc_new);
+    ATF_TP_ADD_TC(tp, libc_literal);
     ATF_TP_ADD_TC(tp, libc_format);
 
     /* Add the tests for the "no_memory" error. */
@@ -0,0 +1,713 @@
+/* Copyright (c) 2026 The NetBSD Foundation, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+ * CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.  */
+
+#if defined(HAVE_CONFIG_H)
+#include "config.h"
+#endif
+
+#include "atf-c/fuzz.h"
+
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include <dirent.h>
+#include <errno.h>
+#include <stdarg.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <atf-c.h>
+
+#include "atf-c/detail/dynstr.h"
+#include "atf-c/detail/env.h"
+#include "atf-c/detail/sanity.h"
+#include "atf-c/detail/text.h"
+
+/* No prototype in header for this one, it's a little sketchy (internal). */
+void atf_tc_set_resultsfile(const char *);
+
+/* Defaults for the fuzzing parameters, which are taken from the fuzz.*
+ * configuration variables or, if unset, from the X-atf.fuzz.* meta-data
+ * properties of the test case. */
+#define DEFAULT_ITERATIONS 10000
+#define DEFAULT_MAX_LEN 4096
+
+/* Number of candidates tried while minimizing a failing input. */
+#define MINIMIZE_TRIES 1024
+
+/* A single input of the corpus. */
+struct input {
+    char *path;
+    unsigned char *data;
+    size_t size;
+};
+
+struct corpus {
+    char *dir;
+    struct input *inputs;
+    size_t count;
+};
+
+/* State shared with the process that runs the fuzzing loop, so that the
+ * input it was processing survives a crash. */
+struct shared_state {
+    unsigned long long iterations;
+    size_t size;
+    unsigned char data[];
+};
+
+/* Input being replayed, reported if the test case exits while processing
+ * it. */
+static const char *Replay_Path = NULL;
+static pid_t Replay_Owner = -1;
+
+/* ---------------------------------------------------------------------
+ * Auxiliary functions.
+ * --------------------------------------------------------------------- */
+
+/** Formats a string; the result must be released with free(3). */
+static char *
+format_string(const char *fmt, ...)
+{
+    atf_dynstr_t str;
+    atf_error_t err;
+    va_list ap;
+
+    va_start(ap, fmt);
+    err = atf_dynstr_init_ap(&str, fmt, ap);
+    va_end(ap);
+    if (atf_is_error(err)) {
+        atf_error_free(err);
+        atf_tc_fail("Cannot allocate memory");
+    }
+    return atf_dynstr_fini_disown(&str);
+}
+
+/** Gets the value of a fuzzing parameter.
+ *
+ * The fuzz.<name> configuration variable takes precedence over the
+ * X-atf.fuzz.<name> meta-data property of the test case.  Returns NULL if
+ * neither is set. */
+static const char *
+get_param(const atf_tc_t *tc, const char *name)
+{
+    char var[64];
+
+    snprintf(var, sizeof(var), "fuzz.%s", name);
+    if (atf_tc_has_config_var(tc, var))
+        return atf_tc_get_config_var(tc, var);
+
+    snprintf(var, sizeof(var), "X-atf.fuzz.%s", name);
+    if (atf_tc_has_md_var(tc, var))
+        return atf_tc_get_md_var(tc, var);
+
+    return NULL;
+}
+
+static long
+get_long_param(const atf_tc_t *tc, const char *name, const long defval)
+{
+    const char *strval = get_param(tc, name);
+    atf_error_t err;
+    long val;
+
+    if (strval == NULL)
+        return defval;
+
+    err = atf_text_to_long(strval, &val);
+    if (atf_is_error(err) || val < 0) {
+        if (atf_is_error(err))
+            atf_error_free(err);
+        atf_tc_fail("Invalid value for the fuzz.%s parameter: %s", name,
+                    strval);
+    }
+    return val;
+}
+
+static bool
+fuzzing_enabled(const atf_tc_t *tc)
+{
+    atf_error_t err;
+    bool val;
+
+    if (!atf_tc_has_config_var(tc, "fuzz"))
+        return false;
+
+    err = atf_text_to_bool(atf_tc_get_config_var(tc, "fuzz"), &val);
+    if (atf_is_error(err)) {
+        atf_error_free(err);
+        atf_tc_fail("Invalid value for the fuzz configuration variable: %s",
+                    atf_tc_get_config_var(tc, "fuzz"));
+    }
+    return val;
+}
+
+/** Computes the directory holding the corpus of a test case.
+ *
+ * Relative paths are interpreted from the source directory; the default is
+ * <ident>.corpus.  The returned string must be released with free(3). */
+static char *
+corpus_dir(const atf_tc_t *tc)
+{
+    const char *dir = get_param(tc, "corpus");
+    const char *srcdir = atf_tc_get_config_var_wd(tc, "srcdir", ".");
+
+    if (dir != NULL && dir[0] == '/')
+        return format_string("%s", dir);
+    else if (dir != NULL)
+        return format_string("%s/%s", srcdir, dir);
+    else
+        return format_string("%s/%s.corpus", srcdir, atf_tc_get_ident(tc));
+}
+
+static void
+read_input(struct input *in)
+{
+    size_t capacity = 4096;
+    ssize_t count;
+    int fd;
+
+    fd = open(in->path, O_RDONLY);
+    ATF_REQUIRE_MSG(fd != -1, "Cannot open %s", in->path);
+
+    in->data = malloc(capacity);
+    ATF_REQUIRE_MSG(in->data != NULL, "Cannot allocate memory");
+    in->size = 0;
+    while ((count = read(fd, in->data + in->size,
+                         capacity - in->size)) > 0) {
+        in->size += count;
+        if (in->size == capacity) {
+            unsigned char *data = realloc(in->data, capacity * 2);
+            ATF_REQUIRE_MSG(data != NULL, "Cannot allocate memory");
+            in->data = data;
+            capacity *= 2;
+        }
+    }
+    ATF_REQUIRE_MSG(count == 0, "Cannot read %s", in->path);
+    close(fd);
+}
+
+static int
+compare_inputs(const void *a, const void *b)
+{
+    return strcmp(((const struct input *)a)->path,
+                  ((const struct input *)b)->path);
+}
+
+/** Loads all the files of a corpus, sorted by name.
+ *
+ * A missing directory is an empty corpus. */
+static void
+corpus_load(struct corpus *c, const atf_tc_t *tc)
+{
+    struct dirent *de;
+    size_t capacity = 0;
+    DIR *d;
+
+    c->dir = corpus_dir(tc);
+    c->inputs = NULL;
+    c->count = 0;
+
+    d = opendir(c->dir);
+    if (d == NULL) {
+        ATF_REQUIRE_MSG(errno == ENOENT, "Cannot open the corpus directory "
+                        "%s", c->dir);
+        return;
+    }
+
+    while ((de = readdir(d)) != NULL) {
+        struct input *in;
+
+        if (de->d_name[0] == '.')
+            continue;
+
+        if (c->count == capacity) {
+            capacity = capacity == 0 ? 16 : capacity * 2;
+            in = realloc(c->inputs, capacity * sizeof(*c->inputs));
+            ATF_REQUIRE_MSG(in != NULL, "Cannot allocate memory");
+            c->inputs = in;
+        }
+
+        in = &c->inputs[c->count++];
+        in->path = format_string("%s/%s", c->dir, de->d_name);
+    }
+    closedir(d);
+
+    if (c->count > 0) {
+        size_t i;
+
+        qsort(c->inputs, c->count, sizeof(*c->inputs), compare_inputs);
+        for (i = 0; i < c->count; i++)
+            read_input(&c->inputs[i]);
+    }
+}
+
+static void
+corpus_fini(struct corpus *c)
+{
+    size_t i;
+
+    for (i = 0; i < c->count; i++) {
+        free(c->inputs[i].data);
+        free(c->inputs[i].path);
+    }
+    free(c->inputs);
+    free(c->dir);
+}
+
+static void
+report_replay_path(void)
+{
+
+    if (Replay_Path != NULL && Replay_Owner == getpid())
+        fprintf(stderr, "Test case terminated while replaying %s\n",
+                Replay_Path);
+}
+
+/** Feeds every input of the corpus to the target, in order. */
+static void
+replay(const struct corpus *c, atf_fuzz_target_t target, const void *cookie)
+{
+    static bool registered = false;
+    size_t i;
+
+    if (!registered) {
+        atexit(report_replay_path);
+        registered = true;
+    }
+
+    Replay_Owner = getpid();
+    for (i = 0; i < c->count; i++) {
+        Replay_Path = c->inputs[i].path;
+        target(c->inputs[i].data, c->inputs[i].size, cookie);
+    }
+    Replay_Path = NULL;
+}
+
+/** xorshift64* pseudo-random number generator. */
+static uint64_t
+next_random(uint64_t *state)
+{
+
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * UINT64_C(2685821657736338717);
+}
+
+/** Applies a few random mutations to an input.
+ *
+ * \param data Buffer holding the input, of max_len bytes.
+ * \param size [in,out] Size of the input. */
+static void
+mutate(unsigned char *data, size_t *size, const size_t max_len,
+       const struct corpus *c, uint64_t *state)
+{
+    static const unsigned char interesting[] = {
+        0x00, 0x01, 0x7f, 0x80, 0xff, '\n', '%', '/',
+    };
+    int count = 1 + next_random(state) % 4;
+
+    while (count-- > 0) {
+        size_t pos = *size == 0 ? 0 : next_random(state) % *size;
+
+        switch (next_random(state) % 7) {
+        case 0:
+            if (*size > 0)
+                data[pos] ^= 1 << (next_random(state) % 8);
+            break;
+
+        case 1:
+            if (*size > 0)
+                data[pos] = next_random(state) & 0xff;
+            break;
+
+        case 2:
+            if (*size > 0)
+                data[pos] = interesting[next_random(state) %
+                                        sizeof(interesting)];
+            break;
+
+        case 3:
+            if (*size < max_len) {
+                pos = next_random(state) % (*size + 1);
+                memmove(data + pos + 1, data + pos, *size - pos);
+                data[pos] = next_random(state) & 0xff;
+                (*size)++;
+            }
+            break;
+
+        case 4:
+            if (*size > 0) {
+                const size_t len = 1 + next_random(state) % (*size - pos);
+                memmove(data + pos, data + pos + len, *size - pos - len);
+                *size -= len;
+            }
+            break;
+
+        case 5:
+            if (*size > 0 && *size < max_len) {
+                unsigned char chunk[64];
+                size_t len = 1 + next_random(state) % (*size - pos);
+                const size_t dest = next_random(state) % (*size + 1);
+                if (len > sizeof(chunk))
+                    len = sizeof(chunk);
+                if (len > max_len - *size)
+                    len = max_len - *size;
+                memcpy(chunk, data + pos, len);
+                memmove(data + dest + len, data + dest, *size - dest);
+                memcpy(data + dest, chunk, len);
+                *size += len;
+            }
+            break;
+
+        case 6:
+            if (c->count > 0) {
+                const struct input *other =
+                    &c->inputs[next_random(state) % c->count];
+                if (other->size > 0) {
+                    const size_t from = next_random(state) % other->size;
+                    size_t len = 1 + next_random(state) %
+                        (other->size - from);
+                    pos = next_random(state) % (*size + 1);
+                    if (len > max_len - pos)
+                        len = max_len - pos;
+                    memcpy(data + pos, other->data + from, len);
+                    if (pos + len > *size)
+                        *size = pos + len;
+                }
+            }
+            break;
+
+        default:
+            UNREACHABLE;
+        }
+    }
+}
+
+static unsigned long long
+now_usecs(void)
+{
+    struct timespec ts;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/** Body of the process that runs the fuzzing loop.
+ *
+ * Every input is copied to the shared state before feeding it to the
+ * target.  The process exits successfully once the budget is exhausted;
+ * failures of the target terminate it as usual, recording their reason in
+ * resfile. */
+static void
+fuzz_loop(const struct corpus *c, atf_fuzz_target_t target,
+          const void *cookie, struct shared_state *shared,
+          const size_t max_len, const long iterations, const long seconds,
+          uint64_t seed, const char *resfile)
+{
+    const unsigned long long deadline = seconds == 0 ? 0 :
+        now_usecs() + (unsigned long long)seconds * 1000000;
+    unsigned char *data;
+    uint64_t state = seed == 0 ? 1 : seed;
+
+    atf_tc_set_resultsfile(resfile);
+
+    data = malloc(max_len == 0 ? 1 : max_len);
+    ATF_REQUIRE_MSG(data != NULL, "Cannot allocate memory");
+
+    while (iterations == 0 ||
+           shared->iterations < (unsigned long long)iterations) {
+        size_t size = 0;
+
+        if (deadline != 0 && (shared->iterations % 256) == 0 &&
+            now_usecs() >= deadline)
+            break;
+
+        if (c->count > 0) {
+            const struct input *in =
+                &c->inputs[next_random(&state) % c->count];
+            size = in->size < max_len ? in->size : max_len;
+            memcpy(data, in->data, size);
+        }
+        mutate(data, &size, max_len, c, &state);
+
+        memcpy(shared->data, data, size);
+        shared->size = size;
+        target(data, size, cookie);
+        shared->iterations++;
+    }
+
+    free(data);
+    exit(EXIT_SUCCESS);
+}
+
+/** Describes why a process running the target failed.
+ *
+ * Returns false if the process exited successfully. */
+static bool
+describe_failure(const int status, const char *resfile, char *buf,
+                 const size_t buflen)
+{
+    if (WIFSIGNALED(status)) {
+        snprintf(buf, buflen, "received signal %d", WTERMSIG(status));
+        return true;
+    } else if (WIFEXITED(status) && WEXITSTATUS(status) != EXIT_SUCCESS) {
+        char line[1024];
+        const char *reason;
+        ssize_t count;
+        int fd;
+
+        snprintf(buf, buflen, "exited with code %d", WEXITSTATUS(status));
+
+        fd = open(resfile, O_RDONLY);
+        if (fd == -1)
+            return true;
+        count = read(fd, line, sizeof(line) - 1);
+        close(fd);
+        if (count <= 0)
+            return true;
+        line[count] = '\0';
+        line[strcspn(line, "\n")] = '\0';
+
+        /* Results of test cases running in-process are prefixed by the
+         * name of the test case. */
+        reason = strstr(line, "failed: ");
+        if (reason != NULL)
+            snprintf(buf, buflen, "%s", reason);
+        return true;
+    } else
+        return false;
+}
+
+static int
+wait_child(const pid_t pid)
+{
+    int status;
+
+    while (waitpid(pid, &status, 0) == -1)
+        ATF_REQUIRE_MSG(errno == EINTR, "waitpid(%d) failed", (int)pid);
+    return status;
+}
+
+/** Checks if the target fails for an input, in a subprocess. */
+static bool
+input_fails(atf_fuzz_target_t target, const void *cookie,
+            const unsigned char *data, const size_t size, const char *resfile)
+{
+    char buf[16];
+    pid_t pid;
+
+    fflush(stdout);
+    fflush(stderr);
+    pid = fork();
+    ATF_REQUIRE_MSG(pid != -1, "Cannot fork to minimize input");
+    if (pid == 0) {
+        /* The target may print a lot while minimizing; drop it. */
+        const int fd = open("/dev/null", O_WRONLY);
+        if (fd != -1) {
+            dup2(fd, STDOUT_FILENO);
+            dup2(fd, STDERR_FILENO);
+            close(fd);
+        }
+        atf_tc_set_resultsfile(resfile);
+        target(data, size, cookie);
+        exit(EXIT_SUCCESS);
+    }
+
+    return describe_failure(wait_child(pid), resfile, buf, sizeof(buf));
+}
+
+/** Shrinks a failing input by removing chunks that do not matter.
+ *
+ * \param size [in,out] Size of the input. */
+static void
+minimize(atf_fuzz_target_t target, const void *cookie, unsigned char *data,
+         size_t *size, const char *resfile)
+{
+    unsigned char *candidate;
+    size_t chunk = *size / 2;
+    int tries = 0;
+
+    if (*size == 0)
+        return;
+
+    candidate = malloc(*size);
+    ATF_REQUIRE_MSG(candidate != NULL, "Cannot allocate memory");
+
+    while (chunk > 0 && tries < MINIMIZE_TRIES) {
+        bool progress = false;
+        size_t pos = 0;
+
+        while (pos < *size && tries < MINIMIZE_TRIES) {
+            const size_t len = chunk < *size - pos ? chunk : *size - pos;
+
+            memcpy(candidate, data, pos);
+            memcpy(candidate + pos, data + pos + len, *size - pos - len);
+            tries++;
+            if (input_fails(target, cookie, candidate, *size - len,
+                            resfile)) {
+                memcpy(data, candidate, *size - len);
+                *size -= len;
+                progress = true;
+            } else
+                pos += len;
+        }
+
+        if (!progress)
+            chunk /= 2;
+    }
+
+    free(candidate);
+}
+
+/** Stores a failing input in the corpus.
+ *
+ * Falls back to the current directory if the corpus cannot be written to,
+ * as happens with installed test suites.  The returned path must be
+ * released with free(3). */
+static char *
+save_input(const char *dir, const unsigned char *data, const size_t size)
+{
+    uint64_t hash = UINT64_C(14695981039346656037);
+    char *path;
+    size_t i;
+    int fd;
+
+    for (i = 0; i < size; i++) {
+        hash ^= data[i];
+        hash *= UINT64_C(1099511628211);
+    }
+
+    (void)mkdir(dir, 0755);
+    path = format_string("%s/crash-%016llx", dir, (unsigned long long)hash);
+    fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1) {
+        free(path);
+        path = format_string("crash-%016llx", (unsigned long long)hash);
+        fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        ATF_REQUIRE_MSG(fd != -1, "Cannot create %s", path);
+    }
+    ATF_REQUIRE_MSG(write(fd, data, size) == (ssize_t)size,
+                    "Cannot write %s", path);
+    close(fd);
+
+    return path;
+}
+
+/** Runs the fuzzing loop in a subprocess and reports its findings. */
+static void
+fuzz(const atf_tc_t *tc, const struct corpus *c, atf_fuzz_target_t target,
+     const void *cookie)
+{
+    const long iterations = get_long_param(tc, "iterations",
+                                           DEFAULT_ITERATIONS);
+    const long seconds = get_long_param(tc, "time", 0);
+    const long max_len = get_long_param(tc, "max_len", DEFAULT_MAX_LEN);
+    const uint64_t seed = get_long_param(tc, "seed",
+        (long)((time(NULL) ^ (getpid() << 16)) & 0x7fffffff));
+    struct shared_state *shared;
+    const size_t shared_size = sizeof(*shared) + max_len;
+    char resfile[1024], reason[1024];
+    unsigned char *data;
+    size_t size;
+    char *path;
+    pid_t pid;
+    int fd;
+
+    ATF_REQUIRE_MSG(iterations > 0 || seconds > 0, "Fuzzing needs a budget; "
+                    "set fuzz.iterations or fuzz.time");
+
+    snprintf(resfile, sizeof(resfile), "%s/atf-fuzz.XXXXXX",
+             atf_env_get_with_default("TMPDIR", "/tmp"));
+    fd = mkstemp(resfile);
+    ATF_REQUIRE_MSG(fd != -1, "Cannot create temporary file %s", resfile);
+    close(fd);
+
+    shared = mmap(NULL, shared_size, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_ANON, -1, 0);
+    ATF_REQUIRE_MSG(shared != MAP_FAILED, "Cannot map shared memory");
+    shared->iterations = 0;
+    shared->size = 0;
+
+    fprintf(stderr, "Fuzzing with seed %llu; set fuzz.seed to reproduce\n",
+            (unsigned long long)seed);
+    fflush(stdout);
+    fflush(stderr);
+    pid = fork();
+    ATF_REQUIRE_MSG(pid != -1, "Cannot fork to run the fuzzer");
+    if (pid == 0)
+        fuzz_loop(c, target, cookie, shared, max_len, iterations, seconds,
+                  seed, resfile);
+
+    if (!describe_failure(wait_child(pid), resfile, reason, sizeof(reason))) {
+        fprintf(stderr, "Fuzzed %llu inputs without failures\n",
+                shared->iterations);
+        munmap(shared, shared_size);
+        unlink(resfile);
+        return;
+    }
+
+    size = shared->size;
+    data = malloc(size == 0 ? 1 : size);
+    ATF_REQUIRE_MSG(data != NULL, "Cannot allocate memory");
+    memcpy(data, shared->data, size);
+    fprintf(stderr, "Input %llu %s; minimizing %zu bytes\n",
+            shared->iterations + 1, reason, size);
+    munmap(shared, shared_size);
+
+    minimize(target, cookie, data, &size, resfile);
+    unlink(resfile);
+
+    path = save_input(c->dir, data, size);
+    free(data);
+    atf_tc_fail("Fuzzing found an input that %s; saved it to %s (%zu "
+                "bytes)", reason, path, size);
+}
+
+/* ---------------------------------------------------------------------
+ * Free functions.
+ * --------------------------------------------------------------------- */
+
+void
+atf_fuzz_run(const atf_tc_t *tc, atf_fuzz_target_t target,
+             const void *cookie)
+{
+    struct corpus c;
+
+    corpus_load(&c, tc);
+    replay(&c, target, cookie);
+    if (fuzzing_enabled(tc))
+        fuzz(tc, &c, target, cookie);
+    corpus_fini(&c);
+}
@@ -0,0 +1,296 @@
+/* Copyright (c) 2026 The NetBSD Foundation, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+ * CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.  */
+
+#include "atf-c/fuzz.h"
+
+#include <sys/stat.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <atf-c.h>
+
+#include "atf-c/detail/test_helpers.h"
+
+/* ---------------------------------------------------------------------
+ * Auxiliary functions.
+ * --------------------------------------------------------------------- */
+
+static void
+init_and_run_h_tc(atf_tc_t *tc, const atf_tc_pack_t *tcpack,
+                  const char *const *config)
+{
+    RE(atf_tc_init_pack(tc, tcpack, config));
+    run_h_tc(tc, "output", "error", "result");
+    atf_tc_fini(tc);
+}
+
+static void
+create_corpus_file(const char *dir, const char *name, const char *contents)
+{
+    char path[1024];
+
+    (void)mkdir(dir, 0755);
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    atf_utils_create_file(path, "%s", contents);
+}
+
+/* ---------------------------------------------------------------------
+ * Helper test cases.
+ * --------------------------------------------------------------------- */
+
+ATF_TC_FUZZ(h_record);
+ATF_TC_HEAD(h_record, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Helper test case");
+}
+ATF_TC_FUZZ_BODY(h_record, tc, data, size)
+{
+    FILE *f = fopen("seen", "a");
+    ATF_REQUIRE(f != NULL);
+    fwrite(data, 1, size, f);
+    fputc('\n', f);
+    fclose(f);
+}
+
+ATF_TC_FUZZ(h_reject);
+ATF_TC_HEAD(h_reject, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Helper test case");
+}
+ATF_TC_FUZZ_BODY(h_reject, tc, data, size)
+{
+    ATF_REQUIRE_MSG(memchr(data, '!', size) == NULL, "Input has a bang");
+}
+
+ATF_TC_FUZZ(h_crash);
+ATF_TC_HEAD(h_crash, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Helper test case");
+}
+ATF_TC_FUZZ_BODY(h_crash, tc, data, size)
+{
+    if (memchr(data, '!', size) != NULL)
+        abort();
+}
+
+ATF_TC_FUZZ(h_noop);
+ATF_TC_HEAD(h_noop, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Helper test case");
+    atf_tc_set_md_var(tc, "X-atf.fuzz.iterations", "50");
+}
+ATF_TC_FUZZ_BODY(h_noop, tc, data, size)
+{
+    (void)data;
+    (void)size;
+}
+
+/* ---------------------------------------------------------------------
+ * Test cases for the replay of the corpus.
+ * --------------------------------------------------------------------- */
+
+ATF_TC(replay);
+ATF_TC_HEAD(replay, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Tests that the corpus is replayed in "
+                      "order when fuzzing is not enabled");
+}
+ATF_TC_BODY(replay, tc)
+{
+    const char *const config[] = { "srcdir", ".", NULL };
+
+    create_corpus_file("h_record.corpus", "b", "second");
+    create_corpus_file("h_record.corpus", "a", "first");
+    create_corpus_file("h_record.corpus", "c", "third");
+    create_corpus_file("h_record.corpus", ".hidden", "ignored");
+
+    init_and_run_h_tc(&ATF_TC_NAME(h_record), &ATF_TC_PACK_NAME(h_record),
+                      config);
+
+    ATF_REQUIRE(atf_utils_grep_file("^passed", "result"));
+    ATF_REQUIRE(atf_utils_compare_file("seen", "first\nsecond\nthird\n"));
+}
+
+ATF_TC(replay_missing);
+ATF_TC_HEAD(replay_missing, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Tests that a missing corpus is an empty "
+                      "one");
+}
+ATF_TC_BODY(replay_missing, tc)
+{
+    const char *const config[] = { "srcdir", ".", NULL };
+
+    init_and_run_h_tc(&ATF_TC_NAME(h_record), &ATF_TC_PACK_NAME(h_record),
+                      config);
+
+    ATF_REQUIRE(atf_utils_grep_file("^passed", "result"));
+    ATF_REQUIRE(!atf_utils_file_exists("seen"));
+}
+
+ATF_TC(replay_fail);
+ATF_TC_HEAD(replay_fail, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Tests that a failing corpus input fails "
+                      "the test case and is identified");
+}
+ATF_TC_BODY(replay_fail, tc)
+{
+    const char *const config[] = { "srcdir", ".", "fuzz.corpus", "inputs",
+                                   NULL };
+
+    create_corpus_file("inputs", "good", "hello");
+    create_corpus_file("inputs", "bad", "hello!");
+
+    init_and_run_h_tc(&ATF_TC_NAME(h_reject), &ATF_TC_PACK_NAME(h_reject),
+                      config);
+
+    ATF_REQUIRE(atf_utils_grep_file("^failed: .*Input has a bang",
+                                    "result"));
+    ATF_REQUIRE(atf_utils_grep_file("while replaying \\./inputs/bad$",
+                                    "error"));
+}
+
+/* ---------------------------------------------------------------------
+ * Test cases for fuzzing.
+ * --------------------------------------------------------------------- */
+
+ATF_TC(fuzz_crash);
+ATF_TC_HEAD(fuzz_crash, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Tests that fuzzing finds, minimizes and "
+                      "saves an input that crashes the target");
+}
+ATF_TC_BODY(fuzz_crash, tc)
+{
+    const char *const config[] = { "srcdir", ".", "fuzz", "true",
+                                   "fuzz.iterations", "100000",
+                                   "fuzz.seed", "1", NULL };
+
+    create_corpus_file("h_crash.corpus", "seed", "some input");
+
+    init_and_run_h_tc(&ATF_TC_NAME(h_crash), &ATF_TC_PACK_NAME(h_crash),
+                      config);
+
+    ATF_REQUIRE(atf_utils_grep_file("^failed: Fuzzing found an input that "
+                                    "received signal 6; saved it to "
+                                    "\\./h_crash\\.corpus/crash-[0-9a-f]+ "
+                                    "\\(1 bytes\\)", "result"));
+    ATF_REQUIRE(atf_utils_grep_file("Fuzzing with seed 1", "error"));
+}
+
+ATF_TC(fuzz_fail);
+ATF_TC_HEAD(fuzz_fail, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Tests that fuzzing reports the reason "
+                      "of a failed requirement");
+}
+ATF_TC_BODY(fuzz_fail, tc)
+{
+    const char *const config[] = { "srcdir", ".", "fuzz", "true",
+                                   "fuzz.iterations", "100000", NULL };
+
+    init_and_run_h_tc(&ATF_TC_NAME(h_reject), &ATF_TC_PACK_NAME(h_reject),
+                      config);
+
+    ATF_REQUIRE(atf_utils_grep_file("^failed: Fuzzing found an input that "
+                                    "failed: .*Input has a bang; saved it "
+                                    "to .*\\(1 bytes\\)", "result"));
+}
+
+ATF_TC(fuzz_budget);
+ATF_TC_HEAD(fuzz_budget, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Tests that the fuzzing budget comes "
+                      "from the configuration or the meta-data");
+}
+ATF_TC_BODY(fuzz_budget, tc)
+{
+    const char *const md_config[] = { "srcdir", ".", "fuzz", "yes", NULL };
+    const char *const config[] = { "srcdir", ".", "fuzz", "yes",
+                                   "fuzz.iterations", "20", NULL };
+
+    init_and_run_h_tc(&ATF_TC_NAME(h_noop), &ATF_TC_PACK_NAME(h_noop),
+                      md_config);
+    ATF_REQUIRE(atf_utils_grep_file("^passed", "result"));
+    ATF_REQUIRE(atf_utils_grep_file("Fuzzed 50 inputs without failures",
+                                    "error"));
+
+    init_and_run_h_tc(&ATF_TC_NAME(h_noop), &ATF_TC_PACK_NAME(h_noop),
+                      config);
+    ATF_REQUIRE(atf_utils_grep_file("^passed", "result"));
+    ATF_REQUIRE(atf_utils_grep_file("Fuzzed 20 inputs without failures",
+                                    "error"));
+}
+
+ATF_TC(fuzz_invalid);
+ATF_TC_HEAD(fuzz_invalid, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Tests that invalid fuzzing parameters "
+                      "fail the test case");
+}
+ATF_TC_BODY(fuzz_invalid, tc)
+{
+    const char *const config[] = { "srcdir", ".", "fuzz", "true",
+                                   "fuzz.iterations", "many", NULL };
+
+    init_and_run_h_tc(&ATF_TC_NAME(h_noop), &ATF_TC_PACK_NAME(h_noop),
+                      config);
+    ATF_REQUIRE(atf_utils_grep_file("^failed: Invalid value for the "
+                                    "fuzz.iterations parameter: many",
+                                    "result"));
+}
+
+/* ---------------------------------------------------------------------
+ * Tests cases for the header file.
+ * --------------------------------------------------------------------- */
+
+HEADER_TC(include, "atf-c/fuzz.h");
+
+/* ---------------------------------------------------------------------
+ * Main.
+ * --------------------------------------------------------------------- */
+
+ATF_TP_ADD_TCS(tp)
+{
+    /* Add the tests for the replay of the corpus. */
+    ATF_TP_ADD_TC(tp, replay);
+    ATF_TP_ADD_TC(tp, replay_missing);
+    ATF_TP_ADD_TC(tp, replay_fail);
+
+    /* Add the tests for fuzzing. */
+    ATF_TP_ADD_TC(tp, fuzz_crash);
+    ATF_TP_ADD_TC(tp, fuzz_fail);
+    ATF_TP_ADD_TC(tp, fuzz_budget);
+    ATF_TP_ADD_TC(tp, fuzz_invalid);
+
+    /* Add the test cases for the header file. */
+    ATF_TP_ADD_TC(tp, include);
+
+    return atf_no_error();
+}
@@ -30,6 +30,7 @@
 
 #include <atf-c/defs.h>
 #include <atf-c/error.h>
+#include <atf-c/fuzz.h>
 #include <atf-c/tc.h>
 #include <atf-c/tp.h>
 #include <atf-c/utils.h>
@@ -73,6 +74,31 @@
         .m_cleanup = atfu_ ## tc ## _cleanup, \
     }
 
+#define ATF_TC_FUZZ(tc) \
+    static void atfu_ ## tc ## _head(atf_tc_t *); \
+    static void atfu_ ## tc ## _fuzz(const atf_tc_t *, const void *, \
+                                     const size_t); \
+    static void \
+    atfu_ ## tc ## _fuzz_target(const void *atfu_data, \
+                                const size_t atfu_size, \
+                                const void *atfu_tc) \
+    { \
+        atfu_ ## tc ## _fuzz((const atf_tc_t *)atfu_tc, atfu_data, \
+                             atfu_size); \
+    } \
+    static void \
+    atfu_ ## tc ## _body(const atf_tc_t *atfu_tc) \
+    { \
+        atf_fuzz_run(atfu_tc, atfu_ ## tc ## _fuzz_target, atfu_tc); \
+    } \
+    static atf_tc_t atfu_ ## tc ## _tc; \
+    static atf_tc_pack_t atfu_ ## tc ## _tc_pack = { \
+        .m_ident = #tc, \
+        .m_head = atfu_ ## tc ## _head, \
+        .m_body = atfu_ ## tc ## _body, \
+        .m_cleanup = NULL, \
+    }
+
 #define ATF_TC_HEAD(tc, tcptr) \
     static \
     void \
@@ -89,6 +115,12 @@
 #define ATF_TC_BODY_NAME(tc) \
     (atfu_ ## tc ## _body)
 
+#define ATF_TC_FUZZ_BODY(tc, tcptr, data, size) \
+    static \
+    void \
+    atfu_ ## tc ## _fuzz(const atf_tc_t *tcptr ATF_DEFS_ATTRIBUTE_UNUSED, \
+                         const void *data, const size_t size)
+
 #define ATF_TC_CLEANUP(tc, tcptr) \
     static \
     void \
@@ -209,4 +241,74 @@
 #define ATF_REQUIRE_ERRNO(exp_errno, bool_expr) \
     atf_tc_require_errno(__FILE__, __LINE__, exp_errno, #bool_expr, bool_expr)
 
+#define ATF_CHECK_ALLOCS_AT_MOST(max) \
+    for (atf_utils_alloc_scope_t atfu_alloc_scope = \
+             atf_utils_alloc_scope_begin(__FILE__, __LINE__); \
+         atfu_alloc_scope.m_active; \
+         atf_utils_alloc_scope_end(&atfu_alloc_scope, __FILE__, __LINE__, \
+                                   (max), false))
+
+#define ATF_REQUIRE_ALLOCS_AT_MOST(max) \
+    for (atf_utils_alloc_scope_t atfu_alloc_scope = \
+             atf_utils_alloc_scope_begin(__FILE__, __LINE__); \
+         atfu_alloc_scope.m_active; \
+         atf_utils_alloc_scope_end(&atfu_alloc_scope, __FILE__, __LINE__, \
+                                   (max), true))
+
+#define ATF_CHECK_NO_ALLOCS ATF_CHECK_ALLOCS_AT_MOST(0)
+
+#define ATF_REQUIRE_NO_ALLOCS ATF_REQUIRE_ALLOCS_AT_MOST(0)
+
+#define ATF_CHECK_IO_WITHIN(budget) \
+    for (atf_utils_io_scope_t atfu_io_scope = \
+             atf_utils_io_scope_begin(budget); \
+         atfu_io_scope.m_active; \
+         atf_utils_io_scope_end(&atfu_io_scope, __FILE__, __LINE__, false))
+
+#define ATF_REQUIRE_IO_WITHIN(budget) \
+    for (atf_utils_io_scope_t atfu_io_scope = \
+             atf_utils_io_scope_begin(budget); \
+         atfu_io_scope.m_active; \
+         atf_utils_io_scope_end(&atfu_io_scope, __FILE__, __LINE__, true))
+
+#define ATF_CHECK_READS_AT_MOST(calls, bytes) \
+    ATF_CHECK_IO_WITHIN(atf_utils_io_budget((calls), (bytes), \
+                                            ATF_UTILS_IO_UNLIMITED, \
+                                            ATF_UTILS_IO_UNLIMITED))
+
+#define ATF_REQUIRE_READS_AT_MOST(calls, bytes) \
+    ATF_REQUIRE_IO_WITHIN(atf_utils_io_budget((calls), (bytes), \
+                                              ATF_UTILS_IO_UNLIMITED, \
+                                              ATF_UTILS_IO_UNLIMITED))
+
+#define ATF_CHECK_WRITES_AT_MOST(calls, bytes) \
+    ATF_CHECK_IO_WITHIN(atf_utils_io_budget(ATF_UTILS_IO_UNLIMITED, \
+                                            ATF_UTILS_IO_UNLIMITED, \
+                                            (calls), (bytes)))
+
+#define ATF_REQUIRE_WRITES_AT_MOST(calls, bytes) \
+    ATF_REQUIRE_IO_WITHIN(atf_utils_io_budget(ATF_UTILS_IO_UNLIMITED, \
+                                              ATF_UTILS_IO_UNLIMITED, \
+                                              (calls), (bytes)))
+
+#define ATF_CHECK_PERCENTILE_BELOW(hist, percentile, value) \
+    atf_utils_histogram_check_below(__FILE__, __LINE__, &(hist), \
+                                    (percentile), (value), false)
+
+#define ATF_REQUIRE_PERCENTILE_BELOW(hist, percentile, value) \
+    atf_utils_histogram_check_below(__FILE__, __LINE__, &(hist), \
+                                    (percentile), (value), true)
+
+#define ATF_CHECK_P50_BELOW(hist, value) \
+    ATF_CHECK_PERCENTILE_BELOW(hist, 50.0, value)
+
+#define ATF_REQUIRE_P50_BELOW(hist, value) \
+    ATF_REQUIRE_PERCENTILE_BELOW(hist, 50.0, value)
+
+#define ATF_CHECK_P99_BELOW(hist, value) \
+    ATF_CHECK_PERCENTILE_BELOW(hist, 99.0, value)
+
+#define ATF_REQUIRE_P99_BELOW(hist, value) \
+    ATF_REQUIRE_PERCENTILE_BELOW(hist, 99.0, value)
+
 #endif /* !defined(ATF_C_MACROS_H) */
@@ -79,6 +79,7 @@ atf_require_errno_semicolons(void)
 #define TEST_MACRO_1 invalid + name
 #define TEST_MACRO_2 invalid + name
 #define TEST_MACRO_3 invalid + name
+#define TEST_MACRO_4 invalid + name
 ATF_TC(TEST_MACRO_1);
 ATF_TC_HEAD(TEST_MACRO_1, tc) { if (tc != NULL) {} }
 ATF_TC_BODY(TEST_MACRO_1, tc) { if (tc != NULL) {} }
@@ -100,3 +101,9 @@ ATF_TC_BODY(TEST_MACRO_3, tc) { if (tc != NULL) {} }
 atf_tc_t *test_name_3 = &ATF_TC_NAME(TEST_MACRO_3);
 atf_tc_pack_t *test_pack_3 = &ATF_TC_PACK_NAME(TEST_MACRO_3);
 void (*body_3)(const atf_tc_t *) = ATF_TC_BODY_NAME(TEST_MACRO_3);
+ATF_TC_FUZZ(TEST_MACRO_4);
+ATF_TC_HEAD(TEST_MACRO_4, tc) { if (tc != NULL) {} }
+ATF_TC_FUZZ_BODY(TEST_MACRO_4, tc, data, size) { if (data != NULL && size > 0) {} }
+atf_tc_t *test_name_4 = &ATF_TC_NAME(TEST_MACRO_4);
+atf_tc_pack_t *test_pack_4 = &ATF_TC_PACK_NAME(TEST_MACRO_4);
+void (*body_4)(const atf_tc_t *) = ATF_TC_BODY_NAME(TEST_MACRO_4);
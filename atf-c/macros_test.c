@@ -541,6 +541,59 @@ ATF_TC_BODY(check_match, tc)
     do_check_eq_tests(tests);
 }
 
+static
+size_t
+count_lines(const char *path, const char *regex)
+{
+    char line[1024];
+    size_t count = 0;
+    FILE *f;
+
+    f = fopen(path, "r");
+    ATF_REQUIRE(f != NULL);
+    while (fgets(line, sizeof(line), f) != NULL) {
+        if (atf_utils_grep_string("%s", line, regex))
+            count++;
+    }
+    fclose(f);
+    return count;
+}
+
+ATF_TC_HEAD(h_check_repeated, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Helper test case");
+}
+ATF_TC_BODY(h_check_repeated, tc)
+{
+    int i;
+
+    for (i = 0; i < 1000; i++)
+        ATF_CHECK_MSG(i < 0, "repeated %d", i);
+    ATF_CHECK_MSG(false, "single");
+}
+
+ATF_TC(check_repeated);
+ATF_TC_HEAD(check_repeated, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Tests that repeated failures of the "
+                      "same check are only reported a few times");
+}
+ATF_TC_BODY(check_repeated, tc)
+{
+    init_and_run_h_tc("h_check_repeated", ATF_TC_HEAD_NAME(h_check_repeated),
+                      ATF_TC_BODY_NAME(h_check_repeated));
+
+    ATF_REQUIRE(atf_utils_grep_file("^failed: 1001 checks failed", "result"));
+    ATF_CHECK_EQ(10, count_lines("error", "Check failed: .*repeated"));
+    ATF_CHECK(atf_utils_grep_file("repeated 9$", "error"));
+    ATF_CHECK(!atf_utils_grep_file("repeated 10$", "error"));
+    ATF_CHECK(atf_utils_grep_file("Further failures at .*macros_test.c:[0-9]+ "
+                                  "will not be reported", "error"));
+    ATF_CHECK(atf_utils_grep_file("Check failed: .*single$", "error"));
+    ATF_CHECK(atf_utils_grep_file("990 more failures at .*macros_test.c:[0-9]+ "
+                                  "were not reported", "error"));
+}
+
 /* ---------------------------------------------------------------------
  * Test cases for the ATF_REQUIRE and ATF_REQUIRE_MSG macros.
  * --------------------------------------------------------------------- */
@@ -876,6 +929,7 @@ ATF_TP_ADD_TCS(tp)
     ATF_TP_ADD_TC(tp, check_streq);
     ATF_TP_ADD_TC(tp, check_errno);
     ATF_TP_ADD_TC(tp, check_match);
+    ATF_TP_ADD_TC(tp, check_repeated);
 
     ATF_TP_ADD_TC(tp, require);
     ATF_TP_ADD_TC(tp, require_eq);
@@ -134,10 +134,67 @@ EOF
               "LD_LIBRARY_PATH=${libpath} ./tp tc"
 }
 
+atf_test_case build_static
+build_static_head()
+{
+    atf_set "descr" "Checks that a test program can be built against" \
+                    "the static variant of the C library, with and" \
+                    "without link-time optimization"
+    atf_set "require.progs" "pkg-config"
+}
+build_static_body()
+{
+    pkg-config atf-c-static || atf_skip "The static variant was not built"
+
+    atf_check -s eq:0 -o save:stdout -e empty \
+              pkg-config --variable=cc atf-c
+    cc=$(cat stdout)
+    echo "Compiler is: ${cc}"
+    atf_require_prog ${cc}
+
+    cat >tp.c <<EOF
+#include <stdio.h>
+
+#include <atf-c.h>
+
+ATF_TC_WITHOUT_HEAD(tc);
+ATF_TC_BODY(tc, tc) {
+    printf("Running\n");
+}
+
+ATF_TP_ADD_TCS(tp) {
+    ATF_TP_ADD_TC(tp, tc);
+
+    return atf_no_error();
+}
+EOF
+
+    atf_check -s eq:0 -o save:stdout -e empty \
+              pkg-config --cflags atf-c-static
+    cflags=$(cat stdout)
+    atf_check -s eq:0 -o save:stdout -e empty pkg-config --libs atf-c-static
+    libs=$(cat stdout)
+    echo "LIBS are: ${libs}"
+
+    # The program must not need the shared libraries at run time, so it is
+    # run without pointing the dynamic loader at them.
+    atf_check -s eq:0 -o empty -e empty \
+              ${cc} ${cflags} -o tp tp.c ${libs}
+    atf_check -s eq:0 -o match:'Running' -e ignore ./tp tc
+
+    if ${cc} -flto ${cflags} -o lto tp.c ${libs} >/dev/null 2>&1
+    then
+        atf_check -s eq:0 -o match:'Running' -e ignore ./lto tc
+    else
+        echo "The compiler cannot do link-time optimization; skipping"
+    fi
+}
+
 atf_init_test_cases()
 {
     atf_add_test_case version
     atf_add_test_case build
+    atf_add_test_case build_static
 }
 
 # vim: syntax=sh:expandtab:shiftwidth=4:softtabstop=4
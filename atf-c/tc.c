@@ -23,29 +23,52 @@
  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
  * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.  */
 
+#if defined(HAVE_CONFIG_H)
+#include "config.h"
+#endif
+
 #include "atf-c/tc.h"
 
 #include <sys/types.h>
+#include <sys/resource.h>
 #include <sys/stat.h>
 #include <sys/uio.h>
+#include <sys/wait.h>
 
+#if defined(HAVE_DLFCN_H)
+#include <dlfcn.h>
+#endif
+#include <ctype.h>
 #include <errno.h>
+#if defined(HAVE_BACKTRACE)
+#include <execinfo.h>
+#endif
 #include <fcntl.h>
+#include <limits.h>
+#include <setjmp.h>
+#include <signal.h>
 #include <stdarg.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "atf-c/defs.h"
+#include "atf-c/detail/alloc.h"
+#include "atf-c/detail/arena.h"
 #include "atf-c/detail/env.h"
 #include "atf-c/detail/fs.h"
 #include "atf-c/detail/map.h"
+#include "atf-c/detail/ns.h"
+#include "atf-c/detail/prof.h"
 #include "atf-c/detail/sanity.h"
 #include "atf-c/detail/text.h"
+#include "atf-c/detail/vclock.h"
 #include "atf-c/error.h"
+#include "atf-c/utils.h"
 
 /* ---------------------------------------------------------------------
  * Auxiliary functions.
@@ -60,11 +83,22 @@ enum expect_type {
     EXPECT_TIMEOUT,
 };
 
+/* A named value recorded by the body; see atf_tc_record_metric. */
+struct metric {
+    struct metric *next;
+    const char *name;
+    const char *unit;
+    double value;
+};
+
 struct context {
     const atf_tc_t *tc;
+    atf_arena_t *arena;
     const char *resfile;
     int resfilefd;
     size_t fail_count;
+    bool in_process;
+    bool finished;
 
     enum expect_type expect;
     atf_dynstr_t expect_reason;
@@ -72,57 +106,176 @@ struct context {
     size_t expect_fail_count;
     int expect_exitcode;
     int expect_signo;
+
+    struct metric *metrics;
+    struct metric **metrics_tail;
+
+    bool timing;
+    unsigned long long body_start_usecs;
+    unsigned long long body_start_cpu_usecs;
 };
 
-static void context_init(struct context *, const atf_tc_t *, const char *);
+static void context_init(struct context *, const atf_tc_t *, atf_arena_t *,
+                         const char *, const bool);
 static void context_set_resfile(struct context *, const char *);
 static void context_close_resfile(struct context *);
 static void check_fatal_error(atf_error_t);
 static void report_fatal_error(const char *, ...)
     ATF_DEFS_ATTRIBUTE_NORETURN;
-static atf_error_t write_resfile(const int, const char *, const int,
-                                 const atf_dynstr_t *);
+static atf_error_t write_resfile(const int, const char *, const char *,
+                                 const int, const atf_dynstr_t *);
 static void create_resfile(struct context *, const char *, const int,
                            atf_dynstr_t *);
+static void write_metrics(const struct context *);
+static unsigned long long cpu_usecs(unsigned long long *);
+static unsigned long long monotonic_usecs(void);
+static void start_timing(struct context *);
+static void record_timing(struct context *);
+static void _atf_tc_record_metric(struct context *, const char *,
+    const double, const char *);
 static void error_in_expect(struct context *, const char *, ...)
     ATF_DEFS_ATTRIBUTE_NORETURN;
 static void validate_expect(struct context *);
+static void require_own_process(struct context *, const char *);
+static void terminate(struct context *, const int)
+    ATF_DEFS_ATTRIBUTE_NORETURN;
 static void expected_failure(struct context *, atf_dynstr_t *)
     ATF_DEFS_ATTRIBUTE_NORETURN;
 static void fail_requirement(struct context *, atf_dynstr_t *)
     ATF_DEFS_ATTRIBUTE_NORETURN;
-static void fail_check(struct context *, atf_dynstr_t *);
+static void report_check_failure(const char *, const size_t, const char *,
+                                 ...) ATF_DEFS_ATTRIBUTE_FORMAT_PRINTF(3, 4);
+static void flush_check_failures(void);
+static void fail_check(struct context *, const char *, const size_t,
+                       atf_dynstr_t *);
 static void pass(struct context *)
     ATF_DEFS_ATTRIBUTE_NORETURN;
 static void skip(struct context *, atf_dynstr_t *)
     ATF_DEFS_ATTRIBUTE_NORETURN;
-static void format_reason_ap(atf_dynstr_t *, const char *, const size_t,
-                             const char *, va_list);
-static void format_reason_fmt(atf_dynstr_t *, const char *, const size_t,
-                              const char *, ...);
-static void errno_test(struct context *, const char *, const size_t,
-                       const int, const char *, const bool,
-                       void (*)(struct context *, atf_dynstr_t *));
+static void format_reason_ap(struct context *, atf_dynstr_t *, const char *,
+                             const size_t, const char *, va_list);
+static void format_reason_fmt(struct context *, atf_dynstr_t *, const char *,
+                              const size_t, const char *, ...);
+static bool errno_test(struct context *, const char *, const size_t,
+                       const int, const char *, const bool, atf_dynstr_t *);
 static atf_error_t check_prog_in_dir(const char *, void *);
 static atf_error_t check_prog(struct context *, const char *);
+static bool md_var_enabled(struct context *, const atf_tc_t *, const char *);
+static void check_leaks(struct context *, const atf_utils_alloc_stats_t *);
+static bool virtual_clock_active(void);
+static void reexec_self(char *const *);
+static void enable_virtual_clock(struct context *);
+static void isolate(struct context *, const atf_tc_t *, const char *);
+static bool feature_enabled(struct context *, const atf_tc_t *,
+                            const char *, const char *);
+static void start_profile(const atf_tc_t *, const char *);
+static void finish_profile(void);
+static long watchdog_timeout(const atf_tc_t *);
+static bool watchdog_running(void);
+static void watchdog_format_result(const long);
+static void watchdog_arm_body(const char *, const long);
+static void watch_body(const char *, const long);
+static void run_body(const atf_tc_t *, const char *, const bool)
+    ATF_DEFS_ATTRIBUTE_NORETURN;
 
-/* No prototype in header for this one, it's a little sketchy (internal). */
+/* No prototypes in header for these ones, they are a little sketchy
+ * (internal). */
+void atf_tc_set_program_args(char **);
 void atf_tc_set_resultsfile(const char *);
+atf_error_t atf_tc_run_in_process(const atf_tc_t *, const char *,
+                                  void (*)(void), bool *);
+void atf_tc_unwind(void) ATF_DEFS_ATTRIBUTE_NORETURN;
+
+/* Arguments the test program was started with, used to re-execute it. */
+static char **Program_Args = NULL;
+
+/* Where a test case running in-process returns to once it has recorded its
+ * result, instead of terminating the process.  Unwind_Hook, if set, is
+ * invoked first so that the C++ bindings can unwind their own frames by
+ * raising an exception, after which they call atf_tc_unwind; it returns if
+ * there is nothing to unwind.  Only the process that started the test case
+ * unwinds: children it forks still exit. */
+static jmp_buf *Unwind_Target = NULL;
+static void (*Unwind_Hook)(void) = NULL;
+static pid_t Unwind_Owner = -1;
+static int Unwind_Status;
+
+/* CPU time, in microseconds, that the test program consumed before running
+ * the test case, which covers loading it and setting it up.  It is taken
+ * before forking the watchdog so that the body inherits it. */
+static unsigned long long Startup_Cpu_Usecs = 0;
+
+/* Seconds that the watchdog waits for the body to print its stack and exit
+ * after its timeout, before killing it. */
+#define WATCHDOG_GRACE 5
+
+/* State of the watchdog that enforces the timeout of the body when there is
+ * no runtime engine to do so.  The first two are used by the parent, the
+ * rest by the body; the result line is formatted upfront because the
+ * signal handler that writes it cannot allocate. */
+static volatile pid_t Watchdog_Child = -1;
+static volatile sig_atomic_t Watchdog_Expirations = 0;
+static pid_t Watchdog_Body = -1;
+static const char *Watchdog_Resfile = NULL;
+static char Watchdog_Result[128];
+
+/* Failed checks are reported this many times per source location; further
+ * failures at the same location are only counted and summarized when the
+ * test case terminates. */
+#define CHECK_REPORT_LIMIT 10
+
+/* Locations of failed checks, in an open-addressed hash table.  Failures at
+ * locations that do not fit are always reported. */
+#define CHECK_SITES 256
+static struct check_site {
+    const char *file;
+    size_t line;
+    size_t count;
+} Check_Sites[CHECK_SITES];
+
+/* Repeated failure reports are collected here to avoid one write(2) per
+ * failure; the first report for every location is written right away so
+ * that it is not lost if the test case crashes. */
+static char Check_Buffer[4096];
+static size_t Check_Buffer_Length = 0;
+
+/* Process that owns the state above; children forked by the test case
+ * must not report their parent's failures. */
+static pid_t Check_Owner = -1;
 
 static void
-context_init(struct context *ctx, const atf_tc_t *tc, const char *resfile)
+context_init(struct context *ctx, const atf_tc_t *tc, atf_arena_t *arena,
+             const char *resfile, const bool in_process)
 {
 
     ctx->tc = tc;
+    ctx->arena = arena;
     ctx->resfilefd = -1;
+    ctx->in_process = in_process;
+    ctx->finished = false;
     context_set_resfile(ctx, resfile);
     ctx->fail_count = 0;
     ctx->expect = EXPECT_PASS;
-    check_fatal_error(atf_dynstr_init(&ctx->expect_reason));
+    check_fatal_error(atf_dynstr_init_arena(&ctx->expect_reason, ctx->arena));
     ctx->expect_previous_fail_count = 0;
     ctx->expect_fail_count = 0;
     ctx->expect_exitcode = 0;
     ctx->expect_signo = 0;
+    ctx->metrics = NULL;
+    ctx->metrics_tail = &ctx->metrics;
+    ctx->timing = false;
+
+    memset(Check_Sites, 0, sizeof(Check_Sites));
+    Check_Buffer_Length = 0;
+    Check_Owner = getpid();
+    {
+        static bool registered = false;
+        if (!registered) {
+            /* Catch test cases that exit(3) on their own. */
+            atexit(flush_check_failures);
+            registered = true;
+        }
+    }
 }
 
 static void
@@ -137,7 +290,8 @@ context_set_resfile(struct context *ctx, const char *resfile)
     else if (strcmp(resfile, "/dev/stderr") == 0)
         ctx->resfilefd = STDERR_FILENO;
     else
-        ctx->resfilefd = open(resfile, O_WRONLY | O_CREAT | O_TRUNC,
+        ctx->resfilefd = open(resfile, O_WRONLY | O_CREAT |
+            (ctx->in_process ? O_APPEND : O_TRUNC),
             S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
     if (ctx->resfilefd == -1) {
             err = atf_libc_error(errno,
@@ -188,25 +342,35 @@ report_fatal_error(const char *msg, ...)
 
 /** Writes to a results file.
  *
- * The results file is supposed to be already open.
+ * The results file is supposed to be already open.  If ident is not NULL,
+ * the result is prefixed by it, as test cases running in-process share a
+ * single results file.
  *
  * This function returns an error code instead of exiting in case of error
  * because the caller needs to clean up the reason object before terminating.
  */
 static atf_error_t
-write_resfile(const int fd, const char *result, const int arg,
-              const atf_dynstr_t *reason)
+write_resfile(const int fd, const char *ident, const char *result,
+              const int arg, const atf_dynstr_t *reason)
 {
     static char NL[] = "\n", CS[] = ": ";
     char buf[64];
     const char *r;
-    struct iovec iov[5];
+    struct iovec iov[7];
     ssize_t ret;
     int count = 0;
 
     INV(arg == -1 || reason != NULL);
 
 #define UNCONST(a) ((void *)(uintptr_t)(const void *)(a))
+    if (ident != NULL) {
+        iov[count].iov_base = UNCONST(ident);
+        iov[count++].iov_len = strlen(ident);
+
+        iov[count].iov_base = CS;
+        iov[count++].iov_len = sizeof(CS) - 1;
+    }
+
     iov[count].iov_base = UNCONST(result);
     iov[count++].iov_len = strlen(result);
 
@@ -251,6 +415,19 @@ create_resfile(struct context *ctx, const char *result, const int arg,
 {
     atf_error_t err;
 
+    if (ctx->finished) {
+        /* The body swallowed the exception that was unwinding it after it
+         * recorded its result; keep the first result. */
+        INV(ctx->in_process);
+        if (reason != NULL)
+            atf_dynstr_fini(reason);
+        return;
+    }
+
+    if (ctx->timing)
+        record_timing(ctx);
+    flush_check_failures();
+
     /*
      * We'll attempt to truncate the results file, but only if it's not pointed
      * at stdout/stderr.  We could just blindly ftruncate() here, but it may
@@ -259,15 +436,146 @@ create_resfile(struct context *ctx, const char *result, const int arg,
      * but it will also redirect the results directly to some file and we'll
      * have no issue here.
      */
-    if (ctx->resfilefd != STDOUT_FILENO && ctx->resfilefd != STDERR_FILENO &&
-        ftruncate(ctx->resfilefd, 0) != -1)
+    if (!ctx->in_process && ctx->resfilefd != STDOUT_FILENO &&
+        ctx->resfilefd != STDERR_FILENO && ftruncate(ctx->resfilefd, 0) != -1)
         lseek(ctx->resfilefd, 0, SEEK_SET);
-    err = write_resfile(ctx->resfilefd, result, arg, reason);
+    err = write_resfile(ctx->resfilefd,
+                        ctx->in_process ? atf_tc_get_ident(ctx->tc) : NULL,
+                        result, arg, reason);
 
     if (reason != NULL)
         atf_dynstr_fini(reason);
 
     check_fatal_error(err);
+    write_metrics(ctx);
+}
+
+/** Returns the CPU time consumed by the process so far, in microseconds,
+ * and its maximum resident set size, in KiB, if maxrss_kib is not NULL. */
+static unsigned long long
+cpu_usecs(unsigned long long *maxrss_kib)
+{
+    struct rusage ru;
+
+    if (getrusage(RUSAGE_SELF, &ru) == -1) {
+        if (maxrss_kib != NULL)
+            *maxrss_kib = 0;
+        return 0;
+    }
+    if (maxrss_kib != NULL) {
+#if defined(__APPLE__)
+        *maxrss_kib = (unsigned long long)ru.ru_maxrss / 1024;
+#else
+        *maxrss_kib = (unsigned long long)ru.ru_maxrss;
+#endif
+    }
+    return (unsigned long long)ru.ru_utime.tv_sec * 1000000 +
+        ru.ru_utime.tv_usec + (unsigned long long)ru.ru_stime.tv_sec *
+        1000000 + ru.ru_stime.tv_usec;
+}
+
+static unsigned long long
+monotonic_usecs(void)
+{
+    struct timespec ts;
+
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) == -1)
+        return 0;
+    return (unsigned long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/** Starts timing the body for record_timing. */
+static void
+start_timing(struct context *ctx)
+{
+    ctx->timing = true;
+    ctx->body_start_cpu_usecs = cpu_usecs(NULL);
+    ctx->body_start_usecs = monotonic_usecs();
+}
+
+/** Records the time and memory used by the test case as atf.* metrics.
+ *
+ * The startup time is the CPU time that the test program consumed before
+ * the test case started; it is not recorded for test cases that run
+ * in-process, which share the startup of the program. */
+static void
+record_timing(struct context *ctx)
+{
+    const unsigned long long end_usecs = monotonic_usecs();
+    unsigned long long maxrss_kib;
+    const unsigned long long end_cpu_usecs = cpu_usecs(&maxrss_kib);
+
+    if (!ctx->in_process)
+        _atf_tc_record_metric(ctx, "atf.startup_time",
+                              Startup_Cpu_Usecs / 1e6, "s");
+    _atf_tc_record_metric(ctx, "atf.body_time",
+                          (end_usecs - ctx->body_start_usecs) / 1e6, "s");
+    _atf_tc_record_metric(ctx, "atf.body_cpu_time",
+                          (end_cpu_usecs - ctx->body_start_cpu_usecs) / 1e6,
+                          "s");
+    _atf_tc_record_metric(ctx, "atf.max_rss", (double)maxrss_kib, "KiB");
+}
+
+/** Writes the metrics recorded by the body next to the results file.
+ *
+ * The results file itself must keep a single line for the runtime engine
+ * to parse it, so the metrics go to a file named after it with a .metrics
+ * suffix or, if the results go to the standard output or error, after the
+ * test case in the work directory.  Test cases running in-process append
+ * to the shared file, prefixing every line by their name as they do in the
+ * results file.
+ *
+ * An error in this function is considered to be fatal, as in
+ * create_resfile.
+ */
+static void
+write_metrics(const struct context *ctx)
+{
+    const bool to_stdio = strcmp(ctx->resfile, "/dev/stdout") == 0 ||
+        strcmp(ctx->resfile, "/dev/stderr") == 0;
+    const bool shared = ctx->in_process && !to_stdio;
+    const struct metric *m;
+    atf_dynstr_t path;
+    atf_error_t err;
+    FILE *f;
+
+    if (ctx->metrics == NULL && (ctx->in_process || to_stdio))
+        return;
+
+    check_fatal_error(atf_dynstr_init_fmt(&path, "%s.metrics", to_stdio ?
+        atf_tc_get_ident(ctx->tc) : ctx->resfile));
+
+    if (ctx->metrics == NULL) {
+        /* Do not leave the metrics of a previous run behind. */
+        (void)unlink(atf_dynstr_cstring(&path));
+        atf_dynstr_fini(&path);
+        return;
+    }
+
+    f = fopen(atf_dynstr_cstring(&path), shared ? "a" : "w");
+    if (f == NULL) {
+        err = atf_libc_error(errno, "Cannot create metrics file '%s'",
+                             atf_dynstr_cstring(&path));
+        atf_dynstr_fini(&path);
+        check_fatal_error(err);
+    }
+
+    for (m = ctx->metrics; m != NULL; m = m->next) {
+        if (shared)
+            fprintf(f, "%s: ", atf_tc_get_ident(ctx->tc));
+        fprintf(f, "%s: %.15g", m->name, m->value);
+        if (m->unit[0] != '\0')
+            fprintf(f, " %s", m->unit);
+        fputc('\n', f);
+    }
+
+    if (ferror(f) || fclose(f) == EOF) {
+        err = atf_libc_error(errno, "Failed to write metrics file '%s'",
+                             atf_dynstr_cstring(&path));
+        atf_dynstr_fini(&path);
+        check_fatal_error(err);
+    }
+    atf_dynstr_fini(&path);
 }
 
 /** Fails a test case if validate_expect fails. */
@@ -278,7 +586,7 @@ error_in_expect(struct context *ctx, const char *fmt, ...)
     va_list ap;
 
     va_start(ap, fmt);
-    format_reason_ap(&reason, NULL, 0, fmt, ap);
+    format_reason_ap(ctx, &reason, NULL, 0, fmt, ap);
     va_end(ap);
 
     ctx->expect = EXPECT_PASS;  /* Ensure fail_requirement really fails. */
@@ -316,14 +624,50 @@ validate_expect(struct context *ctx)
         UNREACHABLE;
 }
 
+/** Fails a test case that relies on terminating its process.
+ *
+ * Expecting the test case to exit, die or hang cannot be honored when it
+ * shares the process with other test cases. */
+static void
+require_own_process(struct context *ctx, const char *what)
+{
+    if (ctx->in_process) {
+        atf_dynstr_t reason;
+
+        format_reason_fmt(ctx, &reason, NULL, 0, "%s cannot be used in "
+            "test cases that run in-process", what);
+        ctx->expect = EXPECT_PASS;
+        fail_requirement(ctx, &reason);
+    }
+}
+
+/** Terminates the test case once its result has been recorded. */
+static void
+terminate(struct context *ctx, const int exitcode)
+{
+    finish_profile();
+    context_close_resfile(ctx);
+
+    if (ctx->in_process && Unwind_Target != NULL &&
+        Unwind_Owner == getpid()) {
+        if (!ctx->finished) {
+            ctx->finished = true;
+            Unwind_Status = exitcode;
+        }
+        if (Unwind_Hook != NULL)
+            Unwind_Hook();
+        atf_tc_unwind();
+    }
+    exit(exitcode);
+}
+
 static void
 expected_failure(struct context *ctx, atf_dynstr_t *reason)
 {
     check_fatal_error(atf_dynstr_prepend_fmt(reason, "%s: ",
         atf_dynstr_cstring(&ctx->expect_reason)));
     create_resfile(ctx, "expected_failure", -1, reason);
-    context_close_resfile(ctx);
-    exit(EXIT_SUCCESS);
+    terminate(ctx, EXIT_SUCCESS);
 }
 
 static void
@@ -333,8 +677,7 @@ fail_requirement(struct context *ctx, atf_dynstr_t *reason)
         expected_failure(ctx, reason);
     } else if (ctx->expect == EXPECT_PASS) {
         create_resfile(ctx, "failed", -1, reason);
-        context_close_resfile(ctx);
-        exit(EXIT_FAILURE);
+        terminate(ctx, EXIT_FAILURE);
     } else {
         error_in_expect(ctx, "Test case raised a failure but was not "
             "expecting one; reason was %s", atf_dynstr_cstring(reason));
@@ -342,16 +685,141 @@ fail_requirement(struct context *ctx, atf_dynstr_t *reason)
     UNREACHABLE;
 }
 
+/** Looks up the entry for a source location in Check_Sites.
+ *
+ * Returns NULL if the location is unknown (file is NULL) or if the table is
+ * full. */
+static struct check_site *
+find_check_site(const char *file, const size_t line)
+{
+    size_t i, probe;
+
+    if (file == NULL)
+        return NULL;
+
+    /* The file names come from __FILE__, so comparing pointers is enough
+     * to tell locations apart. */
+    i = (((uintptr_t)file >> 4) ^ (line * 2654435761u)) % CHECK_SITES;
+    for (probe = 0; probe < CHECK_SITES; probe++) {
+        struct check_site *site = &Check_Sites[(i + probe) % CHECK_SITES];
+
+        if (site->file == NULL) {
+            site->file = file;
+            site->line = line;
+            return site;
+        } else if (site->file == file && site->line == line)
+            return site;
+    }
+    return NULL;
+}
+
+/** Discards the failures inherited from the parent in forked children. */
+static void
+claim_check_failures(void)
+{
+    if (Check_Owner != getpid()) {
+        memset(Check_Sites, 0, sizeof(Check_Sites));
+        Check_Buffer_Length = 0;
+        Check_Owner = getpid();
+    }
+}
+
+static void
+write_check_failures(const char *text, const size_t length)
+{
+    if (length > 0) {
+        fwrite(text, 1, length, stderr);
+        fflush(stderr);
+    }
+}
+
+/** Reports a check failure at the given source location.
+ *
+ * Only the first CHECK_REPORT_LIMIT failures at every location are printed;
+ * the rest are counted for flush_check_failures to summarize. */
 static void
-fail_check(struct context *ctx, atf_dynstr_t *reason)
+report_check_failure(const char *file, const size_t line, const char *fmt,
+                     ...)
+{
+    struct check_site *site;
+    char message[1024];
+    va_list ap;
+    int length;
+
+    claim_check_failures();
+    site = find_check_site(file, line);
+    if (site != NULL && ++site->count > CHECK_REPORT_LIMIT)
+        return;
+
+    va_start(ap, fmt);
+    length = vsnprintf(message, sizeof(message), fmt, ap);
+    va_end(ap);
+    if (length < 0)
+        return;
+
+    if (site == NULL || site->count == 1 ||
+        (size_t)length >= sizeof(message)) {
+        /* Write first reports, and those too long to be buffered, in full
+         * right away. */
+        write_check_failures(Check_Buffer, Check_Buffer_Length);
+        Check_Buffer_Length = 0;
+        if ((size_t)length >= sizeof(message)) {
+            va_start(ap, fmt);
+            vfprintf(stderr, fmt, ap);
+            va_end(ap);
+        } else
+            write_check_failures(message, length);
+        return;
+    }
+
+    if (Check_Buffer_Length + length > sizeof(Check_Buffer)) {
+        write_check_failures(Check_Buffer, Check_Buffer_Length);
+        Check_Buffer_Length = 0;
+    }
+    memcpy(Check_Buffer + Check_Buffer_Length, message, length);
+    Check_Buffer_Length += length;
+
+    if (site->count == CHECK_REPORT_LIMIT)
+        report_check_failure(NULL, 0, "*** Further failures at %s:%zu will "
+            "not be reported\n", file, line);
+}
+
+/** Writes out pending check failure reports.
+ *
+ * This also summarizes, once, the failures that were not reported. */
+static void
+flush_check_failures(void)
+{
+    size_t i;
+
+    claim_check_failures();
+    write_check_failures(Check_Buffer, Check_Buffer_Length);
+    Check_Buffer_Length = 0;
+
+    for (i = 0; i < CHECK_SITES; i++) {
+        struct check_site *site = &Check_Sites[i];
+
+        if (site->count > CHECK_REPORT_LIMIT) {
+            fprintf(stderr, "*** %zu more failures at %s:%zu were not "
+                "reported\n", site->count - CHECK_REPORT_LIMIT, site->file,
+                site->line);
+            site->count = CHECK_REPORT_LIMIT;
+        }
+    }
+}
+
+static void
+fail_check(struct context *ctx, const char *file, const size_t line,
+           atf_dynstr_t *reason)
 {
     if (ctx->expect == EXPECT_FAIL) {
-        fprintf(stderr, "*** Expected check failure: %s: %s\n",
-            atf_dynstr_cstring(&ctx->expect_reason),
+        report_check_failure(file, line, "*** Expected check failure: %s: "
+            "%s\n", atf_dynstr_cstring(&ctx->expect_reason),
             atf_dynstr_cstring(reason));
         ctx->expect_fail_count++;
     } else if (ctx->expect == EXPECT_PASS) {
-        fprintf(stderr, "*** Check failed: %s\n", atf_dynstr_cstring(reason));
+        report_check_failure(file, line, "*** Check failed: %s\n",
+            atf_dynstr_cstring(reason));
         ctx->fail_count++;
     } else {
         error_in_expect(ctx, "Test case raised a failure but was not "
@@ -369,8 +837,7 @@ pass(struct context *ctx)
             "a pass instead");
     } else if (ctx->expect == EXPECT_PASS) {
         create_resfile(ctx, "passed", -1, NULL);
-        context_close_resfile(ctx);
-        exit(EXIT_SUCCESS);
+        terminate(ctx, EXIT_SUCCESS);
     } else {
         error_in_expect(ctx, "Test case asked to explicitly pass but was "
             "not expecting such condition");
@@ -383,8 +850,7 @@ skip(struct context *ctx, atf_dynstr_t *reason)
 {
     if (ctx->expect == EXPECT_PASS) {
         create_resfile(ctx, "skipped", -1, reason);
-        context_close_resfile(ctx);
-        exit(EXIT_SUCCESS);
+        terminate(ctx, EXIT_SUCCESS);
     } else {
         error_in_expect(ctx, "Can only skip a test case when running in "
             "expect pass mode");
@@ -397,7 +863,8 @@ skip(struct context *ctx, atf_dynstr_t *reason)
  * The formatted reason is stored in out_reason.  out_reason is initialized
  * in this function and is supposed to be released by the caller.  In general,
  * the reason will eventually be fed to create_resfile, which will release
- * it.
+ * it.  The reason is allocated from the test case's arena, so releasing it
+ * right after formatting it (as fail_check does) recycles the memory.
  *
  * Errors in this function are fatal.  Rationale being: reasons are used to
  * create results files; if we can't format the reason correctly, the result
@@ -405,18 +872,23 @@ skip(struct context *ctx, atf_dynstr_t *reason)
  * fatal error.
  */
 static void
-format_reason_ap(atf_dynstr_t *out_reason,
+format_reason_ap(struct context *ctx, atf_dynstr_t *out_reason,
                  const char *source_file, const size_t source_line,
                  const char *reason, va_list ap)
 {
     atf_error_t err;
 
-    if (source_file != NULL) {
-        err = atf_dynstr_init_fmt(out_reason, "%s:%zd: ", source_file,
-                                  source_line);
-    } else {
-        PRE(source_line == 0);
-        err = atf_dynstr_init(out_reason);
+    /* The test case did not ask for this memory, so it must not show up in
+     * its allocation budgets or leak reports. */
+    atf_alloc_suspend();
+
+    err = atf_dynstr_init_arena(out_reason, ctx->arena);
+    if (!atf_is_error(err)) {
+        if (source_file != NULL) {
+            err = atf_dynstr_append_fmt(out_reason, "%s:%zd: ", source_file,
+                                        source_line);
+        } else
+            PRE(source_line == 0);
     }
 
     if (!atf_is_error(err)) {
@@ -426,43 +898,306 @@ format_reason_ap(atf_dynstr_t *out_reason,
         va_end(ap2);
     }
 
+    atf_alloc_resume();
+
     check_fatal_error(err);
 }
 
 static void
-format_reason_fmt(atf_dynstr_t *out_reason,
+format_reason_fmt(struct context *ctx, atf_dynstr_t *out_reason,
                   const char *source_file, const size_t source_line,
                   const char *reason, ...)
 {
     va_list ap;
 
     va_start(ap, reason);
-    format_reason_ap(out_reason, source_file, source_line, reason, ap);
+    format_reason_ap(ctx, out_reason, source_file, source_line, reason, ap);
     va_end(ap);
 }
 
-static void
+/** Validates the result of an expression that sets errno on failure.
+ *
+ * Returns true and initializes reason if the validation fails. */
+static bool
 errno_test(struct context *ctx, const char *file, const size_t line,
            const int exp_errno, const char *expr_str,
-           const bool expr_result,
-           void (*fail_func)(struct context *, atf_dynstr_t *))
+           const bool expr_result, atf_dynstr_t *reason)
 {
     const int actual_errno = errno;
 
     if (expr_result) {
         if (exp_errno != actual_errno) {
-            atf_dynstr_t reason;
-
-            format_reason_fmt(&reason, file, line, "Expected errno %d, got %d, "
-                "in %s", exp_errno, actual_errno, expr_str);
-            fail_func(ctx, &reason);
+            format_reason_fmt(ctx, reason, file, line, "Expected errno %d, "
+                "got %d, in %s", exp_errno, actual_errno, expr_str);
+            return true;
         }
     } else {
+        format_reason_fmt(ctx, reason, file, line, "Expected true value in %s",
+            expr_str);
+        return true;
+    }
+    return false;
+}
+
+/** Checks whether the test case enables an optional behavior.
+ *
+ * These behaviors are controlled by X-atf.* meta-data properties, such as
+ * X-atf.leak_check, which take a boolean value and default to false. */
+static bool
+md_var_enabled(struct context *ctx, const atf_tc_t *tc, const char *name)
+{
+    const char *strval;
+    atf_error_t err;
+    bool val;
+
+    if (!atf_tc_has_md_var(tc, name))
+        return false;
+
+    strval = atf_tc_get_md_var(tc, name);
+    err = atf_text_to_bool(strval, &val);
+    if (atf_is_error(err)) {
         atf_dynstr_t reason;
 
-        format_reason_fmt(&reason, file, line, "Expected true value in %s",
-            expr_str);
-        fail_func(ctx, &reason);
+        atf_error_free(err);
+        format_reason_fmt(ctx, &reason, NULL, 0, "%s does not have a valid "
+            "boolean value; found %s", name, strval);
+        fail_requirement(ctx, &reason);
+    }
+    return val;
+}
+
+/** Reports the blocks allocated by the body that were never released.
+ *
+ * \param before Allocation counters taken right before running the body. */
+static void
+check_leaks(struct context *ctx, const atf_utils_alloc_stats_t *before)
+{
+    atf_utils_alloc_stats_t after;
+    long long blocks, bytes;
+
+    (void)atf_utils_get_alloc_stats(&after);
+    blocks = (long long)((after.m_allocs - after.m_frees) -
+                         (before->m_allocs - before->m_frees));
+    bytes = (long long)(after.m_live_bytes - before->m_live_bytes);
+
+    if (blocks > 0) {
+        atf_dynstr_t reason;
+
+        format_reason_fmt(ctx, &reason, NULL, 0, "Test case body leaked "
+            "%lld allocations (%lld bytes)", blocks, bytes);
+        fail_check(ctx, NULL, 0, &reason);
+    }
+}
+
+/** Checks whether the libatf-c-vclock shim is loaded in the process. */
+static bool
+virtual_clock_active(void)
+{
+    bool active = false;
+
+#if defined(HAVE_DLFCN_H)
+    void *self = dlopen(NULL, RTLD_LAZY);
+    if (self != NULL) {
+        active = dlsym(self, ATF_VCLOCK_SKEW_SYMBOL) != NULL;
+        dlclose(self);
+    }
+#endif
+    return active;
+}
+
+/** Ensures that the test case runs with virtual clocks.
+ *
+ * The shim can only be loaded at startup, so, unless it is already present,
+ * this re-executes the test program with the shim preloaded.  The test case
+ * is skipped if that is not possible. */
+/** Replaces the process with a new instance of the test program.
+ *
+ * argv[0] is not necessarily a path to the program, e.g. if it was started
+ * through the PATH, so the program is located through the system instead
+ * whenever possible.  Only returns on failure, with errno set. */
+static void
+reexec_self(char *const *argv)
+{
+    if (access("/proc/self/exe", X_OK) != -1)
+        execv("/proc/self/exe", argv);
+#if defined(HAVE_GETEXECNAME)
+    if (getexecname() != NULL)
+        execv(getexecname(), argv);
+#endif
+    execvp(argv[0], argv);
+}
+
+static void
+enable_virtual_clock(struct context *ctx)
+{
+    const char *library;
+    atf_dynstr_t preload, reason;
+
+    if (virtual_clock_active()) {
+        if (atf_env_has("__ATF_VCLOCK_REEXEC"))
+            check_fatal_error(atf_env_unset("__ATF_VCLOCK_REEXEC"));
+        return;
+    }
+
+    library = atf_env_get_with_default("ATF_VCLOCK_LIBRARY",
+                                       ATF_VCLOCK_LIBRARY);
+    if (ctx->in_process || Program_Args == NULL ||
+        atf_env_has("__ATF_VCLOCK_REEXEC") || access(library, R_OK) == -1) {
+        format_reason_fmt(ctx, &reason, NULL, 0, "Virtual clock requested "
+            "but %s cannot be preloaded", library);
+        skip(ctx, &reason);
+    }
+
+    if (atf_env_has("LD_PRELOAD"))
+        check_fatal_error(atf_dynstr_init_fmt(&preload, "%s:%s", library,
+                                              atf_env_get("LD_PRELOAD")));
+    else
+        check_fatal_error(atf_dynstr_init_fmt(&preload, "%s", library));
+    check_fatal_error(atf_env_set("LD_PRELOAD", atf_dynstr_cstring(&preload)));
+    atf_dynstr_fini(&preload);
+    check_fatal_error(atf_env_set("__ATF_VCLOCK_REEXEC", "yes"));
+
+    fflush(stdout);
+    fflush(stderr);
+    if (ctx->resfilefd > STDERR_FILENO)
+        (void)fcntl(ctx->resfilefd, F_SETFD, FD_CLOEXEC);
+    reexec_self(Program_Args);
+
+    format_reason_fmt(ctx, &reason, NULL, 0, "Cannot re-execute %s to "
+        "enable the virtual clock: %s", Program_Args[0], strerror(errno));
+    fail_requirement(ctx, &reason);
+}
+
+/** Runs the test case in the isolation requested by X-atf.isolation.
+ *
+ * Namespace isolation falls back to running the test case as is, with a
+ * notice, when namespaces are not available or the test case runs
+ * in-process. */
+static void
+isolate(struct context *ctx, const atf_tc_t *tc, const char *resfile)
+{
+    const char *mode = atf_tc_get_md_var(tc, "X-atf.isolation");
+    const char *keep[3];
+    char resdir[PATH_MAX];
+    atf_dynstr_t reason;
+    atf_error_t err;
+    bool entered;
+
+    if (strcmp(mode, "none") == 0)
+        return;
+    else if (strcmp(mode, "namespace") != 0) {
+        format_reason_fmt(ctx, &reason, NULL, 0, "X-atf.isolation must be "
+            "none or namespace; found %s", mode);
+        fail_requirement(ctx, &reason);
+    }
+
+    if (ctx->in_process) {
+        fprintf(stderr, "*** Namespace isolation skipped: the test case runs "
+                "in-process\n");
+        return;
+    }
+
+    /* The results file must remain reachable after the switch, and so must
+     * the data files of the test program. */
+    snprintf(resdir, sizeof(resdir), "%s", resfile);
+    if (strrchr(resdir, '/') != NULL)
+        *strrchr(resdir, '/') = '\0';
+    keep[0] = resdir;
+    keep[1] = atf_tc_get_config_var_wd(tc, "srcdir", "");
+    keep[2] = NULL;
+    err = atf_ns_enter(keep, &entered);
+    if (atf_is_error(err)) {
+        char buf[1024];
+
+        atf_error_format(err, buf, sizeof(buf));
+        atf_error_free(err);
+        if (!entered) {
+            fprintf(stderr, "*** Namespace isolation skipped: %s\n", buf);
+            return;
+        }
+        format_reason_fmt(ctx, &reason, NULL, 0, "Cannot isolate the test "
+            "case: %s", buf);
+        fail_requirement(ctx, &reason);
+    }
+}
+
+/** Checks whether an optional behavior of the body is enabled, either by
+ * the given configuration variable, so that it can be requested for a whole
+ * run, or by the given X-atf.* property. */
+static bool
+feature_enabled(struct context *ctx, const atf_tc_t *tc,
+                const char *config_var, const char *md_var)
+{
+    if (atf_tc_has_config_var(tc, config_var)) {
+        const char *strval = atf_tc_get_config_var(tc, config_var);
+        atf_error_t err;
+        bool val;
+
+        err = atf_text_to_bool(strval, &val);
+        if (atf_is_error(err)) {
+            atf_dynstr_t reason;
+
+            atf_error_free(err);
+            format_reason_fmt(ctx, &reason, NULL, 0, "%s does not have a "
+                "valid boolean value; found %s", config_var, strval);
+            fail_requirement(ctx, &reason);
+        }
+        if (val)
+            return true;
+    }
+    return md_var_enabled(ctx, tc, md_var);
+}
+
+/** Starts sampling the stack of the body.
+ *
+ * The folded stacks go next to the results file, or to the work directory
+ * if the results go to the standard output or error.  Profiling is skipped
+ * with a notice if it is not supported. */
+static void
+start_profile(const atf_tc_t *tc, const char *resfile)
+{
+    static bool registered = false;
+    atf_dynstr_t path;
+    atf_error_t err;
+
+    if (strcmp(resfile, "/dev/stdout") == 0 ||
+        strcmp(resfile, "/dev/stderr") == 0)
+        check_fatal_error(atf_dynstr_init_fmt(&path, "%s.folded",
+                                              atf_tc_get_ident(tc)));
+    else
+        check_fatal_error(atf_dynstr_init_fmt(&path, "%s.folded", resfile));
+
+    err = atf_prof_start(atf_dynstr_cstring(&path));
+    atf_dynstr_fini(&path);
+    if (atf_is_error(err)) {
+        char buf[1024];
+
+        atf_error_format(err, buf, sizeof(buf));
+        atf_error_free(err);
+        fprintf(stderr, "*** Profiling skipped: %s\n", buf);
+        return;
+    }
+
+    if (!registered) {
+        /* Catch test cases that exit(3) on their own. */
+        atexit(finish_profile);
+        registered = true;
+    }
+}
+
+/** Stops the profile of the body, if any, and writes it out. */
+static void
+finish_profile(void)
+{
+    atf_error_t err;
+
+    err = atf_prof_finish();
+    if (atf_is_error(err)) {
+        char buf[1024];
+
+        atf_error_format(err, buf, sizeof(buf));
+        atf_error_free(err);
+        fprintf(stderr, "*** Cannot write the profile: %s\n", buf);
     }
 }
 
@@ -519,8 +1254,8 @@ check_prog(struct context *ctx, const char *prog)
 
             atf_error_free(err);
             atf_fs_path_fini(&p);
-            format_reason_fmt(&reason, NULL, 0, "The required program %s could "
-                "not be found", prog);
+            format_reason_fmt(ctx, &reason, NULL, 0, "The required program %s "
+                "could not be found", prog);
             skip(ctx, &reason);
         }
     } else {
@@ -552,8 +1287,8 @@ check_prog(struct context *ctx, const char *prog)
 
             atf_fs_path_fini(&bp);
             atf_fs_path_fini(&p);
-            format_reason_fmt(&reason, NULL, 0, "The required program %s could "
-                "not be found in the PATH", prog);
+            format_reason_fmt(ctx, &reason, NULL, 0, "The required program %s "
+                "could not be found in the PATH", prog);
             fail_requirement(ctx, &reason);
         }
 
@@ -572,6 +1307,10 @@ out:
  * --------------------------------------------------------------------- */
 
 struct atf_tc_impl {
+    /* Owns all the runtime state of the test case, including this
+     * structure, so that it can be released in one go. */
+    atf_arena_t m_arena;
+
     const char *m_ident;
 
     atf_map_t m_vars;
@@ -592,23 +1331,28 @@ atf_tc_init(atf_tc_t *tc, const char *ident, atf_tc_head_t head,
             const char *const *config)
 {
     atf_error_t err;
+    atf_arena_t arena;
 
-    tc->pimpl = malloc(sizeof(struct atf_tc_impl));
+    atf_arena_init(&arena);
+    tc->pimpl = atf_arena_alloc(&arena, sizeof(struct atf_tc_impl));
     if (tc->pimpl == NULL) {
+        atf_arena_fini(&arena);
         err = atf_no_memory_error();
         goto err;
     }
+    tc->pimpl->m_arena = arena;
 
     tc->pimpl->m_ident = ident;
     tc->pimpl->m_head = head;
     tc->pimpl->m_body = body;
     tc->pimpl->m_cleanup = cleanup;
 
-    err = atf_map_init_charpp(&tc->pimpl->m_config, config);
+    err = atf_map_init_charpp_arena(&tc->pimpl->m_config, config,
+                                    &tc->pimpl->m_arena);
     if (atf_is_error(err))
-        goto err;
+        goto err_arena;
 
-    err = atf_map_init(&tc->pimpl->m_vars);
+    err = atf_map_init_arena(&tc->pimpl->m_vars, &tc->pimpl->m_arena);
     if (atf_is_error(err))
         goto err_vars;
 
@@ -639,6 +1383,9 @@ err_map:
     atf_map_fini(&tc->pimpl->m_vars);
 err_vars:
     atf_map_fini(&tc->pimpl->m_config);
+err_arena:
+    arena = tc->pimpl->m_arena;
+    atf_arena_fini(&arena);
 err:
     return err;
 }
@@ -654,8 +1401,13 @@ atf_tc_init_pack(atf_tc_t *tc, const atf_tc_pack_t *pack,
 void
 atf_tc_fini(atf_tc_t *tc)
 {
-    atf_map_fini(&tc->pimpl->m_vars);
-    free(tc->pimpl);
+    atf_arena_t arena;
+
+    /* Neither map holds managed values, so there is nothing to release
+     * other than the arena; copy it out first because it lives inside
+     * the memory it is about to free. */
+    arena = tc->pimpl->m_arena;
+    atf_arena_fini(&arena);
 }
 
 /*
@@ -808,17 +1560,24 @@ atf_error_t
 atf_tc_set_md_var(atf_tc_t *tc, const char *name, const char *fmt, ...)
 {
     atf_error_t err;
-    char *value;
+    atf_dynstr_t value;
     va_list ap;
 
-    va_start(ap, fmt);
-    err = atf_text_format_ap(&value, fmt, ap);
-    va_end(ap);
+    /* The value is left behind in the arena, so the map does not need to
+     * manage it. */
+    err = atf_dynstr_init_arena(&value, &tc->pimpl->m_arena);
+    if (!atf_is_error(err)) {
+        va_start(ap, fmt);
+        err = atf_dynstr_append_ap(&value, fmt, ap);
+        va_end(ap);
 
-    if (!atf_is_error(err))
-        err = atf_map_insert(&tc->pimpl->m_vars, name, value, true);
-    else
-        free(value);
+        if (!atf_is_error(err))
+            err = atf_map_insert(&tc->pimpl->m_vars, name,
+                                 (void *)(uintptr_t)atf_dynstr_cstring(&value),
+                                 false);
+        else
+            atf_dynstr_fini(&value);
+    }
 
     return err;
 }
@@ -858,7 +1617,7 @@ _atf_tc_fail(struct context *ctx, const char *fmt, va_list ap)
     atf_dynstr_t reason;
 
     va_copy(ap2, ap);
-    format_reason_ap(&reason, NULL, 0, fmt, ap2);
+    format_reason_ap(ctx, &reason, NULL, 0, fmt, ap2);
     va_end(ap2);
 
     fail_requirement(ctx, &reason);
@@ -872,10 +1631,10 @@ _atf_tc_fail_nonfatal(struct context *ctx, const char *fmt, va_list ap)
     atf_dynstr_t reason;
 
     va_copy(ap2, ap);
-    format_reason_ap(&reason, NULL, 0, fmt, ap2);
+    format_reason_ap(ctx, &reason, NULL, 0, fmt, ap2);
     va_end(ap2);
 
-    fail_check(ctx, &reason);
+    fail_check(ctx, NULL, 0, &reason);
 }
 
 static void
@@ -886,10 +1645,10 @@ _atf_tc_fail_check(struct context *ctx, const char *file, const size_t line,
     atf_dynstr_t reason;
 
     va_copy(ap2, ap);
-    format_reason_ap(&reason, file, line, fmt, ap2);
+    format_reason_ap(ctx, &reason, file, line, fmt, ap2);
     va_end(ap2);
 
-    fail_check(ctx, &reason);
+    fail_check(ctx, file, line, &reason);
 }
 
 static void
@@ -900,7 +1659,7 @@ _atf_tc_fail_requirement(struct context *ctx, const char *file,
     atf_dynstr_t reason;
 
     va_copy(ap2, ap);
-    format_reason_ap(&reason, file, line, fmt, ap2);
+    format_reason_ap(ctx, &reason, file, line, fmt, ap2);
     va_end(ap2);
 
     fail_requirement(ctx, &reason);
@@ -914,6 +1673,64 @@ _atf_tc_pass(struct context *ctx)
     UNREACHABLE;
 }
 
+/** Tells whether a metric name or unit can be written out unambiguously.
+ *
+ * Names are restricted to letters, digits, dots, dashes and underscores so
+ * that all the language bindings accept the same ones; units only need to
+ * be a single word without colons, which separate the name from the value
+ * in the metrics file. */
+static bool
+valid_metric_word(const char *word, const bool is_name)
+{
+    const char *p;
+
+    for (p = word; *p != '\0'; p++) {
+        const unsigned char c = *p;
+
+        if (is_name ? !(isalnum(c) || c == '.' || c == '-' || c == '_') :
+            (isspace(c) || !isprint(c) || c == ':'))
+            return false;
+    }
+    return true;
+}
+
+static void
+_atf_tc_record_metric(struct context *ctx, const char *name,
+                      const double value, const char *unit)
+{
+    struct metric *m;
+
+    if (unit == NULL)
+        unit = "";
+    if (name[0] == '\0' || !valid_metric_word(name, true) ||
+        !valid_metric_word(unit, false)) {
+        atf_dynstr_t reason;
+
+        format_reason_fmt(ctx, &reason, NULL, 0, "Invalid metric '%s' with "
+            "unit '%s'", name, unit);
+        fail_requirement(ctx, &reason);
+    }
+
+    for (m = ctx->metrics; m != NULL; m = m->next)
+        if (strcmp(m->name, name) == 0)
+            break;
+    if (m == NULL) {
+        m = atf_arena_alloc(ctx->arena, sizeof(*m));
+        if (m == NULL || (m->name = atf_arena_strdup(ctx->arena,
+                                                    name)) == NULL)
+            check_fatal_error(atf_no_memory_error());
+        m->unit = "";
+        m->next = NULL;
+        *ctx->metrics_tail = m;
+        ctx->metrics_tail = &m->next;
+    }
+
+    if (strcmp(m->unit, unit) != 0 &&
+        (m->unit = atf_arena_strdup(ctx->arena, unit)) == NULL)
+        check_fatal_error(atf_no_memory_error());
+    m->value = value;
+}
+
 static void
 _atf_tc_require_prog(struct context *ctx, const char *prog)
 {
@@ -927,7 +1744,7 @@ _atf_tc_skip(struct context *ctx, const char *fmt, va_list ap)
     va_list ap2;
 
     va_copy(ap2, ap);
-    format_reason_ap(&reason, NULL, 0, fmt, ap2);
+    format_reason_ap(ctx, &reason, NULL, 0, fmt, ap2);
     va_end(ap2);
 
     skip(ctx, &reason);
@@ -938,7 +1755,11 @@ _atf_tc_check_errno(struct context *ctx, const char *file, const size_t line,
                     const int exp_errno, const char *expr_str,
                     const bool expr_result)
 {
-    errno_test(ctx, file, line, exp_errno, expr_str, expr_result, fail_check);
+    atf_dynstr_t reason;
+
+    if (errno_test(ctx, file, line, exp_errno, expr_str, expr_result,
+                   &reason))
+        fail_check(ctx, file, line, &reason);
 }
 
 static void
@@ -946,8 +1767,11 @@ _atf_tc_require_errno(struct context *ctx, const char *file, const size_t line,
                       const int exp_errno, const char *expr_str,
                       const bool expr_result)
 {
-    errno_test(ctx, file, line, exp_errno, expr_str, expr_result,
-        fail_requirement);
+    atf_dynstr_t reason;
+
+    if (errno_test(ctx, file, line, exp_errno, expr_str, expr_result,
+                   &reason))
+        fail_requirement(ctx, &reason);
 }
 
 static void
@@ -968,7 +1792,7 @@ _atf_tc_expect_fail(struct context *ctx, const char *reason, va_list ap)
     ctx->expect = EXPECT_FAIL;
     atf_dynstr_fini(&ctx->expect_reason);
     va_copy(ap2, ap);
-    check_fatal_error(atf_dynstr_init_ap(&ctx->expect_reason, reason, ap2));
+    format_reason_ap(ctx, &ctx->expect_reason, NULL, 0, reason, ap2);
     va_end(ap2);
     ctx->expect_previous_fail_count = ctx->expect_fail_count;
 }
@@ -980,11 +1804,12 @@ _atf_tc_expect_exit(struct context *ctx, const int exitcode, const char *reason,
     va_list ap2;
     atf_dynstr_t formatted;
 
+    require_own_process(ctx, "atf_tc_expect_exit");
     validate_expect(ctx);
 
     ctx->expect = EXPECT_EXIT;
     va_copy(ap2, ap);
-    check_fatal_error(atf_dynstr_init_ap(&formatted, reason, ap2));
+    format_reason_ap(ctx, &formatted, NULL, 0, reason, ap2);
     va_end(ap2);
 
     create_resfile(ctx, "expected_exit", exitcode, &formatted);
@@ -997,11 +1822,12 @@ _atf_tc_expect_signal(struct context *ctx, const int signo, const char *reason,
     va_list ap2;
     atf_dynstr_t formatted;
 
+    require_own_process(ctx, "atf_tc_expect_signal");
     validate_expect(ctx);
 
     ctx->expect = EXPECT_SIGNAL;
     va_copy(ap2, ap);
-    check_fatal_error(atf_dynstr_init_ap(&formatted, reason, ap2));
+    format_reason_ap(ctx, &formatted, NULL, 0, reason, ap2);
     va_end(ap2);
 
     create_resfile(ctx, "expected_signal", signo, &formatted);
@@ -1013,11 +1839,12 @@ _atf_tc_expect_death(struct context *ctx, const char *reason, va_list ap)
     va_list ap2;
     atf_dynstr_t formatted;
 
+    require_own_process(ctx, "atf_tc_expect_death");
     validate_expect(ctx);
 
     ctx->expect = EXPECT_DEATH;
     va_copy(ap2, ap);
-    check_fatal_error(atf_dynstr_init_ap(&formatted, reason, ap2));
+    format_reason_ap(ctx, &formatted, NULL, 0, reason, ap2);
     va_end(ap2);
 
     create_resfile(ctx, "expected_death", -1, &formatted);
@@ -1029,11 +1856,12 @@ _atf_tc_expect_timeout(struct context *ctx, const char *reason, va_list ap)
     va_list ap2;
     atf_dynstr_t formatted;
 
+    require_own_process(ctx, "atf_tc_expect_timeout");
     validate_expect(ctx);
 
     ctx->expect = EXPECT_TIMEOUT;
     va_copy(ap2, ap);
-    check_fatal_error(atf_dynstr_init_ap(&formatted, reason, ap2));
+    format_reason_ap(ctx, &formatted, NULL, 0, reason, ap2);
     va_end(ap2);
 
     create_resfile(ctx, "expected_timeout", -1, &formatted);
@@ -1052,31 +1880,346 @@ _atf_tc_set_resultsfile(struct context *ctx, const char *file)
 
 static struct context Current;
 
-atf_error_t
-atf_tc_run(const atf_tc_t *tc, const char *resfile)
+/** Returns the number of seconds that the body may run for before the
+ * watchdog kills it, or 0 if it must not be watched.
+ *
+ * The runtime engine enforces timeouts itself, so the watchdog only acts
+ * when the test case runs without one, and only if the test case sets its
+ * timeout explicitly: the body of a watched test case runs in a process
+ * group of its own, which takes it out of the job control of the terminal. */
+static long
+watchdog_timeout(const atf_tc_t *tc)
+{
+    atf_error_t err;
+    long seconds;
+
+    if (!atf_tc_has_md_var(tc, "timeout"))
+        return 0;
+
+    if (atf_env_has("__RUNNING_INSIDE_ATF_RUN") &&
+        strcmp(atf_env_get("__RUNNING_INSIDE_ATF_RUN"),
+               "internal-yes-value") == 0)
+        return 0;
+
+    err = atf_text_to_long(atf_tc_get_md_var(tc, "timeout"), &seconds);
+    if (atf_is_error(err)) {
+        /* Let the body run; the value is not ours to validate. */
+        atf_error_free(err);
+        return 0;
+    }
+    return seconds > 0 ? seconds : 0;
+}
+
+/** Returns whether the calling process is the body of a watched test case.
+ *
+ * This is the case of a test program that re-executes itself, for example
+ * to enable the virtual clock, after the watchdog has been started. */
+static bool
+watchdog_running(void)
 {
-    context_init(&Current, tc, resfile);
+    return atf_env_has("__ATF_WATCHDOG") &&
+        atol(atf_env_get("__ATF_WATCHDOG")) == (long)getpid();
+}
+
+/** Prints the stack of the body and records that it timed out.
+ *
+ * The watchdog sends SIGQUIT to the body when its timeout expires.  Unless
+ * the body expects the timeout, in which case its results file already
+ * says so, this replaces the results file with a failure. */
+static void
+watchdog_dump(const int signo)
+{
+    static const char header[] = "*** Test case timed out; stack of the "
+        "body:\n";
+    ssize_t ignored;
+    int fd;
+
+    if (getpid() != Watchdog_Body) {
+        /* A process forked by the body inherited the handler: let the
+         * signal have its default effect once the handler returns. */
+        struct sigaction sa;
+
+        memset(&sa, 0, sizeof(sa));
+        sa.sa_handler = SIG_DFL;
+        sigemptyset(&sa.sa_mask);
+        (void)sigaction(signo, &sa, NULL);
+        (void)raise(signo);
+        return;
+    }
+
+    ignored = write(STDERR_FILENO, header, sizeof(header) - 1);
+#if defined(HAVE_BACKTRACE)
+    {
+        void *frames[64];
 
+        backtrace_symbols_fd(frames, backtrace(frames, 64), STDERR_FILENO);
+    }
+#endif
+
+    if (Current.expect != EXPECT_TIMEOUT) {
+        if (strcmp(Watchdog_Resfile, "/dev/stdout") == 0)
+            fd = STDOUT_FILENO;
+        else if (strcmp(Watchdog_Resfile, "/dev/stderr") == 0)
+            fd = STDERR_FILENO;
+        else
+            fd = open(Watchdog_Resfile, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd != -1)
+            ignored = write(fd, Watchdog_Result, strlen(Watchdog_Result));
+    }
+    (void)ignored;
+    _exit(EXIT_FAILURE);
+}
+
+/** Asks the body to dump its stack when the timeout expires, and kills its
+ * whole process group if it has not exited after a grace period. */
+static void
+watchdog_expire(const int signo)
+{
+    (void)signo;
+    if (Watchdog_Expirations++ == 0) {
+        (void)kill(Watchdog_Child, SIGQUIT);
+        (void)alarm(WATCHDOG_GRACE);
+    } else
+        (void)kill(-Watchdog_Child, SIGKILL);
+}
+
+/** Passes termination signals received by the watchdog on to the body,
+ * which runs in a process group of its own. */
+static void
+watchdog_forward(const int signo)
+{
+    (void)kill(-Watchdog_Child, signo);
+}
+
+/** Writes the result of a body that ignored the request to dump its stack,
+ * unless the results file says that the timeout was expected. */
+static void
+watchdog_write_result(const char *resfile)
+{
+    char buf[32];
+    FILE *f;
+
+    if (strcmp(resfile, "/dev/stdout") == 0 ||
+        strcmp(resfile, "/dev/stderr") == 0) {
+        f = fopen(resfile, "w");
+    } else {
+        f = fopen(resfile, "r");
+        if (f != NULL) {
+            const bool expected = fgets(buf, sizeof(buf), f) != NULL &&
+                strncmp(buf, "expected_timeout:", 17) == 0;
+
+            fclose(f);
+            if (expected)
+                return;
+        }
+        f = fopen(resfile, "w");
+    }
+
+    if (f != NULL) {
+        fputs(Watchdog_Result, f);
+        fclose(f);
+    }
+}
+
+/** Formats the result that records that the body timed out. */
+static void
+watchdog_format_result(const long seconds)
+{
+    snprintf(Watchdog_Result, sizeof(Watchdog_Result), "failed: Test case "
+             "timed out after %ld second%s\n", seconds,
+             seconds == 1 ? "" : "s");
+}
+
+/** Prepares the body to print its stack and record its result when the
+ * watchdog tells it that its timeout expired. */
+static void
+watchdog_arm_body(const char *resfile, const long seconds)
+{
+    struct sigaction sa;
+
+    watchdog_format_result(seconds);
+    Watchdog_Body = getpid();
+    Watchdog_Resfile = resfile;
+#if defined(HAVE_BACKTRACE)
+    {
+        /* The first call may load the unwinder, which is not safe to do
+         * from the signal handler. */
+        void *frames[1];
+        (void)backtrace(frames, 1);
+    }
+#endif
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = watchdog_dump;
+    sigemptyset(&sa.sa_mask);
+    (void)sigaction(SIGQUIT, &sa, NULL);
+}
+
+/** Runs the body in a child process that is killed if it runs for too long.
+ *
+ * Returns in the child, which goes on to run the body.  The parent waits
+ * for the child and terminates the same way it did, so that the test
+ * program behaves as if there were no watchdog.  If the child cannot be
+ * created, the body runs without a watchdog. */
+static void
+watch_body(const char *resfile, const long seconds)
+{
+    struct sigaction sa;
+    struct rlimit rl;
+    pid_t pid;
+    int status;
+
+    watchdog_format_result(seconds);
+
+    fflush(stdout);
+    fflush(stderr);
+    pid = fork();
+    if (pid == -1) {
+        fprintf(stderr, "*** Cannot start the watchdog of the test case: "
+                "%s\n", strerror(errno));
+        return;
+    } else if (pid == 0) {
+        char value[32];
+
+        (void)setpgid(0, 0);
+        snprintf(value, sizeof(value), "%ld", (long)getpid());
+        check_fatal_error(atf_env_set("__ATF_WATCHDOG", value));
+        watchdog_arm_body(resfile, seconds);
+        return;
+    }
+
+    (void)setpgid(pid, pid);
+    Watchdog_Child = pid;
+
+    memset(&sa, 0, sizeof(sa));
+    sigemptyset(&sa.sa_mask);
+    sa.sa_handler = watchdog_forward;
+    (void)sigaction(SIGHUP, &sa, NULL);
+    (void)sigaction(SIGINT, &sa, NULL);
+    (void)sigaction(SIGTERM, &sa, NULL);
+    sa.sa_handler = watchdog_expire;
+    (void)sigaction(SIGALRM, &sa, NULL);
+    (void)alarm((unsigned int)seconds);
+
+    while (waitpid(pid, &status, 0) == -1)
+        INV(errno == EINTR);
+    (void)alarm(0);
+
+    if (Watchdog_Expirations > 0) {
+        /* Get rid of any process that the body left behind.  The body
+         * records its result when it dumps its stack, so write it here if
+         * the body did not get to: either because it ignored the request
+         * or because it died from it. */
+        (void)kill(-pid, SIGKILL);
+        if (Watchdog_Expirations > 1 || WIFSIGNALED(status))
+            watchdog_write_result(resfile);
+        exit(EXIT_FAILURE);
+    }
+
+    if (WIFEXITED(status))
+        exit(WEXITSTATUS(status));
+
+    /* Die from the same signal as the body, without dumping a core that
+     * would only show the watchdog. */
+    INV(WIFSIGNALED(status));
+    rl.rlim_cur = rl.rlim_max = 0;
+    (void)setrlimit(RLIMIT_CORE, &rl);
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = SIG_DFL;
+    sigemptyset(&sa.sa_mask);
+    (void)sigaction(WTERMSIG(status), &sa, NULL);
+    (void)raise(WTERMSIG(status));
+    abort();
+}
+
+/** Runs the body of a test case and records its result.
+ *
+ * This never returns: the test case either terminates the process or, if
+ * it runs in-process, unwinds to atf_tc_run_in_process. */
+static void
+run_body(const atf_tc_t *tc, const char *resfile, const bool in_process)
+{
+    atf_utils_alloc_stats_t alloc_stats;
+    bool leak_check;
+
+    context_init(&Current, tc, &tc->pimpl->m_arena, resfile, in_process);
+
+    if (md_var_enabled(&Current, tc, "X-atf.virtual_clock"))
+        enable_virtual_clock(&Current);
+
+    if (atf_tc_has_md_var(tc, "X-atf.isolation"))
+        isolate(&Current, tc, resfile);
+
+    if (feature_enabled(&Current, tc, "profile", "X-atf.profile"))
+        start_profile(tc, resfile);
+
+    leak_check = md_var_enabled(&Current, tc, "X-atf.leak_check");
+    if (leak_check) {
+        /* stdio allocates the buffer of stdout on first use and never
+         * releases it; provide one upfront so that printing from the body
+         * is not reported as a leak. */
+        static char stdout_buffer[BUFSIZ];
+        static bool stdout_buffered = false;
+        if (!stdout_buffered) {
+            (void)setvbuf(stdout, stdout_buffer,
+                          isatty(STDOUT_FILENO) ? _IOLBF : _IOFBF,
+                          sizeof(stdout_buffer));
+            stdout_buffered = true;
+        }
+
+        if (!atf_utils_get_alloc_stats(&alloc_stats)) {
+            atf_dynstr_t reason;
+
+            format_reason_fmt(&Current, &reason, NULL, 0, "Leak checking "
+                "requested but allocation tracking is not available; link "
+                "the test program against libatf-c-alloc or preload it");
+            skip(&Current, &reason);
+        }
+    }
+
+    if (feature_enabled(&Current, tc, "timing", "X-atf.timing"))
+        start_timing(&Current);
+
+    atf_alloc_scope_pop_all(false);
     tc->pimpl->m_body(tc);
+    atf_alloc_scope_pop_all(true);
+
+    if (leak_check)
+        check_leaks(&Current, &alloc_stats);
 
     validate_expect(&Current);
 
     if (Current.fail_count > 0) {
         atf_dynstr_t reason;
 
-        format_reason_fmt(&reason, NULL, 0, "%d checks failed; see output for "
-            "more details", Current.fail_count);
+        format_reason_fmt(&Current, &reason, NULL, 0, "%d checks failed; see "
+            "output for more details", Current.fail_count);
         fail_requirement(&Current, &reason);
     } else if (Current.expect_fail_count > 0) {
         atf_dynstr_t reason;
 
-        format_reason_fmt(&reason, NULL, 0, "%d checks failed as expected; "
-            "see output for more details", Current.expect_fail_count);
+        format_reason_fmt(&Current, &reason, NULL, 0, "%d checks failed as "
+            "expected; see output for more details", Current.expect_fail_count);
         expected_failure(&Current, &reason);
     } else {
         pass(&Current);
     }
     UNREACHABLE;
+}
+
+atf_error_t
+atf_tc_run(const atf_tc_t *tc, const char *resfile)
+{
+    const long seconds = watchdog_timeout(tc);
+
+    Startup_Cpu_Usecs = cpu_usecs(NULL);
+    if (seconds > 0) {
+        if (watchdog_running())
+            watchdog_arm_body(resfile, seconds);
+        else
+            watch_body(resfile, seconds);
+    }
+    run_body(tc, resfile, false);
+    UNREACHABLE;
     return atf_no_error();
 }
 
@@ -1160,6 +2303,14 @@ atf_tc_pass(void)
     _atf_tc_pass(&Current);
 }
 
+void
+atf_tc_record_metric(const char *name, const double value, const char *unit)
+{
+    PRE(Current.tc != NULL);
+
+    _atf_tc_record_metric(&Current, name, value, unit);
+}
+
 void
 atf_tc_require_prog(const char *prog)
 {
@@ -1268,6 +2419,14 @@ atf_tc_expect_timeout(const char *reason, ...)
     va_end(ap);
 }
 
+/* Internal! */
+void
+atf_tc_set_program_args(char **argv)
+{
+
+    Program_Args = argv;
+}
+
 /* Internal! */
 void
 atf_tc_set_resultsfile(const char *file)
@@ -1277,3 +2436,41 @@ atf_tc_set_resultsfile(const char *file)
 
     _atf_tc_set_resultsfile(&Current, file);
 }
+
+/* Internal!
+ *
+ * Runs a test case without forking and returns once its result has been
+ * appended to resfile, prefixed by the test case name.  failed is set if
+ * the test case did not pass, was not skipped and did not fail as
+ * expected.  unwind_hook is described next to Unwind_Hook. */
+atf_error_t
+atf_tc_run_in_process(const atf_tc_t *tc, const char *resfile,
+                      void (*unwind_hook)(void), bool *failed)
+{
+    jmp_buf target;
+
+    PRE(Unwind_Target == NULL);
+
+    Unwind_Hook = unwind_hook;
+    Unwind_Owner = getpid();
+    Unwind_Status = EXIT_FAILURE;
+    if (setjmp(target) == 0) {
+        Unwind_Target = &target;
+        run_body(tc, resfile, true);
+    }
+    Unwind_Target = NULL;
+    Unwind_Hook = NULL;
+
+    *failed = Unwind_Status != EXIT_SUCCESS;
+    return atf_no_error();
+}
+
+/* Internal! */
+void
+atf_tc_unwind(void)
+{
+
+    PRE(Unwind_Target != NULL);
+
+    longjmp(*Unwind_Target, 1);
+}
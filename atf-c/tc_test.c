@@ -25,8 +25,20 @@
 
 #include "atf-c/tc.h"
 
+#include <sys/types.h>
+#include <sys/select.h>
+#include <sys/stat.h>
+
+#include <dirent.h>
+#include <net/if.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
 #include <stdbool.h>
+#include <stdio.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
 
 #include <atf-c.h>
 
@@ -75,6 +87,37 @@ ATF_TC_BODY(init, tcin)
     atf_tc_fini(&tc);
 }
 
+ATF_TC(fini__many_vars);
+ATF_TC_HEAD(fini__many_vars, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Tests that atf_tc_fini releases all "
+                      "the memory of a test case with enough variables for "
+                      "its maps to be indexed");
+    atf_tc_set_md_var(tc, "X-atf.leak_check", "true");
+}
+ATF_TC_BODY(fini__many_vars, tcin)
+{
+    char names[64][16];
+    const char *config[64 * 2 + 1];
+    atf_tc_t tc;
+    size_t i;
+
+    for (i = 0; i < 64; i++) {
+        snprintf(names[i], sizeof(names[i]), "var%zu", i);
+        config[i * 2] = names[i];
+        config[i * 2 + 1] = "value";
+    }
+    config[64 * 2] = NULL;
+
+    RE(atf_tc_init(&tc, "test1", ATF_TC_HEAD_NAME(empty),
+                   ATF_TC_BODY_NAME(empty), NULL, config));
+    for (i = 0; i < 64; i++)
+        RE(atf_tc_set_md_var(&tc, names[i], "value"));
+    ATF_REQUIRE(strcmp(atf_tc_get_config_var(&tc, "var63"), "value") == 0);
+    ATF_REQUIRE(strcmp(atf_tc_get_md_var(&tc, "var63"), "value") == 0);
+    atf_tc_fini(&tc);
+}
+
 ATF_TC(init_pack);
 ATF_TC_HEAD(init_pack, tc)
 {
@@ -164,6 +207,250 @@ ATF_TC_BODY(config, tcin)
  * but good tests here could allow us to avoid much of the indirect
  * testing done later on. */
 
+/** Returns the current time as seen by the file system.
+ *
+ * The kernel stamps files with the real time, so this is unaffected by the
+ * virtual clock. */
+static
+time_t
+real_time(void)
+{
+    struct stat sb;
+
+    atf_utils_create_file("stamp", "%s", "");
+    ATF_REQUIRE(stat("stamp", &sb) != -1);
+    return sb.st_mtime;
+}
+
+static
+long long
+monotonic_seconds(void)
+{
+    struct timespec ts;
+
+    ATF_REQUIRE(clock_gettime(CLOCK_MONOTONIC, &ts) != -1);
+    return (long long)ts.tv_sec;
+}
+
+ATF_TC(virtual_clock__sleep);
+ATF_TC_HEAD(virtual_clock__sleep, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Tests that sleeps complete right away "
+                      "with the virtual clock while time still goes by");
+    atf_tc_set_md_var(tc, "X-atf.virtual_clock", "true");
+}
+ATF_TC_BODY(virtual_clock__sleep, tc)
+{
+    const time_t real_start = real_time();
+    const time_t start = time(NULL);
+    const long long mono_start = monotonic_seconds();
+    struct timespec delay;
+
+    ATF_REQUIRE_EQ(0, sleep(3600));
+    delay.tv_sec = 3600;
+    delay.tv_nsec = 0;
+    ATF_REQUIRE(nanosleep(&delay, NULL) != -1);
+
+    ATF_REQUIRE(time(NULL) - start >= 7200);
+    ATF_REQUIRE(monotonic_seconds() - mono_start >= 7200);
+    ATF_REQUIRE(real_time() - real_start < 60);
+}
+
+ATF_TC(virtual_clock__timeouts);
+ATF_TC_HEAD(virtual_clock__timeouts, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Tests that waits without descriptors "
+                      "complete right away with the virtual clock");
+    atf_tc_set_md_var(tc, "X-atf.virtual_clock", "true");
+}
+ATF_TC_BODY(virtual_clock__timeouts, tc)
+{
+    const time_t real_start = real_time();
+    const long long start = monotonic_seconds();
+    struct timeval tv;
+
+    ATF_REQUIRE_EQ(0, poll(NULL, 0, 600 * 1000));
+    tv.tv_sec = 600;
+    tv.tv_usec = 0;
+    ATF_REQUIRE_EQ(0, select(0, NULL, NULL, NULL, &tv));
+    ATF_REQUIRE_EQ(0, usleep(600 * 1000 * 1000));
+
+    ATF_REQUIRE(monotonic_seconds() - start >= 1800);
+    ATF_REQUIRE(real_time() - real_start < 60);
+}
+
+static
+void *
+sleeper(void *arg)
+{
+    const unsigned int *seconds = arg;
+
+    ATF_CHECK_EQ(0, sleep(*seconds));
+    return NULL;
+}
+
+ATF_TC(virtual_clock__threads);
+ATF_TC_HEAD(virtual_clock__threads, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Tests that the virtual clock only moves "
+                      "once all threads are blocked");
+    atf_tc_set_md_var(tc, "X-atf.virtual_clock", "true");
+}
+ATF_TC_BODY(virtual_clock__threads, tc)
+{
+    const time_t real_start = real_time();
+    const long long start = monotonic_seconds();
+    unsigned int seconds[2] = { 1000, 3000 };
+    pthread_t threads[2];
+    size_t i;
+
+    for (i = 0; i < 2; i++)
+        ATF_REQUIRE_EQ(0, pthread_create(&threads[i], NULL, sleeper,
+                                         &seconds[i]));
+    ATF_REQUIRE_EQ(0, sleep(2000));
+    ATF_REQUIRE(monotonic_seconds() - start >= 2000);
+    ATF_REQUIRE(monotonic_seconds() - start < 3000);
+    for (i = 0; i < 2; i++)
+        ATF_REQUIRE_EQ(0, pthread_join(threads[i], NULL));
+
+    ATF_REQUIRE(monotonic_seconds() - start >= 3000);
+    ATF_REQUIRE(real_time() - real_start < 60);
+}
+
+static volatile sig_atomic_t alarm_fired = 0;
+
+static
+void
+alarm_handler(const int signo)
+{
+    (void)signo;
+    alarm_fired = 1;
+}
+
+ATF_TC(virtual_clock__alarm);
+ATF_TC_HEAD(virtual_clock__alarm, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Tests that alarm(3) is delivered at "
+                      "its virtual time and interrupts sleeps");
+    atf_tc_set_md_var(tc, "X-atf.virtual_clock", "true");
+}
+ATF_TC_BODY(virtual_clock__alarm, tc)
+{
+    struct sigaction sa;
+    unsigned int remaining;
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = alarm_handler;
+    sigemptyset(&sa.sa_mask);
+    ATF_REQUIRE(sigaction(SIGALRM, &sa, NULL) != -1);
+
+    ATF_REQUIRE_EQ(0, alarm(300));
+    ATF_REQUIRE_EQ(300, alarm(100));
+    remaining = sleep(1000);
+    ATF_REQUIRE(alarm_fired);
+    ATF_REQUIRE_EQ(900, remaining);
+}
+
+/* Checks if the process is still in the user namespace of its parent.
+ * The kernel hides the namespaces of the parent once the process has left
+ * them, so failing to read them counts as having left. */
+static
+bool
+in_parent_user_namespace(void)
+{
+    char path[64], self[64], parent[64];
+    ssize_t length;
+
+    length = readlink("/proc/self/ns/user", self, sizeof(self) - 1);
+    ATF_REQUIRE(length != -1);
+    self[length] = '\0';
+
+    snprintf(path, sizeof(path), "/proc/%d/ns/user", (int)getppid());
+    length = readlink(path, parent, sizeof(parent) - 1);
+    if (length == -1)
+        return false;
+    parent[length] = '\0';
+
+    return strcmp(self, parent) == 0;
+}
+
+/* Checks if an entry of /tmp leads to one of the directories kept visible
+ * by the isolation, which are the mount points under /tmp.  These include
+ * the work directory and, if they live under /tmp, the source directory and
+ * the directory of the results file. */
+static
+bool
+leads_to_kept_dir(const char *name)
+{
+    const size_t length = strlen(name);
+    char line[4096], mountpoint[4096];
+    bool found;
+    FILE *f;
+
+    f = fopen("/proc/self/mountinfo", "r");
+    ATF_REQUIRE(f != NULL);
+    found = false;
+    while (!found && fgets(line, sizeof(line), f) != NULL) {
+        if (sscanf(line, "%*s %*s %*s %*s %4095s", mountpoint) != 1)
+            continue;
+        found = strncmp(mountpoint, "/tmp/", 5) == 0 &&
+            strncmp(mountpoint + 5, name, length) == 0 &&
+            (mountpoint[5 + length] == '/' || mountpoint[5 + length] == '\0');
+    }
+    fclose(f);
+
+    return found;
+}
+
+ATF_TC(isolation__namespace);
+ATF_TC_HEAD(isolation__namespace, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Tests that X-atf.isolation=namespace "
+                      "runs the body with a private /tmp that only holds "
+                      "the directories kept visible, and a private network");
+    atf_tc_set_md_var(tc, "X-atf.isolation", "namespace");
+}
+ATF_TC_BODY(isolation__namespace, tc)
+{
+    char cwd[1024], path[64];
+    struct if_nameindex *ifs;
+    struct dirent *de;
+    size_t i;
+    DIR *d;
+
+    if (access("/proc/self/ns/user", F_OK) == -1)
+        atf_tc_skip("Namespaces are not supported on this platform");
+    if (in_parent_user_namespace())
+        atf_tc_skip("Namespace isolation was skipped; see the stderr of "
+                    "the test case for the reason");
+
+    /* Only the paths to the kept directories exist in the new /tmp. */
+    ATF_REQUIRE(getcwd(cwd, sizeof(cwd)) != NULL);
+    ATF_REQUIRE(strncmp(cwd, "/tmp/", 5) == 0);
+    d = opendir("/tmp");
+    ATF_REQUIRE(d != NULL);
+    while ((de = readdir(d)) != NULL) {
+        if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0)
+            continue;
+        ATF_CHECK_MSG(leads_to_kept_dir(de->d_name),
+                      "Unexpected entry /tmp/%s", de->d_name);
+    }
+    closedir(d);
+
+    snprintf(path, sizeof(path), "/tmp/atf-isolation.%d", (int)getpid());
+    atf_utils_create_file(path, "private\n");
+    ATF_REQUIRE(atf_utils_compare_file(path, "private\n"));
+    atf_utils_create_file("cookie", "kept\n");
+    ATF_REQUIRE(atf_utils_compare_file("cookie", "kept\n"));
+
+    /* The loopback interface is the only one. */
+    ifs = if_nameindex();
+    ATF_REQUIRE(ifs != NULL);
+    for (i = 0; ifs[i].if_index != 0; i++)
+        ATF_CHECK_STREQ("lo", ifs[i].if_name);
+    if_freenameindex(ifs);
+}
+
 /* ---------------------------------------------------------------------
  * Main.
  * --------------------------------------------------------------------- */
@@ -172,12 +459,17 @@ ATF_TP_ADD_TCS(tp)
 {
     /* Add the test cases for the "atf_tcr_t" type. */
     ATF_TP_ADD_TC(tp, init);
+    ATF_TP_ADD_TC(tp, fini__many_vars);
     ATF_TP_ADD_TC(tp, init_pack);
     ATF_TP_ADD_TC(tp, vars);
     ATF_TP_ADD_TC(tp, config);
 
     /* Add the test cases for the free functions. */
-    /* TODO */
+    ATF_TP_ADD_TC(tp, virtual_clock__sleep);
+    ATF_TP_ADD_TC(tp, virtual_clock__timeouts);
+    ATF_TP_ADD_TC(tp, virtual_clock__threads);
+    ATF_TP_ADD_TC(tp, virtual_clock__alarm);
+    ATF_TP_ADD_TC(tp, isolation__namespace);
 
     return atf_no_error();
 }
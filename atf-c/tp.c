@@ -30,6 +30,7 @@
 #include <string.h>
 #include <unistd.h>
 
+#include "atf-c/detail/arena.h"
 #include "atf-c/detail/fs.h"
 #include "atf-c/detail/map.h"
 #include "atf-c/detail/sanity.h"
@@ -37,6 +38,9 @@
 #include "atf-c/tc.h"
 
 struct atf_tp_impl {
+    /* Holds this structure as well as the list and map below. */
+    atf_arena_t m_arena;
+
     atf_list_t m_tcs;
     atf_map_t m_config;
 };
@@ -76,25 +80,33 @@ atf_error_t
 atf_tp_init(atf_tp_t *tp, const char *const *config)
 {
     atf_error_t err;
+    atf_arena_t arena;
 
     PRE(config != NULL);
 
-    tp->pimpl = malloc(sizeof(struct atf_tp_impl));
-    if (tp->pimpl == NULL)
+    atf_arena_init(&arena);
+    tp->pimpl = atf_arena_alloc(&arena, sizeof(struct atf_tp_impl));
+    if (tp->pimpl == NULL) {
+        atf_arena_fini(&arena);
         return atf_no_memory_error();
+    }
+    tp->pimpl->m_arena = arena;
 
-    err = atf_list_init(&tp->pimpl->m_tcs);
+    err = atf_list_init_arena(&tp->pimpl->m_tcs, &tp->pimpl->m_arena);
     if (atf_is_error(err))
-        goto out;
+        goto err;
 
-    err = atf_map_init_charpp(&tp->pimpl->m_config, config);
-    if (atf_is_error(err)) {
-        atf_list_fini(&tp->pimpl->m_tcs);
-        goto out;
-    }
+    err = atf_map_init_charpp_arena(&tp->pimpl->m_config, config,
+                                    &tp->pimpl->m_arena);
+    if (atf_is_error(err))
+        goto err;
 
     INV(!atf_is_error(err));
-out:
+    return err;
+
+err:
+    arena = tp->pimpl->m_arena;
+    atf_arena_fini(&arena);
     return err;
 }
 
@@ -102,16 +114,15 @@ void
 atf_tp_fini(atf_tp_t *tp)
 {
     atf_list_iter_t iter;
-
-    atf_map_fini(&tp->pimpl->m_config);
+    atf_arena_t arena;
 
     atf_list_for_each(iter, &tp->pimpl->m_tcs) {
         atf_tc_t *tc = atf_list_iter_data(iter);
         atf_tc_fini(tc);
     }
-    atf_list_fini(&tp->pimpl->m_tcs);
 
-    free(tp->pimpl);
+    arena = tp->pimpl->m_arena;
+    atf_arena_fini(&arena);
 }
 
 /*
@@ -23,23 +23,35 @@
  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
  * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.  */
 
+#if defined(HAVE_CONFIG_H)
+#include "config.h"
+#endif
+
 #include "atf-c/utils.h"
 
+#include <sys/resource.h>
 #include <sys/stat.h>
+#include <sys/time.h>
 #include <sys/wait.h>
 
 #include <err.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <regex.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#if defined(HAVE_ZLIB)
+#include <zlib.h>
+#endif
 
 #include <atf-c.h>
 
+#include "atf-c/detail/alloc.h"
 #include "atf-c/detail/dynstr.h"
+#include "atf-c/detail/sanity.h"
 
 /* No prototype in header for this one, it's a little sketchy (internal). */
 void atf_tc_set_resultsfile(const char *);
@@ -96,6 +108,195 @@ grep_string(const char *regex, const char *str)
     return res == 0;
 }
 
+/** Description of the fields of atf_utils_io_stats_t. */
+static const struct io_field {
+    /** Name of the counter in /proc/self/io; NULL if not taken from it. */
+    const char *proc_name;
+    /** Description of the counter for error messages. */
+    const char *descr;
+    /** Offset of the counter within atf_utils_io_stats_t. */
+    size_t offset;
+} io_fields[] = {
+    { "syscr", "read calls", offsetof(atf_utils_io_stats_t, m_reads) },
+    { "rchar", "bytes read", offsetof(atf_utils_io_stats_t, m_read_bytes) },
+    { "syscw", "write calls", offsetof(atf_utils_io_stats_t, m_writes) },
+    { "wchar", "bytes written", offsetof(atf_utils_io_stats_t,
+                                         m_write_bytes) },
+    { "read_bytes", "bytes fetched from storage",
+      offsetof(atf_utils_io_stats_t, m_storage_read_bytes) },
+    { "write_bytes", "bytes sent to storage",
+      offsetof(atf_utils_io_stats_t, m_storage_write_bytes) },
+    { NULL, "block input operations",
+      offsetof(atf_utils_io_stats_t, m_block_ins) },
+    { NULL, "block output operations",
+      offsetof(atf_utils_io_stats_t, m_block_outs) },
+};
+
+#define IO_FIELD(stats, field) \
+    (*(unsigned long long *)((char *)(stats) + (field)->offset))
+
+/** Takes a snapshot of the I/O counters of the current process.
+ *
+ * The block counters come from getrusage(2) and are always available.  The
+ * rest come from /proc/self/io, whose contents are fetched with a single
+ * read(2) call: the kernel updates the syscall-level counters after
+ * generating the file, so the snapshot only shows up in the counters of
+ * later snapshots, as one read call of *overhead bytes.
+ *
+ * \param [out] stats The values of the counters.
+ * \param [out] overhead The bytes read from /proc/self/io, or 0 if the file
+ *     could not be read.
+ *
+ * \return True if the counters from /proc/self/io are available. */
+static bool
+read_io_stats(atf_utils_io_stats_t *stats, size_t *overhead)
+{
+    char buffer[1024];
+    struct rusage ru;
+    char *line, *last;
+    ssize_t length;
+    bool found;
+    int fd;
+
+    memset(stats, 0, sizeof(*stats));
+    *overhead = 0;
+
+    if (getrusage(RUSAGE_SELF, &ru) != -1) {
+        stats->m_block_ins = (unsigned long long)ru.ru_inblock;
+        stats->m_block_outs = (unsigned long long)ru.ru_oublock;
+    }
+
+    fd = open("/proc/self/io", O_RDONLY);
+    if (fd == -1)
+        return false;
+    length = read(fd, buffer, sizeof(buffer) - 1);
+    close(fd);
+    if (length <= 0)
+        return false;
+    buffer[length] = '\0';
+    *overhead = (size_t)length;
+
+    found = false;
+    for (line = strtok_r(buffer, "\n", &last); line != NULL;
+         line = strtok_r(NULL, "\n", &last)) {
+        unsigned long long value;
+        char name[32];
+        size_t i;
+
+        if (sscanf(line, "%31[^:]: %llu", name, &value) != 2)
+            continue;
+
+        for (i = 0; i < sizeof(io_fields) / sizeof(io_fields[0]); i++) {
+            if (io_fields[i].proc_name != NULL &&
+                strcmp(io_fields[i].proc_name, name) == 0) {
+                IO_FIELD(stats, &io_fields[i]) = value;
+                found = true;
+            }
+        }
+    }
+    return found;
+}
+
+/** Starts an allocation-counting scope.
+ *
+ * This is an internal function used by ATF_{CHECK,REQUIRE}_ALLOCS_AT_MOST.
+ * Skips the test case if allocation tracking is not available.
+ *
+ * \param file Source file of the scope, for error reporting.
+ * \param line Source line of the scope, for error reporting.
+ *
+ * \return The state of the scope, to be passed to
+ * atf_utils_alloc_scope_end(). */
+atf_utils_alloc_scope_t
+atf_utils_alloc_scope_begin(const char *file, const size_t line)
+{
+    atf_utils_alloc_scope_t scope;
+
+    if (atf_alloc_get_counters() == NULL)
+        atf_tc_skip("Allocation tracking not available; link the test "
+                    "program against libatf-c-alloc or preload it");
+
+    if (!atf_alloc_scope_push(file, line, &scope.m_depth))
+        atf_tc_fail_requirement(file, line, "Too many nested allocation "
+            "budget blocks");
+
+    scope.m_active = true;
+    (void)atf_utils_get_alloc_stats(&scope.m_start);
+    return scope;
+}
+
+/** Terminates an allocation-counting scope.
+ *
+ * This is an internal function used by ATF_{CHECK,REQUIRE}_ALLOCS_AT_MOST.
+ *
+ * \param scope The state returned by atf_utils_alloc_scope_begin().
+ * \param file Source file of the scope, for error reporting.
+ * \param line Source line of the scope, for error reporting.
+ * \param max Maximum number of allocations permitted within the scope.
+ * \param fatal Whether exceeding the budget fails the test case right away
+ *     or just records a failed check. */
+void
+atf_utils_alloc_scope_end(atf_utils_alloc_scope_t *scope, const char *file,
+                          const size_t line, const unsigned long long max,
+                          const bool fatal)
+{
+    atf_utils_alloc_stats_t end;
+    unsigned long long allocs, bytes;
+
+    (void)atf_utils_get_alloc_stats(&end);
+    scope->m_active = false;
+    atf_alloc_scope_pop(scope->m_depth);
+
+    allocs = end.m_allocs - scope->m_start.m_allocs;
+    bytes = end.m_bytes - scope->m_start.m_bytes;
+    if (allocs <= max)
+        return;
+
+    if (fatal)
+        atf_tc_fail_requirement(file, line, "%llu allocations (%llu bytes) "
+            "done but at most %llu expected", allocs, bytes, max);
+    else
+        atf_tc_fail_check(file, line, "%llu allocations (%llu bytes) done "
+            "but at most %llu expected", allocs, bytes, max);
+}
+
+/** Queries the allocation counters.
+ *
+ * \param [out] stats The current values of the counters; left untouched if
+ *     allocation tracking is not available.
+ *
+ * \return True if the libatf-c-alloc interposer is loaded in the current
+ * process; false otherwise. */
+bool
+atf_utils_get_alloc_stats(atf_utils_alloc_stats_t *stats)
+{
+    const struct atf_alloc_counters *counters = atf_alloc_get_counters();
+
+    if (counters == NULL)
+        return false;
+
+    stats->m_allocs = counters->m_allocs;
+    stats->m_frees = counters->m_frees;
+    stats->m_bytes = counters->m_bytes;
+    stats->m_live_bytes = counters->m_live_bytes;
+    return true;
+}
+
+/** Queries the I/O counters of the current process.
+ *
+ * \param [out] stats The current values of the counters.  The counters that
+ *     come from /proc/self/io are set to zero if it is not available.
+ *
+ * \return True if all counters are available; false if only the block
+ * counters could be obtained. */
+bool
+atf_utils_get_io_stats(atf_utils_io_stats_t *stats)
+{
+    size_t overhead;
+
+    return read_io_stats(stats, &overhead);
+}
+
 /** Prints the contents of a file to stdout.
  *
  * \param name The name of the file to be printed.
@@ -148,22 +349,36 @@ atf_utils_compare_file(const char *name, const char *contents)
     const int fd = open(name, O_RDONLY);
     ATF_REQUIRE_MSG(fd != -1, "Cannot open %s", name);
 
+#if defined(HAVE_ZLIB)
+    /* gzread() passes through files that are not compressed. */
+    gzFile gz = gzdopen(fd, "rb");
+    ATF_REQUIRE_MSG(gz != NULL, "Cannot open %s", name);
+#   define READ_CHUNK(buffer, size) gzread(gz, buffer, size)
+#   define CLOSE_FILE() gzclose(gz)
+#else
+#   define READ_CHUNK(buffer, size) read(fd, buffer, size)
+#   define CLOSE_FILE() close(fd)
+#endif
+
     const char *pos = contents;
     ssize_t remaining = strlen(contents);
 
     char buffer[1024];
     ssize_t count;
-    while ((count = read(fd, buffer, sizeof(buffer))) > 0 &&
+    while ((count = READ_CHUNK(buffer, sizeof(buffer))) > 0 &&
            count <= remaining) {
         if (memcmp(pos, buffer, count) != 0) {
-            close(fd);
+            CLOSE_FILE();
             return false;
         }
         remaining -= count;
         pos += count;
     }
-    close(fd);
+    CLOSE_FILE();
     return count == 0 && remaining == 0;
+
+#undef READ_CHUNK
+#undef CLOSE_FILE
 }
 
 /** Copies a file.
@@ -357,6 +572,341 @@ atf_utils_grep_string(const char *regex, const char *str, ...)
     return res;
 }
 
+#define HISTOGRAM_HALF (1ULL << (ATF_UTILS_HISTOGRAM_SUB_BITS - 1))
+
+/** Computes the bucket of a histogram that holds a value.
+ *
+ * Values below 2^ATF_UTILS_HISTOGRAM_SUB_BITS get a bucket each.  Beyond
+ * that, every power of two is split in HISTOGRAM_HALF buckets of equal
+ * width: the index is made of the magnitude of the value followed by its
+ * most significant bits. */
+static size_t
+histogram_index(const unsigned long long value)
+{
+    unsigned int msb, shift;
+
+    if (value < 2 * HISTOGRAM_HALF)
+        return (size_t)value;
+
+#if defined(__GNUC__)
+    msb = 63 - (unsigned int)__builtin_clzll(value);
+#else
+    msb = 0;
+    while ((value >> msb) > 1)
+        msb++;
+#endif
+    shift = msb - ATF_UTILS_HISTOGRAM_SUB_BITS + 1;
+    return (size_t)(shift * HISTOGRAM_HALF + (value >> shift));
+}
+
+/** Returns the count and the range of values of a bucket of a histogram.
+ *
+ * \param h The histogram to query.
+ * \param index The bucket to query; must be below
+ *     ATF_UTILS_HISTOGRAM_BUCKETS.
+ * \param [out] lowest The lowest value that falls in the bucket.
+ * \param [out] highest The highest value that falls in the bucket.
+ *
+ * \return The number of values recorded in the bucket. */
+unsigned long long
+atf_utils_histogram_bucket(const atf_utils_histogram_t *h, const size_t index,
+                           unsigned long long *lowest,
+                           unsigned long long *highest)
+{
+    PRE(index < ATF_UTILS_HISTOGRAM_BUCKETS);
+
+    if (index < 2 * HISTOGRAM_HALF) {
+        *lowest = index;
+        *highest = index;
+    } else {
+        const unsigned int shift = (unsigned int)(index / HISTOGRAM_HALF) - 1;
+        const unsigned long long sub = index - shift * HISTOGRAM_HALF;
+
+        *lowest = sub << shift;
+        *highest = ((sub + 1) << shift) - 1;
+    }
+    return h->m_buckets[index];
+}
+
+/** Checks that a percentile of a histogram is below a limit.
+ *
+ * This is an internal function used by ATF_{CHECK,REQUIRE}_*_BELOW.  On
+ * failure, the histogram is dumped to stderr so that the distribution shows
+ * up in the output of the test case.
+ *
+ * \param file Source file of the check, for error reporting.
+ * \param line Source line of the check, for error reporting.
+ * \param h The histogram to validate.
+ * \param percentile The percentile to check, in the [0, 100] range.
+ * \param limit The value the percentile must be below of.
+ * \param fatal Whether a failure aborts the test case right away or just
+ *     records a failed check. */
+void
+atf_utils_histogram_check_below(const char *file, const size_t line,
+                                const atf_utils_histogram_t *h,
+                                const double percentile,
+                                const unsigned long long limit,
+                                const bool fatal)
+{
+    unsigned long long value;
+
+    if (h->m_count == 0) {
+        if (fatal)
+            atf_tc_fail_requirement(file, line, "Cannot check p%g of an empty "
+                                    "histogram", percentile);
+        else
+            atf_tc_fail_check(file, line, "Cannot check p%g of an empty "
+                              "histogram", percentile);
+        return;
+    }
+
+    value = atf_utils_histogram_percentile(h, percentile);
+    if (value < limit)
+        return;
+
+    atf_utils_histogram_print(h, stderr);
+    if (fatal)
+        atf_tc_fail_requirement(file, line, "p%g is %llu, not below %llu",
+                                percentile, value, limit);
+    else
+        atf_tc_fail_check(file, line, "p%g is %llu, not below %llu",
+                          percentile, value, limit);
+}
+
+/** Initializes an empty histogram.
+ *
+ * \param h The histogram to initialize. */
+void
+atf_utils_histogram_init(atf_utils_histogram_t *h)
+{
+    memset(h, 0, sizeof(*h));
+    h->m_min = ULLONG_MAX;
+}
+
+/** Adds the values recorded in a histogram to another one.
+ *
+ * This is the way to combine measurements taken by different threads:
+ * each thread records into its own histogram, which are merged once the
+ * threads are done.
+ *
+ * \param dest The histogram to add the values to.
+ * \param src The histogram to take the values from. */
+void
+atf_utils_histogram_merge(atf_utils_histogram_t *dest,
+                          const atf_utils_histogram_t *src)
+{
+    size_t i;
+
+    for (i = 0; i < ATF_UTILS_HISTOGRAM_BUCKETS; i++)
+        dest->m_buckets[i] += src->m_buckets[i];
+    dest->m_count += src->m_count;
+    dest->m_sum += src->m_sum;
+    if (src->m_min < dest->m_min)
+        dest->m_min = src->m_min;
+    if (src->m_max > dest->m_max)
+        dest->m_max = src->m_max;
+}
+
+/** Computes a percentile of the values recorded in a histogram.
+ *
+ * \param h The histogram to query.
+ * \param percentile The percentile to compute, in the [0, 100] range.
+ *
+ * \return The highest value that is equivalent, within the precision of the
+ * histogram, to the requested percentile; or 0 if the histogram is empty. */
+unsigned long long
+atf_utils_histogram_percentile(const atf_utils_histogram_t *h,
+                               const double percentile)
+{
+    unsigned long long target, seen;
+    double exact;
+    size_t i;
+
+    PRE(percentile >= 0.0 && percentile <= 100.0);
+
+    if (h->m_count == 0)
+        return 0;
+
+    exact = percentile / 100.0 * (double)h->m_count;
+    target = (unsigned long long)exact;
+    if ((double)target < exact)
+        target++;
+    if (target == 0)
+        target = 1;
+
+    seen = 0;
+    for (i = 0; i < ATF_UTILS_HISTOGRAM_BUCKETS; i++) {
+        seen += h->m_buckets[i];
+        if (seen >= target) {
+            unsigned long long lowest, highest;
+
+            (void)atf_utils_histogram_bucket(h, i, &lowest, &highest);
+            if (highest > h->m_max)
+                highest = h->m_max;
+            if (highest < h->m_min)
+                highest = h->m_min;
+            return highest;
+        }
+    }
+    UNREACHABLE;
+    return h->m_max;
+}
+
+/** Prints a summary and the non-empty buckets of a histogram.
+ *
+ * \param h The histogram to print.
+ * \param file The stream to print the histogram to. */
+void
+atf_utils_histogram_print(const atf_utils_histogram_t *h, FILE *file)
+{
+    size_t i;
+
+    if (h->m_count == 0) {
+        fprintf(file, "Histogram: no values\n");
+        return;
+    }
+
+    fprintf(file, "Histogram: %llu values, min %llu, mean %llu, max %llu\n",
+            h->m_count, h->m_min, h->m_sum / h->m_count, h->m_max);
+    fprintf(file, "    p50 %llu, p90 %llu, p99 %llu, p99.9 %llu\n",
+            atf_utils_histogram_percentile(h, 50.0),
+            atf_utils_histogram_percentile(h, 90.0),
+            atf_utils_histogram_percentile(h, 99.0),
+            atf_utils_histogram_percentile(h, 99.9));
+    for (i = 0; i < ATF_UTILS_HISTOGRAM_BUCKETS; i++) {
+        unsigned long long lowest, highest, count;
+
+        count = atf_utils_histogram_bucket(h, i, &lowest, &highest);
+        if (count > 0)
+            fprintf(file, "    [%llu, %llu]: %llu\n", lowest, highest, count);
+    }
+}
+
+/** Records a value into a histogram.
+ *
+ * This is cheap enough to be called from tight loops.  It is not thread
+ * safe though: use one histogram per thread and merge them afterwards.
+ *
+ * \param h The histogram to record the value into.
+ * \param value The value to record. */
+void
+atf_utils_histogram_record(atf_utils_histogram_t *h,
+                           const unsigned long long value)
+{
+    h->m_buckets[histogram_index(value)]++;
+    h->m_count++;
+    h->m_sum += value;
+    if (value < h->m_min)
+        h->m_min = value;
+    if (value > h->m_max)
+        h->m_max = value;
+}
+
+/** Constructs an I/O budget for read and write calls.
+ *
+ * \param reads Maximum number of read calls.
+ * \param read_bytes Maximum number of bytes read.
+ * \param writes Maximum number of write calls.
+ * \param write_bytes Maximum number of bytes written.
+ *
+ * \return A budget with the given limits and no limits on storage and block
+ * I/O.  Any of the limits can be ATF_UTILS_IO_UNLIMITED. */
+atf_utils_io_stats_t
+atf_utils_io_budget(const unsigned long long reads,
+                    const unsigned long long read_bytes,
+                    const unsigned long long writes,
+                    const unsigned long long write_bytes)
+{
+    atf_utils_io_stats_t budget;
+
+    budget.m_reads = reads;
+    budget.m_read_bytes = read_bytes;
+    budget.m_writes = writes;
+    budget.m_write_bytes = write_bytes;
+    budget.m_storage_read_bytes = ATF_UTILS_IO_UNLIMITED;
+    budget.m_storage_write_bytes = ATF_UTILS_IO_UNLIMITED;
+    budget.m_block_ins = ATF_UTILS_IO_UNLIMITED;
+    budget.m_block_outs = ATF_UTILS_IO_UNLIMITED;
+    return budget;
+}
+
+/** Starts an I/O-counting scope.
+ *
+ * This is an internal function used by ATF_{CHECK,REQUIRE}_IO_WITHIN.
+ * Skips the test case if the budget limits counters that are not available
+ * in this system.
+ *
+ * \param budget The maximum values for the counters within the scope.
+ *
+ * \return The state of the scope, to be passed to atf_utils_io_scope_end(). */
+atf_utils_io_scope_t
+atf_utils_io_scope_begin(const atf_utils_io_stats_t budget)
+{
+    atf_utils_io_scope_t scope;
+    size_t i;
+
+    scope.m_active = true;
+    scope.m_budget = budget;
+    if (read_io_stats(&scope.m_start, &scope.m_overhead))
+        return scope;
+
+    for (i = 0; i < sizeof(io_fields) / sizeof(io_fields[0]); i++) {
+        if (io_fields[i].proc_name != NULL &&
+            IO_FIELD(&scope.m_budget, &io_fields[i]) != ATF_UTILS_IO_UNLIMITED)
+            atf_tc_skip("I/O accounting not available; cannot read "
+                        "/proc/self/io");
+    }
+    return scope;
+}
+
+/** Terminates an I/O-counting scope.
+ *
+ * This is an internal function used by ATF_{CHECK,REQUIRE}_IO_WITHIN.
+ *
+ * \param scope The state returned by atf_utils_io_scope_begin().
+ * \param file Source file of the scope, for error reporting.
+ * \param line Source line of the scope, for error reporting.
+ * \param fatal Whether exceeding the budget fails the test case right away
+ *     or just records a failed check. */
+void
+atf_utils_io_scope_end(atf_utils_io_scope_t *scope, const char *file,
+                       const size_t line, const bool fatal)
+{
+    atf_utils_io_stats_t end;
+    char reason[1024];
+    size_t overhead, i, pos;
+
+    (void)read_io_stats(&end, &overhead);
+    scope->m_active = false;
+
+    /* Discount the read of /proc/self/io done by atf_utils_io_scope_begin. */
+    if (scope->m_overhead > 0) {
+        end.m_reads -= 1;
+        end.m_read_bytes -= scope->m_overhead;
+    }
+
+    pos = 0;
+    reason[0] = '\0';
+    for (i = 0; i < sizeof(io_fields) / sizeof(io_fields[0]); i++) {
+        const struct io_field *field = &io_fields[i];
+        const unsigned long long used = IO_FIELD(&end, field) -
+            IO_FIELD(&scope->m_start, field);
+        const unsigned long long max = IO_FIELD(&scope->m_budget, field);
+
+        if (max != ATF_UTILS_IO_UNLIMITED && used > max && pos < sizeof(reason))
+            pos += snprintf(reason + pos, sizeof(reason) - pos, "%s%llu %s "
+                "but at most %llu expected", pos == 0 ? "" : "; ", used,
+                field->descr, max);
+    }
+    if (pos == 0)
+        return;
+
+    if (fatal)
+        atf_tc_fail_requirement(file, line, "I/O budget exceeded: %s", reason);
+    else
+        atf_tc_fail_check(file, line, "I/O budget exceeded: %s", reason);
+}
+
 /** Reads a line of arbitrary length.
  *
  * \param fd The descriptor from which to read the line.
@@ -26,11 +26,78 @@
 #if !defined(ATF_C_UTILS_H)
 #define ATF_C_UTILS_H
 
+#include <limits.h>
 #include <stdbool.h>
+#include <stdio.h>
 #include <unistd.h>
 
 #include <atf-c/defs.h>
 
+/* Allocation counters as maintained by the libatf-c-alloc interposer.
+ * Sizes are those reported by malloc_usable_size(3). */
+struct atf_utils_alloc_stats {
+    unsigned long long m_allocs;
+    unsigned long long m_frees;
+    unsigned long long m_bytes;
+    unsigned long long m_live_bytes;
+};
+typedef struct atf_utils_alloc_stats atf_utils_alloc_stats_t;
+
+/* State of an ATF_{CHECK,REQUIRE}_ALLOCS_AT_MOST block. */
+struct atf_utils_alloc_scope {
+    bool m_active;
+    size_t m_depth;
+    atf_utils_alloc_stats_t m_start;
+};
+typedef struct atf_utils_alloc_scope atf_utils_alloc_scope_t;
+
+/* I/O counters of the process.  Also used to express I/O budgets, in which
+ * case ATF_UTILS_IO_UNLIMITED leaves a counter unchecked. */
+struct atf_utils_io_stats {
+    unsigned long long m_reads;
+    unsigned long long m_read_bytes;
+    unsigned long long m_writes;
+    unsigned long long m_write_bytes;
+    unsigned long long m_storage_read_bytes;
+    unsigned long long m_storage_write_bytes;
+    unsigned long long m_block_ins;
+    unsigned long long m_block_outs;
+};
+typedef struct atf_utils_io_stats atf_utils_io_stats_t;
+
+#define ATF_UTILS_IO_UNLIMITED ULLONG_MAX
+
+/* State of an ATF_{CHECK,REQUIRE}_IO_WITHIN block. */
+struct atf_utils_io_scope {
+    bool m_active;
+    atf_utils_io_stats_t m_budget;
+    atf_utils_io_stats_t m_start;
+    size_t m_overhead;
+};
+typedef struct atf_utils_io_scope atf_utils_io_scope_t;
+
+/* Log-linear histogram of non-negative integer values (typically latencies
+ * in microseconds).  Values are exact up to 127 and are kept with a
+ * relative error below 1/64 beyond that. */
+#define ATF_UTILS_HISTOGRAM_SUB_BITS 7
+#define ATF_UTILS_HISTOGRAM_BUCKETS \
+    ((64 - ATF_UTILS_HISTOGRAM_SUB_BITS + 2) << \
+     (ATF_UTILS_HISTOGRAM_SUB_BITS - 1))
+
+struct atf_utils_histogram {
+    unsigned long long m_count;
+    unsigned long long m_sum;
+    unsigned long long m_min;
+    unsigned long long m_max;
+    unsigned long long m_buckets[ATF_UTILS_HISTOGRAM_BUCKETS];
+};
+typedef struct atf_utils_histogram atf_utils_histogram_t;
+
+atf_utils_alloc_scope_t atf_utils_alloc_scope_begin(const char *,
+                                                    const size_t);
+void atf_utils_alloc_scope_end(atf_utils_alloc_scope_t *, const char *,
+                               const size_t, const unsigned long long,
+                               const bool);
 void atf_utils_cat_file(const char *, const char *);
 bool atf_utils_compare_file(const char *, const char *);
 void atf_utils_copy_file(const char *, const char *);
@@ -39,10 +106,35 @@ void atf_utils_create_file(const char *, const char *, ...)
 bool atf_utils_file_exists(const char *);
 pid_t atf_utils_fork(void);
 void atf_utils_free_charpp(char **);
+bool atf_utils_get_alloc_stats(atf_utils_alloc_stats_t *);
+bool atf_utils_get_io_stats(atf_utils_io_stats_t *);
 bool atf_utils_grep_file(const char *, const char *, ...)
     ATF_DEFS_ATTRIBUTE_FORMAT_PRINTF(1, 3);
 bool atf_utils_grep_string(const char *, const char *, ...)
     ATF_DEFS_ATTRIBUTE_FORMAT_PRINTF(1, 3);
+unsigned long long atf_utils_histogram_bucket(const atf_utils_histogram_t *,
+                                              const size_t,
+                                              unsigned long long *,
+                                              unsigned long long *);
+void atf_utils_histogram_check_below(const char *, const size_t,
+                                     const atf_utils_histogram_t *,
+                                     const double, const unsigned long long,
+                                     const bool);
+void atf_utils_histogram_init(atf_utils_histogram_t *);
+void atf_utils_histogram_merge(atf_utils_histogram_t *,
+                               const atf_utils_histogram_t *);
+unsigned long long atf_utils_histogram_percentile(
+    const atf_utils_histogram_t *, const double);
+void atf_utils_histogram_print(const atf_utils_histogram_t *, FILE *);
+void atf_utils_histogram_record(atf_utils_histogram_t *,
+                                const unsigned long long);
+atf_utils_io_stats_t atf_utils_io_budget(const unsigned long long,
+                                         const unsigned long long,
+                                         const unsigned long long,
+                                         const unsigned long long);
+atf_utils_io_scope_t atf_utils_io_scope_begin(const atf_utils_io_stats_t);
+void atf_utils_io_scope_end(atf_utils_io_scope_t *, const char *,
+                            const size_t, const bool);
 char *atf_utils_readline(int);
 void atf_utils_redirect(const int, const char *);
 void atf_utils_wait(const pid_t, const int, const char *, const char *);
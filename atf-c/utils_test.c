@@ -23,6 +23,10 @@
  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
  * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.  */
 
+#if defined(HAVE_CONFIG_H)
+#include "config.h"
+#endif
+
 #include "atf-c/utils.h"
 
 #include <sys/stat.h>
@@ -64,6 +68,159 @@ read_file(const char *path, void *const buffer, const size_t buflen)
     return length;
 }
 
+/* Storage for blocks that the tests below intentionally leak, so that the
+ * compiler cannot optimize the allocations away. */
+static void *volatile leaked_block;
+
+/* A failure reason that is too long to fit in the chunks of the arena of
+ * the test case, so that formatting it makes the arena grow. */
+static const char *
+long_reason(void)
+{
+    static char reason[8192];
+
+    memset(reason, 'x', sizeof(reason) - 1);
+    reason[sizeof(reason) - 1] = '\0';
+    return reason;
+}
+
+ATF_TC_WITHOUT_HEAD(alloc_stats);
+ATF_TC_BODY(alloc_stats, tc)
+{
+    atf_utils_alloc_stats_t before, after;
+
+    if (!atf_utils_get_alloc_stats(&before))
+        atf_tc_skip("Allocation tracking not available");
+
+    leaked_block = malloc(100);
+    ATF_REQUIRE(leaked_block != NULL);
+    ATF_REQUIRE(atf_utils_get_alloc_stats(&after));
+    ATF_REQUIRE_EQ(before.m_allocs + 1, after.m_allocs);
+    ATF_REQUIRE_EQ(before.m_frees, after.m_frees);
+    ATF_REQUIRE(after.m_bytes - before.m_bytes >= 100);
+    ATF_REQUIRE(after.m_live_bytes - before.m_live_bytes >= 100);
+
+    free(leaked_block);
+    ATF_REQUIRE(atf_utils_get_alloc_stats(&after));
+    ATF_REQUIRE_EQ(before.m_frees + 1, after.m_frees);
+    ATF_REQUIRE_EQ(before.m_live_bytes, after.m_live_bytes);
+}
+
+ATF_TC_WITHOUT_HEAD(allocs_at_most__ok);
+ATF_TC_BODY(allocs_at_most__ok, tc)
+{
+    ATF_REQUIRE_ALLOCS_AT_MOST(2) {
+        leaked_block = malloc(10);
+        leaked_block = realloc(leaked_block, 1000);
+        free(leaked_block);
+    }
+}
+
+ATF_TC_WITHOUT_HEAD(allocs_at_most__exceeded);
+ATF_TC_BODY(allocs_at_most__exceeded, tc)
+{
+    atf_tc_expect_fail("The scope allocates more than permitted");
+    ATF_CHECK_ALLOCS_AT_MOST(1) {
+        void *p1 = malloc(10);
+        void *p2 = malloc(10);
+        leaked_block = p1;
+        leaked_block = p2;
+        free(p1);
+        free(p2);
+    }
+}
+
+ATF_TC_WITHOUT_HEAD(no_allocs__ok);
+ATF_TC_BODY(no_allocs__ok, tc)
+{
+    char buffer[16];
+
+    ATF_REQUIRE_NO_ALLOCS {
+        snprintf(buffer, sizeof(buffer), "%d", 12345);
+    }
+    ATF_REQUIRE_STREQ("12345", buffer);
+}
+
+ATF_TC_WITHOUT_HEAD(no_allocs__violated);
+ATF_TC_BODY(no_allocs__violated, tc)
+{
+    atf_tc_expect_fail("The scope allocates memory");
+    ATF_REQUIRE_NO_ALLOCS {
+        leaked_block = strdup("foo");
+        free(leaked_block);
+    }
+}
+
+ATF_TC_WITHOUT_HEAD(no_allocs__failed_check);
+ATF_TC_BODY(no_allocs__failed_check, tc)
+{
+    ATF_CHECK_NO_ALLOCS {
+        atf_tc_expect_fail("The check fails on purpose");
+        ATF_CHECK_MSG(false, "%s", long_reason());
+        atf_tc_expect_pass();
+    }
+}
+
+static void
+leave_block_early(void)
+{
+    ATF_CHECK_NO_ALLOCS {
+        return;
+    }
+}
+
+ATF_TC_WITHOUT_HEAD(allocs_at_most__left_early);
+ATF_TC_BODY(allocs_at_most__left_early, tc)
+{
+    atf_tc_expect_fail("The inner block is left with return");
+    ATF_CHECK_NO_ALLOCS {
+        leave_block_early();
+    }
+    atf_tc_expect_pass();
+
+    atf_tc_expect_fail("The block is left with goto");
+    ATF_CHECK_ALLOCS_AT_MOST(1) {
+        goto out;
+    }
+out:
+    ;
+}
+
+ATF_TC(leak_check__clean);
+ATF_TC_HEAD(leak_check__clean, tc)
+{
+    atf_tc_set_md_var(tc, "X-atf.leak_check", "true");
+}
+ATF_TC_BODY(leak_check__clean, tc)
+{
+    printf("Some output that goes through stdio\n");
+    leaked_block = malloc(10);
+    free(leaked_block);
+}
+
+ATF_TC(leak_check__leaky);
+ATF_TC_HEAD(leak_check__leaky, tc)
+{
+    atf_tc_set_md_var(tc, "X-atf.leak_check", "yes");
+}
+ATF_TC_BODY(leak_check__leaky, tc)
+{
+    atf_tc_expect_fail("The body leaks one block");
+    leaked_block = malloc(10);
+}
+
+ATF_TC(leak_check__framework);
+ATF_TC_HEAD(leak_check__framework, tc)
+{
+    atf_tc_set_md_var(tc, "X-atf.leak_check", "true");
+}
+ATF_TC_BODY(leak_check__framework, tc)
+{
+    atf_tc_expect_fail("The check fails on purpose");
+    ATF_CHECK_MSG(false, "%s", long_reason());
+    atf_tc_expect_pass();
+}
+
 ATF_TC_WITHOUT_HEAD(cat_file__empty);
 ATF_TC_BODY(cat_file__empty, tc)
 {
@@ -184,6 +341,26 @@ ATF_TC_BODY(compare_file__long__not_match, tc)
     ATF_REQUIRE(!atf_utils_compare_file("test.txt", long_contents));
 }
 
+ATF_TC(compare_file__gzip);
+ATF_TC_HEAD(compare_file__gzip, tc)
+{
+    atf_tc_set_md_var(tc, "require.progs", "gzip");
+}
+ATF_TC_BODY(compare_file__gzip, tc)
+{
+#if defined(HAVE_ZLIB)
+    atf_utils_create_file("test.txt", "this is a compressed file\n");
+    ATF_REQUIRE(system("gzip test.txt") == 0);
+    ATF_REQUIRE(atf_utils_compare_file("test.txt.gz",
+                                       "this is a compressed file\n"));
+    ATF_REQUIRE(!atf_utils_compare_file("test.txt.gz",
+                                        "this is a compressed file"));
+    ATF_REQUIRE(!atf_utils_compare_file("test.txt.gz", ""));
+#else
+    atf_tc_skip("Built without zlib support");
+#endif
+}
+
 ATF_TC_WITHOUT_HEAD(copy_file__empty);
 ATF_TC_BODY(copy_file__empty, tc)
 {
@@ -306,6 +483,201 @@ ATF_TC_BODY(grep_string, tc)
     ATF_CHECK(!atf_utils_grep_string("aaaaa", str));
 }
 
+ATF_TC_WITHOUT_HEAD(histogram__empty);
+ATF_TC_BODY(histogram__empty, tc)
+{
+    atf_utils_histogram_t h;
+
+    atf_utils_histogram_init(&h);
+    ATF_REQUIRE_EQ(0, h.m_count);
+    ATF_REQUIRE_EQ(0, atf_utils_histogram_percentile(&h, 50.0));
+    ATF_REQUIRE_EQ(0, atf_utils_histogram_percentile(&h, 100.0));
+}
+
+ATF_TC_WITHOUT_HEAD(histogram__percentile);
+ATF_TC_BODY(histogram__percentile, tc)
+{
+    atf_utils_histogram_t h;
+    unsigned long long i;
+
+    atf_utils_histogram_init(&h);
+    for (i = 1; i <= 1000; i++)
+        atf_utils_histogram_record(&h, i);
+    ATF_REQUIRE_EQ(1000, h.m_count);
+    ATF_REQUIRE_EQ(1, h.m_min);
+    ATF_REQUIRE_EQ(1000, h.m_max);
+
+    /* Small values are exact; larger ones are within 1/64 of the truth. */
+    ATF_REQUIRE_EQ(1, atf_utils_histogram_percentile(&h, 0.0));
+    ATF_REQUIRE_EQ(100, atf_utils_histogram_percentile(&h, 10.0));
+    ATF_REQUIRE(atf_utils_histogram_percentile(&h, 50.0) >= 500);
+    ATF_REQUIRE(atf_utils_histogram_percentile(&h, 50.0) <= 500 + 500 / 64);
+    ATF_REQUIRE(atf_utils_histogram_percentile(&h, 99.0) >= 990);
+    ATF_REQUIRE(atf_utils_histogram_percentile(&h, 99.0) <= 990 + 990 / 64);
+    ATF_REQUIRE_EQ(1000, atf_utils_histogram_percentile(&h, 100.0));
+
+    atf_utils_histogram_record(&h, ULLONG_MAX);
+    ATF_REQUIRE_EQ(ULLONG_MAX, atf_utils_histogram_percentile(&h, 100.0));
+}
+
+ATF_TC_WITHOUT_HEAD(histogram__merge);
+ATF_TC_BODY(histogram__merge, tc)
+{
+    atf_utils_histogram_t h1, h2;
+    unsigned long long i;
+
+    atf_utils_histogram_init(&h1);
+    atf_utils_histogram_init(&h2);
+    for (i = 0; i < 90; i++)
+        atf_utils_histogram_record(&h1, 10);
+    for (i = 0; i < 10; i++)
+        atf_utils_histogram_record(&h2, 50000);
+
+    atf_utils_histogram_merge(&h1, &h2);
+    ATF_REQUIRE_EQ(100, h1.m_count);
+    ATF_REQUIRE_EQ(10, h1.m_min);
+    ATF_REQUIRE_EQ(50000, h1.m_max);
+    ATF_REQUIRE_EQ(10, atf_utils_histogram_percentile(&h1, 90.0));
+    ATF_REQUIRE_EQ(50000, atf_utils_histogram_percentile(&h1, 91.0));
+}
+
+ATF_TC_WITHOUT_HEAD(histogram__print);
+ATF_TC_BODY(histogram__print, tc)
+{
+    atf_utils_histogram_t h;
+    FILE *f;
+
+    atf_utils_histogram_init(&h);
+    atf_utils_histogram_record(&h, 3);
+    atf_utils_histogram_record(&h, 3);
+    atf_utils_histogram_record(&h, 1000);
+
+    ATF_REQUIRE((f = fopen("hist.txt", "w")) != NULL);
+    atf_utils_histogram_print(&h, f);
+    fclose(f);
+
+    ATF_REQUIRE(atf_utils_grep_file("3 values, min 3, mean 335, max 1000",
+                                    "hist.txt"));
+    ATF_REQUIRE(atf_utils_grep_file("^    \\[3, 3\\]: 2$", "hist.txt"));
+    ATF_REQUIRE(atf_utils_grep_file("^    \\[1000, 1007\\]: 1$", "hist.txt"));
+}
+
+ATF_TC_WITHOUT_HEAD(p99_below__ok);
+ATF_TC_BODY(p99_below__ok, tc)
+{
+    atf_utils_histogram_t h;
+    unsigned long long i;
+
+    atf_utils_histogram_init(&h);
+    for (i = 0; i < 1000; i++)
+        atf_utils_histogram_record(&h, i < 995 ? 100 : 100000);
+    ATF_CHECK_P50_BELOW(h, 101);
+    ATF_REQUIRE_P99_BELOW(h, 101);
+    ATF_REQUIRE_PERCENTILE_BELOW(h, 99.9, 100001);
+}
+
+ATF_TC_WITHOUT_HEAD(p99_below__exceeded);
+ATF_TC_BODY(p99_below__exceeded, tc)
+{
+    atf_utils_histogram_t h;
+    unsigned long long i;
+
+    atf_utils_histogram_init(&h);
+    for (i = 0; i < 1000; i++)
+        atf_utils_histogram_record(&h, i < 980 ? 100 : 100000);
+
+    atf_tc_expect_fail("p99 is above the limit");
+    ATF_CHECK_P99_BELOW(h, 1000);
+}
+
+ATF_TC_WITHOUT_HEAD(p99_below__empty);
+ATF_TC_BODY(p99_below__empty, tc)
+{
+    atf_utils_histogram_t h;
+
+    atf_utils_histogram_init(&h);
+    atf_tc_expect_fail("Empty histograms cannot satisfy a percentile");
+    ATF_REQUIRE_P99_BELOW(h, 1000);
+}
+
+ATF_TC_WITHOUT_HEAD(io_stats);
+ATF_TC_BODY(io_stats, tc)
+{
+    atf_utils_io_stats_t before, after;
+    char buffer[100];
+    int fd;
+
+    if (!atf_utils_get_io_stats(&before))
+        atf_tc_skip("I/O accounting not available");
+
+    memset(buffer, 'x', sizeof(buffer));
+    ATF_REQUIRE((fd = open("file.txt", O_WRONLY | O_CREAT, 0644)) != -1);
+    ATF_REQUIRE_EQ(sizeof(buffer), (size_t)write(fd, buffer, sizeof(buffer)));
+    close(fd);
+
+    ATF_REQUIRE(atf_utils_get_io_stats(&after));
+    ATF_REQUIRE_EQ(before.m_writes + 1, after.m_writes);
+    ATF_REQUIRE_EQ(before.m_write_bytes + sizeof(buffer), after.m_write_bytes);
+    ATF_REQUIRE(after.m_reads > before.m_reads);
+}
+
+ATF_TC_WITHOUT_HEAD(io_within__ok);
+ATF_TC_BODY(io_within__ok, tc)
+{
+    char buffer[1024];
+    int fd;
+
+    atf_utils_create_file("file.txt", "%s", "Some contents\n");
+
+    ATF_REQUIRE_IO_WITHIN(atf_utils_io_budget(1, 14, 0, 0)) {
+        fd = open("file.txt", O_RDONLY);
+        ATF_CHECK_EQ(14, read(fd, buffer, sizeof(buffer)));
+        close(fd);
+    }
+}
+
+ATF_TC_WITHOUT_HEAD(reads_at_most__ok);
+ATF_TC_BODY(reads_at_most__ok, tc)
+{
+    char buffer[1024];
+    int fd;
+
+    atf_utils_create_file("file.txt", "%s", "Some contents\n");
+
+    ATF_REQUIRE_READS_AT_MOST(2, 14) {
+        fd = open("file.txt", O_RDONLY);
+        ATF_CHECK_EQ(14, read(fd, buffer, sizeof(buffer)));
+        ATF_CHECK_EQ(0, read(fd, buffer, sizeof(buffer)));
+        close(fd);
+    }
+}
+
+ATF_TC_WITHOUT_HEAD(reads_at_most__exceeded);
+ATF_TC_BODY(reads_at_most__exceeded, tc)
+{
+    char buffer[1024];
+    int fd;
+
+    atf_utils_create_file("file.txt", "%s", "Some contents\n");
+
+    atf_tc_expect_fail("The scope reads more than permitted");
+    ATF_CHECK_READS_AT_MOST(1, 10) {
+        fd = open("file.txt", O_RDONLY);
+        ATF_REQUIRE(read(fd, buffer, sizeof(buffer)) != -1);
+        ATF_REQUIRE(read(fd, buffer, sizeof(buffer)) != -1);
+        close(fd);
+    }
+}
+
+ATF_TC_WITHOUT_HEAD(writes_at_most__exceeded);
+ATF_TC_BODY(writes_at_most__exceeded, tc)
+{
+    atf_tc_expect_fail("The scope writes to a file");
+    ATF_REQUIRE_WRITES_AT_MOST(0, 0) {
+        atf_utils_create_file("file.txt", "%s", "Some contents\n");
+    }
+}
+
 ATF_TC_WITHOUT_HEAD(readline__none);
 ATF_TC_BODY(readline__none, tc)
 {
@@ -525,6 +897,17 @@ ATF_TC_BODY(wait__save_stderr, tc)
 
 ATF_TP_ADD_TCS(tp)
 {
+    ATF_TP_ADD_TC(tp, alloc_stats);
+    ATF_TP_ADD_TC(tp, allocs_at_most__ok);
+    ATF_TP_ADD_TC(tp, allocs_at_most__exceeded);
+    ATF_TP_ADD_TC(tp, no_allocs__ok);
+    ATF_TP_ADD_TC(tp, no_allocs__violated);
+    ATF_TP_ADD_TC(tp, no_allocs__failed_check);
+    ATF_TP_ADD_TC(tp, allocs_at_most__left_early);
+    ATF_TP_ADD_TC(tp, leak_check__clean);
+    ATF_TP_ADD_TC(tp, leak_check__leaky);
+    ATF_TP_ADD_TC(tp, leak_check__framework);
+
     ATF_TP_ADD_TC(tp, cat_file__empty);
     ATF_TP_ADD_TC(tp, cat_file__one_line);
     ATF_TP_ADD_TC(tp, cat_file__several_lines);
@@ -536,6 +919,7 @@ ATF_TP_ADD_TCS(tp)
     ATF_TP_ADD_TC(tp, compare_file__short__not_match);
     ATF_TP_ADD_TC(tp, compare_file__long__match);
     ATF_TP_ADD_TC(tp, compare_file__long__not_match);
+    ATF_TP_ADD_TC(tp, compare_file__gzip);
 
     ATF_TP_ADD_TC(tp, copy_file__empty);
     ATF_TP_ADD_TC(tp, copy_file__some_contents);
@@ -552,6 +936,20 @@ ATF_TP_ADD_TCS(tp)
     ATF_TP_ADD_TC(tp, grep_file);
     ATF_TP_ADD_TC(tp, grep_string);
 
+    ATF_TP_ADD_TC(tp, histogram__empty);
+    ATF_TP_ADD_TC(tp, histogram__percentile);
+    ATF_TP_ADD_TC(tp, histogram__merge);
+    ATF_TP_ADD_TC(tp, histogram__print);
+    ATF_TP_ADD_TC(tp, p99_below__ok);
+    ATF_TP_ADD_TC(tp, p99_below__exceeded);
+    ATF_TP_ADD_TC(tp, p99_below__empty);
+
+    ATF_TP_ADD_TC(tp, io_stats);
+    ATF_TP_ADD_TC(tp, io_within__ok);
+    ATF_TP_ADD_TC(tp, reads_at_most__ok);
+    ATF_TP_ADD_TC(tp, reads_at_most__exceeded);
+    ATF_TP_ADD_TC(tp, writes_at_most__exceeded);
+
     ATF_TP_ADD_TC(tp, readline__none);
     ATF_TP_ADD_TC(tp, readline__some);
 
@@ -23,25 +23,44 @@
 // OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
 // IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#if defined(HAVE_CONFIG_H)
+#include "config.h"
+#endif
+
 extern "C" {
 #include <sys/types.h>
+#if defined(HAVE_SYS_INOTIFY_H)
+#include <sys/inotify.h>
+#endif
+#include <sys/socket.h>
+#include <sys/un.h>
 #include <sys/wait.h>
 
+#include <fcntl.h>
 #include <limits.h>
+#include <poll.h>
+#include <regex.h>
 #include <signal.h>
 #include <stdint.h>
 #include <unistd.h>
+#if defined(HAVE_ZLIB)
+#include <zlib.h>
+#endif
 }
 
+#include <algorithm>
 #include <cerrno>
 #include <cstdlib>
 #include <cstring>
 #include <fstream>
+#include <iomanip>
 #include <ios>
 #include <iostream>
 #include <iterator>
 #include <list>
 #include <memory>
+#include <sstream>
+#include <stdexcept>
 #include <utility>
 
 #include "atf-c++/check.hpp"
@@ -90,7 +109,13 @@ enum output_check_t {
     oc_file,
     oc_empty,
     oc_match,
-    oc_save
+    oc_save,
+
+    // Filters applied to the output before any of the checks above.
+    oc_skip,
+    oc_sort,
+    oc_squeeze,
+    oc_sub,
 };
 
 struct output_check {
@@ -107,6 +132,432 @@ struct output_check {
     }
 };
 
+enum wait_condition_t {
+    wc_exists,
+    wc_match,
+    wc_socket,
+};
+
+struct wait_condition {
+    wait_condition_t type;
+    std::string path;
+    std::string regexp;
+
+    wait_condition(const wait_condition_t& p_type, const std::string& p_path,
+                   const std::string& p_regexp) :
+        type(p_type),
+        path(p_path),
+        regexp(p_regexp)
+    {
+    }
+};
+
+enum resource_check_t {
+    rc_max_cpu,
+    rc_max_rss,
+    rc_max_time,
+};
+
+struct resource_check {
+    resource_check_t type;
+    unsigned long long limit;
+
+    resource_check(const resource_check_t& p_type,
+                   const unsigned long long p_limit) :
+        type(p_type),
+        limit(p_limit)
+    {
+    }
+};
+
+struct batch_entry {
+    size_t line;
+    std::vector< std::string > args;
+
+    batch_entry(const size_t p_line) :
+        line(p_line)
+    {
+    }
+};
+
+//
+// Notifies of changes to the directory that holds a file.
+//
+// Watching the directory instead of the file itself catches the creation
+// of the file as well as any later modifications.  If the system cannot
+// deliver notifications, wait() just sleeps for the given time.
+//
+class path_watcher {
+    int m_fd;
+
+public:
+    path_watcher(const atf::fs::path& path) :
+        m_fd(-1)
+    {
+#if defined(HAVE_SYS_INOTIFY_H)
+        m_fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (m_fd != -1 && ::inotify_add_watch(m_fd,
+                path.branch_path().c_str(), IN_ATTRIB | IN_CLOSE_WRITE |
+                IN_CREATE | IN_MODIFY | IN_MOVED_TO) == -1) {
+            ::close(m_fd);
+            m_fd = -1;
+        }
+#endif
+    }
+
+    ~path_watcher(void)
+    {
+        if (m_fd != -1)
+            ::close(m_fd);
+    }
+
+    bool
+    active(void) const
+    {
+        return m_fd != -1;
+    }
+
+    void
+    wait(const useconds_t timeout)
+    {
+        if (m_fd == -1) {
+            ::usleep(timeout);
+            return;
+        }
+
+        struct pollfd pfd;
+        pfd.fd = m_fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        if (::poll(&pfd, 1, (timeout + 999) / 1000) > 0) {
+            char buffer[4096];
+            while (::read(m_fd, buffer, sizeof(buffer)) > 0)
+                ;
+        }
+    }
+};
+
+static
+bool
+is_filter(const output_check& oc)
+{
+    return oc.type == oc_skip || oc.type == oc_sort ||
+           oc.type == oc_squeeze || oc.type == oc_sub;
+}
+
+static
+bool
+has_checks(const std::vector< output_check >& checks)
+{
+    for (std::vector< output_check >::const_iterator iter = checks.begin();
+         iter != checks.end(); ++iter) {
+        if (!is_filter(*iter))
+            return true;
+    }
+    return false;
+}
+
+//
+// Normalizes the output of a command, one line at a time, according to the
+// filters given to -o or -e.  Filters run in the order they were given; a
+// sort sees the output of the filters before it as a whole, so output that
+// has to be sorted cannot be filtered as it is read.
+//
+class output_filter {
+    struct step {
+        output_check_t type;
+        ::regex_t* preg;
+        std::string replacement;
+    };
+
+    std::vector< step > m_steps;
+    bool m_sort;
+
+    // Disallow copies; the compiled regular expressions are owned by us.
+    output_filter(const output_filter&);
+    output_filter& operator=(const output_filter&);
+
+    void
+    release(void)
+    {
+        for (std::vector< step >::iterator iter = m_steps.begin();
+             iter != m_steps.end(); ++iter) {
+            if (iter->preg != NULL) {
+                ::regfree(iter->preg);
+                delete iter->preg;
+            }
+        }
+        m_steps.clear();
+    }
+
+    static
+    ::regex_t*
+    compile(const std::string& regexp)
+    {
+        ::regex_t* preg = new ::regex_t;
+        if (::regcomp(preg, regexp.c_str(), REG_EXTENDED) != 0) {
+            delete preg;
+            throw std::runtime_error("Invalid regular expression '" + regexp +
+                                     "'");
+        }
+        return preg;
+    }
+
+    static
+    std::string
+    substitute(const std::string& line, const ::regex_t* preg,
+               const std::string& replacement)
+    {
+        std::string result;
+        std::string::size_type pos = 0;
+        ::regmatch_t matches[10];
+
+        while (pos <= line.length() &&
+               ::regexec(preg, line.c_str() + pos, 10, matches,
+                         pos > 0 ? REG_NOTBOL : 0) == 0) {
+            result += line.substr(pos, matches[0].rm_so);
+            for (std::string::size_type i = 0; i < replacement.length();
+                 i++) {
+                int group = -1;
+                if (replacement[i] == '&')
+                    group = 0;
+                else if (replacement[i] == '\\' &&
+                         i + 1 < replacement.length()) {
+                    i++;
+                    if (replacement[i] >= '0' && replacement[i] <= '9')
+                        group = replacement[i] - '0';
+                    else {
+                        result += replacement[i];
+                        continue;
+                    }
+                } else {
+                    result += replacement[i];
+                    continue;
+                }
+
+                if (matches[group].rm_so != -1)
+                    result += line.substr(pos + matches[group].rm_so,
+                        matches[group].rm_eo - matches[group].rm_so);
+            }
+
+            if (matches[0].rm_eo == matches[0].rm_so) {
+                // Empty match: copy one character to make progress.
+                if (pos + matches[0].rm_eo < line.length())
+                    result += line[pos + matches[0].rm_eo];
+                pos += matches[0].rm_eo + 1;
+            } else
+                pos += matches[0].rm_eo;
+        }
+        if (pos < line.length())
+            result += line.substr(pos);
+        return result;
+    }
+
+    static
+    std::string
+    squeeze(const std::string& line)
+    {
+        std::string result;
+        bool blank = false;
+
+        for (std::string::const_iterator iter = line.begin();
+             iter != line.end(); ++iter) {
+            if (*iter == ' ' || *iter == '\t' || *iter == '\r')
+                blank = true;
+            else {
+                if (blank && !result.empty())
+                    result += ' ';
+                result += *iter;
+                blank = false;
+            }
+        }
+        return result;
+    }
+
+    //
+    // Applies the filters in [first, last) to a line.  Returns false if the
+    // line has to be dropped.
+    //
+    static
+    bool
+    run_steps(std::string& line, std::vector< step >::const_iterator first,
+              const std::vector< step >::const_iterator last)
+    {
+        for (std::vector< step >::const_iterator iter = first;
+             iter != last; ++iter) {
+            if (iter->type == oc_skip) {
+                if (::regexec(iter->preg, line.c_str(), 0, NULL, 0) == 0)
+                    return false;
+            } else if (iter->type == oc_squeeze) {
+                line = squeeze(line);
+            } else if (iter->type == oc_sub) {
+                line = substitute(line, iter->preg, iter->replacement);
+            } else
+                UNREACHABLE;
+        }
+        return true;
+    }
+
+public:
+    output_filter(const std::vector< output_check >& checks) :
+        m_sort(false)
+    {
+        try {
+            for (std::vector< output_check >::const_iterator iter =
+                 checks.begin(); iter != checks.end(); ++iter) {
+                step st;
+                st.type = iter->type;
+                st.preg = NULL;
+
+                if (iter->type == oc_skip) {
+                    st.preg = compile(iter->value);
+                } else if (iter->type == oc_sort) {
+                    m_sort = true;
+                } else if (iter->type == oc_squeeze) {
+                    // Nothing to prepare.
+                } else if (iter->type == oc_sub) {
+                    const char delim = iter->value[0];
+                    const std::string::size_type middle =
+                        iter->value.find(delim, 1);
+                    st.preg = compile(iter->value.substr(1, middle - 1));
+                    st.replacement = iter->value.substr(middle + 1,
+                        iter->value.length() - middle - 2);
+                } else
+                    continue;
+
+                m_steps.push_back(st);
+            }
+        } catch (...) {
+            release();
+            throw;
+        }
+    }
+
+    ~output_filter(void)
+    {
+        release();
+    }
+
+    bool
+    empty(void)
+        const
+    {
+        return m_steps.empty();
+    }
+
+    bool
+    sorts(void)
+        const
+    {
+        return m_sort;
+    }
+
+    //
+    // Applies the filters to a line, without its terminating newline.
+    // Returns false if the line has to be dropped.  Only valid if there is
+    // no sort among the filters.
+    //
+    bool
+    apply(std::string& line)
+        const
+    {
+        PRE(!m_sort);
+        return run_steps(line, m_steps.begin(), m_steps.end());
+    }
+
+    //
+    // Applies the filters to all the lines of the output, without their
+    // terminating newlines.
+    //
+    void
+    apply(std::vector< std::string >& lines)
+        const
+    {
+        std::vector< step >::const_iterator first = m_steps.begin();
+        for (;;) {
+            std::vector< step >::const_iterator last = first;
+            while (last != m_steps.end() && last->type != oc_sort)
+                ++last;
+
+            std::vector< std::string >::size_type kept = 0;
+            for (std::vector< std::string >::size_type i = 0;
+                 i < lines.size(); i++) {
+                if (run_steps(lines[i], first, last)) {
+                    if (kept != i)
+                        lines[kept].swap(lines[i]);
+                    kept++;
+                }
+            }
+            lines.resize(kept);
+
+            if (last == m_steps.end())
+                break;
+            std::sort(lines.begin(), lines.end());
+            first = last + 1;
+        }
+    }
+};
+
+//
+// Reads the lines of a file as seen through an output_filter.  Lines are
+// filtered as they are read unless they have to be sorted, which requires
+// holding them all in memory.
+//
+class filtered_reader {
+    std::ifstream m_stream;
+    const output_filter& m_filter;
+    std::vector< std::string > m_sorted;
+    std::vector< std::string >::size_type m_next;
+
+    bool
+    read_line(std::string& line)
+    {
+        while (std::getline(m_stream, line)) {
+            if (m_filter.apply(line))
+                return true;
+        }
+        check_stream();
+        return false;
+    }
+
+    void
+    check_stream(void)
+    {
+        if (m_stream.bad())
+            throw std::runtime_error("Failed to read output");
+    }
+
+public:
+    filtered_reader(const atf::fs::path& path, const output_filter& filter) :
+        m_stream(path.c_str()),
+        m_filter(filter),
+        m_next(0)
+    {
+        if (!m_stream)
+            throw std::runtime_error("Failed to open " + path.str());
+
+        if (m_filter.sorts()) {
+            std::string line;
+            while (std::getline(m_stream, line))
+                m_sorted.push_back(line);
+            check_stream();
+            m_filter.apply(m_sorted);
+        }
+    }
+
+    bool
+    next(std::string& line)
+    {
+        if (!m_filter.sorts())
+            return read_line(line);
+
+        if (m_next == m_sorted.size())
+            return false;
+        line = m_sorted[m_next++];
+        return true;
+    }
+};
+
 class temp_file : public std::ostream {
     std::auto_ptr< atf::fs::path > m_path;
     int m_fd;
@@ -165,6 +616,185 @@ public:
     }
 };
 
+//
+// Reads a file, decompressing it on the fly if it was compressed with
+// gzip(1) and zlib support is available.
+//
+class input_file {
+    const atf::fs::path m_path;
+#if defined(HAVE_ZLIB)
+    gzFile m_gz;
+#else
+    std::ifstream m_stream;
+#endif
+
+    // Disallow copies.
+    input_file(const input_file&);
+    input_file& operator=(const input_file&);
+
+public:
+    input_file(const atf::fs::path& p_path) :
+        m_path(p_path)
+#if defined(HAVE_ZLIB)
+        , m_gz(::gzopen(p_path.c_str(), "rb"))
+    {
+        if (m_gz == NULL)
+#else
+        , m_stream(p_path.c_str(), std::fstream::binary)
+    {
+        if (!m_stream)
+#endif
+            throw std::runtime_error("Failed to open " + m_path.str());
+    }
+
+    ~input_file(void)
+    {
+#if defined(HAVE_ZLIB)
+        ::gzclose(m_gz);
+#endif
+    }
+
+    //
+    // Reads up to size bytes, returning fewer only at the end of the file.
+    //
+    size_t
+    read(char* buffer, const size_t size)
+    {
+#if defined(HAVE_ZLIB)
+        const int count = ::gzread(m_gz, buffer, size);
+        if (count == -1)
+            throw std::runtime_error("Failed to read from " + m_path.str());
+        return count;
+#else
+        m_stream.read(buffer, size);
+        if (m_stream.bad())
+            throw std::runtime_error("Failed to read from " + m_path.str());
+        return m_stream.gcount();
+#endif
+    }
+};
+
+static
+bool
+is_compressed(const atf::fs::path& path)
+{
+    std::ifstream stream(path.c_str(), std::fstream::binary);
+    char magic[2];
+    return stream.read(magic, sizeof(magic)) &&
+           magic[0] == '\x1f' && magic[1] == '\x8b';
+}
+
+static
+bool
+wants_compression(const std::string& path)
+{
+    return path.length() > 3 && path.compare(path.length() - 3, 3, ".gz") == 0;
+}
+
+//
+// Decides how to capture a stream based on the checks that will inspect
+// it, so that no more output than necessary reaches the disk.  Only the
+// checks that compare the contents against something else, or that are
+// preceded by filters, need the whole stream in a temporary file.
+//
+static
+atf::check::capture
+plan_capture(const std::vector< output_check >& checks)
+{
+    bool filtered = false, ignored = true, empty = true;
+    const output_check* save = NULL;
+    size_t nchecks = 0;
+
+    for (std::vector< output_check >::const_iterator iter = checks.begin();
+         iter != checks.end(); ++iter) {
+        if (is_filter(*iter)) {
+            filtered = true;
+            continue;
+        }
+
+        nchecks++;
+        if (iter->type != oc_ignore)
+            ignored = false;
+        if (iter->type != oc_empty)
+            empty = false;
+        if (iter->type == oc_save)
+            save = &(*iter);
+    }
+
+    if (ignored)
+        return atf::check::capture::discard();
+    else if (empty && !filtered)
+        return atf::check::capture::probe();
+    else if (save != NULL && nchecks == 1 && !filtered &&
+             !wants_compression(save->value))
+        return atf::check::capture::path(save->value);
+    else
+        return atf::check::capture::file();
+}
+
+//
+// Provides a decompressed copy of a file that diff(1) and cat_file can
+// display.  Files that are not compressed are used as they are.
+//
+class plain_file {
+    const atf::fs::path m_path;
+    std::auto_ptr< temp_file > m_temp;
+
+public:
+    plain_file(const atf::fs::path& p_path) :
+        m_path(p_path)
+    {
+        if (!is_compressed(m_path))
+            return;
+
+        m_temp.reset(new temp_file("atf-check.XXXXXX"));
+        input_file input(m_path);
+        char buffer[4096];
+        size_t count;
+        while ((count = input.read(buffer, sizeof(buffer))) > 0)
+            m_temp->write(std::string(buffer, count));
+        m_temp->close();
+    }
+
+    const atf::fs::path&
+    path(void)
+        const
+    {
+        return m_temp.get() != NULL ? m_temp->get_path() : m_path;
+    }
+};
+
+//
+// Provides a file with the output as seen by the checks so that it can be
+// shown when they fail.  Filtered output is only written out at this point.
+//
+class shown_output {
+    const atf::fs::path m_path;
+    std::auto_ptr< temp_file > m_temp;
+
+public:
+    shown_output(const atf::fs::path& p_path, const output_filter& filter) :
+        m_path(p_path)
+    {
+        if (filter.empty())
+            return;
+
+        m_temp.reset(new temp_file("atf-check.XXXXXX"));
+        filtered_reader reader(m_path, filter);
+        std::string line;
+        while (reader.next(line))
+            m_temp->write(line + "\n");
+        m_temp->close();
+    }
+
+    const atf::fs::path&
+    path(void)
+        const
+    {
+        return m_temp.get() != NULL ? m_temp->get_path() : m_path;
+    }
+};
+
 } // anonymous namespace
 
 static useconds_t
@@ -332,10 +962,44 @@ parse_output_check_arg(const std::string& arg)
         if (negated)
             throw atf::application::usage_error("Cannot negate save checker");
         type = oc_save;
-    } else
+    } else if (action == "skip")
+        type = oc_skip;
+    else if (action == "sort")
+        type = oc_sort;
+    else if (action == "squeeze")
+        type = oc_squeeze;
+    else if (action == "sub")
+        type = oc_sub;
+    else
         throw atf::application::usage_error("Invalid output checker");
 
-    return output_check(type, negated, arg.substr(delimiter + 1));
+    const std::string value = (delimiter == std::string::npos) ? "" :
+        arg.substr(delimiter + 1);
+    const output_check oc(type, negated, value);
+    if (is_filter(oc)) {
+        if (negated)
+            throw atf::application::usage_error("Cannot negate %s filter",
+                                                action.c_str());
+        if ((type == oc_sort || type == oc_squeeze) &&
+            delimiter != std::string::npos)
+            throw atf::application::usage_error("The %s filter takes no "
+                                                "argument", action.c_str());
+        if (type == oc_skip && value.empty())
+            throw atf::application::usage_error("The skip filter takes a "
+                                                "regexp");
+        if (type == oc_sub) {
+            const std::string::size_type middle = value.empty() ?
+                std::string::npos : value.find(value[0], 1);
+            if (value.length() < 3 || value[0] == '\\' ||
+                middle == std::string::npos ||
+                middle == value.length() - 1 ||
+                value[value.length() - 1] != value[0] ||
+                value.find(value[0], middle + 1) != value.length() - 1)
+                throw atf::application::usage_error("The sub filter takes "
+                    "/regexp/replacement/");
+        }
+    }
+    return oc;
 }
 
 static void
@@ -394,6 +1058,182 @@ parse_repeat_check_arg(const std::string& arg, useconds_t *m_timo,
     *m_interval = l * mseconds_in_useconds;
 }
 
+static wait_condition
+parse_wait_condition_arg(const std::string& arg)
+{
+    const std::string::size_type delimiter = arg.find(':');
+    if (delimiter == std::string::npos || delimiter == arg.length() - 1)
+        throw atf::application::usage_error("Invalid wait condition");
+    const std::string action = arg.substr(0, delimiter);
+    const std::string value = arg.substr(delimiter + 1);
+
+    if (action == "exists") {
+        return wait_condition(wc_exists, value, "");
+    } else if (action == "match") {
+        const std::string::size_type delimiter2 = value.find(':');
+        if (delimiter2 == std::string::npos || delimiter2 == 0)
+            throw atf::application::usage_error("The match wait condition "
+                "takes a path and a regexp");
+        return wait_condition(wc_match, value.substr(0, delimiter2),
+                              value.substr(delimiter2 + 1));
+    } else if (action == "socket") {
+        struct sockaddr_un addr;
+        if (value.length() >= sizeof(addr.sun_path))
+            throw atf::application::usage_error("Socket path %s is too long",
+                                                value.c_str());
+        return wait_condition(wc_socket, value, "");
+    } else
+        throw atf::application::usage_error("Invalid wait condition");
+}
+
+static
+resource_check
+parse_resource_check_arg(const std::string& arg, const char option)
+{
+    const std::string::size_type delimiter = arg.find(':');
+    const std::string action = arg.substr(0, delimiter);
+    if (delimiter == std::string::npos || delimiter == arg.length() - 1)
+        throw atf::application::usage_error("Invalid resource checker");
+    const std::string value = arg.substr(delimiter + 1);
+
+    resource_check_t type;
+    if (option == 't' && action == "max-time")
+        type = rc_max_time;
+    else if (option == 't' && action == "max-cpu")
+        type = rc_max_cpu;
+    else if (option == 'm' && action == "max-rss")
+        type = rc_max_rss;
+    else
+        throw atf::application::usage_error("Invalid resource checker");
+
+    char *end;
+    errno = 0;
+    const unsigned long long limit = std::strtoull(value.c_str(), &end, 10);
+    if (errno != 0 || *end != '\0' || value[0] == '-')
+        throw atf::application::usage_error("Limit for the %s checker must "
+                                            "be a number", action.c_str());
+
+    return resource_check(type, limit);
+}
+
+static
+unsigned int
+parse_jobs_arg(const std::string& arg)
+{
+    char *end;
+    errno = 0;
+    const long l = std::strtol(arg.c_str(), &end, 10);
+    if (errno != 0 || *end != '\0' || l < 1 || l > INT_MAX)
+        throw atf::application::usage_error("The number of jobs must be a "
+                                            "positive number");
+    return static_cast< unsigned int >(l);
+}
+
+//
+// Splits a manifest record into words using the quoting rules of sh(1),
+// without any expansions: single quotes preserve everything, double quotes
+// honor backslash escapes and a backslash outside quotes escapes the next
+// character.  Returns false if a quote is left open.
+//
+static
+bool
+split_manifest_record(const std::string& record,
+                      std::vector< std::string >& words)
+{
+    std::string word;
+    bool in_word = false;
+    char quote = '\0';
+
+    for (std::string::size_type i = 0; i < record.length(); i++) {
+        const char ch = record[i];
+
+        if (quote == '\'') {
+            if (ch == '\'')
+                quote = '\0';
+            else
+                word += ch;
+        } else if (quote == '"') {
+            if (ch == '"')
+                quote = '\0';
+            else if (ch == '\\' && i + 1 < record.length() &&
+                     std::strchr("\"\\$`", record[i + 1]) != NULL)
+                word += record[++i];
+            else
+                word += ch;
+        } else if (ch == '\'' || ch == '"') {
+            quote = ch;
+            in_word = true;
+        } else if (ch == '\\' && i + 1 < record.length()) {
+            word += record[++i];
+            in_word = true;
+        } else if (ch == ' ' || ch == '\t') {
+            if (in_word) {
+                words.push_back(word);
+                word.clear();
+                in_word = false;
+            }
+        } else {
+            word += ch;
+            in_word = true;
+        }
+    }
+    if (in_word)
+        words.push_back(word);
+
+    return quote == '\0';
+}
+
+//
+// Reads a batch manifest.  Each record holds the arguments to a single
+// atf-check invocation: its checks followed by the command to run.  Blank
+// lines and lines starting with '#' are ignored, and a line ending with a
+// backslash continues on the next one.
+//
+static
+std::vector< batch_entry >
+read_manifest(const std::string& path)
+{
+    std::ifstream stream(path.c_str());
+    if (!stream)
+        throw std::runtime_error("Failed to open manifest " + path);
+
+    std::vector< batch_entry > entries;
+    std::string line, record;
+    size_t lineno = 0, first_line = 0;
+    while (std::getline(stream, line)) {
+        lineno++;
+        if (record.empty()) {
+            first_line = lineno;
+            const std::string::size_type start =
+                line.find_first_not_of(" \t");
+            if (start == std::string::npos || line[start] == '#')
+                continue;
+        }
+
+        if (!line.empty() && line[line.length() - 1] == '\\') {
+            record += line.substr(0, line.length() - 1);
+            continue;
+        }
+        record += line;
+
+        batch_entry entry(first_line);
+        if (!split_manifest_record(record, entry.args)) {
+            std::ostringstream error;
+            error << path << ":" << first_line << ": Unterminated quote";
+            throw std::runtime_error(error.str());
+        }
+        entries.push_back(entry);
+        record.clear();
+    }
+    if (!record.empty()) {
+        std::ostringstream error;
+        error << path << ":" << first_line << ": Unexpected end of file";
+        throw std::runtime_error(error.str());
+    }
+
+    return entries;
+}
+
 static
 std::string
 flatten_argv(char* const* argv)
@@ -415,7 +1255,8 @@ flatten_argv(char* const* argv)
 
 static
 std::auto_ptr< atf::check::check_result >
-execute(const char* const* argv)
+execute(const char* const* argv, const atf::check::capture& out,
+        const atf::check::capture& err)
 {
     // TODO: This should go to stderr... but fixing it now may be hard as test
     // cases out there might be relying on stderr being silent.
@@ -426,12 +1267,13 @@ execute(const char* const* argv)
     std::cout.flush();
 
     atf::process::argv_array argva(argv);
-    return atf::check::exec(argva);
+    return atf::check::exec(argva, out, err);
 }
 
 static
 std::auto_ptr< atf::check::check_result >
-execute_with_shell(char* const* argv)
+execute_with_shell(char* const* argv, const atf::check::capture& out,
+                   const atf::check::capture& err)
 {
     const std::string cmd = flatten_argv(argv);
 
@@ -440,12 +1282,12 @@ execute_with_shell(char* const* argv)
     sh_argv[1] = "-c";
     sh_argv[2] = cmd.c_str();
     sh_argv[3] = NULL;
-    return execute(sh_argv);
+    return execute(sh_argv, out, err);
 }
 
 static
 void
-cat_file(const atf::fs::path& path)
+cat_file(const atf::fs::path& path, std::ostream& os = std::cerr)
 {
     std::ifstream stream(path.c_str());
     if (!stream)
@@ -453,7 +1295,7 @@ cat_file(const atf::fs::path& path)
 
     stream >> std::noskipws;
     std::istream_iterator< char > begin(stream), end;
-    std::ostream_iterator< char > out(std::cerr);
+    std::ostream_iterator< char > out(os);
     std::copy(begin, end, out);
 
     stream.close();
@@ -482,25 +1324,164 @@ grep_file(const atf::fs::path& path, const std::string& regexp)
 
 static
 bool
-file_empty(const atf::fs::path& p)
+socket_accepts(const std::string& path)
+{
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == -1)
+        throw atf::system_error("atf_check", "socket(2) failed", errno);
+
+    struct sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    std::strcpy(addr.sun_path, path.c_str());
+
+    const bool connected = ::connect(fd, reinterpret_cast< struct sockaddr* >(
+        &addr), sizeof(addr)) != -1;
+    ::close(fd);
+    return connected;
+}
+
+static
+bool
+wait_condition_holds(const wait_condition& wc)
+{
+    switch (wc.type) {
+    case wc_exists:
+        return ::access(wc.path.c_str(), F_OK) != -1;
+    case wc_match:
+        // The file may be gone again by the time we open it.
+        return ::access(wc.path.c_str(), R_OK) != -1 &&
+            grep_file(atf::fs::path(wc.path), wc.regexp);
+    case wc_socket:
+        return socket_accepts(wc.path);
+    default:
+        UNREACHABLE;
+        return false;
+    }
+}
+
+static
+void
+print_wait_condition(const wait_condition& wc)
+{
+    switch (wc.type) {
+    case wc_exists:
+        std::cerr << "file " << wc.path << " to exist";
+        break;
+    case wc_match:
+        std::cerr << "regexp " << wc.regexp << " to be in " << wc.path;
+        break;
+    case wc_socket:
+        std::cerr << "socket " << wc.path << " to accept connections";
+        break;
+    default:
+        UNREACHABLE;
+    }
+}
+
+static
+bool
+wait_for_condition(const wait_condition& wc, const useconds_t deadline)
 {
+    path_watcher watcher(atf::fs::path(wc.path));
+    useconds_t backoff = mseconds_in_useconds;
+
+    // Set up the watcher before the first check so that no change can go
+    // unnoticed in between.
+    while (!wait_condition_holds(wc)) {
+        const useconds_t now = get_monotonic_useconds();
+        if (now >= deadline) {
+            std::cerr << "Fail: timed out waiting for ";
+            print_wait_condition(wc);
+            std::cerr << "\n";
+            return false;
+        }
+
+        useconds_t timeout = deadline - now;
+        // A socket starts accepting connections when its owner calls
+        // listen(2), which is not a file system event, so keep checking
+        // it periodically.  The same applies if notifications are not
+        // available at all.
+        if (wc.type == wc_socket || !watcher.active()) {
+            timeout = std::min(timeout, backoff);
+            backoff = std::min(backoff * 2, 50 * mseconds_in_useconds);
+        }
+        watcher.wait(timeout);
+    }
+    return true;
+}
+
+static
+bool
+grep_output(const atf::fs::path& path, const std::string& regexp,
+            const output_filter& filter)
+{
+    if (filter.empty())
+        return grep_file(path, regexp);
+
+    filtered_reader reader(path, filter);
+    std::string line;
+    while (reader.next(line)) {
+        if (atf::text::match(line, regexp))
+            return true;
+    }
+    return false;
+}
+
+static
+bool
+file_empty(const atf::fs::path& p, const output_filter& filter)
+{
+    if (!filter.empty()) {
+        filtered_reader reader(p, filter);
+        std::string line;
+        return !reader.next(line);
+    }
+
     atf::fs::file_info f(p);
 
     return (f.get_size() == 0);
 }
 
+//
+// Compares the filtered lines of p1, each terminated by a newline, against
+// the contents of p2 without writing the former anywhere.
+//
 static bool
-compare_files(const atf::fs::path& p1, const atf::fs::path& p2)
+compare_filtered(const atf::fs::path& p1, const output_filter& filter,
+                 const atf::fs::path& p2)
 {
+    filtered_reader reader(p1, filter);
+    input_file f2(p2);
+
+    std::string line;
+    std::vector< char > buf;
+    while (reader.next(line)) {
+        line += '\n';
+        buf.resize(line.length());
+        if (f2.read(&buf[0], buf.size()) != line.length() ||
+            std::memcmp(&buf[0], line.data(), line.length()) != 0)
+            return false;
+    }
+
+    char extra;
+    return f2.read(&extra, 1) == 0;
+}
+
+static bool
+compare_files(const atf::fs::path& p1, const output_filter& filter,
+              const atf::fs::path& p2)
+{
+    if (!filter.empty())
+        return compare_filtered(p1, filter, p2);
+
     bool equal = false;
 
     std::ifstream f1(p1.c_str());
     if (!f1)
         throw std::runtime_error("Failed to open " + p1.str());
 
-    std::ifstream f2(p2.c_str());
-    if (!f2)
-        throw std::runtime_error("Failed to open " + p2.str());
+    input_file f2(p2);
 
     for (;;) {
         char buf1[512], buf2[512];
@@ -509,17 +1490,15 @@ compare_files(const atf::fs::path& p1, const atf::fs::path& p2)
         if (f1.bad())
             throw std::runtime_error("Failed to read from " + p1.str());
 
-        f2.read(buf2, sizeof(buf2));
-        if (f2.bad())
-            throw std::runtime_error("Failed to read from " + p2.str());
+        const size_t count2 = f2.read(buf2, sizeof(buf2));
 
-        if ((f1.gcount() == 0) && (f2.gcount() == 0)) {
+        if ((f1.gcount() == 0) && (count2 == 0)) {
             equal = true;
             break;
         }
 
-        if ((f1.gcount() != f2.gcount()) ||
-            (std::memcmp(buf1, buf2, f1.gcount()) != 0)) {
+        if ((static_cast< size_t >(f1.gcount()) != count2) ||
+            (std::memcmp(buf1, buf2, count2) != 0)) {
             break;
         }
     }
@@ -675,18 +1654,48 @@ run_status_checks(const std::vector< status_check >& checks,
     return ok;
 }
 
+static
+void
+save_compressed(const atf::fs::path& source, const std::string& target)
+{
+#if defined(HAVE_ZLIB)
+    std::ifstream ifs(source.c_str(), std::fstream::binary);
+    if (!ifs)
+        throw std::runtime_error("Failed to open " + source.str());
+
+    gzFile gz = ::gzopen(target.c_str(), "wb");
+    if (gz == NULL)
+        throw std::runtime_error("Failed to create " + target);
+
+    char buffer[4096];
+    while (ifs.read(buffer, sizeof(buffer)) || ifs.gcount() > 0) {
+        if (::gzwrite(gz, buffer, ifs.gcount()) != ifs.gcount()) {
+            ::gzclose(gz);
+            throw std::runtime_error("Failed to write to " + target);
+        }
+    }
+
+    if (::gzclose(gz) != Z_OK)
+        throw std::runtime_error("Failed to write to " + target);
+#else
+    throw std::runtime_error("Cannot save " + target + ": atf-check was "
+                             "built without zlib support");
+#endif
+}
+
 static
 bool
 run_output_check(const output_check oc, const atf::fs::path& path,
-                 const std::string& stdxxx)
+                 const output_filter& filter, const std::string& stdxxx)
 {
     bool result;
 
     if (oc.type == oc_empty) {
-        const bool is_empty = file_empty(path);
+        const bool is_empty = file_empty(path, filter);
         if (!oc.negated && !is_empty) {
             std::cerr << "Fail: " << stdxxx << " not empty\n";
-            print_diff(atf::fs::path("/dev/null"), path);
+            print_diff(atf::fs::path("/dev/null"),
+                       shown_output(path, filter).path());
             result = false;
         } else if (oc.negated && is_empty) {
             std::cerr << "Fail: " << stdxxx << " is empty\n";
@@ -694,15 +1703,17 @@ run_output_check(const output_check oc, const atf::fs::path& path,
         } else
             result = true;
     } else if (oc.type == oc_file) {
-        const bool equals = compare_files(path, atf::fs::path(oc.value));
+        const bool equals = compare_files(path, filter,
+                                          atf::fs::path(oc.value));
         if (!oc.negated && !equals) {
             std::cerr << "Fail: " << stdxxx << " does not match golden "
                 "output\n";
-            print_diff(atf::fs::path(oc.value), path);
+            print_diff(plain_file(atf::fs::path(oc.value)).path(),
+                       shown_output(path, filter).path());
             result = false;
         } else if (oc.negated && equals) {
             std::cerr << "Fail: " << stdxxx << " matches golden output\n";
-            cat_file(atf::fs::path(oc.value));
+            cat_file(plain_file(atf::fs::path(oc.value)).path());
             result = false;
         } else
             result = true;
@@ -713,11 +1724,11 @@ run_output_check(const output_check oc, const atf::fs::path& path,
         temp.write(decode(oc.value));
         temp.close();
 
-        const bool equals = compare_files(path, temp.get_path());
+        const bool equals = compare_files(path, filter, temp.get_path());
         if (!oc.negated && !equals) {
             std::cerr << "Fail: " << stdxxx << " does not match expected "
                 "value\n";
-            print_diff(temp.get_path(), path);
+            print_diff(temp.get_path(), shown_output(path, filter).path());
             result = false;
         } else if (oc.negated && equals) {
             std::cerr << "Fail: " << stdxxx << " matches expected value\n";
@@ -726,22 +1737,31 @@ run_output_check(const output_check oc, const atf::fs::path& path,
         } else
             result = true;
     } else if (oc.type == oc_match) {
-        const bool matches = grep_file(path, oc.value);
+        const bool matches = grep_output(path, oc.value, filter);
         if (!oc.negated && !matches) {
             std::cerr << "Fail: regexp " + oc.value + " not in " << stdxxx
                       << "\n";
-            cat_file(path);
+            cat_file(shown_output(path, filter).path());
             result = false;
         } else if (oc.negated && matches) {
             std::cerr << "Fail: regexp " + oc.value + " is in " << stdxxx
                       << "\n";
-            cat_file(path);
+            cat_file(shown_output(path, filter).path());
             result = false;
         } else
             result = true;
     } else if (oc.type == oc_save) {
         INV(!oc.negated);
-        std::ifstream ifs(path.c_str(), std::fstream::binary);
+        if (path == atf::fs::path(oc.value))
+            return true; // Captured straight into the destination.
+
+        const shown_output output(path, filter);
+        if (wants_compression(oc.value)) {
+            save_compressed(output.path(), oc.value);
+            return true;
+        }
+
+        std::ifstream ifs(output.path().c_str(), std::fstream::binary);
         ifs >> std::noskipws;
         std::istream_iterator< char > begin(ifs), end;
 
@@ -766,9 +1786,79 @@ run_output_checks(const std::vector< output_check >& checks,
 {
     bool ok = true;
 
+    const output_filter filter(checks);
     for (std::vector< output_check >::const_iterator iter = checks.begin();
          iter != checks.end(); iter++) {
-         ok &= run_output_check(*iter, path, stdxxx);
+        if (!is_filter(*iter))
+            ok &= run_output_check(*iter, path, filter, stdxxx);
+    }
+
+    return ok;
+}
+
+static
+void
+print_resources(const atf::check::check_result& r)
+{
+    std::cerr << std::fixed << std::setprecision(3)
+              << "Resources: wall time " << r.wall_usecs() / 1000.0
+              << " ms, user time " << r.user_usecs() / 1000.0
+              << " ms, system time " << r.system_usecs() / 1000.0
+              << " ms, max RSS " << r.maxrss_kib() << " KiB\n";
+}
+
+static
+bool
+run_resource_check(const resource_check& rc,
+                   const atf::check::check_result& r)
+{
+    unsigned long long used;
+    const char* what;
+    const char* unit;
+
+    switch (rc.type) {
+    case rc_max_cpu:
+        used = (r.user_usecs() + r.system_usecs()) / mseconds_in_useconds;
+        what = "CPU time";
+        unit = "ms";
+        break;
+
+    case rc_max_rss:
+        used = r.maxrss_kib();
+        what = "maximum resident set size";
+        unit = "KiB";
+        break;
+
+    case rc_max_time:
+        used = r.wall_usecs() / mseconds_in_useconds;
+        what = "wall time";
+        unit = "ms";
+        break;
+
+    default:
+        UNREACHABLE;
+        return false;
+    }
+
+    if (used > rc.limit) {
+        std::cerr << "Fail: " << what << " of " << used << " " << unit
+                  << " exceeds the limit of " << rc.limit << " " << unit
+                  << "\n";
+        return false;
+    }
+    return true;
+}
+
+static
+bool
+run_resource_checks(const std::vector< resource_check >& checks,
+                    const atf::check::check_result& result)
+{
+    bool ok = true;
+
+    for (std::vector< resource_check >::const_iterator iter = checks.begin();
+         iter != checks.end(); iter++) {
+         ok &= run_resource_check(*iter, result);
     }
 
     return ok;
@@ -781,12 +1871,20 @@ run_output_checks(const std::vector< output_check >& checks,
 namespace {
 
 class atf_check : public atf::application::app {
+    bool m_bflag;
+    bool m_checks_given;
     bool m_rflag;
+    bool m_vflag;
     bool m_xflag;
 
     useconds_t m_timo;
     useconds_t m_interval;
 
+    std::string m_manifest;
+    unsigned int m_jobs;
+
+    std::vector< wait_condition > m_wait_conditions;
+    std::vector< resource_check > m_resource_checks;
     std::vector< status_check > m_status_checks;
     std::vector< output_check > m_stdout_checks;
     std::vector< output_check > m_stderr_checks;
@@ -801,6 +1899,8 @@ class atf_check : public atf::application::app {
     void process_option(int, const char*);
     void process_option_s(const std::string&);
 
+    int run_batch(void);
+
 public:
     atf_check(void);
     int main(void);
@@ -813,8 +1913,12 @@ const char* atf_check::m_description =
 
 atf_check::atf_check(void) :
     app(m_description, "atf-check(1)"),
+    m_bflag(false),
+    m_checks_given(false),
     m_rflag(false),
-    m_xflag(false)
+    m_vflag(false),
+    m_xflag(false),
+    m_jobs(0)
 {
 }
 
@@ -839,7 +1943,7 @@ std::string
 atf_check::specific_args(void)
     const
 {
-    return "<command>";
+    return "<command> | -b <manifest>";
 }
 
 atf_check::options_set
@@ -849,16 +1953,30 @@ atf_check::specific_options(void)
     using atf::application::option;
     options_set opts;
 
+    opts.insert(option('b', "manifest", "Run the checks listed in the "
+                "manifest, one per line, instead of a single command"));
+    opts.insert(option('j', "jobs", "Number of manifest entries to run "
+                "concurrently (default: number of CPUs)"));
     opts.insert(option('s', "qual:value", "Handle status. Qualifier "
                 "must be one of: ignore exit:<num> signal:<name|num>"));
     opts.insert(option('o', "action:arg", "Handle stdout. Action must be "
                 "one of: empty ignore file:<path> inline:<val> match:regexp "
-                "save:<path>"));
+                "save:<path>, or a filter: skip:regexp sort squeeze "
+                "sub:/regexp/replacement/"));
     opts.insert(option('e', "action:arg", "Handle stderr. Action must be "
                 "one of: empty ignore file:<path> inline:<val> match:regexp "
-                "save:<path>"));
+                "save:<path>, or a filter: skip:regexp sort squeeze "
+                "sub:/regexp/replacement/"));
+    opts.insert(option('m', "max-rss:<KiB>", "Fail if the command's maximum "
+                "resident set size exceeds the given limit"));
     opts.insert(option('r', "timeout[:interval]", "Repeat failed check until "
                 "the timeout expires."));
+    opts.insert(option('t', "qual:<ms>", "Fail if the command takes too "
+                "long. Qualifier must be one of: max-cpu max-time"));
+    opts.insert(option('v', "", "Print the resources used by the command"));
+    opts.insert(option('w', "cond:arg", "Wait for a condition before running "
+                "the command. Condition must be one of: exists:<path> "
+                "match:<path>:<regexp> socket:<path>"));
     opts.insert(option('x', "", "Execute command as a shell command"));
 
     return opts;
@@ -867,7 +1985,19 @@ atf_check::specific_options(void)
 void
 atf_check::process_option(int ch, const char* arg)
 {
+    if (ch != 'b' && ch != 'j')
+        m_checks_given = true;
+
     switch (ch) {
+    case 'b':
+        m_bflag = true;
+        m_manifest = arg;
+        break;
+
+    case 'j':
+        m_jobs = parse_jobs_arg(arg);
+        break;
+
     case 's':
         m_status_checks.push_back(parse_status_check_arg(arg));
         break;
@@ -880,11 +2010,24 @@ atf_check::process_option(int ch, const char* arg)
         m_stderr_checks.push_back(parse_output_check_arg(arg));
         break;
 
+    case 'm':
+    case 't':
+        m_resource_checks.push_back(parse_resource_check_arg(arg, ch));
+        break;
+
     case 'r':
         m_rflag = true;
         parse_repeat_check_arg(arg, &m_timo, &m_interval);
         break;
 
+    case 'v':
+        m_vflag = true;
+        break;
+
+    case 'w':
+        m_wait_conditions.push_back(parse_wait_condition_arg(arg));
+        break;
+
     case 'x':
         m_xflag = true;
         break;
@@ -894,9 +2037,126 @@ atf_check::process_option(int ch, const char* arg)
     }
 }
 
+int
+atf_check::run_batch(void)
+{
+    const std::vector< batch_entry > entries = read_manifest(m_manifest);
+
+    unsigned int jobs = m_jobs;
+    if (jobs == 0) {
+        const long ncpus = ::sysconf(_SC_NPROCESSORS_ONLN);
+        jobs = ncpus > 0 ? static_cast< unsigned int >(ncpus) : 1;
+    }
+
+    // Each entry runs in a child process that captures its output to a
+    // file so that the reports can be printed in manifest order.
+    std::vector< temp_file* > outputs(entries.size(), NULL);
+    std::vector< pid_t > pids(entries.size(), -1);
+    std::vector< int > statuses(entries.size(), -1);
+    size_t next_start = 0, next_report = 0, running = 0, failed = 0;
+
+    try {
+        while (next_report < entries.size()) {
+            while (running < jobs && next_start < entries.size()) {
+                const batch_entry& entry = entries[next_start];
+                outputs[next_start] = new temp_file("atf-check.XXXXXX");
+                outputs[next_start]->close();
+
+                std::cout.flush();
+                std::cerr.flush();
+                const pid_t pid = ::fork();
+                if (pid == -1)
+                    throw atf::system_error("atf_check::run_batch",
+                                            "fork(2) failed", errno);
+                else if (pid == 0) {
+                    const int fd = ::open(
+                        outputs[next_start]->get_path().c_str(),
+                        O_WRONLY | O_TRUNC);
+                    if (fd == -1 || ::dup2(fd, STDOUT_FILENO) == -1 ||
+                        ::dup2(fd, STDERR_FILENO) == -1)
+                        ::_exit(EXIT_FAILURE);
+                    ::close(fd);
+
+                    std::vector< char* > argv;
+                    argv.push_back(const_cast< char* >("atf-check"));
+                    for (std::vector< std::string >::const_iterator iter =
+                         entry.args.begin(); iter != entry.args.end(); ++iter)
+                        argv.push_back(const_cast< char* >(iter->c_str()));
+                    argv.push_back(NULL);
+
+                    const int exitcode = atf_check().run(argv.size() - 1,
+                                                         &argv[0]);
+                    std::cout.flush();
+                    std::cerr.flush();
+                    ::_exit(exitcode);
+                }
+                pids[next_start++] = pid;
+                running++;
+            }
+
+            int status;
+            const pid_t pid = ::waitpid(-1, &status, 0);
+            if (pid == -1) {
+                if (errno == EINTR)
+                    continue;
+                throw atf::system_error("atf_check::run_batch",
+                                        "waitpid(2) failed", errno);
+            }
+            const std::vector< pid_t >::iterator iter =
+                std::find(pids.begin(), pids.end(), pid);
+            if (iter == pids.end())
+                continue;
+            statuses[iter - pids.begin()] = status;
+            *iter = -1;
+            running--;
+
+            for (; next_report < next_start && statuses[next_report] != -1;
+                 next_report++) {
+                const bool ok = WIFEXITED(statuses[next_report]) &&
+                    WEXITSTATUS(statuses[next_report]) == EXIT_SUCCESS;
+                if (!ok)
+                    failed++;
+
+                cat_file(outputs[next_report]->get_path(), std::cout);
+                std::cout << "Entry at line " << entries[next_report].line
+                          << ": " << (ok ? "passed" : "failed") << "\n";
+                std::cout.flush();
+
+                delete outputs[next_report];
+                outputs[next_report] = NULL;
+            }
+        }
+    } catch (...) {
+        for (size_t i = 0; i < entries.size(); i++) {
+            if (pids[i] != -1)
+                ::waitpid(pids[i], NULL, 0);
+            delete outputs[i];
+        }
+        throw;
+    }
+
+    if (failed > 0) {
+        std::cerr << "Fail: " << failed << " of " << entries.size()
+                  << " manifest entries failed\n";
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
 int
 atf_check::main(void)
 {
+    if (m_bflag) {
+        if (m_argc > 0)
+            throw atf::application::usage_error("Cannot specify a command "
+                                                "with -b");
+        if (m_checks_given)
+            throw atf::application::usage_error("Checks must be given in "
+                                                "the manifest with -b");
+        return run_batch();
+    } else if (m_jobs != 0)
+        throw atf::application::usage_error("-j can only be used with -b");
+
     if (m_argc < 1)
         throw atf::application::usage_error("No command specified");
 
@@ -909,18 +2169,35 @@ atf_check::main(void)
         throw atf::application::usage_error("Cannot specify -s more than once");
     }
 
-    if (m_stdout_checks.empty())
+    if (!has_checks(m_stdout_checks))
         m_stdout_checks.push_back(output_check(oc_empty, false, ""));
-    if (m_stderr_checks.empty())
+    if (!has_checks(m_stderr_checks))
         m_stderr_checks.push_back(output_check(oc_empty, false, ""));
 
+    // Wait conditions share the deadline given to -r, if any; otherwise
+    // they must hold right away.
+    const useconds_t deadline = m_rflag ? m_timo : get_monotonic_useconds();
+    for (std::vector< wait_condition >::const_iterator iter =
+         m_wait_conditions.begin(); iter != m_wait_conditions.end(); ++iter) {
+        if (!wait_for_condition(*iter, deadline))
+            return EXIT_FAILURE;
+    }
+
+    const atf::check::capture out = plan_capture(m_stdout_checks);
+    const atf::check::capture err = plan_capture(m_stderr_checks);
+
     do {
         std::auto_ptr< atf::check::check_result > r =
-            m_xflag ? execute_with_shell(m_argv) : execute(m_argv);
+            m_xflag ? execute_with_shell(m_argv, out, err) :
+                      execute(m_argv, out, err);
+
+        if (m_vflag)
+            print_resources(*r);
 
         if ((run_status_checks(m_status_checks, *r) == false) ||
             (run_output_checks(*r, "stderr") == false) ||
-            (run_output_checks(*r, "stdout") == false))
+            (run_output_checks(*r, "stdout") == false) ||
+            (run_resource_checks(m_resource_checks, *r) == false))
             status = EXIT_FAILURE;
         else
             status = EXIT_SUCCESS;
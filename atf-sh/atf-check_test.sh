@@ -196,6 +196,31 @@ oflag_file_body()
     h_pass "cat bin" -o file:bin
 }
 
+atf_test_case oflag_file_gzip
+oflag_file_gzip_head()
+{
+    atf_set "descr" "Tests for the -o option using compressed golden files"
+    atf_set "require.progs" "gzip"
+}
+oflag_file_gzip_body()
+{
+    if ! ${Atf_Check} -o save:probe.gz true >/dev/null 2>&1; then
+        atf_skip "atf-check was built without zlib support"
+    fi
+
+    printf 'line 1\nline 2\n' | gzip -c >golden.gz
+    h_pass "printf 'line 1\nline 2\n'" -o file:golden.gz
+    h_pass "printf 'line   1\nline 2\n'" -o squeeze -o file:golden.gz
+    h_fail "printf 'line 1\n'" -o file:golden.gz
+    grep '^-line 2$' tmp >/dev/null || \
+        atf_fail "atf-check did not show the decompressed golden file"
+    h_fail "printf 'line 1\nline 2\n'" -o not-file:golden.gz
+
+    h_pass "echo foo" -o save:out.gz
+    test "$(gzip -dc out.gz)" = foo || atf_fail "Saved output not compressed"
+    h_pass "echo foo" -o file:out.gz
+}
+
 atf_test_case oflag_inline
 oflag_inline_head()
 {
@@ -267,6 +292,49 @@ oflag_negated_body()
     h_fail "echo foo bar" -o not-match:foo
 }
 
+atf_test_case oflag_filters
+oflag_filters_head()
+{
+    atf_set "descr" "Tests for the -o option using output filters"
+}
+oflag_filters_body()
+{
+    h_pass "echo pid 1234 at 0xdeadbeef" \
+        -o "sub:/[0-9]+|0x[0-9a-f]+/N/" -o inline:"pid N at N\n"
+    h_pass "echo '(ab)'" -o 'sub:|\((.*)\)|[\1]|' -o 'sub:/a/&&/' \
+        -o inline:"[aab]\n"
+    h_pass "printf 'c\nb\na\n'" -o sort -o inline:"a\nb\nc\n"
+    h_pass "printf '  a \t b   c  \n'" -o squeeze -o inline:"a b c\n"
+    h_pass "printf '# x\nfoo\n# y\n'" -o skip:'^#' -o inline:"foo\n"
+    h_pass "echo '# only a comment'" -o skip:'^#'
+    h_pass "printf 'no-newline'" -o squeeze -o inline:"no-newline\n"
+
+    printf 'a 1\nb 2\n' >golden
+    h_pass "printf 'b   2\na  1\n'" -o squeeze -o sort -o file:golden
+    h_fail "printf 'b   2\na  1\n'" -o squeeze -o file:golden
+    grep '^+a 1$' tmp >/dev/null || \
+        atf_fail "atf-check did not show the filtered output"
+
+    # Filters apply in order, before and after sorting.
+    h_pass "printf 'b\na\n'" -o sort -o sub:/a/z/ -o inline:"z\nb\n"
+    h_pass "printf 'b\na\n'" -o sub:/a/z/ -o sort -o inline:"b\nz\n"
+    h_pass "printf 'c\nb\na\n'" -o sort -o sub:/^a/z/ -o sort \
+        -o skip:b -o inline:"c\nz\n"
+
+    h_pass "echo foo 123" -o sub:/[0-9]+/N/ -o match:'^foo N$'
+    h_fail "echo foo 123" -o sub:/[0-9]+/N/ -o match:123
+
+    h_pass "echo 'x  y'" -o squeeze -o save:out
+    echo "x y" >exp
+    cmp -s out exp || atf_fail "Saved output was not filtered"
+
+    h_fail "true" -o sub:/a/b
+    h_fail "true" -o sub:/a/b/c/
+    h_fail "true" -o sort:foo
+    h_fail "true" -o not-squeeze
+    h_fail "true" -o skip:
+}
+
 atf_test_case eflag_empty
 eflag_empty_head()
 {
@@ -378,6 +446,224 @@ eflag_negated_body()
     h_fail "echo foo bar 1>&2" -e not-match:foo
 }
 
+atf_test_case wflag_exists
+wflag_exists_head()
+{
+    atf_set "descr" "Tests for the -w option using the 'exists' condition"
+}
+wflag_exists_body()
+{
+    touch present
+    h_pass "true" -o ignore -w exists:present
+
+    ( sleep 1; touch created ) &
+    h_pass "true" -o ignore -w exists:created -r 10
+    wait
+
+    h_fail "true" -w exists:missing
+    h_fail "true" -w exists:missing -r 1
+    grep "timed out waiting for file missing to exist" tmp >/dev/null || \
+        atf_fail "atf-check did not report the unmet condition"
+}
+
+atf_test_case wflag_match
+wflag_match_head()
+{
+    atf_set "descr" "Tests for the -w option using the 'match' condition"
+}
+wflag_match_body()
+{
+    echo "starting" >log
+    ( sleep 1; echo "listening on port 1234" >>log ) &
+    h_pass "true" -o ignore -w "match:log:listening on port [0-9]+" -r 10
+    wait
+
+    h_fail "true" -w "match:log:shutting down" -r 1
+    grep "timed out waiting for regexp shutting down to be in log" tmp \
+        >/dev/null || atf_fail "atf-check did not report the unmet condition"
+}
+
+atf_test_case wflag_socket
+wflag_socket_head()
+{
+    atf_set "descr" "Tests for the -w option using the 'socket' condition"
+}
+wflag_socket_body()
+{
+    h_fail "true" -w socket:missing -r 1
+    touch not-a-socket
+    h_fail "true" -w socket:not-a-socket
+    grep "timed out waiting for socket not-a-socket to accept connections" \
+        tmp >/dev/null || atf_fail "atf-check did not report the unmet" \
+                                   "condition"
+}
+
+atf_test_case wflag_invalid
+wflag_invalid_head()
+{
+    atf_set "descr" "Tests for the -w option with invalid conditions"
+}
+wflag_invalid_body()
+{
+    h_fail "true" -w exists
+    h_fail "true" -w exists:
+    h_fail "true" -w match:log
+    h_fail "true" -w unknown:foo
+}
+
+atf_test_case tflag
+tflag_head()
+{
+    atf_set "descr" "Tests for the -t option"
+}
+tflag_body()
+{
+    h_pass "true" -t max-time:10000
+    h_pass "true" -t max-cpu:10000
+
+    h_fail "sleep 1" -t max-time:100
+    grep "Fail: wall time of [0-9]* ms exceeds the limit of 100 ms" tmp \
+        >/dev/null || atf_fail "atf-check did not report the wall time"
+
+    h_fail "true" -t max-time
+    h_fail "true" -t max-time:abc
+    h_fail "true" -t max-rss:100
+}
+
+atf_test_case mflag
+mflag_head()
+{
+    atf_set "descr" "Tests for the -m option"
+}
+mflag_body()
+{
+    h_pass "true" -m max-rss:10000000
+
+    h_fail "true" -m max-rss:0
+    grep "Fail: maximum resident set size of [0-9]* KiB exceeds the limit" \
+        tmp >/dev/null || atf_fail "atf-check did not report the max RSS"
+
+    h_fail "true" -m max-rss:-1
+    h_fail "true" -m max-time:100
+}
+
+atf_test_case vflag
+vflag_head()
+{
+    atf_set "descr" "Tests for the -v option"
+}
+vflag_body()
+{
+    atf_check -s eq:0 -o ignore \
+        -e match:"^Resources: wall time [0-9.]* ms, user time [0-9.]* ms, system time [0-9.]* ms, max RSS [0-9]* KiB$" \
+        ${Atf_Check} -v true
+}
+
+atf_test_case bflag
+bflag_head()
+{
+    atf_set "descr" "Tests for the -b option"
+}
+bflag_body()
+{
+    cat >manifest <<EOF
+# Comments and blank lines are ignored.
+
+-o inline:"a b\\n" echo "a b"
+-s exit:1 false
+-o match:second \\
+    -x 'echo second'
+EOF
+    atf_check -s eq:0 -o save:stdout -e empty ${Atf_Check} -b manifest
+    cat >expout <<EOF
+Entry at line 3: passed
+Entry at line 4: passed
+Entry at line 5: passed
+EOF
+    atf_check -o file:expout grep '^Entry' stdout
+
+    echo '-o inline:"foo\\n" echo bar' >>manifest
+    atf_check -s eq:1 -o save:stdout -e save:stderr ${Atf_Check} -b manifest
+    atf_check -o ignore grep 'Entry at line 7: failed' stdout
+    atf_check -o ignore grep 'stdout does not match expected value' stdout
+    atf_check -o ignore grep 'Fail: 1 of 4 manifest entries failed' stderr
+}
+
+atf_test_case bflag_concurrent
+bflag_concurrent_head()
+{
+    atf_set "descr" "Tests that -b runs the manifest entries concurrently"
+}
+bflag_concurrent_body()
+{
+    for i in 1 2 3 4; do
+        echo "-x 'sleep 1; touch done.${i}'" >>manifest
+    done
+    # Running the entries one after the other would take 4 seconds.
+    atf_check -o ignore -t max-time:3500 ${Atf_Check} -b manifest -j 4
+    for i in 1 2 3 4; do
+        test -f done.${i} || atf_fail "Entry ${i} did not run"
+    done
+}
+
+atf_test_case bflag_invalid
+bflag_invalid_head()
+{
+    atf_set "descr" "Tests for the -b option with invalid arguments"
+}
+bflag_invalid_body()
+{
+    echo "true" >manifest
+    h_fail "true" -b manifest
+    atf_check -s eq:1 -o empty -e ignore ${Atf_Check} -b manifest -s exit:0
+    atf_check -s eq:1 -o empty -e ignore ${Atf_Check} -j 2 true
+    atf_check -s eq:1 -o empty -e ignore ${Atf_Check} -b manifest -j 0
+    atf_check -s eq:1 -o empty -e match:"Failed to open manifest missing" \
+        ${Atf_Check} -b missing
+
+    echo "echo 'unterminated" >manifest
+    atf_check -s eq:1 -o empty -e match:"manifest:1: Unterminated quote" \
+        ${Atf_Check} -b manifest
+}
+
+atf_test_case capture_plan
+capture_plan_head()
+{
+    atf_set "descr" "Tests that the output is only stored when the checks" \
+            "need it"
+}
+capture_plan_body()
+{
+    [ -e /dev/fd/1 ] || atf_skip "/dev/fd is not available"
+
+    h_pass '[ -c /dev/fd/1 ] && [ -c /dev/fd/2 ]' -o ignore -e ignore
+    h_pass '[ -p /dev/fd/1 ] && [ -p /dev/fd/2 ]' -o empty -e empty
+    h_pass '[ -f /dev/fd/1 ] && echo foo' -o match:foo
+    h_pass '[ -f /dev/fd/1 ] && echo foo' -o match:foo -o save:out
+    h_pass '[ -f /dev/fd/1 ] && echo foo' -o save:out
+    echo foo >exp
+    cmp -s out exp || atf_fail "Saved output does not match expected results"
+}
+
+atf_test_case capture_probe
+capture_probe_head()
+{
+    atf_set "descr" "Tests that the 'empty' check only keeps the beginning" \
+            "of the output and does not wait for background processes"
+    atf_set "timeout" "20"
+}
+capture_probe_body()
+{
+    h_fail 'i=0; while [ $i -lt 10000 ]; do echo y; i=$((i + 1)); done' \
+        -o empty
+    lines=$(grep -c '^+y$' tmp)
+    [ "${lines}" -gt 0 -a "${lines}" -lt 10000 ] || \
+        atf_fail "Expected a prefix of the output but got ${lines} lines"
+
+    h_fail 'echo foo; sleep 60 &' -o empty
+    grep '^+foo$' tmp >/dev/null || atf_fail "Output not shown"
+}
+
 atf_test_case stdin
 stdin_head()
 {
@@ -418,11 +704,13 @@ atf_init_test_cases()
     atf_add_test_case oflag_empty
     atf_add_test_case oflag_ignore
     atf_add_test_case oflag_file
+    atf_add_test_case oflag_file_gzip
     atf_add_test_case oflag_inline
     atf_add_test_case oflag_match
     atf_add_test_case oflag_save
     atf_add_test_case oflag_multiple
     atf_add_test_case oflag_negated
+    atf_add_test_case oflag_filters
 
     atf_add_test_case eflag_empty
     atf_add_test_case eflag_ignore
@@ -433,6 +721,22 @@ atf_init_test_cases()
     atf_add_test_case eflag_multiple
     atf_add_test_case eflag_negated
 
+    atf_add_test_case wflag_exists
+    atf_add_test_case wflag_match
+    atf_add_test_case wflag_socket
+    atf_add_test_case wflag_invalid
+
+    atf_add_test_case tflag
+    atf_add_test_case mflag
+    atf_add_test_case vflag
+
+    atf_add_test_case bflag
+    atf_add_test_case bflag_concurrent
+    atf_add_test_case bflag_invalid
+
+    atf_add_test_case capture_plan
+    atf_add_test_case capture_probe
+
     atf_add_test_case stdin
 
     atf_add_test_case invalid_umask
@@ -25,17 +25,24 @@
 
 extern "C" {
 #include <unistd.h>
+
+#include "atf-c/detail/ns.h"
+#include "atf-c/error.h"
 }
 
 #include <cerrno>
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
+#include <stdexcept>
+#include <vector>
 
 #include "atf-c++/detail/application.hpp"
 #include "atf-c++/detail/env.hpp"
+#include "atf-c++/detail/exceptions.hpp"
 #include "atf-c++/detail/fs.hpp"
 #include "atf-c++/detail/sanity.hpp"
+#include "atf-c++/detail/text.hpp"
 
 // ------------------------------------------------------------------------
 // Auxiliary functions.
@@ -99,6 +106,61 @@ construct_argv(const std::string& shell, const int interpreter_argc,
     return argv;
 }
 
+//!
+//! \brief Moves the process into new namespaces if libatf-sh.subr asked to.
+//!
+//! The test program sets __ATF_SH_ISOLATE to a colon-separated list of the
+//! directories to keep visible when one of its test cases requests namespace
+//! isolation, and then executes itself again.  The shell and the files of
+//! atf-sh are kept visible too, as they may live under /tmp.
+//!
+static
+void
+isolate(const atf::fs::path& shell)
+{
+    std::vector< std::string > dirs = atf::text::split(
+        atf::env::get("__ATF_SH_ISOLATE"), ":");
+    atf::env::unset("__ATF_SH_ISOLATE");
+
+    const std::string pkgdatadir = atf::env::get("ATF_PKGDATADIR",
+                                                 ATF_PKGDATADIR);
+    dirs.push_back(atf::env::get("ATF_LIBEXECDIR", ATF_LIBEXECDIR));
+    dirs.push_back(pkgdatadir);
+    dirs.push_back(shell.branch_path().str());
+
+    std::vector< const char* > keep;
+    for (std::vector< std::string >::const_iterator iter = dirs.begin();
+         iter != dirs.end(); iter++)
+        keep.push_back((*iter).c_str());
+    keep.push_back(NULL);
+
+    bool entered;
+    atf_error_t err = atf_ns_enter(&keep[0], &entered);
+    if (atf_is_error(err)) {
+        if (entered)
+            atf::throw_atf_error(err);
+
+        char buf[1024];
+        atf_error_format(err, buf, sizeof(buf));
+        atf_error_free(err);
+        std::cerr << "*** Namespace isolation skipped: " << buf << "\n";
+    }
+
+    // The namespaces only keep a limited number of directories visible;
+    // rather than running a shell that cannot load atf-sh, bail out.
+    const atf::fs::path subr = atf::fs::path(pkgdatadir) / "libatf-sh.subr";
+    if (!atf::fs::exists(shell))
+        throw std::runtime_error("Cannot isolate the test case: " +
+                                 shell.str() + " is not visible in the new "
+                                 "namespaces");
+    if (!atf::fs::exists(subr))
+        throw std::runtime_error("Cannot isolate the test case: " +
+                                 subr.str() + " is not visible in the new "
+                                 "namespaces");
+
+    atf::env::set("__ATF_SH_ISOLATED", "yes");
+}
+
 } // anonymous namespace
 
 // ------------------------------------------------------------------------
@@ -167,6 +229,9 @@ atf_sh::main(void)
         throw std::runtime_error("The test program '" + script.str() + "' "
                                  "does not exist");
 
+    if (atf::env::has("__ATF_SH_ISOLATE"))
+        isolate(m_shell);
+
     const char** argv = construct_argv(m_shell.str(), m_argc, m_argv);
     // Don't bother keeping track of the memory allocated by construct_argv:
     // we are going to exec or die immediately.
@@ -0,0 +1,58 @@
+# Copyright (c) 2026 The NetBSD Foundation, Inc.
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+# 1. Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+# 2. Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#
+# THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+# CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+# INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+# IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+# DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+# DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+# GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+# INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+# IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+# OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+# IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+# -------------------------------------------------------------------------
+# A test program with thousands of test cases, used to verify that finding
+# and running one of them does not depend on how many there are.
+# -------------------------------------------------------------------------
+
+Num_Tcs=5000
+
+atf_test_case tc_cleanup cleanup
+tc_cleanup_body()
+{
+    touch "${Control_Dir}/body"
+}
+tc_cleanup_cleanup()
+{
+    touch "${Control_Dir}/cleanup"
+}
+
+atf_init_test_cases()
+{
+    i=0
+    while [ ${i} -lt ${Num_Tcs} ]; do
+        atf_test_case tc_${i}
+        eval "tc_${i}_head() { atf_set descr 'Test case ${i}'; }"
+        eval "tc_${i}_body() { :; }"
+        atf_add_test_case tc_${i}
+        i=$((${i} + 1))
+    done
+
+    Control_Dir=$(atf_config_get controldir .)
+    atf_add_test_case tc_cleanup
+}
+
+# vim: syntax=sh:expandtab:shiftwidth=4:softtabstop=4
@@ -297,6 +297,29 @@ tc_missing_body_head()
     atf_set "descr" "Helper test case for the t_tc test program"
 }
 
+atf_test_case tc_isolation_namespace
+tc_isolation_namespace_head()
+{
+    atf_set "descr" "Helper test case for the t_tc test program"
+    atf_set "X-atf.isolation" "namespace"
+}
+tc_isolation_namespace_body()
+{
+    touch /tmp/atf-isolation.$$ || atf_fail "Cannot write to /tmp"
+    echo /tmp/atf-isolation.$$ >probe
+}
+
+atf_test_case tc_isolation_invalid
+tc_isolation_invalid_head()
+{
+    atf_set "descr" "Helper test case for the t_tc test program"
+    atf_set "X-atf.isolation" "chroot"
+}
+tc_isolation_invalid_body()
+{
+    true
+}
+
 # -------------------------------------------------------------------------
 # Helper tests for "t_tp".
 # -------------------------------------------------------------------------
@@ -348,6 +371,8 @@ atf_init_test_cases()
     atf_add_test_case tc_pass_return_error
     atf_add_test_case tc_fail
     atf_add_test_case tc_missing_body
+    atf_add_test_case tc_isolation_namespace
+    atf_add_test_case tc_isolation_invalid
 
     # Add helper tests for t_tp.
     [ -f $(atf_get_srcdir)/subrs ] && . $(atf_get_srcdir)/subrs
@@ -51,10 +51,75 @@ missing_body_body()
     atf_check -s eq:1 -o ignore -e ignore ${h} tc_missing_body
 }
 
+atf_test_case isolation_namespace
+isolation_namespace_head()
+{
+    atf_set "descr" "Verifies that test cases requesting namespace" \
+                    "isolation get a private /tmp"
+}
+isolation_namespace_body()
+{
+    h="$(atf_get_srcdir)/misc_helpers -s $(atf_get_srcdir)"
+    atf_check -s eq:0 -o ignore -e save:stderr ${h} tc_isolation_namespace
+    if grep '^\*\*\* Namespace isolation skipped' stderr >/dev/null; then
+        atf_skip "Namespaces are not available"
+    fi
+    atf_check -s eq:0 -o match:'^/tmp/atf-isolation\.' cat probe
+    atf_check -s eq:1 test -f "$(cat probe)"
+}
+
+atf_test_case isolation_invalid
+isolation_invalid_head()
+{
+    atf_set "descr" "Verifies that invalid values of X-atf.isolation" \
+                    "are reported as failures"
+}
+isolation_invalid_body()
+{
+    h="$(atf_get_srcdir)/misc_helpers -s $(atf_get_srcdir)"
+    atf_check -s eq:1 -o match:'failed:.*isolation must be none or namespace' \
+        -e ignore ${h} tc_isolation_invalid
+}
+
+atf_test_case many_test_cases
+many_test_cases_head()
+{
+    atf_set "descr" "Verifies that test programs with thousands of test" \
+                    "cases can find and run any of them"
+}
+many_test_cases_body()
+{
+    h="$(atf_get_srcdir)/many_tcs_helpers -s $(atf_get_srcdir)"
+
+    atf_check -s eq:0 -o save:list -e ignore ${h} -l
+    atf_check -s eq:0 -o inline:'5001\n' -x "grep -c '^ident: ' list"
+
+    for tc in tc_0 tc_2500 tc_4999; do
+        start=$(date +%s)
+        atf_check -s eq:0 -o match:'^passed$' -e ignore \
+            ${h} -r /dev/stdout ${tc}
+        echo "Running ${tc} took $(($(date +%s) - ${start})) seconds"
+    done
+
+    atf_check -s eq:1 -o empty -e match:"Unknown test case .tc_5000'" \
+        ${h} tc_5000
+    atf_check -s eq:1 -o empty -e match:'Unknown test case' ${h} 'tc_;true'
+
+    atf_check -s eq:0 -o ignore -e ignore ${h} -v controldir=$(pwd) \
+        tc_cleanup:body
+    atf_check -s eq:0 -o ignore -e ignore ${h} -v controldir=$(pwd) \
+        tc_cleanup:cleanup
+    test -f body || atf_fail "The body of tc_cleanup did not run"
+    test -f cleanup || atf_fail "The cleanup of tc_cleanup did not run"
+}
+
 atf_init_test_cases()
 {
     atf_add_test_case default_status
     atf_add_test_case missing_body
+    atf_add_test_case isolation_namespace
+    atf_add_test_case isolation_invalid
+    atf_add_test_case many_test_cases
 }
 
 # vim: syntax=sh:expandtab:shiftwidth=4:softtabstop=4
@@ -0,0 +1,87 @@
+dnl Copyright (c) 2026 The NetBSD Foundation, Inc.
+dnl All rights reserved.
+dnl
+dnl Redistribution and use in source and binary forms, with or without
+dnl modification, are permitted provided that the following conditions
+dnl are met:
+dnl 1. Redistributions of source code must retain the above copyright
+dnl    notice, this list of conditions and the following disclaimer.
+dnl 2. Redistributions in binary form must reproduce the above copyright
+dnl    notice, this list of conditions and the following disclaimer in the
+dnl    documentation and/or other materials provided with the distribution.
+dnl
+dnl THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+dnl CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+dnl INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+dnl MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+dnl IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+dnl DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+dnl DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+dnl GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+dnl INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+dnl IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+dnl OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+dnl IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+dnl
+dnl ATF_MODULE_ALLOC
+dnl
+dnl Checks for the features needed to build the libatf-c-alloc interposer,
+dnl which wraps the system allocator to count allocations done by test
+dnl cases.  The interposer is only built when the system provides a way to
+dnl look up the next definition of a symbol and to query the usable size
+dnl of an allocated block; otherwise, the allocation assertions in libatf-c
+dnl report that tracking is not available.
+dnl
+AC_DEFUN([ATF_MODULE_ALLOC], [
+    AC_CHECK_HEADERS([dlfcn.h malloc.h malloc_np.h])
+    AC_SEARCH_LIBS([dlsym], [dl])
+    AC_CHECK_FUNCS([memalign pvalloc reallocarray])
+
+    AC_CACHE_CHECK(
+        [whether the allocator can be interposed],
+        [atf_cv_alloc_interposable], [
+        AC_LANG_PUSH([C])
+        AC_LINK_IFELSE(
+            [AC_LANG_PROGRAM([#define _GNU_SOURCE
+#include <dlfcn.h>
+#include <stdlib.h>
+#if defined(HAVE_MALLOC_NP_H)
+#   include <malloc_np.h>
+#elif defined(HAVE_MALLOC_H)
+#   include <malloc.h>
+#endif], [
+         void *p = dlsym(RTLD_NEXT, "malloc");
+         return (int)malloc_usable_size(p);
+         ])],
+         [atf_cv_alloc_interposable=yes],
+         [atf_cv_alloc_interposable=no])
+        AC_LANG_POP([C])
+    ])
+    if test x"${atf_cv_alloc_interposable}" = xyes; then
+        AC_DEFINE([HAVE_ALLOC_INTERPOSER], [1],
+                  [Define to 1 if libatf-c-alloc can be built])
+    fi
+
+    dnl Programs that link against libatf-c-alloc do not reference any of
+    dnl its symbols directly (e.g. C++ code only calls operator new), so the
+    dnl linker must be told to keep the dependency.
+    AC_CACHE_CHECK(
+        [whether the linker accepts --no-as-needed],
+        [atf_cv_ld_no_as_needed], [
+        atf_save_LDFLAGS="${LDFLAGS}"
+        LDFLAGS="${LDFLAGS} -Wl,--no-as-needed"
+        AC_LINK_IFELSE(
+            [AC_LANG_PROGRAM([], [])],
+            [atf_cv_ld_no_as_needed=yes],
+            [atf_cv_ld_no_as_needed=no])
+        LDFLAGS="${atf_save_LDFLAGS}"
+    ])
+    ATF_ALLOC_LDFLAGS=
+    if test x"${atf_cv_ld_no_as_needed}" = xyes; then
+        ATF_ALLOC_LDFLAGS="-Wl,--no-as-needed"
+    fi
+    AC_SUBST([ATF_ALLOC_LDFLAGS])
+    AM_CONDITIONAL([ENABLE_ALLOC_INTERPOSER],
+                   [test x"${atf_cv_alloc_interposable}" = xyes])
+])
@@ -24,6 +24,14 @@ dnl OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
 dnl IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 AC_DEFUN([ATF_MODULE_FS], [
+    dnl Used by atf-check to wait for changes to files without polling.
+    AC_CHECK_HEADERS([sys/inotify.h])
+
+    dnl Used by atf-watch to tell apart changes made within the same second
+    dnl when it has to scan directories.
+    AC_CHECK_MEMBERS([struct stat.st_mtim, struct stat.st_mtimespec], [], [],
+                     [#include <sys/stat.h>])
+
     AC_MSG_CHECKING(whether basename takes a constant pointer)
     AC_COMPILE_IFELSE(
         [AC_LANG_PROGRAM([#include <libgen.h>], [
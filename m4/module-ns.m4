@@ -0,0 +1,57 @@
+dnl Copyright (c) 2026 The NetBSD Foundation, Inc.
+dnl All rights reserved.
+dnl
+dnl Redistribution and use in source and binary forms, with or without
+dnl modification, are permitted provided that the following conditions
+dnl are met:
+dnl 1. Redistributions of source code must retain the above copyright
+dnl    notice, this list of conditions and the following disclaimer.
+dnl 2. Redistributions in binary form must reproduce the above copyright
+dnl    notice, this list of conditions and the following disclaimer in the
+dnl    documentation and/or other materials provided with the distribution.
+dnl
+dnl THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+dnl CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+dnl INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+dnl MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+dnl IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+dnl DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+dnl DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+dnl GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+dnl INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+dnl IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+dnl OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+dnl IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+dnl
+dnl ATF_MODULE_NS
+dnl
+dnl Checks whether the test cases can be isolated in Linux namespaces,
+dnl which the X-atf.isolation meta-data property relies on.
+dnl
+AC_DEFUN([ATF_MODULE_NS], [
+    AC_CACHE_CHECK(
+        [whether namespaces are supported],
+        [atf_cv_namespaces_supported], [
+        AC_LANG_PUSH([C])
+        AC_LINK_IFELSE(
+            [AC_LANG_PROGRAM([#define _GNU_SOURCE
+#include <sys/ioctl.h>
+#include <sys/mount.h>
+#include <net/if.h>
+#include <sched.h>], [
+         struct ifreq ifr;
+         ifr.ifr_flags = IFF_UP;
+         (void)ioctl(0, SIOCSIFFLAGS, &ifr);
+         (void)mount("tmpfs", "/tmp", "tmpfs", MS_BIND | MS_REC, NULL);
+         return unshare(CLONE_NEWUSER | CLONE_NEWNS | CLONE_NEWNET |
+                        CLONE_NEWUTS | CLONE_NEWIPC);
+         ])],
+         [atf_cv_namespaces_supported=yes],
+         [atf_cv_namespaces_supported=no])
+        AC_LANG_POP([C])
+    ])
+    if test x"${atf_cv_namespaces_supported}" = xyes; then
+        AC_DEFINE([HAVE_NAMESPACES], [1],
+                  [Define to 1 if test cases can run in Linux namespaces])
+    fi
+])
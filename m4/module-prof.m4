@@ -0,0 +1,46 @@
+dnl Copyright (c) 2026 The NetBSD Foundation, Inc.
+dnl All rights reserved.
+dnl
+dnl Redistribution and use in source and binary forms, with or without
+dnl modification, are permitted provided that the following conditions
+dnl are met:
+dnl 1. Redistributions of source code must retain the above copyright
+dnl    notice, this list of conditions and the following disclaimer.
+dnl 2. Redistributions in binary form must reproduce the above copyright
+dnl    notice, this list of conditions and the following disclaimer in the
+dnl    documentation and/or other materials provided with the distribution.
+dnl
+dnl THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+dnl CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+dnl INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+dnl MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+dnl IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+dnl DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+dnl DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+dnl GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+dnl INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+dnl IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+dnl OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+dnl IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+dnl
+dnl ATF_MODULE_PROF
+dnl
+dnl Checks for backtrace(3), which the sampling profiler enabled by the
+dnl profile configuration variable and the X-atf.profile meta-data property
+dnl relies on.  Some systems provide it in libexecinfo.
+dnl
+AC_DEFUN([ATF_MODULE_PROF], [
+    ATF_PROF_LIBS=
+    AC_CHECK_HEADER([execinfo.h], [
+        atf_save_LIBS="${LIBS}"
+        AC_SEARCH_LIBS([backtrace], [execinfo], [
+            test x"${ac_cv_search_backtrace}" = x"none required" || \
+                ATF_PROF_LIBS="${ac_cv_search_backtrace}"
+            AC_DEFINE([HAVE_BACKTRACE], [1],
+                      [Define to 1 if backtrace(3) is available])
+        ])
+        LIBS="${atf_save_LIBS}"
+    ])
+    AC_SUBST([ATF_PROF_LIBS])
+])
@@ -0,0 +1,85 @@
+dnl Copyright (c) 2026 The NetBSD Foundation, Inc.
+dnl All rights reserved.
+dnl
+dnl Redistribution and use in source and binary forms, with or without
+dnl modification, are permitted provided that the following conditions
+dnl are met:
+dnl 1. Redistributions of source code must retain the above copyright
+dnl    notice, this list of conditions and the following disclaimer.
+dnl 2. Redistributions in binary form must reproduce the above copyright
+dnl    notice, this list of conditions and the following disclaimer in the
+dnl    documentation and/or other materials provided with the distribution.
+dnl
+dnl THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+dnl CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+dnl INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+dnl MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+dnl IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+dnl DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+dnl DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+dnl GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+dnl INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+dnl IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+dnl OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+dnl IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+dnl
+dnl ATF_MODULE_STATIC
+dnl
+dnl Checks whether to build libatf-c-static.a and libatf-c++-static.a, the
+dnl static variant of the libraries for test programs that want to skip the
+dnl dynamic loader at startup, and which flags to build them with.  The
+dnl objects are position independent and split into one section per
+dnl function so that the linker can drop the unused parts of the runtime.
+dnl When the compiler supports fat LTO objects, the archives also carry
+dnl the intermediate representation so that test programs built with -flto
+dnl can optimize across the library boundary, while the rest link as usual.
+dnl
+AC_DEFUN([ATF_MODULE_STATIC], [
+    AC_ARG_ENABLE([static-variant],
+                  AS_HELP_STRING([--disable-static-variant],
+                                 [Do not build the static variant of the
+                                  libraries]),
+                  [], [enable_static_variant=yes])
+
+    ATF_STATIC_CFLAGS=
+    ATF_STATIC_CXXFLAGS=
+    ATF_STATIC_LDFLAGS=
+    ATF_STATIC_CXX_LDFLAGS=
+    if test x"${enable_static_variant}" != xno; then
+        AC_LANG_PUSH([C])
+        for f in -fPIC -ffunction-sections -fdata-sections; do
+            KYUA_CC_FLAG(${f}, ATF_STATIC_CFLAGS)
+        done
+        atf_lto_flags=
+        KYUA_CC_FLAG([-flto], atf_lto_flags)
+        KYUA_CC_FLAG([-ffat-lto-objects], atf_lto_flags)
+        if test x"${atf_lto_flags}" = x" -flto -ffat-lto-objects"; then
+            ATF_STATIC_CFLAGS="${ATF_STATIC_CFLAGS}${atf_lto_flags}"
+        fi
+        KYUA_CC_FLAG([-Wl,--gc-sections], ATF_STATIC_LDFLAGS)
+        if test -z "${ATF_STATIC_LDFLAGS}"; then
+            KYUA_CC_FLAG([-Wl,-dead_strip], ATF_STATIC_LDFLAGS)
+        fi
+        AC_LANG_POP([C])
+
+        AC_LANG_PUSH([C++])
+        for f in -fPIC -ffunction-sections -fdata-sections; do
+            KYUA_CXX_FLAG(${f}, ATF_STATIC_CXXFLAGS)
+        done
+        atf_lto_flags=
+        KYUA_CXX_FLAG([-flto], atf_lto_flags)
+        KYUA_CXX_FLAG([-ffat-lto-objects], atf_lto_flags)
+        if test x"${atf_lto_flags}" = x" -flto -ffat-lto-objects"; then
+            ATF_STATIC_CXXFLAGS="${ATF_STATIC_CXXFLAGS}${atf_lto_flags}"
+        fi
+        KYUA_CXX_FLAG([-static-libstdc++], ATF_STATIC_CXX_LDFLAGS)
+        AC_LANG_POP([C++])
+    fi
+    AC_SUBST([ATF_STATIC_CFLAGS])
+    AC_SUBST([ATF_STATIC_CXXFLAGS])
+    AC_SUBST([ATF_STATIC_LDFLAGS])
+    AC_SUBST([ATF_STATIC_CXX_LDFLAGS])
+    AM_CONDITIONAL([ENABLE_STATIC_VARIANT],
+                   [test x"${enable_static_variant}" != xno])
+])
@@ -0,0 +1,69 @@
+dnl Copyright (c) 2026 The NetBSD Foundation, Inc.
+dnl All rights reserved.
+dnl
+dnl Redistribution and use in source and binary forms, with or without
+dnl modification, are permitted provided that the following conditions
+dnl are met:
+dnl 1. Redistributions of source code must retain the above copyright
+dnl    notice, this list of conditions and the following disclaimer.
+dnl 2. Redistributions in binary form must reproduce the above copyright
+dnl    notice, this list of conditions and the following disclaimer in the
+dnl    documentation and/or other materials provided with the distribution.
+dnl
+dnl THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+dnl CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+dnl INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+dnl MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+dnl IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+dnl DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+dnl DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+dnl GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+dnl INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+dnl IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+dnl OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+dnl IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+dnl
+dnl ATF_MODULE_VCLOCK
+dnl
+dnl Checks for the features needed to build the libatf-c-vclock shim, which
+dnl virtualizes the clocks of a test program so that its timed waits
+dnl complete as soon as every thread in the process is waiting.  The shim
+dnl must be built after ATF_MODULE_ALLOC, which locates dlsym(3).
+dnl
+AC_DEFUN([ATF_MODULE_VCLOCK], [
+    dnl Used to locate the test program when it re-executes itself with the
+    dnl shim preloaded and /proc/self/exe is not available.
+    AC_CHECK_FUNCS([getexecname])
+
+    atf_save_LIBS="${LIBS}"
+    AC_SEARCH_LIBS([pthread_create], [pthread])
+    AC_SEARCH_LIBS([clock_gettime], [rt])
+    ATF_VCLOCK_LIBS="${LIBS}"
+    LIBS="${atf_save_LIBS}"
+    AC_SUBST([ATF_VCLOCK_LIBS])
+
+    AC_CACHE_CHECK(
+        [whether the clocks can be virtualized],
+        [atf_cv_vclock_supported], [
+        atf_save_LIBS="${LIBS}"
+        LIBS="${ATF_VCLOCK_LIBS}"
+        AC_LANG_PUSH([C])
+        AC_LINK_IFELSE(
+            [AC_LANG_PROGRAM([#define _GNU_SOURCE
+#include <dlfcn.h>
+#include <pthread.h>
+#include <time.h>], [
+         pthread_condattr_t attr;
+         void *p = dlsym(RTLD_NEXT, "clock_gettime");
+         (void)pthread_condattr_init(&attr);
+         (void)pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+         return p != NULL;
+         ])],
+         [atf_cv_vclock_supported=yes],
+         [atf_cv_vclock_supported=no])
+        AC_LANG_POP([C])
+        LIBS="${atf_save_LIBS}"
+    ])
+    AM_CONDITIONAL([ENABLE_VCLOCK],
+                   [test x"${atf_cv_vclock_supported}" = xyes])
+])
@@ -0,0 +1,50 @@
+dnl Copyright (c) 2026 The NetBSD Foundation, Inc.
+dnl All rights reserved.
+dnl
+dnl Redistribution and use in source and binary forms, with or without
+dnl modification, are permitted provided that the following conditions
+dnl are met:
+dnl 1. Redistributions of source code must retain the above copyright
+dnl    notice, this list of conditions and the following disclaimer.
+dnl 2. Redistributions in binary form must reproduce the above copyright
+dnl    notice, this list of conditions and the following disclaimer in the
+dnl    documentation and/or other materials provided with the distribution.
+dnl
+dnl THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+dnl CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+dnl INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+dnl MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+dnl IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+dnl DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+dnl DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+dnl GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+dnl INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+dnl IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+dnl OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+dnl IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+dnl ATF_MODULE_ZLIB
+dnl
+dnl Checks for zlib, which is used to read and write gzip-compressed golden
+dnl files.  Support is enabled by default if the library is present.
+dnl
+AC_DEFUN([ATF_MODULE_ZLIB], [
+    AC_ARG_WITH([zlib],
+                AS_HELP_STRING([--without-zlib],
+                               [Disable support for gzip-compressed files]),
+                [], [with_zlib=check])
+
+    ATF_ZLIB_LIBS=
+    if test x"${with_zlib}" != xno; then
+        AC_CHECK_HEADER([zlib.h], [
+            AC_CHECK_LIB([z], [gzdopen], [
+                ATF_ZLIB_LIBS=-lz
+                AC_DEFINE([HAVE_ZLIB], [1],
+                          [Define to 1 if zlib is available])
+            ])
+        ])
+        if test x"${with_zlib}" = xyes -a -z "${ATF_ZLIB_LIBS}"; then
+            AC_MSG_ERROR([zlib support requested but zlib was not found])
+        fi
+    fi
+    AC_SUBST([ATF_ZLIB_LIBS])
+])
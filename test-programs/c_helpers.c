@@ -425,6 +425,27 @@ ATF_TC_BODY(result_skip, tc)
     atf_tc_skip("Skipped reason");
 }
 
+ATF_TC_WITHOUT_HEAD(result_metrics);
+ATF_TC_BODY(result_metrics, tc)
+{
+    printf("msg\n");
+    atf_tc_record_metric("throughput", 12.5, "MB/s");
+    atf_tc_record_metric("hits", 3, NULL);
+    atf_tc_record_metric("throughput", 25, "MB/s");
+}
+
+ATF_TC_WITHOUT_HEAD(result_metrics_invalid);
+ATF_TC_BODY(result_metrics_invalid, tc)
+{
+    atf_tc_record_metric("bad name", 1, NULL);
+}
+
+ATF_TC_WITHOUT_HEAD(result_metrics_invalid_unit);
+ATF_TC_BODY(result_metrics_invalid_unit, tc)
+{
+    atf_tc_record_metric("latency", 1, "ms:avg");
+}
+
 ATF_TC(result_newlines_fail);
 ATF_TC_HEAD(result_newlines_fail, tc)
 {
@@ -447,6 +468,114 @@ ATF_TC_BODY(result_newlines_skip, tc)
     atf_tc_skip("First line\nSecond line");
 }
 
+ATF_TC(result_timeout);
+ATF_TC_HEAD(result_timeout, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Helper test case for the t_result test "
+                      "program");
+    atf_tc_set_md_var(tc, "timeout", "1");
+}
+ATF_TC_BODY(result_timeout, tc)
+{
+    sleep(30);
+}
+
+ATF_TC(result_no_timeout);
+ATF_TC_HEAD(result_no_timeout, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Helper test case for the t_result test "
+                      "program");
+}
+ATF_TC_BODY(result_no_timeout, tc)
+{
+    if (getpgrp() == getpid())
+        atf_tc_fail("The body runs in a process group of its own");
+}
+
+ATF_TC(result_virtual_clock);
+ATF_TC_HEAD(result_virtual_clock, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Helper test case for the t_result test "
+                      "program");
+    atf_tc_set_md_var(tc, "X-atf.virtual_clock", "true");
+}
+ATF_TC_BODY(result_virtual_clock, tc)
+{
+    ATF_REQUIRE_EQ(0, sleep(3600));
+}
+
+ATF_TC(result_virtual_clock_timeout);
+ATF_TC_HEAD(result_virtual_clock_timeout, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Helper test case for the t_result test "
+                      "program");
+    atf_tc_set_md_var(tc, "timeout", "1");
+    atf_tc_set_md_var(tc, "X-atf.virtual_clock", "true");
+}
+ATF_TC_BODY(result_virtual_clock_timeout, tc)
+{
+    /* Sleeping would return right away under the virtual clock. */
+    for (;;)
+        continue;
+}
+
+/* ---------------------------------------------------------------------
+ * Helper tests for "t_result" in-process.
+ * --------------------------------------------------------------------- */
+
+ATF_TC(in_process_pass);
+ATF_TC_HEAD(in_process_pass, tc)
+{
+    atf_tc_set_md_var(tc, "X-atf.in_process", "true");
+}
+ATF_TC_BODY(in_process_pass, tc)
+{
+    ATF_CHECK(true);
+    atf_tc_record_metric("checks", 1, NULL);
+}
+
+ATF_TC(in_process_fail);
+ATF_TC_HEAD(in_process_fail, tc)
+{
+    atf_tc_set_md_var(tc, "X-atf.in_process", "true");
+}
+ATF_TC_BODY(in_process_fail, tc)
+{
+    atf_tc_fail("Failure reason");
+}
+
+ATF_TC(in_process_checks);
+ATF_TC_HEAD(in_process_checks, tc)
+{
+    atf_tc_set_md_var(tc, "X-atf.in_process", "true");
+}
+ATF_TC_BODY(in_process_checks, tc)
+{
+    ATF_CHECK(false);
+    ATF_CHECK(false);
+}
+
+ATF_TC(in_process_skip);
+ATF_TC_HEAD(in_process_skip, tc)
+{
+    atf_tc_set_md_var(tc, "X-atf.in_process", "true");
+}
+ATF_TC_BODY(in_process_skip, tc)
+{
+    atf_tc_skip("Skipped reason");
+}
+
+ATF_TC(in_process_expect_exit);
+ATF_TC_HEAD(in_process_expect_exit, tc)
+{
+    atf_tc_set_md_var(tc, "X-atf.in_process", "true");
+}
+ATF_TC_BODY(in_process_expect_exit, tc)
+{
+    atf_tc_expect_exit(0, "Exits");
+    exit(EXIT_SUCCESS);
+}
+
 /* ---------------------------------------------------------------------
  * Main.
  * --------------------------------------------------------------------- */
@@ -496,8 +625,22 @@ ATF_TP_ADD_TCS(tp)
     ATF_TP_ADD_TC(tp, result_pass);
     ATF_TP_ADD_TC(tp, result_fail);
     ATF_TP_ADD_TC(tp, result_skip);
+    ATF_TP_ADD_TC(tp, result_metrics);
+    ATF_TP_ADD_TC(tp, result_metrics_invalid);
+    ATF_TP_ADD_TC(tp, result_metrics_invalid_unit);
     ATF_TP_ADD_TC(tp, result_newlines_fail);
     ATF_TP_ADD_TC(tp, result_newlines_skip);
+    ATF_TP_ADD_TC(tp, result_timeout);
+    ATF_TP_ADD_TC(tp, result_no_timeout);
+    ATF_TP_ADD_TC(tp, result_virtual_clock);
+    ATF_TP_ADD_TC(tp, result_virtual_clock_timeout);
+
+    /* Add helper tests for t_result in-process. */
+    ATF_TP_ADD_TC(tp, in_process_pass);
+    ATF_TP_ADD_TC(tp, in_process_fail);
+    ATF_TP_ADD_TC(tp, in_process_checks);
+    ATF_TP_ADD_TC(tp, in_process_skip);
+    ATF_TP_ADD_TC(tp, in_process_expect_exit);
 
     return atf_no_error();
 }
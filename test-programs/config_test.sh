@@ -50,9 +50,63 @@ vflag_body()
     done
 }
 
+atf_test_case cflag
+cflag_head()
+{
+    atf_set "descr" "Tests that the -c flag works correctly to load" \
+                    "configuration variables from a file"
+}
+cflag_body()
+{
+    i=0
+    while [ ${i} -lt 2000 ]; do
+        echo "unused.var${i}=value ${i}"
+        i=$((i + 1))
+    done >filler
+
+    cat >empty.conf <<EOF
+# Comments and blank lines are ignored.
+
+test=
+EOF
+    { cat filler; echo 'test=foo'; } >value.conf
+    { echo 'test=foo bar'; cat filler; } >multi.conf
+    printf 'a=b\n\nno-value\n' >invalid.conf
+
+    for h in $(get_helpers); do
+        atf_check -s eq:0 -o ignore -e ignore ${h} -s $(atf_get_srcdir) \
+            -r resfile -c empty.conf config_empty
+        atf_check -s eq:0 -o ignore -e empty grep 'passed' resfile
+
+        atf_check -s eq:0 -o ignore -e ignore ${h} -s $(atf_get_srcdir) \
+            -r resfile -c value.conf config_value
+        atf_check -s eq:0 -o ignore -e empty grep 'passed' resfile
+
+        atf_check -s eq:0 -o ignore -e ignore ${h} -s $(atf_get_srcdir) \
+            -r resfile -c multi.conf config_multi_value
+        atf_check -s eq:0 -o ignore -e empty grep 'passed' resfile
+
+        # Variables are set in the order of the flags.
+        atf_check -s eq:0 -o ignore -e ignore ${h} -s $(atf_get_srcdir) \
+            -r resfile -c multi.conf -v test=foo config_value
+        atf_check -s eq:0 -o ignore -e empty grep 'passed' resfile
+        atf_check -s eq:0 -o ignore -e ignore ${h} -s $(atf_get_srcdir) \
+            -r resfile -v test=foo -c multi.conf config_multi_value
+        atf_check -s eq:0 -o ignore -e empty grep 'passed' resfile
+
+        atf_check -s eq:1 -o empty \
+            -e match:'Invalid line 3 in config file invalid.conf' \
+            ${h} -s $(atf_get_srcdir) -c invalid.conf config_value
+        atf_check -s eq:1 -o empty \
+            -e match:'Cannot open config file missing.conf' \
+            ${h} -s $(atf_get_srcdir) -c missing.conf config_value
+    done
+}
+
 atf_init_test_cases()
 {
     atf_add_test_case vflag
+    atf_add_test_case cflag
 }
 
 # vim: syntax=sh:expandtab:shiftwidth=4:softtabstop=4
@@ -280,6 +280,30 @@ ATF_TEST_CASE_BODY(result_skip)
     ATF_SKIP("Skipped reason");
 }
 
+ATF_TEST_CASE(result_metrics);
+ATF_TEST_CASE_HEAD(result_metrics) { }
+ATF_TEST_CASE_BODY(result_metrics)
+{
+    std::cout << "msg\n";
+    record_metric("throughput", 12.5, "MB/s");
+    record_metric("hits", 3);
+    record_metric("throughput", 25, "MB/s");
+}
+
+ATF_TEST_CASE(result_metrics_invalid);
+ATF_TEST_CASE_HEAD(result_metrics_invalid) { }
+ATF_TEST_CASE_BODY(result_metrics_invalid)
+{
+    record_metric("bad name", 1);
+}
+
+ATF_TEST_CASE(result_metrics_invalid_unit);
+ATF_TEST_CASE_HEAD(result_metrics_invalid_unit) { }
+ATF_TEST_CASE_BODY(result_metrics_invalid_unit)
+{
+    record_metric("latency", 1, "ms:avg");
+}
+
 ATF_TEST_CASE(result_newlines_fail);
 ATF_TEST_CASE_HEAD(result_newlines_fail)
 {
@@ -300,6 +324,17 @@ ATF_TEST_CASE_BODY(result_newlines_skip)
     ATF_SKIP("First line\nSecond line");
 }
 
+ATF_TEST_CASE(result_timeout);
+ATF_TEST_CASE_HEAD(result_timeout)
+{
+    set_md_var("descr", "Helper test case for the t_result test program");
+    set_md_var("timeout", "1");
+}
+ATF_TEST_CASE_BODY(result_timeout)
+{
+    ::sleep(30);
+}
+
 ATF_TEST_CASE(result_exception);
 ATF_TEST_CASE_HEAD(result_exception) { }
 ATF_TEST_CASE_BODY(result_exception)
@@ -307,6 +342,90 @@ ATF_TEST_CASE_BODY(result_exception)
     throw std::runtime_error("This is unhandled");
 }
 
+// ------------------------------------------------------------------------
+// Helper tests for "t_result" in-process.
+// ------------------------------------------------------------------------
+
+namespace {
+
+class unwind_marker {
+public:
+    ~unwind_marker(void)
+    {
+        std::cout << "unwound\n";
+    }
+};
+
+} // anonymous namespace
+
+ATF_TEST_CASE(in_process_pass);
+ATF_TEST_CASE_HEAD(in_process_pass)
+{
+    set_md_var("X-atf.in_process", "true");
+}
+ATF_TEST_CASE_BODY(in_process_pass)
+{
+    ATF_REQUIRE(true);
+    record_metric("checks", 1);
+}
+
+ATF_TEST_CASE(in_process_fail);
+ATF_TEST_CASE_HEAD(in_process_fail)
+{
+    set_md_var("X-atf.in_process", "true");
+}
+ATF_TEST_CASE_BODY(in_process_fail)
+{
+    unwind_marker marker;
+    ATF_FAIL("Failure reason");
+}
+
+ATF_TEST_CASE(in_process_checks);
+ATF_TEST_CASE_HEAD(in_process_checks)
+{
+    set_md_var("X-atf.in_process", "true");
+}
+ATF_TEST_CASE_BODY(in_process_checks)
+{
+    fail_nonfatal("First check");
+    fail_nonfatal("Second check");
+}
+
+ATF_TEST_CASE(in_process_skip);
+ATF_TEST_CASE_HEAD(in_process_skip)
+{
+    set_md_var("X-atf.in_process", "true");
+}
+ATF_TEST_CASE_BODY(in_process_skip)
+{
+    ATF_SKIP("Skipped reason");
+}
+
+ATF_TEST_CASE(in_process_expect_exit);
+ATF_TEST_CASE_HEAD(in_process_expect_exit)
+{
+    set_md_var("X-atf.in_process", "true");
+}
+ATF_TEST_CASE_BODY(in_process_expect_exit)
+{
+    expect_exit(0, "Exits");
+    std::exit(EXIT_SUCCESS);
+}
+
+ATF_TEST_CASE(in_process_swallowed);
+ATF_TEST_CASE_HEAD(in_process_swallowed)
+{
+    set_md_var("X-atf.in_process", "true");
+}
+ATF_TEST_CASE_BODY(in_process_swallowed)
+{
+    try {
+        ATF_FAIL("Failure reason");
+    } catch (...) {
+    }
+    ATF_FAIL("Second reason");
+}
+
 // ------------------------------------------------------------------------
 // Main.
 // ------------------------------------------------------------------------
@@ -349,7 +468,19 @@ ATF_INIT_TEST_CASES(tcs)
     ATF_ADD_TEST_CASE(tcs, result_pass);
     ATF_ADD_TEST_CASE(tcs, result_fail);
     ATF_ADD_TEST_CASE(tcs, result_skip);
+    ATF_ADD_TEST_CASE(tcs, result_metrics);
+    ATF_ADD_TEST_CASE(tcs, result_metrics_invalid);
+    ATF_ADD_TEST_CASE(tcs, result_metrics_invalid_unit);
     ATF_ADD_TEST_CASE(tcs, result_newlines_fail);
     ATF_ADD_TEST_CASE(tcs, result_newlines_skip);
+    ATF_ADD_TEST_CASE(tcs, result_timeout);
     ATF_ADD_TEST_CASE(tcs, result_exception);
+
+    // Add helper tests for t_result in-process.
+    ATF_ADD_TEST_CASE(tcs, in_process_pass);
+    ATF_ADD_TEST_CASE(tcs, in_process_fail);
+    ATF_ADD_TEST_CASE(tcs, in_process_checks);
+    ATF_ADD_TEST_CASE(tcs, in_process_skip);
+    ATF_ADD_TEST_CASE(tcs, in_process_expect_exit);
+    ATF_ADD_TEST_CASE(tcs, in_process_swallowed);
 }
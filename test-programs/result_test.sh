@@ -83,6 +83,125 @@ result_to_file_body()
     done
 }
 
+atf_test_case result_metrics
+result_metrics_head()
+{
+    atf_set "descr" "Tests that the metrics recorded by the body are written" \
+                    "next to the results file"
+}
+result_metrics_body()
+{
+    srcdir="$(atf_get_srcdir)"
+    for h in $(get_helpers); do
+        rm -f resfile.metrics result_metrics.metrics
+        atf_check -s eq:0 -o inline:"msg\n" -e ignore "${h}" -s "${srcdir}" \
+            -r resfile result_metrics
+        atf_check -o inline:"passed\n" cat resfile
+        atf_check -o inline:"throughput: 25 MB/s\nhits: 3\n" \
+            cat resfile.metrics
+
+        atf_check -s eq:0 -o inline:"msg\n" -e ignore "${h}" -s "${srcdir}" \
+            -r resfile result_pass
+        atf_check test ! -f resfile.metrics
+
+        atf_check -s eq:0 -o match:"^passed$" -e ignore "${h}" \
+            -s "${srcdir}" result_metrics
+        atf_check -o inline:"throughput: 25 MB/s\nhits: 3\n" \
+            cat result_metrics.metrics
+
+        atf_check -s eq:1 -o ignore -e ignore "${h}" -s "${srcdir}" \
+            -r resfile result_metrics_invalid
+        atf_check -o match:"^failed: Invalid metric 'bad name'" cat resfile
+
+        atf_check -s eq:1 -o ignore -e ignore "${h}" -s "${srcdir}" \
+            -r resfile result_metrics_invalid_unit
+        atf_check -o match:"^failed: Invalid metric 'latency'.*unit 'ms:avg'" \
+            cat resfile
+    done
+}
+
+atf_test_case result_profile
+result_profile_head()
+{
+    atf_set "descr" "Tests that the profile configuration variable writes" \
+                    "the folded stacks of the body next to the results file"
+}
+result_profile_body()
+{
+    srcdir="$(atf_get_srcdir)"
+    for h in $(get_helpers c_helpers cpp_helpers); do
+        rm -f resfile.folded
+        atf_check -s eq:1 -o inline:"msg\n" -e save:stderr "${h}" \
+            -s "${srcdir}" -r resfile -v profile=true result_fail
+        if grep '^\*\*\* Profiling skipped' stderr >/dev/null; then
+            atf_skip "Stack sampling is not supported"
+        fi
+        atf_check -o inline:"failed: Failure reason\n" cat resfile
+        atf_check test -f resfile.folded
+
+        atf_check -s eq:1 -o ignore -e ignore "${h}" -s "${srcdir}" \
+            -r resfile -v profile=maybe result_pass
+        atf_check -o match:"profile does not have a valid boolean value" \
+            cat resfile
+    done
+}
+
+atf_test_case result_timeout
+result_timeout_head()
+{
+    atf_set "descr" "Tests that test cases running outside of a runtime" \
+                    "engine are killed once their timeout expires"
+}
+result_timeout_body()
+{
+    unset __RUNNING_INSIDE_ATF_RUN
+    srcdir="$(atf_get_srcdir)"
+    for h in $(get_helpers c_helpers cpp_helpers); do
+        atf_check -s eq:1 -o empty -e match:'timed out; stack of the body' \
+            "${h}" -s "${srcdir}" -r resfile result_timeout
+        atf_check -o inline:"failed: Test case timed out after 1 second\n" \
+            cat resfile
+
+        atf_check -s eq:1 -o empty -e ignore "${h}" -s "${srcdir}" \
+            -r resfile expect_timeout_and_hang
+        atf_check -o inline:"expected_timeout: Will overrun\n" cat resfile
+
+        atf_check -s eq:1 \
+            -o match:'^failed: Test case timed out after 1 second$' \
+            -e ignore "${h}" -s "${srcdir}" result_timeout
+    done
+
+    # Test cases that do not set a timeout are not watched, and thus stay
+    # in the process group of their caller.
+    atf_check -s eq:0 -o inline:"passed\n" -e ignore \
+        "$(atf_get_srcdir)/c_helpers" -s "${srcdir}" result_no_timeout
+}
+
+atf_test_case result_virtual_clock
+result_virtual_clock_head()
+{
+    atf_set "descr" "Tests that test cases using the virtual clock can" \
+                    "re-execute a test program started through the PATH"
+}
+result_virtual_clock_body()
+{
+    srcdir="$(atf_get_srcdir)"
+    atf_check -s eq:0 -o save:stdout -e ignore env PATH="${srcdir}:${PATH}" \
+        c_helpers -s "${srcdir}" result_virtual_clock
+    if grep '^skipped: ' stdout >/dev/null; then
+        atf_skip "The virtual clock is not available"
+    fi
+    atf_check -o inline:"passed\n" cat stdout
+
+    # The watchdog keeps watching the body after it is re-executed.
+    unset __RUNNING_INSIDE_ATF_RUN
+    atf_check -s eq:1 -o empty -e match:'timed out; stack of the body' \
+        "${srcdir}/c_helpers" -s "${srcdir}" -r resfile \
+        result_virtual_clock_timeout
+    atf_check -o inline:"failed: Test case timed out after 1 second\n" \
+        cat resfile
+}
+
 atf_test_case result_to_file_fail
 result_to_file_fail_head()
 {
@@ -123,13 +242,62 @@ result_exception_body()
     done
 }
 
+atf_test_case result_in_process
+result_in_process_head()
+{
+    atf_set "descr" "Tests that -i runs several test cases in-process and" \
+                    "reports the result of each"
+}
+result_in_process_body()
+{
+    srcdir="$(atf_get_srcdir)"
+    cat >expout <<EOF
+in_process_pass: passed
+in_process_fail: failed: Failure reason
+in_process_checks: failed: 2 checks failed; see output for more details
+in_process_skip: skipped: Skipped reason
+in_process_expect_exit: failed: atf_tc_expect_exit cannot be used in test cases that run in-process
+EOF
+    for h in $(get_helpers c_helpers cpp_helpers); do
+        atf_check -s eq:1 -o ignore -e ignore "${h}" -s "${srcdir}" -i \
+            -r resfile
+        grep -v swallowed resfile >resfile.filtered
+        atf_check -o file:expout cat resfile.filtered
+        atf_check -o inline:"in_process_pass: checks: 1\n" \
+            cat resfile.metrics
+
+        atf_check -s eq:0 -o ignore -e ignore "${h}" -s "${srcdir}" -i \
+            -r resfile in_process_skip in_process_pass
+        atf_check -o inline:"in_process_skip: skipped: Skipped reason\nin_process_pass: passed\n" \
+            cat resfile
+
+        atf_check -s eq:1 -e match:"result_pass' cannot run in-process" \
+            "${h}" -s "${srcdir}" -i result_pass
+        atf_check -s eq:1 -e match:"Cannot use -i with -l" \
+            "${h}" -s "${srcdir}" -i -l
+    done
+
+    h="$(get_helpers cpp_helpers)"
+    atf_check -s eq:1 -o match:"unwound" -e ignore "${h}" -s "${srcdir}" -i \
+        in_process_fail
+    atf_check -s eq:1 -o ignore -e ignore "${h}" -s "${srcdir}" -i \
+        -r resfile in_process_swallowed
+    atf_check -o inline:"in_process_swallowed: failed: Failure reason\n" \
+        cat resfile
+}
+
 atf_init_test_cases()
 {
     atf_add_test_case runtime_warnings
     atf_add_test_case result_on_stdout
     atf_add_test_case result_to_file
+    atf_add_test_case result_metrics
+    atf_add_test_case result_profile
+    atf_add_test_case result_timeout
+    atf_add_test_case result_virtual_clock
     atf_add_test_case result_to_file_fail
     atf_add_test_case result_exception
+    atf_add_test_case result_in_process
 }
 
 # vim: syntax=sh:expandtab:shiftwidth=4:softtabstop=4
@@ -336,6 +336,27 @@ result_skip_body()
     atf_skip "Skipped reason"
 }
 
+atf_test_case result_metrics
+result_metrics_body()
+{
+    echo "msg"
+    atf_record_metric throughput 12.5 MB/s
+    atf_record_metric hits 3
+    atf_record_metric throughput 25 MB/s
+}
+
+atf_test_case result_metrics_invalid
+result_metrics_invalid_body()
+{
+    atf_record_metric "bad name" 1
+}
+
+atf_test_case result_metrics_invalid_unit
+result_metrics_invalid_unit_body()
+{
+    atf_record_metric latency 1 ms:avg
+}
+
 # -------------------------------------------------------------------------
 # Main.
 # -------------------------------------------------------------------------
@@ -385,6 +406,9 @@ atf_init_test_cases()
     atf_add_test_case result_pass
     atf_add_test_case result_fail
     atf_add_test_case result_skip
+    atf_add_test_case result_metrics
+    atf_add_test_case result_metrics_invalid
+    atf_add_test_case result_metrics_invalid_unit
 }
 
 # vim: syntax=sh:expandtab:shiftwidth=4:softtabstop=4
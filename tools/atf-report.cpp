@@ -0,0 +1,987 @@
+// Copyright (c) 2026 The NetBSD Foundation, Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+// CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+// INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+// IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+// IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+// IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#if defined(HAVE_CONFIG_H)
+#include "config.h"
+#endif
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "atf-c++/detail/application.hpp"
+#include "atf-c++/detail/fs.hpp"
+#include "atf-c++/detail/sanity.hpp"
+#include "atf-c++/detail/text.hpp"
+
+// ------------------------------------------------------------------------
+// Auxiliary types and functions.
+// ------------------------------------------------------------------------
+
+namespace {
+
+// Names of the metrics that test programs record when timing is enabled;
+// see atf-c(3).
+const char* const startup_time = "atf.startup_time";
+const char* const body_time = "atf.body_time";
+const char* const body_cpu_time = "atf.body_cpu_time";
+const char* const max_rss = "atf.max_rss";
+
+typedef std::map< std::string, double > metrics_map;
+
+struct tc_record {
+    std::string m_program;
+    std::string m_name;
+    std::string m_result;
+    metrics_map m_metrics;
+
+    std::string
+    id(void)
+        const
+    {
+        return m_program + ":" + m_name;
+    }
+
+    double
+    get(const std::string& metric)
+        const
+    {
+        const metrics_map::const_iterator iter = m_metrics.find(metric);
+        return iter == m_metrics.end() ? 0.0 : (*iter).second;
+    }
+};
+
+// Test cases keyed by their "program:test_case" identifier.
+typedef std::map< std::string, tc_record > records_map;
+
+struct program_record {
+    std::string m_program;
+    size_t m_tcs;
+    double m_startup_time;
+    double m_body_time;
+
+    program_record(void) : m_tcs(0), m_startup_time(0), m_body_time(0) {}
+};
+
+struct regression {
+    std::string m_id;
+    std::string m_metric;
+    double m_previous;
+    double m_current;
+};
+
+static
+bool
+has_suffix(const std::string& str, const std::string& suffix)
+{
+    return str.length() > suffix.length() &&
+        str.compare(str.length() - suffix.length(), suffix.length(),
+                    suffix) == 0;
+}
+
+//!
+//! \brief Returns the result of a results file line without its reason.
+//!
+static
+std::string
+result_type(const std::string& line)
+{
+    const std::string::size_type pos = line.find_first_of(":(");
+    return atf::text::trim(pos == std::string::npos ? line :
+                           line.substr(0, pos));
+}
+
+static
+bool
+is_result_type(const std::string& type)
+{
+    static const char* const types[] = { "broken", "expected_death",
+        "expected_exit", "expected_failure", "expected_signal",
+        "expected_timeout", "failed", "passed", "skipped", NULL };
+
+    for (const char* const* iter = types; *iter != NULL; iter++) {
+        if (type == *iter)
+            return true;
+    }
+    return false;
+}
+
+//!
+//! \brief Splits a metric line into its name and value.
+//!
+//! The value may be followed by a unit, which is not needed as the units
+//! of the metrics the report cares about are known.
+//!
+static
+bool
+parse_metric(const std::string& text, std::string& name, double& value)
+{
+    const std::string::size_type pos = text.find(": ");
+    if (pos == std::string::npos)
+        return false;
+    name = text.substr(0, pos);
+
+    const std::string rest = text.substr(pos + 2);
+    const char* start = rest.c_str();
+    char* end;
+    value = std::strtod(start, &end);
+    return end != start && (*end == '\0' || *end == ' ');
+}
+
+//!
+//! \brief Loads the metrics file of a test case, or of a test program
+//! that ran its test cases in-process.
+//!
+//! \param rel The path of the results file relative to the scanned
+//! directory, which must be named after the test case and live in a
+//! directory named after the test program; in-process runs name the
+//! results file after the test program instead.
+//!
+static
+void
+load_metrics(const atf::fs::path& file, const std::string& rel,
+             records_map& records)
+{
+    const atf::fs::path resfile(file.str().substr(0, file.str().length() -
+                                                  std::strlen(".metrics")));
+
+    std::ifstream is(file.c_str());
+    if (!is)
+        throw std::runtime_error("Cannot open metrics file " + file.str());
+
+    // Results of the test cases that ran in-process keyed by their name,
+    // or the result of the single test case under the empty key.
+    std::map< std::string, std::string > results;
+    {
+        std::ifstream ris(resfile.c_str());
+        std::string line;
+        while (std::getline(ris, line)) {
+            const std::string type = result_type(line);
+            if (is_result_type(type)) {
+                if (results.find("") == results.end())
+                    results[""] = type;
+            } else {
+                const std::string::size_type pos = line.find(": ");
+                if (pos != std::string::npos)
+                    results[line.substr(0, pos)] = result_type(
+                        line.substr(pos + 2));
+            }
+        }
+    }
+
+    std::string line;
+    while (std::getline(is, line)) {
+        if (line.empty())
+            continue;
+
+        tc_record tc;
+        std::string text = line;
+        const std::string::size_type first = line.find(": ");
+        if (first != std::string::npos &&
+            line.find(": ", first + 2) != std::string::npos) {
+            // A test case that ran in-process prefixes its metrics by its
+            // name.
+            tc.m_program = rel;
+            tc.m_name = line.substr(0, first);
+            text = line.substr(first + 2);
+        } else {
+            const std::string::size_type slash = rel.rfind('/');
+            tc.m_program = slash == std::string::npos ? "." :
+                rel.substr(0, slash);
+            tc.m_name = slash == std::string::npos ? rel :
+                rel.substr(slash + 1);
+        }
+
+        std::string name;
+        double value;
+        if (!parse_metric(text, name, value))
+            throw std::runtime_error("Invalid line '" + line + "' in " +
+                                     file.str());
+
+        tc_record& record = records[tc.id()];
+        if (record.m_name.empty()) {
+            record = tc;
+            std::map< std::string, std::string >::const_iterator iter =
+                results.find(tc.m_name);
+            if (iter == results.end())
+                iter = results.find("");
+            record.m_result = iter == results.end() ? "unknown" :
+                (*iter).second;
+        }
+        record.m_metrics[name] = value;
+    }
+}
+
+//!
+//! \brief Looks for metrics files under a directory.
+//!
+static
+void
+scan(const atf::fs::path& dir, const std::string& prefix,
+     records_map& records)
+{
+    const atf::fs::directory entries(dir);
+    for (atf::fs::directory::const_iterator iter = entries.begin();
+         iter != entries.end(); ++iter) {
+        const std::string& name = (*iter).first;
+        if (name == "." || name == "..")
+            continue;
+
+        const atf::fs::path path = dir / name;
+        const int type = (*iter).second.get_type();
+        if (type == atf::fs::file_info::dir_type)
+            scan(path, prefix + name + "/", records);
+        else if (type == atf::fs::file_info::reg_type &&
+                 has_suffix(name, ".metrics"))
+            load_metrics(path, prefix + name.substr(0, name.length() -
+                                                    std::strlen(".metrics")),
+                         records);
+    }
+}
+
+// ------------------------------------------------------------------------
+// JSON input and output.
+// ------------------------------------------------------------------------
+
+//!
+//! \brief A JSON value, as far as reading previous reports requires.
+//!
+struct json_value {
+    enum type { null_type, bool_type, number_type, string_type,
+                array_type, object_type };
+
+    type m_type;
+    double m_number;
+    std::string m_string;
+    std::vector< json_value > m_array;
+    std::vector< std::pair< std::string, json_value > > m_object;
+
+    json_value(void) : m_type(null_type), m_number(0) {}
+
+    const json_value*
+    member(const std::string& name)
+        const
+    {
+        for (std::vector< std::pair< std::string, json_value > >::
+             const_iterator iter = m_object.begin(); iter != m_object.end();
+             ++iter) {
+            if ((*iter).first == name)
+                return &(*iter).second;
+        }
+        return NULL;
+    }
+};
+
+class json_parser {
+    const std::string& m_text;
+    std::string::size_type m_pos;
+
+    void
+    fail(const std::string& what)
+    {
+        throw std::runtime_error("Invalid report: " + what + " at offset " +
+                                 atf::text::to_string(m_pos));
+    }
+
+    void
+    skip_blanks(void)
+    {
+        while (m_pos < m_text.length() &&
+               std::isspace(static_cast< unsigned char >(m_text[m_pos])))
+            m_pos++;
+    }
+
+    void
+    expect(const char ch)
+    {
+        skip_blanks();
+        if (m_pos >= m_text.length() || m_text[m_pos] != ch)
+            fail(std::string("expected '") + ch + "'");
+        m_pos++;
+    }
+
+    bool
+    accept(const char ch)
+    {
+        skip_blanks();
+        if (m_pos < m_text.length() && m_text[m_pos] == ch) {
+            m_pos++;
+            return true;
+        }
+        return false;
+    }
+
+    std::string
+    parse_string(void)
+    {
+        expect('"');
+        std::string str;
+        while (m_pos < m_text.length() && m_text[m_pos] != '"') {
+            char ch = m_text[m_pos++];
+            if (ch == '\\') {
+                if (m_pos >= m_text.length())
+                    break;
+                ch = m_text[m_pos++];
+                switch (ch) {
+                case 'b': ch = '\b'; break;
+                case 'f': ch = '\f'; break;
+                case 'n': ch = '\n'; break;
+                case 'r': ch = '\r'; break;
+                case 't': ch = '\t'; break;
+                case 'u':
+                    if (m_pos + 4 > m_text.length())
+                        fail("truncated escape");
+                    ch = static_cast< char >(std::strtol(
+                        m_text.substr(m_pos, 4).c_str(), NULL, 16));
+                    m_pos += 4;
+                    break;
+                default:
+                    break;
+                }
+            }
+            str += ch;
+        }
+        expect('"');
+        return str;
+    }
+
+    json_value
+    parse_value(void)
+    {
+        json_value value;
+
+        skip_blanks();
+        if (m_pos >= m_text.length())
+            fail("unexpected end");
+
+        const char ch = m_text[m_pos];
+        if (ch == '{') {
+            m_pos++;
+            value.m_type = json_value::object_type;
+            if (!accept('}')) {
+                do {
+                    const std::string name = parse_string();
+                    expect(':');
+                    value.m_object.push_back(std::make_pair(name,
+                                                            parse_value()));
+                } while (accept(','));
+                expect('}');
+            }
+        } else if (ch == '[') {
+            m_pos++;
+            value.m_type = json_value::array_type;
+            if (!accept(']')) {
+                do {
+                    value.m_array.push_back(parse_value());
+                } while (accept(','));
+                expect(']');
+            }
+        } else if (ch == '"') {
+            value.m_type = json_value::string_type;
+            value.m_string = parse_string();
+        } else if (m_text.compare(m_pos, 4, "true") == 0) {
+            value.m_type = json_value::bool_type;
+            value.m_number = 1;
+            m_pos += 4;
+        } else if (m_text.compare(m_pos, 5, "false") == 0) {
+            value.m_type = json_value::bool_type;
+            m_pos += 5;
+        } else if (m_text.compare(m_pos, 4, "null") == 0) {
+            m_pos += 4;
+        } else {
+            const char* start = m_text.c_str() + m_pos;
+            char* end;
+            value.m_type = json_value::number_type;
+            value.m_number = std::strtod(start, &end);
+            if (end == start)
+                fail("unexpected character");
+            m_pos += end - start;
+        }
+        return value;
+    }
+
+public:
+    json_parser(const std::string& text) : m_text(text), m_pos(0) {}
+
+    json_value
+    parse(void)
+    {
+        const json_value value = parse_value();
+        skip_blanks();
+        if (m_pos != m_text.length())
+            fail("trailing data");
+        return value;
+    }
+};
+
+//!
+//! \brief Loads the test cases of a report previously printed with -j.
+//!
+static
+records_map
+load_report(const atf::fs::path& file)
+{
+    std::ifstream is(file.c_str());
+    if (!is)
+        throw std::runtime_error("Cannot open report " + file.str());
+    std::ostringstream text;
+    text << is.rdbuf();
+
+    const json_value report = json_parser(text.str()).parse();
+    const json_value* tcs = report.member("test_cases");
+    if (tcs == NULL || tcs->m_type != json_value::array_type)
+        throw std::runtime_error("Invalid report " + file.str() + ": no "
+                                 "test_cases array");
+
+    records_map records;
+    for (std::vector< json_value >::const_iterator iter =
+         tcs->m_array.begin(); iter != tcs->m_array.end(); ++iter) {
+        const json_value* program = (*iter).member("program");
+        const json_value* name = (*iter).member("test_case");
+        const json_value* metrics = (*iter).member("metrics");
+        if (program == NULL || name == NULL || metrics == NULL)
+            continue;
+
+        tc_record tc;
+        tc.m_program = program->m_string;
+        tc.m_name = name->m_string;
+        for (std::vector< std::pair< std::string, json_value > >::
+             const_iterator iter2 = metrics->m_object.begin();
+             iter2 != metrics->m_object.end(); ++iter2)
+            tc.m_metrics[(*iter2).first] = (*iter2).second.m_number;
+        records[tc.id()] = tc;
+    }
+    return records;
+}
+
+static
+std::string
+json_string(const std::string& str)
+{
+    std::string out = "\"";
+    for (std::string::const_iterator iter = str.begin(); iter != str.end();
+         ++iter) {
+        const unsigned char ch = *iter;
+        if (ch == '"' || ch == '\\') {
+            out += '\\';
+            out += ch;
+        } else if (ch < 0x20) {
+            char buf[8];
+            std::snprintf(buf, sizeof(buf), "\\u%04x", ch);
+            out += buf;
+        } else
+            out += ch;
+    }
+    return out + "\"";
+}
+
+static
+std::string
+json_number(const double value)
+{
+    std::ostringstream str;
+    str.precision(15);
+    str << value;
+    return str.str();
+}
+
+// ------------------------------------------------------------------------
+// Text output.
+// ------------------------------------------------------------------------
+
+//!
+//! \brief Prints a table with left-aligned text columns and right-aligned
+//! numeric columns.
+//!
+static
+void
+print_table(std::ostream& os, const std::string& title,
+            const std::vector< std::string >& headers,
+            const std::vector< std::vector< std::string > >& rows,
+            const size_t text_columns)
+{
+    std::vector< size_t > widths;
+    for (size_t i = 0; i < headers.size(); i++)
+        widths.push_back(headers[i].length());
+    for (std::vector< std::vector< std::string > >::const_iterator iter =
+         rows.begin(); iter != rows.end(); ++iter) {
+        for (size_t i = 0; i < (*iter).size(); i++)
+            widths[i] = std::max(widths[i], (*iter)[i].length());
+    }
+
+    os << title << "\n\n";
+    std::vector< std::vector< std::string > > all(1, headers);
+    all.insert(all.end(), rows.begin(), rows.end());
+    for (std::vector< std::vector< std::string > >::const_iterator iter =
+         all.begin(); iter != all.end(); ++iter) {
+        std::string line;
+        for (size_t i = 0; i < (*iter).size(); i++) {
+            const std::string& cell = (*iter)[i];
+            const std::string pad(widths[i] - cell.length(), ' ');
+            if (i > 0)
+                line += "  ";
+            line += i < text_columns ? cell + pad : pad + cell;
+        }
+        os << atf::text::trim(line) << "\n";
+    }
+    if (rows.empty())
+        os << "(none)\n";
+    os << "\n";
+}
+
+static
+std::string
+format_fixed(const double value, const int decimals)
+{
+    char buf[64];
+    std::snprintf(buf, sizeof(buf), "%.*f", decimals, value);
+    return buf;
+}
+
+static
+std::string
+format_metric(const std::string& metric, const double value)
+{
+    if (metric == max_rss)
+        return format_fixed(value, 0) + " KiB";
+    else
+        return format_fixed(value * 1000, 3) + " ms";
+}
+
+// ------------------------------------------------------------------------
+// Report computations.
+// ------------------------------------------------------------------------
+
+class by_metric {
+    std::string m_metric;
+
+public:
+    by_metric(const std::string& metric) : m_metric(metric) {}
+
+    bool
+    operator()(const tc_record* a, const tc_record* b)
+        const
+    {
+        const double va = a->get(m_metric), vb = b->get(m_metric);
+        return va != vb ? va > vb : a->id() < b->id();
+    }
+};
+
+static
+std::vector< const tc_record* >
+top(const records_map& records, const std::string& metric, const size_t n)
+{
+    std::vector< const tc_record* > tcs;
+    for (records_map::const_iterator iter = records.begin();
+         iter != records.end(); ++iter) {
+        if ((*iter).second.m_metrics.find(metric) !=
+            (*iter).second.m_metrics.end())
+            tcs.push_back(&(*iter).second);
+    }
+    std::sort(tcs.begin(), tcs.end(), by_metric(metric));
+    if (tcs.size() > n)
+        tcs.resize(n);
+    return tcs;
+}
+
+static
+std::vector< program_record >
+summarize_programs(const records_map& records)
+{
+    std::map< std::string, program_record > programs;
+    for (records_map::const_iterator iter = records.begin();
+         iter != records.end(); ++iter) {
+        const tc_record& tc = (*iter).second;
+        program_record& program = programs[tc.m_program];
+        program.m_program = tc.m_program;
+        program.m_tcs++;
+        program.m_startup_time += tc.get(startup_time);
+        program.m_body_time += tc.get(body_time);
+    }
+
+    std::vector< program_record > out;
+    for (std::map< std::string, program_record >::const_iterator iter =
+         programs.begin(); iter != programs.end(); ++iter)
+        out.push_back((*iter).second);
+    return out;
+}
+
+//!
+//! \brief Compares the timing metrics of the test cases against a previous
+//! report.
+//!
+//! Changes below 1 ms or 1 MiB are ignored, as they are dominated by noise.
+//!
+static
+std::vector< regression >
+find_regressions(const records_map& previous, const records_map& current,
+                 const double threshold)
+{
+    static const char* const metrics[] = { startup_time, body_time,
+                                           body_cpu_time, max_rss, NULL };
+
+    std::vector< regression > out;
+    for (records_map::const_iterator iter = current.begin();
+         iter != current.end(); ++iter) {
+        const records_map::const_iterator old = previous.find((*iter).first);
+        if (old == previous.end())
+            continue;
+
+        for (const char* const* metric = metrics; *metric != NULL;
+             metric++) {
+            const metrics_map& now = (*iter).second.m_metrics;
+            const metrics_map& then = (*old).second.m_metrics;
+            if (now.find(*metric) == now.end() ||
+                then.find(*metric) == then.end())
+                continue;
+
+            const double floor = *metric == max_rss ? 1024 : 0.001;
+            regression r;
+            r.m_id = (*iter).first;
+            r.m_metric = *metric;
+            r.m_previous = (*then.find(*metric)).second;
+            r.m_current = (*now.find(*metric)).second;
+            if (r.m_current - r.m_previous >= floor &&
+                r.m_current > r.m_previous * (1 + threshold / 100))
+                out.push_back(r);
+        }
+    }
+    return out;
+}
+
+static
+std::string
+format_change(const regression& r)
+{
+    if (r.m_previous == 0)
+        return "new";
+    return "+" + format_fixed((r.m_current / r.m_previous - 1) * 100, 1) +
+        "%";
+}
+
+} // anonymous namespace
+
+// ------------------------------------------------------------------------
+// The "atf_report" class.
+// ------------------------------------------------------------------------
+
+namespace {
+
+class atf_report : public atf::application::app {
+    bool m_jflag;
+    size_t m_count;
+    std::string m_previous;
+    double m_threshold;
+
+    static const char* m_description;
+
+    std::string specific_args(void) const;
+    options_set specific_options(void) const;
+    void process_option(int, const char*);
+
+    void print_text(const records_map&, const std::vector< regression >&);
+    void print_json(const records_map&, const std::vector< regression >&);
+
+public:
+    atf_report(void);
+    int main(void);
+};
+
+} // anonymous namespace
+
+const char* atf_report::m_description =
+    "atf-report summarizes the time and memory used by the test cases of a "
+    "test suite run.";
+
+atf_report::atf_report(void) :
+    app(m_description, "atf-report(1)"),
+    m_jflag(false),
+    m_count(10),
+    m_threshold(10)
+{
+}
+
+std::string
+atf_report::specific_args(void)
+    const
+{
+    return "[directory ...]";
+}
+
+atf_report::options_set
+atf_report::specific_options(void)
+    const
+{
+    using atf::application::option;
+    options_set opts;
+
+    opts.insert(option('j', "", "Print the report as JSON"));
+    opts.insert(option('n', "count", "Number of test cases to list as the "
+                "slowest and most memory-hungry (default: 10)"));
+    opts.insert(option('p', "report", "Previous JSON report to look for "
+                "regressions against"));
+    opts.insert(option('t', "percent", "Increase over the previous report "
+                "that counts as a regression (default: 10)"));
+
+    return opts;
+}
+
+void
+atf_report::process_option(int ch, const char* arg)
+{
+    switch (ch) {
+    case 'j':
+        m_jflag = true;
+        break;
+
+    case 'n':
+        try {
+            const long count = atf::text::to_type< long >(arg);
+            if (count < 1)
+                throw std::runtime_error("Negative count");
+            m_count = count;
+        } catch (const std::runtime_error&) {
+            throw atf::application::usage_error("Invalid count '%s'", arg);
+        }
+        break;
+
+    case 'p':
+        m_previous = arg;
+        break;
+
+    case 't':
+        try {
+            m_threshold = atf::text::to_type< double >(arg);
+            if (m_threshold < 0)
+                throw std::runtime_error("Negative threshold");
+        } catch (const std::runtime_error&) {
+            throw atf::application::usage_error("Invalid threshold '%s'",
+                                                arg);
+        }
+        break;
+
+    default:
+        UNREACHABLE;
+    }
+}
+
+void
+atf_report::print_text(const records_map& records,
+                       const std::vector< regression >& regressions)
+{
+    std::vector< std::string > headers;
+    std::vector< std::vector< std::string > > rows;
+
+    const std::vector< const tc_record* > slowest = top(records, body_time,
+                                                        m_count);
+    headers.push_back("Test case");
+    headers.push_back("Result");
+    headers.push_back("Body (ms)");
+    headers.push_back("CPU (ms)");
+    headers.push_back("Startup (ms)");
+    for (std::vector< const tc_record* >::const_iterator iter =
+         slowest.begin(); iter != slowest.end(); ++iter) {
+        std::vector< std::string > row;
+        row.push_back((*iter)->id());
+        row.push_back((*iter)->m_result);
+        row.push_back(format_fixed((*iter)->get(body_time) * 1000, 3));
+        row.push_back(format_fixed((*iter)->get(body_cpu_time) * 1000, 3));
+        row.push_back(format_fixed((*iter)->get(startup_time) * 1000, 3));
+        rows.push_back(row);
+    }
+    print_table(std::cout, "Slowest test cases", headers, rows, 2);
+
+    const std::vector< const tc_record* > hungriest = top(records, max_rss,
+                                                          m_count);
+    headers.clear();
+    rows.clear();
+    headers.push_back("Test case");
+    headers.push_back("Result");
+    headers.push_back("Max RSS (KiB)");
+    for (std::vector< const tc_record* >::const_iterator iter =
+         hungriest.begin(); iter != hungriest.end(); ++iter) {
+        std::vector< std::string > row;
+        row.push_back((*iter)->id());
+        row.push_back((*iter)->m_result);
+        row.push_back(format_fixed((*iter)->get(max_rss), 0));
+        rows.push_back(row);
+    }
+    print_table(std::cout, "Most memory-hungry test cases", headers, rows, 2);
+
+    const std::vector< program_record > programs =
+        summarize_programs(records);
+    headers.clear();
+    rows.clear();
+    headers.push_back("Test program");
+    headers.push_back("Test cases");
+    headers.push_back("Startup (ms)");
+    headers.push_back("Body (ms)");
+    headers.push_back("Startup share");
+    for (std::vector< program_record >::const_iterator iter =
+         programs.begin(); iter != programs.end(); ++iter) {
+        const double total = (*iter).m_startup_time + (*iter).m_body_time;
+        std::vector< std::string > row;
+        row.push_back((*iter).m_program);
+        row.push_back(atf::text::to_string((*iter).m_tcs));
+        row.push_back(format_fixed((*iter).m_startup_time * 1000, 3));
+        row.push_back(format_fixed((*iter).m_body_time * 1000, 3));
+        row.push_back(total == 0 ? "-" : format_fixed(
+            (*iter).m_startup_time / total * 100, 1) + "%");
+        rows.push_back(row);
+    }
+    print_table(std::cout, "Startup versus body time per test program",
+                headers, rows, 1);
+
+    if (!m_previous.empty()) {
+        headers.clear();
+        rows.clear();
+        headers.push_back("Test case");
+        headers.push_back("Metric");
+        headers.push_back("Previous");
+        headers.push_back("Current");
+        headers.push_back("Change");
+        for (std::vector< regression >::const_iterator iter =
+             regressions.begin(); iter != regressions.end(); ++iter) {
+            std::vector< std::string > row;
+            row.push_back((*iter).m_id);
+            row.push_back((*iter).m_metric);
+            row.push_back(format_metric((*iter).m_metric,
+                                        (*iter).m_previous));
+            row.push_back(format_metric((*iter).m_metric,
+                                        (*iter).m_current));
+            row.push_back(format_change(*iter));
+            rows.push_back(row);
+        }
+        print_table(std::cout, "Regressions against " + m_previous, headers,
+                    rows, 2);
+    }
+}
+
+void
+atf_report::print_json(const records_map& records,
+                       const std::vector< regression >& regressions)
+{
+    std::ostream& os = std::cout;
+
+    os << "{\n  \"test_cases\": [";
+    for (records_map::const_iterator iter = records.begin();
+         iter != records.end(); ++iter) {
+        const tc_record& tc = (*iter).second;
+        os << (iter == records.begin() ? "\n" : ",\n")
+           << "    {\"program\": " << json_string(tc.m_program)
+           << ", \"test_case\": " << json_string(tc.m_name)
+           << ", \"result\": " << json_string(tc.m_result)
+           << ", \"metrics\": {";
+        for (metrics_map::const_iterator iter2 = tc.m_metrics.begin();
+             iter2 != tc.m_metrics.end(); ++iter2)
+            os << (iter2 == tc.m_metrics.begin() ? "" : ", ")
+               << json_string((*iter2).first) << ": "
+               << json_number((*iter2).second);
+        os << "}}";
+    }
+    os << "\n  ],\n";
+
+    const char* const lists[][2] = { { "slowest", body_time },
+                                     { "memory_hungry", max_rss } };
+    for (size_t i = 0; i < 2; i++) {
+        const std::vector< const tc_record* > tcs = top(records, lists[i][1],
+                                                        m_count);
+        os << "  \"" << lists[i][0] << "\": [";
+        for (std::vector< const tc_record* >::const_iterator iter =
+             tcs.begin(); iter != tcs.end(); ++iter)
+            os << (iter == tcs.begin() ? "" : ", ")
+               << json_string((*iter)->id());
+        os << "],\n";
+    }
+
+    const std::vector< program_record > programs =
+        summarize_programs(records);
+    os << "  \"programs\": [";
+    for (std::vector< program_record >::const_iterator iter =
+         programs.begin(); iter != programs.end(); ++iter)
+        os << (iter == programs.begin() ? "\n" : ",\n")
+           << "    {\"program\": " << json_string((*iter).m_program)
+           << ", \"test_cases\": " << (*iter).m_tcs
+           << ", \"startup_time\": " << json_number((*iter).m_startup_time)
+           << ", \"body_time\": " << json_number((*iter).m_body_time) << "}";
+    os << "\n  ],\n";
+
+    os << "  \"regressions\": [";
+    for (std::vector< regression >::const_iterator iter =
+         regressions.begin(); iter != regressions.end(); ++iter)
+        os << (iter == regressions.begin() ? "\n" : ",\n")
+           << "    {\"test_case\": " << json_string((*iter).m_id)
+           << ", \"metric\": " << json_string((*iter).m_metric)
+           << ", \"previous\": " << json_number((*iter).m_previous)
+           << ", \"current\": " << json_number((*iter).m_current) << "}";
+    os << "\n  ]\n}\n";
+}
+
+int
+atf_report::main(void)
+{
+    std::vector< std::string > dirs;
+    for (int i = 0; i < m_argc; i++)
+        dirs.push_back(m_argv[i]);
+    if (dirs.empty())
+        dirs.push_back(".");
+
+    records_map records;
+    for (std::vector< std::string >::const_iterator iter = dirs.begin();
+         iter != dirs.end(); ++iter) {
+        const atf::fs::path dir(*iter);
+        if (!atf::fs::exists(dir))
+            throw std::runtime_error("Cannot find directory " + dir.str());
+        scan(dir, "", records);
+    }
+
+    std::vector< regression > regressions;
+    if (!m_previous.empty())
+        regressions = find_regressions(
+            load_report(atf::fs::path(m_previous)), records, m_threshold);
+
+    if (m_jflag)
+        print_json(records, regressions);
+    else
+        print_text(records, regressions);
+
+    return regressions.empty() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int
+main(int argc, char* const* argv)
+{
+    return atf_report().run(argc, argv);
+}
@@ -0,0 +1,227 @@
+# Copyright (c) 2026 The NetBSD Foundation, Inc.
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+# 1. Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+# 2. Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#
+# THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+# CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+# INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+# IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+# DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+# DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+# GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+# INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+# IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+# OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+# IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+: ${ATF_REPORT:="__ATF_REPORT__"}
+
+# Creates the results and metrics files of a test case run by a test
+# program.
+create_tc() {
+    local tc="${1}"; shift
+    local result="${1}"; shift
+
+    mkdir -p "$(dirname "${tc}")"
+    echo "${result}" >"${tc}"
+    for metric in "${@}"; do
+        echo "${metric}"
+    done >"${tc}.metrics"
+}
+
+create_suite() {
+    create_tc run/prog1/fast passed \
+        "atf.startup_time: 0.002 s" "atf.body_time: 0.001 s" \
+        "atf.body_cpu_time: 0.001 s" "atf.max_rss: 1000 KiB"
+    create_tc run/prog1/slow "failed: Oops" \
+        "atf.startup_time: 0.002 s" "atf.body_time: 0.5 s" \
+        "atf.body_cpu_time: 0.25 s" "atf.max_rss: 3000 KiB"
+    create_tc run/dir/prog2/big passed \
+        "atf.startup_time: 0.004 s" "atf.body_time: 0.1 s" \
+        "atf.body_cpu_time: 0.1 s" "atf.max_rss: 90000 KiB" "rows: 5"
+}
+
+atf_test_case text
+text_head()
+{
+    atf_set "descr" "Checks the text report of a suite run"
+}
+text_body()
+{
+    create_suite
+
+    cat >expout <<EOF
+Slowest test cases
+
+Test case      Result  Body (ms)  CPU (ms)  Startup (ms)
+prog1:slow     failed    500.000   250.000         2.000
+dir/prog2:big  passed    100.000   100.000         4.000
+prog1:fast     passed      1.000     1.000         2.000
+
+Most memory-hungry test cases
+
+Test case      Result  Max RSS (KiB)
+dir/prog2:big  passed          90000
+prog1:slow     failed           3000
+prog1:fast     passed           1000
+
+Startup versus body time per test program
+
+Test program  Test cases  Startup (ms)  Body (ms)  Startup share
+dir/prog2              1         4.000    100.000           3.8%
+prog1                  2         4.000    501.000           0.8%
+
+EOF
+    atf_check -s eq:0 -o file:expout "${ATF_REPORT}" run
+}
+
+atf_test_case count
+count_head()
+{
+    atf_set "descr" "Checks that -n limits the listed test cases"
+}
+count_body()
+{
+    create_suite
+
+    atf_check -s eq:0 -o save:stdout "${ATF_REPORT}" -n 1 run
+    atf_check -s eq:0 -o ignore grep '^prog1:slow ' stdout
+    atf_check -s eq:1 -o empty grep '^prog1:fast ' stdout
+
+    atf_check -s eq:1 -o empty -e match:"Invalid count '0'" \
+        "${ATF_REPORT}" -n 0 run
+}
+
+atf_test_case json
+json_head()
+{
+    atf_set "descr" "Checks the machine-readable report of a suite run"
+}
+json_body()
+{
+    create_suite
+
+    atf_check -s eq:0 -o save:report.json "${ATF_REPORT}" -j run
+    atf_check -s eq:0 -o ignore grep -F \
+        '{"program": "dir/prog2", "test_case": "big", "result": "passed", "metrics": {"atf.body_cpu_time": 0.1, "atf.body_time": 0.1, "atf.max_rss": 90000, "atf.startup_time": 0.004, "rows": 5}}' \
+        report.json
+    atf_check -s eq:0 -o ignore grep -F \
+        '"slowest": ["prog1:slow", "dir/prog2:big", "prog1:fast"],' \
+        report.json
+    atf_check -s eq:0 -o ignore grep -F \
+        '"memory_hungry": ["dir/prog2:big", "prog1:slow", "prog1:fast"],' \
+        report.json
+    atf_check -s eq:0 -o ignore grep -F \
+        '{"program": "prog1", "test_cases": 2, "startup_time": 0.004, "body_time": 0.501}' \
+        report.json
+}
+
+atf_test_case regressions
+regressions_head()
+{
+    atf_set "descr" "Checks that regressions against a previous report" \
+                    "are detected"
+}
+regressions_body()
+{
+    create_suite
+    atf_check -s eq:0 -o save:previous.json "${ATF_REPORT}" -j run
+
+    atf_check -s eq:0 -o match:'^\(none\)$' \
+        "${ATF_REPORT}" -p previous.json run
+
+    create_tc run/prog1/slow passed \
+        "atf.startup_time: 0.002 s" "atf.body_time: 0.6 s" \
+        "atf.body_cpu_time: 0.26 s" "atf.max_rss: 3001 KiB"
+    create_tc run/dir/prog2/big passed \
+        "atf.startup_time: 0.0045 s" "atf.body_time: 0.1 s" \
+        "atf.body_cpu_time: 0.1 s" "atf.max_rss: 190000 KiB"
+
+    atf_check -s eq:1 -o save:stdout "${ATF_REPORT}" -p previous.json run
+    atf_check -s eq:0 -o ignore grep \
+        '^prog1:slow *atf.body_time *500.000 ms *600.000 ms *+20.0%$' stdout
+    atf_check -s eq:0 -o ignore grep \
+        '^dir/prog2:big *atf.max_rss *90000 KiB *190000 KiB *+111.1%$' stdout
+    atf_check -s eq:1 -o empty grep 'body_cpu_time' stdout
+    atf_check -s eq:1 -o empty grep 'startup_time' stdout
+
+    atf_check -s eq:0 -o ignore "${ATF_REPORT}" -p previous.json -t 150 run
+}
+
+atf_test_case in_process
+in_process_head()
+{
+    atf_set "descr" "Checks that the metrics of test programs that run" \
+                    "their test cases in-process are attributed to each" \
+                    "test case"
+}
+in_process_body()
+{
+    mkdir run
+    cat >run/prog <<EOF
+a: passed
+b: failed: Oops
+EOF
+    cat >run/prog.metrics <<EOF
+a: atf.body_time: 0.003 s
+b: atf.body_time: 0.002 s
+EOF
+
+    atf_check -s eq:0 -o save:stdout "${ATF_REPORT}" run
+    atf_check -s eq:0 -o ignore grep '^prog:a *passed *3.000' stdout
+    atf_check -s eq:0 -o ignore grep '^prog:b *failed *2.000' stdout
+}
+
+atf_test_case timing
+timing_head()
+{
+    atf_set "descr" "Checks the report of the timing data recorded by a" \
+                    "real test program"
+}
+timing_body()
+{
+    h="$(atf_get_srcdir)/../test-programs/c_helpers"
+
+    mkdir -p run/c_helpers
+    atf_check -s eq:0 -o ignore -e ignore "${h}" -s "$(dirname "${h}")" \
+        -v timing=true -r run/c_helpers/result_pass result_pass
+    atf_check -s eq:0 -o save:report.json "${ATF_REPORT}" -j run
+    for metric in startup_time body_time body_cpu_time max_rss; do
+        atf_check -s eq:0 -o ignore grep "\"atf.${metric}\": " report.json
+    done
+    atf_check -s eq:0 -o ignore grep -F '"result": "passed"' report.json
+}
+
+atf_test_case missing_directory
+missing_directory_head()
+{
+    atf_set "descr" "Checks the error reported for missing directories"
+}
+missing_directory_body()
+{
+    atf_check -s eq:1 -o empty \
+        -e match:'Cannot find directory non-existent' \
+        "${ATF_REPORT}" non-existent
+}
+
+atf_init_test_cases()
+{
+    atf_add_test_case text
+    atf_add_test_case count
+    atf_add_test_case json
+    atf_add_test_case regressions
+    atf_add_test_case in_process
+    atf_add_test_case timing
+    atf_add_test_case missing_directory
+}
+
+# vim: syntax=sh:expandtab:shiftwidth=4:softtabstop=4
@@ -0,0 +1,917 @@
+// Copyright (c) 2026 The NetBSD Foundation, Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+// CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+// INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+// IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+// IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+// IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#if defined(HAVE_CONFIG_H)
+#include "config.h"
+#endif
+
+extern "C" {
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#if defined(HAVE_SYS_INOTIFY_H)
+#include <sys/inotify.h>
+#endif
+
+#include <dirent.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+}
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "atf-c++/detail/application.hpp"
+#include "atf-c++/detail/exceptions.hpp"
+#include "atf-c++/detail/fs.hpp"
+#include "atf-c++/detail/process.hpp"
+#include "atf-c++/detail/sanity.hpp"
+#include "atf-c++/detail/text.hpp"
+
+// ------------------------------------------------------------------------
+// Auxiliary types and functions.
+// ------------------------------------------------------------------------
+
+namespace {
+
+// Time during which changes must stop arriving before the affected test
+// cases are rerun, so that a build that touches many files triggers a
+// single run.
+const int quiet_period_ms = 200;
+
+// Interval between scans of the watched directories when the system cannot
+// notify of changes.
+const int poll_interval_ms = 1000;
+
+volatile sig_atomic_t Interrupted = 0;
+
+void
+interrupt_handler(const int signo)
+{
+    (void)signo;
+    Interrupted = 1;
+}
+
+// Directory in which the test case being run has to execute; see
+// enter_work_dir.
+std::string Work_Dir;
+
+void
+enter_work_dir(void)
+{
+    if (::chdir(Work_Dir.c_str()) == -1) {
+        std::cerr << "Cannot enter work directory " << Work_Dir << ": "
+                  << std::strerror(errno) << "\n";
+        std::exit(EXIT_FAILURE);
+    }
+}
+
+double
+now(void)
+{
+    struct timeval tv;
+    ::gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+bool
+is_directory(const atf::fs::path& p)
+{
+    struct stat sb;
+    return ::stat(p.c_str(), &sb) != -1 && S_ISDIR(sb.st_mode);
+}
+
+//!
+//! \brief Removes a directory and all of its contents.
+//!
+//! Errors are ignored: a test case that leaves behind files that cannot
+//! be removed must not stop the watch.
+//!
+void
+remove_tree(const atf::fs::path& dir)
+{
+    DIR* d = ::opendir(dir.c_str());
+    if (d != NULL) {
+        struct dirent* de;
+        while ((de = ::readdir(d)) != NULL) {
+            const std::string name = de->d_name;
+            if (name == "." || name == "..")
+                continue;
+
+            const atf::fs::path p = dir / name;
+            struct stat sb;
+            if (::lstat(p.c_str(), &sb) != -1 && S_ISDIR(sb.st_mode)) {
+                (void)::chmod(p.c_str(), 0700);
+                remove_tree(p);
+            } else
+                (void)::unlink(p.c_str());
+        }
+        ::closedir(d);
+    }
+    (void)::rmdir(dir.c_str());
+}
+
+//!
+//! \brief Tells whether a changed file is to be ignored.
+//!
+//! Hidden files, which include the object directories of libtool and the
+//! swap files of editors, and backup files change constantly without being
+//! inputs of the test cases.
+//!
+bool
+is_noise(const std::string& name)
+{
+    return name.empty() || name[0] == '.' || name[name.length() - 1] == '~';
+}
+
+struct test_case {
+    std::string m_name;
+    bool m_has_cleanup;
+    // Files the test case reads, as given by its X-atf.inputs property.  If
+    // empty, the test case depends on every file in the source directory.
+    std::set< std::string > m_inputs;
+};
+
+struct test_program {
+    // Name of the test program as derived from the command line.
+    std::string m_name;
+    atf::fs::path m_path;
+    atf::fs::path m_srcdir;
+    std::vector< test_case > m_tcs;
+
+    test_program(const std::string& name, const atf::fs::path& p) :
+        m_name(name),
+        m_path(p),
+        m_srcdir(p.branch_path())
+    {
+    }
+};
+
+// Identifies a test case by the index of its program and its name.
+typedef std::pair< size_t, std::string > tc_id;
+
+// Orders the test cases that failed in their last run before the others.
+class failed_first {
+    const std::map< tc_id, bool >& m_failed;
+
+public:
+    failed_first(const std::map< tc_id, bool >& failed) :
+        m_failed(failed)
+    {
+    }
+
+    bool
+    operator()(const tc_id& id)
+        const
+    {
+        const std::map< tc_id, bool >::const_iterator iter =
+            m_failed.find(id);
+        return iter != m_failed.end() && (*iter).second;
+    }
+};
+
+// ------------------------------------------------------------------------
+// The "change_watcher" class.
+// ------------------------------------------------------------------------
+
+//!
+//! \brief Notifies of the files that change in a set of directories.
+//!
+//! Uses inotify(7) where available.  Otherwise, or if the watches cannot be
+//! set up, the directories are scanned periodically and files are deemed to
+//! have changed when their modification time, status change time, size or
+//! inode number do.  Either way, changes are noticed from the moment a
+//! directory is watched, so those made between two waits are not lost.
+//!
+class change_watcher {
+    typedef std::map< std::string, std::string > snapshot;
+
+    std::set< std::string > m_dirs;
+    int m_fd;
+    std::map< int, std::string > m_wds;
+    std::map< std::string, snapshot > m_snapshots;
+    std::set< std::string > m_pending;
+
+    static
+    snapshot
+    scan(const std::string& dir)
+    {
+        snapshot snap;
+
+        DIR* d = ::opendir(dir.c_str());
+        if (d == NULL)
+            return snap;
+
+        struct dirent* de;
+        while ((de = ::readdir(d)) != NULL) {
+            const std::string name = de->d_name;
+            if (is_noise(name))
+                continue;
+
+            struct stat sb;
+            if (::stat((dir + "/" + name).c_str(), &sb) == -1)
+                continue;
+            snap[name] = atf::text::to_string(sb.st_mtime) + ":" +
+#if defined(HAVE_STRUCT_STAT_ST_MTIM)
+                atf::text::to_string(sb.st_mtim.tv_nsec) + ":" +
+#elif defined(HAVE_STRUCT_STAT_ST_MTIMESPEC)
+                atf::text::to_string(sb.st_mtimespec.tv_nsec) + ":" +
+#endif
+                atf::text::to_string(sb.st_ctime) + ":" +
+                atf::text::to_string(sb.st_size) + ":" +
+                atf::text::to_string(sb.st_ino);
+        }
+        ::closedir(d);
+
+        return snap;
+    }
+
+    bool
+    read_events(std::set< std::string >& changed)
+    {
+        bool got = false;
+
+#if defined(HAVE_SYS_INOTIFY_H)
+        char buffer[4096]
+            __attribute__((aligned(__alignof__(struct inotify_event))));
+        ssize_t len;
+        while ((len = ::read(m_fd, buffer, sizeof(buffer))) > 0) {
+            for (char* ptr = buffer; ptr < buffer + len;
+                 ptr += sizeof(struct inotify_event) +
+                        reinterpret_cast< struct inotify_event* >(ptr)->len) {
+                const struct inotify_event* ev =
+                    reinterpret_cast< struct inotify_event* >(ptr);
+                const std::map< int, std::string >::const_iterator iter =
+                    m_wds.find(ev->wd);
+                if (iter == m_wds.end() || ev->len == 0 ||
+                    is_noise(ev->name))
+                    continue;
+                changed.insert((atf::fs::path((*iter).second) /
+                                ev->name).str());
+                got = true;
+            }
+        }
+#else
+        (void)changed;
+#endif
+
+        return got;
+    }
+
+    bool
+    rescan(std::set< std::string >& changed)
+    {
+        bool got = false;
+
+        for (std::set< std::string >::const_iterator iter = m_dirs.begin();
+             iter != m_dirs.end(); ++iter) {
+            const snapshot snap = scan(*iter);
+            snapshot& old = m_snapshots[*iter];
+
+            for (snapshot::const_iterator iter2 = snap.begin();
+                 iter2 != snap.end(); ++iter2) {
+                const snapshot::const_iterator prev =
+                    old.find((*iter2).first);
+                if (prev == old.end() || (*prev).second != (*iter2).second) {
+                    changed.insert((atf::fs::path(*iter) /
+                                    (*iter2).first).str());
+                    got = true;
+                }
+            }
+            for (snapshot::const_iterator iter2 = old.begin();
+                 iter2 != old.end(); ++iter2) {
+                if (snap.find((*iter2).first) == snap.end()) {
+                    changed.insert((atf::fs::path(*iter) /
+                                    (*iter2).first).str());
+                    got = true;
+                }
+            }
+
+            old = snap;
+        }
+
+        return got;
+    }
+
+    bool
+    collect(const int timeout_ms, std::set< std::string >& changed)
+    {
+        if (m_fd == -1) {
+            ::usleep(timeout_ms * 1000);
+            return rescan(changed);
+        }
+
+        struct pollfd pfd;
+        pfd.fd = m_fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        if (::poll(&pfd, 1, timeout_ms) <= 0)
+            return false;
+        return read_events(changed);
+    }
+
+    // Disallow copies; the notification descriptor is owned by us.
+    change_watcher(const change_watcher&);
+    change_watcher& operator=(const change_watcher&);
+
+    //!
+    //! \brief Switches to scanning the directories periodically.
+    //!
+    //! Keeps the changes that inotify(7) has already queued so that the next
+    //! wait returns them.
+    //!
+    void
+    fall_back_to_scanning(void)
+    {
+        if (m_fd != -1) {
+            (void)read_events(m_pending);
+            ::close(m_fd);
+            m_fd = -1;
+            m_wds.clear();
+        }
+
+        for (std::set< std::string >::const_iterator iter = m_dirs.begin();
+             iter != m_dirs.end(); ++iter) {
+            if (m_snapshots.find(*iter) == m_snapshots.end())
+                m_snapshots[*iter] = scan(*iter);
+        }
+    }
+
+public:
+    change_watcher(void) :
+        m_fd(-1)
+    {
+#if defined(HAVE_SYS_INOTIFY_H)
+        m_fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+    }
+
+    ~change_watcher(void)
+    {
+        if (m_fd != -1)
+            ::close(m_fd);
+    }
+
+    //!
+    //! \brief Starts watching the given directories too.
+    //!
+    //! Directories that are already watched keep their pending changes.
+    //!
+    void
+    add(const std::set< std::string >& dirs)
+    {
+        for (std::set< std::string >::const_iterator iter = dirs.begin();
+             iter != dirs.end(); ++iter) {
+            if (!m_dirs.insert(*iter).second)
+                continue;
+
+#if defined(HAVE_SYS_INOTIFY_H)
+            if (m_fd != -1) {
+                const int wd = ::inotify_add_watch(m_fd, (*iter).c_str(),
+                    IN_ATTRIB | IN_CLOSE_WRITE | IN_CREATE | IN_DELETE |
+                    IN_MOVED_FROM | IN_MOVED_TO);
+                if (wd != -1) {
+                    m_wds[wd] = *iter;
+                    continue;
+                }
+            }
+#endif
+            fall_back_to_scanning();
+        }
+    }
+
+    //!
+    //! \brief Waits for files to change.
+    //!
+    //! Returns once changes stop arriving for the quiet period, or with an
+    //! empty set if interrupted by a signal.
+    //!
+    std::set< std::string >
+    wait(void)
+    {
+        std::set< std::string > changed;
+        changed.swap(m_pending);
+
+        const int interval = m_fd == -1 ? poll_interval_ms : 1000;
+        while (!Interrupted && changed.empty() && !collect(interval, changed))
+            ;
+        while (!Interrupted && collect(quiet_period_ms, changed))
+            ;
+
+        if (Interrupted)
+            changed.clear();
+        return changed;
+    }
+};
+
+} // anonymous namespace
+
+// ------------------------------------------------------------------------
+// The "atf_watch" class.
+// ------------------------------------------------------------------------
+
+namespace {
+
+class atf_watch : public atf::application::app {
+    std::vector< std::string > m_config_args;
+    std::vector< std::string > m_watch_paths;
+    long m_max_runs;
+
+    atf::fs::path m_tmpdir;
+    std::vector< test_program > m_programs;
+    std::map< tc_id, bool > m_failed;
+
+    static const char* m_description;
+
+    std::string specific_args(void) const;
+    options_set specific_options(void) const;
+    void process_option(int, const char*);
+
+    atf::process::status exec(const test_program&,
+                              const std::vector< std::string >&,
+                              const std::string&);
+    bool list(test_program&);
+    void add_programs(const atf::fs::path&);
+    std::set< std::string > watched_dirs(void) const;
+    std::vector< tc_id > affected(const std::set< std::string >&);
+    void run_tc(const tc_id&);
+    void run_tcs(std::vector< tc_id >);
+
+public:
+    atf_watch(void);
+    int main(void);
+};
+
+} // anonymous namespace
+
+const char* atf_watch::m_description =
+    "atf-watch runs the test cases of a set of test programs and reruns "
+    "those affected by changes to the test programs or their inputs.";
+
+atf_watch::atf_watch(void) :
+    app(m_description, "atf-watch(1)"),
+    m_max_runs(-1),
+    m_tmpdir(".")
+{
+}
+
+std::string
+atf_watch::specific_args(void)
+    const
+{
+    return "test_program|directory ...";
+}
+
+atf_watch::options_set
+atf_watch::specific_options(void)
+    const
+{
+    using atf::application::option;
+    options_set opts;
+
+    opts.insert(option('c', "file", "Configuration file passed to the test "
+                "programs"));
+    opts.insert(option('n', "count", "Exit after rerunning test cases this "
+                "many times; 0 runs them once"));
+    opts.insert(option('v', "var=value", "Configuration variable passed to "
+                "the test programs"));
+    opts.insert(option('w', "path", "Additional file or directory whose "
+                "changes rerun every test case"));
+
+    return opts;
+}
+
+void
+atf_watch::process_option(int ch, const char* arg)
+{
+    switch (ch) {
+    case 'c':
+        m_config_args.push_back("-c");
+        m_config_args.push_back(atf::fs::path(arg).to_absolute().str());
+        break;
+
+    case 'n':
+        try {
+            m_max_runs = atf::text::to_type< long >(arg);
+            if (m_max_runs < 0)
+                throw std::runtime_error("Negative count");
+        } catch (const std::runtime_error&) {
+            throw atf::application::usage_error("Invalid count '%s'", arg);
+        }
+        break;
+
+    case 'v':
+        m_config_args.push_back("-v");
+        m_config_args.push_back(arg);
+        break;
+
+    case 'w':
+        m_watch_paths.push_back(atf::fs::path(arg).to_absolute().str());
+        break;
+
+    default:
+        UNREACHABLE;
+    }
+}
+
+//!
+//! \brief Runs a test program in a fresh work directory.
+//!
+//! The output of the test program goes to files in the temporary directory
+//! of the tool, next to the work directory.
+//!
+atf::process::status
+atf_watch::exec(const test_program& tp, const std::vector< std::string >& args,
+                const std::string& output)
+{
+    std::vector< std::string > argv;
+    argv.push_back(tp.m_path.str());
+    argv.insert(argv.end(), args.begin(), args.end());
+
+    Work_Dir = (m_tmpdir / "work").str();
+    return atf::process::exec(tp.m_path, atf::process::argv_array(argv),
+        atf::process::stream_redirect_path(m_tmpdir / (output + ".out")),
+        atf::process::stream_redirect_path(m_tmpdir / (output + ".err")),
+        enter_work_dir);
+}
+
+//!
+//! \brief Loads the test cases of a test program through its -l flag.
+//!
+//! \return False if the test program could not be listed, in which case
+//! its previous test cases are kept.
+//!
+bool
+atf_watch::list(test_program& tp)
+{
+    if (::access(tp.m_path.c_str(), X_OK) == -1)
+        return false;
+
+    std::vector< std::string > args;
+    args.push_back("-l");
+
+    ::mkdir((m_tmpdir / "work").c_str(), 0755);
+    const atf::process::status s = exec(tp, args, "list");
+    remove_tree(m_tmpdir / "work");
+    if (!s.exited() || s.exitstatus() != EXIT_SUCCESS)
+        return false;
+
+    std::ifstream is((m_tmpdir / "list.out").c_str());
+    std::string line;
+    if (!std::getline(is, line) ||
+        line.find("Content-Type: application/X-atf-tp") != 0)
+        return false;
+
+    std::vector< test_case > tcs;
+    while (std::getline(is, line)) {
+        const std::string::size_type pos = line.find(": ");
+        if (pos == std::string::npos)
+            continue;
+        const std::string name = line.substr(0, pos);
+        const std::string value = line.substr(pos + 2);
+
+        if (name == "ident") {
+            test_case tc;
+            tc.m_name = value;
+            tc.m_has_cleanup = false;
+            tcs.push_back(tc);
+        } else if (tcs.empty()) {
+            continue;
+        } else if (name == "has.cleanup") {
+            tcs.back().m_has_cleanup = value == "true";
+        } else if (name == "X-atf.inputs") {
+            const std::vector< std::string > words =
+                atf::text::split(value, " ");
+            for (std::vector< std::string >::const_iterator iter =
+                 words.begin(); iter != words.end(); ++iter) {
+                const atf::fs::path input(*iter);
+                tcs.back().m_inputs.insert(input.is_absolute() ?
+                    input.str() : (tp.m_srcdir / input).str());
+            }
+        }
+    }
+
+    tp.m_tcs = tcs;
+    return true;
+}
+
+//!
+//! \brief Adds the test programs named on the command line.
+//!
+//! A directory stands for the test programs it contains, which are the
+//! executables that answer to -l.
+//!
+void
+atf_watch::add_programs(const atf::fs::path& arg)
+{
+    const atf::fs::path p = arg.to_absolute();
+
+    if (!atf::fs::exists(p))
+        throw std::runtime_error("Cannot find test program " + arg.str());
+
+    if (!is_directory(p)) {
+        test_program tp(arg.str(), p);
+        if (!list(tp))
+            throw std::runtime_error("Cannot list the test cases of " +
+                                     arg.str());
+        m_programs.push_back(tp);
+        return;
+    }
+
+    const atf::fs::directory entries(p);
+    for (atf::fs::directory::const_iterator iter = entries.begin();
+         iter != entries.end(); ++iter) {
+        if (is_noise((*iter).first) ||
+            (*iter).second.get_type() != atf::fs::file_info::reg_type ||
+            !(*iter).second.is_owner_executable())
+            continue;
+
+        test_program tp((arg / (*iter).first).str(), p / (*iter).first);
+        if (list(tp))
+            m_programs.push_back(tp);
+    }
+}
+
+std::set< std::string >
+atf_watch::watched_dirs(void)
+    const
+{
+    std::set< std::string > dirs;
+
+    for (std::vector< test_program >::const_iterator iter =
+         m_programs.begin(); iter != m_programs.end(); ++iter) {
+        dirs.insert((*iter).m_srcdir.str());
+        for (std::vector< test_case >::const_iterator iter2 =
+             (*iter).m_tcs.begin(); iter2 != (*iter).m_tcs.end(); ++iter2) {
+            for (std::set< std::string >::const_iterator iter3 =
+                 (*iter2).m_inputs.begin(); iter3 != (*iter2).m_inputs.end();
+                 ++iter3)
+                dirs.insert(atf::fs::path(*iter3).branch_path().str());
+        }
+    }
+
+    for (std::vector< std::string >::const_iterator iter =
+         m_watch_paths.begin(); iter != m_watch_paths.end(); ++iter) {
+        const atf::fs::path p(*iter);
+        dirs.insert(is_directory(p) ? p.str() : p.branch_path().str());
+    }
+
+    std::set< std::string > existing;
+    for (std::set< std::string >::const_iterator iter = dirs.begin();
+         iter != dirs.end(); ++iter) {
+        if (is_directory(atf::fs::path(*iter)))
+            existing.insert(*iter);
+    }
+    return existing;
+}
+
+//!
+//! \brief Computes the test cases affected by a set of changed files.
+//!
+//! A test program that changed is listed again and all of its test cases
+//! are affected.  A file in the source directory of a test program affects
+//! the test cases that list it in X-atf.inputs and those that do not
+//! declare their inputs.  The paths given to -w affect every test case.
+//!
+std::vector< tc_id >
+atf_watch::affected(const std::set< std::string >& changed)
+{
+    std::set< std::string > programs;
+    for (std::vector< test_program >::const_iterator iter =
+         m_programs.begin(); iter != m_programs.end(); ++iter)
+        programs.insert((*iter).m_path.str());
+
+    bool all = false;
+    for (std::set< std::string >::const_iterator iter = changed.begin();
+         !all && iter != changed.end(); ++iter) {
+        for (std::vector< std::string >::const_iterator iter2 =
+             m_watch_paths.begin(); iter2 != m_watch_paths.end(); ++iter2) {
+            if (*iter == *iter2 || (*iter).find(*iter2 + "/") == 0)
+                all = true;
+        }
+    }
+
+    std::set< tc_id > ids;
+    for (size_t i = 0; i < m_programs.size(); i++) {
+        test_program& tp = m_programs[i];
+
+        const bool rebuilt = changed.find(tp.m_path.str()) != changed.end();
+        if (rebuilt && !list(tp)) {
+            std::cout << tp.m_name << ": cannot list test cases; "
+                "waiting for it to be rebuilt\n";
+            continue;
+        }
+
+        for (std::vector< test_case >::const_iterator iter =
+             tp.m_tcs.begin(); iter != tp.m_tcs.end(); ++iter) {
+            bool affected = all || rebuilt;
+            for (std::set< std::string >::const_iterator iter2 =
+                 changed.begin(); !affected && iter2 != changed.end();
+                 ++iter2) {
+                if ((*iter).m_inputs.empty())
+                    affected = programs.find(*iter2) == programs.end() &&
+                        atf::fs::path(*iter2).branch_path() == tp.m_srcdir;
+                else
+                    affected = (*iter).m_inputs.find(*iter2) !=
+                        (*iter).m_inputs.end();
+            }
+            if (affected)
+                ids.insert(tc_id(i, (*iter).m_name));
+        }
+    }
+
+    return std::vector< tc_id >(ids.begin(), ids.end());
+}
+
+void
+atf_watch::run_tc(const tc_id& id)
+{
+    const test_program& tp = m_programs[id.first];
+    const std::string ident = tp.m_name + ":" + id.second;
+
+    const test_case* tc = NULL;
+    for (std::vector< test_case >::const_iterator iter = tp.m_tcs.begin();
+         iter != tp.m_tcs.end(); ++iter) {
+        if ((*iter).m_name == id.second)
+            tc = &(*iter);
+    }
+    INV(tc != NULL);
+
+    const atf::fs::path resfile = m_tmpdir / "result";
+    (void)::unlink(resfile.c_str());
+    remove_tree(m_tmpdir / "work");
+    if (::mkdir((m_tmpdir / "work").c_str(), 0755) == -1)
+        throw atf::system_error("atf_watch::run_tc",
+                                "Cannot create work directory", errno);
+
+    std::vector< std::string > args;
+    args.push_back("-s");
+    args.push_back(tp.m_srcdir.str());
+    args.insert(args.end(), m_config_args.begin(), m_config_args.end());
+    args.push_back("-r");
+    args.push_back(resfile.str());
+    args.push_back(id.second);
+
+    const double start = now();
+    const atf::process::status s = exec(tp, args, "body");
+    const double elapsed = now() - start;
+
+    if (tc->m_has_cleanup) {
+        args.pop_back();
+        args.pop_back();
+        args.pop_back();
+        args.push_back(id.second + ":cleanup");
+        (void)exec(tp, args, "cleanup");
+    }
+    remove_tree(m_tmpdir / "work");
+
+    std::string result;
+    {
+        std::ifstream is(resfile.c_str());
+        if (!std::getline(is, result))
+            result = s.signaled() ?
+                "broken: Received signal " +
+                    atf::text::to_string(s.termsig()) :
+                "broken: Test case did not write a result";
+    }
+
+    const std::string type = result.substr(0, result.find_first_of(":("));
+    m_failed[id] = type == "failed" || type == "broken";
+
+    char time[32];
+    std::snprintf(time, sizeof(time), "%.3fs", elapsed);
+    std::cout << ident << "  ->  " << result << "  [" << time << "]"
+              << std::endl;
+}
+
+//!
+//! \brief Runs a set of test cases, those that failed last time first.
+//!
+void
+atf_watch::run_tcs(std::vector< tc_id > ids)
+{
+    std::stable_partition(ids.begin(), ids.end(), failed_first(m_failed));
+
+    size_t passed = 0, failed = 0;
+    for (std::vector< tc_id >::const_iterator iter = ids.begin();
+         !Interrupted && iter != ids.end(); ++iter) {
+        run_tc(*iter);
+        if (m_failed[*iter])
+            failed++;
+        else
+            passed++;
+    }
+
+    std::cout << "===> " << passed + failed << " test cases run: " << passed
+              << " succeeded, " << failed << " failed" << std::endl;
+}
+
+int
+atf_watch::main(void)
+{
+    if (m_argc < 1)
+        throw atf::application::usage_error("No test programs provided");
+
+    struct sigaction sa;
+    std::memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = interrupt_handler;
+    ::sigemptyset(&sa.sa_mask);
+    ::sigaction(SIGHUP, &sa, NULL);
+    ::sigaction(SIGINT, &sa, NULL);
+    ::sigaction(SIGTERM, &sa, NULL);
+
+    const char* tmpdir = std::getenv("TMPDIR");
+    std::string tmpl = std::string(tmpdir == NULL ? "/tmp" : tmpdir) +
+        "/atf-watch.XXXXXX";
+    if (::mkdtemp(&tmpl[0]) == NULL)
+        throw atf::system_error("atf_watch::main", "Cannot create temporary "
+                                "directory " + tmpl, errno);
+    m_tmpdir = atf::fs::path(tmpl);
+
+    int ret = EXIT_SUCCESS;
+    try {
+        for (int i = 0; i < m_argc; i++)
+            add_programs(atf::fs::path(m_argv[i]));
+
+        std::vector< tc_id > ids;
+        for (size_t i = 0; i < m_programs.size(); i++) {
+            for (std::vector< test_case >::const_iterator iter =
+                 m_programs[i].m_tcs.begin();
+                 iter != m_programs[i].m_tcs.end(); ++iter)
+                ids.push_back(tc_id(i, (*iter).m_name));
+        }
+        // Watch before running anything so that the changes made while the
+        // test cases run trigger the next run.
+        change_watcher watcher;
+        watcher.add(watched_dirs());
+        run_tcs(ids);
+
+        for (long runs = 0; !Interrupted &&
+             (m_max_runs == -1 || runs < m_max_runs);) {
+            // Relisting a test program may have declared new inputs.
+            watcher.add(watched_dirs());
+            std::cout << "===> Watching for changes" << std::endl;
+
+            const std::set< std::string > changed = watcher.wait();
+            if (changed.empty())
+                continue;
+
+            ids = affected(changed);
+            if (!ids.empty()) {
+                run_tcs(ids);
+                runs++;
+            }
+        }
+
+        for (std::map< tc_id, bool >::const_iterator iter =
+             m_failed.begin(); iter != m_failed.end(); ++iter) {
+            if ((*iter).second)
+                ret = EXIT_FAILURE;
+        }
+    } catch (...) {
+        remove_tree(m_tmpdir);
+        throw;
+    }
+    remove_tree(m_tmpdir);
+
+    return ret;
+}
+
+int
+main(int argc, char* const* argv)
+{
+    return atf_watch().run(argc, argv);
+}
@@ -0,0 +1,243 @@
+# Copyright (c) 2026 The NetBSD Foundation, Inc.
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+# 1. Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+# 2. Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#
+# THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+# CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+# INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+# IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+# DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+# DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+# GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+# INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+# IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+# OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+# IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+: ${ATF_WATCH:="__ATF_WATCH__"}
+
+# Creates a test program whose test cases a and b check the contents of the
+# a.txt and b.txt data files, and whose test case c declares no inputs and
+# fails if c.txt exists.
+create_prog() {
+    mkdir -p src
+    cat >src/prog <<EOF
+#! __ATF_SH__
+
+atf_test_case a
+a_head() { atf_set X-atf.inputs "a.txt"; }
+a_body() { grep ok "\$(atf_get_srcdir)/a.txt" || atf_fail "a.txt is bad"; }
+
+atf_test_case b
+b_head() { atf_set X-atf.inputs "b.txt"; }
+b_body() { grep ok "\$(atf_get_srcdir)/b.txt" || atf_fail "b.txt is bad"; }
+
+atf_test_case c
+c_body() { test ! -f "\$(atf_get_srcdir)/c.txt" || atf_fail "c.txt exists"; }
+
+atf_init_test_cases() {
+    atf_add_test_case a
+    atf_add_test_case b
+    atf_add_test_case c
+}
+EOF
+    chmod +x src/prog
+    echo ok >src/a.txt
+    echo ok >src/b.txt
+}
+
+# Waits until the output of the tool started in the background has the
+# given number of lines matching a pattern, killing the tool if it takes
+# too long.
+wait_for_output() {
+    local n=0
+    while [ $(grep -c "${1}" out) -lt ${2:-1} ]; do
+        if [ ${n} -ge 600 ]; then
+            kill ${!}
+            cat out
+            atf_fail "atf-watch did not print '${1}' in time"
+        fi
+        sleep 0.1
+        n=$((${n} + 1))
+    done
+}
+
+# Waits until the test cases run by the tool started in the background
+# create the given file, killing the tool if they take too long.
+wait_for_file() {
+    local n=0
+    while [ ! -f "${1}" ]; do
+        if [ ${n} -ge 600 ]; then
+            kill ${!}
+            atf_fail "The test cases did not create ${1} in time"
+        fi
+        sleep 0.1
+        n=$((${n} + 1))
+    done
+}
+
+# Waits until the tool started in the background is watching for changes.
+wait_for_watch() {
+    wait_for_output '^===> Watching for changes'
+}
+
+# Prints the results of the second run of test cases.
+second_run() {
+    sed -n -e '/^===> Watching/,$p' out | grep ' -> '
+}
+
+atf_test_case once
+once_head()
+{
+    atf_set "descr" "Checks that -n 0 runs the test cases once"
+}
+once_body()
+{
+    create_prog
+
+    atf_check -s eq:0 -o save:stdout -e empty "${ATF_WATCH}" -n 0 src/prog
+    atf_check -s eq:0 -o ignore grep '^src/prog:a  ->  passed  \[' stdout
+    atf_check -s eq:0 -o ignore grep '^src/prog:b  ->  passed  \[' stdout
+    atf_check -s eq:0 -o ignore grep '^src/prog:c  ->  passed  \[' stdout
+    atf_check -s eq:0 -o ignore \
+        grep '^===> 3 test cases run: 3 succeeded, 0 failed$' stdout
+    atf_check -s eq:1 -o empty grep 'Watching' stdout
+
+    echo bad >src/b.txt
+    atf_check -s eq:1 -o save:stdout -e empty "${ATF_WATCH}" -n 0 src
+    atf_check -s eq:0 -o ignore grep '^src/prog:b  ->  failed: b.txt is bad' \
+        stdout
+}
+
+atf_test_case inputs
+inputs_head()
+{
+    atf_set "descr" "Checks that a change to a data file only reruns the" \
+                    "test cases that depend on it"
+}
+inputs_body()
+{
+    create_prog
+
+    "${ATF_WATCH}" -n 1 src/prog >out 2>&1 &
+    wait_for_watch
+    echo bad >src/a.txt
+    wait_for_output '^===> [0-9]* test cases run' 2
+    wait $! && atf_fail "atf-watch did not report the failure"
+
+    cat out
+    second_run >second
+    atf_check -s eq:0 -o ignore grep '^src/prog:a  ->  failed: a.txt is bad' \
+        second
+    atf_check -s eq:0 -o ignore grep '^src/prog:c  ->  passed' second
+    atf_check -s eq:1 -o empty grep '^src/prog:b' second
+    atf_check -s eq:0 -o ignore \
+        grep '^===> 2 test cases run: 1 succeeded, 1 failed$' out
+}
+
+atf_test_case during_run
+during_run_head()
+{
+    atf_set "descr" "Checks that a change made while the test cases run" \
+                    "triggers another run"
+}
+during_run_body()
+{
+    create_prog
+    sed -e 's,^\(a_body.*\); },\1; touch "$(atf_get_srcdir)/../running"; \
+while [ ! -f "$(atf_get_srcdir)/../edited" ]; do sleep 0.1; done; },' \
+        src/prog >src/prog.new
+    chmod +x src/prog.new
+    mv src/prog.new src/prog
+
+    "${ATF_WATCH}" -n 1 src/prog >out 2>&1 &
+    wait_for_file running
+    echo bad >src/a.txt
+    touch edited
+    wait_for_output '^===> [0-9]* test cases run' 2
+    wait $! && atf_fail "atf-watch did not report the failure"
+
+    cat out
+    second_run >second
+    atf_check -s eq:0 -o ignore grep '^src/prog:a  ->  failed: a.txt is bad' \
+        second
+}
+
+atf_test_case failed_first
+failed_first_head()
+{
+    atf_set "descr" "Checks that the test cases that failed are rerun first"
+}
+failed_first_body()
+{
+    create_prog
+    touch src/c.txt
+
+    "${ATF_WATCH}" -n 1 src/prog >out 2>&1 &
+    wait_for_watch
+    touch src/prog
+    wait_for_output '^===> [0-9]* test cases run' 2
+    wait $!
+
+    cat out
+    second_run >second
+    atf_check -s eq:0 -o match:'^src/prog:c  ->  failed: c.txt exists' head -n 1 second
+    atf_check -s eq:0 -o match:'^3$' sh -c 'wc -l <second | tr -d " "'
+}
+
+atf_test_case watch_path
+watch_path_head()
+{
+    atf_set "descr" "Checks that a change to a path given with -w reruns" \
+                    "every test case"
+}
+watch_path_body()
+{
+    create_prog
+    mkdir lib
+
+    "${ATF_WATCH}" -n 1 -w lib src/prog >out 2>&1 &
+    wait_for_watch
+    echo changed >lib/file
+    wait_for_output '^===> [0-9]* test cases run' 2
+    wait $!
+
+    cat out
+    second_run >second
+    atf_check -s eq:0 -o match:'^3$' sh -c 'wc -l <second | tr -d " "'
+}
+
+atf_test_case missing_program
+missing_program_head()
+{
+    atf_set "descr" "Checks the error reported for missing test programs"
+}
+missing_program_body()
+{
+    atf_check -s eq:1 -o empty \
+        -e match:'Cannot find test program non-existent' \
+        "${ATF_WATCH}" -n 0 non-existent
+    atf_check -s eq:1 -o empty -e match:'No test programs provided' \
+        "${ATF_WATCH}"
+}
+
+atf_init_test_cases()
+{
+    atf_add_test_case once
+    atf_add_test_case inputs
+    atf_add_test_case during_run
+    atf_add_test_case failed_first
+    atf_add_test_case watch_path
+    atf_add_test_case missing_program
+}
+
+# vim: syntax=sh:expandtab:shiftwidth=4:softtabstop=4